@@ -7,239 +7,2469 @@
 
 #include "parser.h"
 #include "lexer.h"
+#include "const_eval.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
-bool generate_asm(FILE* fp, node_root_t* root) {
-    assert(root && root->functions && fp);
+static void ga_profile_runtime(ga_data_t* data);
+static void ga_instrument_runtime(ga_data_t* data);
+static void ga_start(ga_data_t* data);
+static void ga_label_statement(ga_data_t* data, node_stat_t* stat);
 
+bool generate_mir(mir_t* mir, node_root_t* root, ga_options_t* options) {
+    assert(root && root->functions && mir);
+
+    ga_options_t tuned;
+    memset(&tuned, 0, sizeof(ga_options_t));
+    if(options) tuned = *options;
+    // without a core to tune for, tune for all of them
+    if(!tuned.tune) tuned.tune = tune_lookup(TUNE_DEFAULT);
     ga_data_t data;
-    data.fp = fp;
-    data.label_index = 0;
+    memset(&data, 0, sizeof(ga_data_t));
+    data.options = &tuned;
+    mir_init(mir, data.options->target == GA_TARGET_X86_64);
+    mir->debug_info = data.options->debug_info;
+    data.mir = mir;
+    data.text_section = MIR_SECTION_TEXT;
 
     // Need to traverse as a tree
     node_t* curr = root->functions;
-    while(curr) {
-        if(!ga_function(&data, (node_func_t*)curr)) return false;
+    bool success = true;
+    while(curr && success) {
+        success = ga_function(&data, (node_func_t*)curr);
         curr = curr->next;
-        // switch(curr->type) {
-        // case NODE_FUNCTION:
-        //     node_func_t* func = (node_func_t*)curr;
-        //     fprintf(fp, ".globl %s\n%s:\n", func->function_name->name, func->function_name->name);
-        //     curr = (node_t*)func->stat;
-        //     continue;
-        // case NODE_STATEMENT:
-        //     node_stat_t* stat = (node_stat_t*)curr;
-        //     fprintf(fp, "\tmovl $%u, %%eax\n\tret\n", stat->exp->literal_value);
-        //     break;
-        // default:
-        //     break;
-        // }
-        // curr = curr->next;
+    }
+    free(data.colds);
+    free(data.intervals);
+    free(data.live);
+
+    if(data.options->profile_generate) ga_profile_runtime(&data);
+    if(data.options->instrument != GA_INSTRUMENT_NONE) ga_instrument_runtime(&data);
+    free(data.instrumented);
+    if(data.options->start) ga_start(&data);
+    // nothing here needs an executable stack
+    mir_emit_section(mir, MIR_SECTION_NOTE_GNU_STACK);
+
+    if(success && data.options->peephole) {
+        ph_optimize(mir, data.options->optimize_size, data.options->peephole);
+        // blocks that came together give the rules new windows
+        if(data.options->cfg && cfg_optimize(mir, data.options->optimize_size, data.options->cfg))
+            ph_optimize(mir, data.options->optimize_size, data.options->peephole);
+    }
+    mir_compact(mir);
+    mir_split_blocks(mir);
+    return success;
+}
+
+#define GA_IS_64(_data) ((_data)->options->target == GA_TARGET_X86_64)
+
+// 32 bit parameters and spilled temporaries are addressed off ebp, so only functions
+// with some get a frame. 64 bit functions always have one, it keeps calls aligned.
+#define GA_HAS_FRAME(_data, _func) (GA_IS_64(_data) || (_func)->param_count > 0 || (_data)->spill_slots > 0)
+#define GA_PARAM_OFFSET(_index) (8 + 4 * (int)(_index))
+
+// operands used all over, eax holds every value
+#define GA_EAX mir_reg(MIR_AX, 4)
+#define GA_ECX mir_reg(MIR_CX, 4)
+#define GA_EDX mir_reg(MIR_DX, 4)
+#define GA_AL mir_reg(MIR_AX, 1)
+// the stack pointer and anything pushed are as wide as an address
+#define GA_WORD(_data) (GA_IS_64(_data) ? 8 : 4)
+#define GA_SP(_data) mir_reg(MIR_SP, GA_WORD(_data))
+
+static mir_operand_t ga_local(const char* prefix, size_t number) {
+    return mir_target(mir_label(prefix, number));
+}
+
+static void ga_label(ga_data_t* data, const char* prefix, size_t number) {
+    mir_emit_label(data->mir, mir_label(prefix, number));
+}
+
+static void ga_jmp(ga_data_t* data, const char* prefix, size_t number) {
+    mir_emit(data->mir, MIR_JMP, 1, ga_local(prefix, number));
+}
+
+static void ga_jcc(ga_data_t* data, mir_cc cc, const char* prefix, size_t number) {
+    mir_emit_cc(data->mir, MIR_JCC, cc, ga_local(prefix, number));
+}
+
+// registers temporaries can be allocated to
+#define GA_REGS(X) \
+    X(ECX, MIR_CX) \
+    X(EDX, MIR_DX) \
+    X(EBX, MIR_BX) \
+    X(ESI, MIR_SI) \
+    X(EDI, MIR_DI) \
+    X(R8D, MIR_R8) \
+    X(R9D, MIR_R9) \
+    X(R10D, MIR_R10) \
+    X(R11D, MIR_R11) \
+    X(R12D, MIR_R12) \
+    X(R13D, MIR_R13) \
+    X(R14D, MIR_R14) \
+    X(R15D, MIR_R15)
+
+#define GA_REG_ENUM(_name, _reg) GA_REG_##_name,
+typedef enum ga_reg_e {
+    GA_REGS(GA_REG_ENUM)
+    GA_REG_COUNT
+} ga_reg;
+#undef GA_REG_ENUM
+
+#define GA_REG_MIR(_name, _reg) _reg,
+static const mir_register ga_regs[GA_REG_COUNT] = { GA_REGS(GA_REG_MIR) };
+#undef GA_REG_MIR
+
+// registers a call may overwrite, ecx also serves as scratch for division and
+// profiling, edx for division and switch dispatch
+#define GA_CALLER_SAVED32 (RA_BIT(GA_REG_ECX) | RA_BIT(GA_REG_EDX))
+#define GA_CALLER_SAVED64 (RA_BIT(GA_REG_ECX) | RA_BIT(GA_REG_EDX) | RA_BIT(GA_REG_ESI) | RA_BIT(GA_REG_EDI) | RA_BIT(GA_REG_R8D) | \
+    RA_BIT(GA_REG_R9D) | RA_BIT(GA_REG_R10D) | RA_BIT(GA_REG_R11D))
+#define GA_CALLER_SAVED(_data) (GA_IS_64(_data) ? GA_CALLER_SAVED64 : GA_CALLER_SAVED32)
+// cdq and idiv take the dividend in edx:eax, the divisor waits in ecx
+#define GA_DIVISION_CLOBBERS (RA_BIT(GA_REG_ECX) | RA_BIT(GA_REG_EDX))
+
+// caller saved registers come first, they cost nothing to use in a value that
+// does not live through a call or a division. r10d and r11d never carry arguments.
+static const int ga_pool32[] = { GA_REG_ECX, GA_REG_EDX, GA_REG_EBX, GA_REG_ESI, GA_REG_EDI };
+static const int ga_pool64[] = {
+    GA_REG_R10D, GA_REG_R11D, GA_REG_R8D, GA_REG_R9D, GA_REG_ESI, GA_REG_EDI, GA_REG_EDX, GA_REG_ECX,
+    GA_REG_EBX, GA_REG_R12D, GA_REG_R13D, GA_REG_R14D, GA_REG_R15D
+};
+
+#define GA_REG_ARGS 6
+static const mir_register ga_arg_regs[GA_REG_ARGS] = { MIR_DI, MIR_SI, MIR_DX, MIR_CX, MIR_R8, MIR_R9 };
+
+// 64 bit register parameters are spilled below the frame pointer, the rest stay
+// where the caller put them
+static int ga_param_offset(ga_data_t* data, size_t index) {
+    if(!GA_IS_64(data)) return GA_PARAM_OFFSET(index);
+    if(index < GA_REG_ARGS) return -8 * (int)(index + 1);
+    return 16 + 8 * (int)(index - GA_REG_ARGS);
+}
+
+static mir_operand_t ga_param(ga_data_t* data, size_t index) {
+    return mir_mem(MIR_BP, ga_param_offset(data, index), 4);
+}
+
+// TEMPORARIES, the left operand of a binary operator is kept in a register
+// while the right one is evaluated into eax. The measuring pass records when
+// each one is written, read and which registers are overwritten meanwhile.
+
+// spill slots sit below the 64 bit register parameters
+static int ga_spill_offset(ga_data_t* data, size_t slot) {
+    if(!GA_IS_64(data)) return -4 * (int)(slot + 1);
+    size_t reg_params = data->curr_func->param_count < GA_REG_ARGS ? data->curr_func->param_count : GA_REG_ARGS;
+    return -8 * (int)reg_params - 4 * (int)(slot + 1);
+}
+
+static mir_operand_t ga_operand(ga_data_t* data, ra_interval_t* interval) {
+    if(interval->reg == RA_SPILLED) return mir_mem(MIR_BP, ga_spill_offset(data, interval->slot), 4);
+    return mir_reg(ga_regs[interval->reg], 4);
+}
+
+static uint32_t ga_reg_bit(mir_register reg) {
+    for(size_t i = 0; i < GA_REG_COUNT; ++i) {
+        if(ga_regs[i] == reg) return RA_BIT(i);
+    }
+    return 0;
+}
+
+// registers about to be overwritten cannot hold a live temporary
+static void ga_clobber(ga_data_t* data, uint32_t regs) {
+    if(!data->measuring) return;
+    for(size_t i = 0; i < data->depth; ++i)
+        data->intervals[data->live[i]].clobbers |= regs;
+}
+
+static void ga_push(ga_data_t* data) {
+    if(data->depth == data->live_capacity) {
+        data->live_capacity = data->live_capacity ? data->live_capacity * 2 : 16;
+        data->live = (size_t*)realloc(data->live, data->live_capacity * sizeof(size_t));
+    }
+
+    if(data->measuring) {
+        if(data->interval_count == data->interval_capacity) {
+            data->interval_capacity = data->interval_capacity ? data->interval_capacity * 2 : 64;
+            data->intervals = (ra_interval_t*)realloc(data->intervals, data->interval_capacity * sizeof(ra_interval_t));
+        }
+        ra_interval_t* interval = &data->intervals[data->interval_count];
+        memset(interval, 0, sizeof(ra_interval_t));
+        interval->start = data->position++;
+        data->live[data->depth++] = data->interval_count++;
+        return;
+    }
+
+    assert(data->next_interval < data->interval_count);
+    data->live[data->depth++] = data->next_interval;
+    mir_emit(data->mir, MIR_MOV, 2, GA_EAX, ga_operand(data, &data->intervals[data->next_interval++]));
+}
+
+// the innermost temporary, which is dead afterwards
+static mir_operand_t ga_pop(ga_data_t* data) {
+    assert(data->depth);
+    ra_interval_t* interval = &data->intervals[data->live[--data->depth]];
+    if(data->measuring) {
+        interval->end = data->position++;
+        return GA_ECX;
+    }
+    return ga_operand(data, interval);
+}
+
+static void ga_pop_to(ga_data_t* data, mir_register reg) {
+    ga_clobber(data, ga_reg_bit(reg));
+    mir_operand_t operand = ga_pop(data);
+    if(operand.kind != MIR_OPERAND_REG || operand.reg != reg) mir_emit(data->mir, MIR_MOV, 2, operand, mir_reg(reg, 4));
+}
+
+// PROFILING
+
+#define GA_PROFILING(_data) ((_data)->options->profile_generate)
+#define GA_PROFILE_MAIN(_data) (GA_PROFILING(_data) && strcmp((_data)->curr_func->function_name, "main") == 0)
+#define GA_COUNTER_OFFSET(_probe, _slot) (16 * ((_probe) - 1) + 8 * (_slot))
+
+static mir_operand_t ga_counter(ga_data_t* data, size_t offset) {
+    if(GA_IS_64(data)) return mir_mem_label(mir_symbol(".pcounters"), MIR_RIP, offset, 8);
+    return mir_mem_label(mir_symbol(".pcounters"), MIR_NO_REG, offset, 4);
+}
+
+// 32 bit counters are added a half at a time with the carry
+static void ga_add_counter(ga_data_t* data, mir_operand_t value, size_t offset) {
+    mir_emit(data->mir, MIR_ADD, 2, value, ga_counter(data, offset));
+    if(!GA_IS_64(data)) mir_emit(data->mir, MIR_ADC, 2, mir_imm(0), ga_counter(data, offset + 4));
+}
+
+static void ga_count(ga_data_t* data, size_t probe) {
+    if(!GA_PROFILING(data) || !probe) return;
+    ga_add_counter(data, mir_imm(1), GA_COUNTER_OFFSET(probe, 0));
+}
+
+// count an && or || operand held in eax, and whether it was true, without a branch
+static void ga_count_operand(ga_data_t* data, size_t probe) {
+    if(!GA_PROFILING(data) || !probe) return;
+    ga_count(data, probe);
+    ga_clobber(data, RA_BIT(GA_REG_ECX));
+    mir_emit(data->mir, MIR_CMP, 2, mir_imm(0), GA_EAX);
+    mir_emit_cc(data->mir, MIR_SETCC, MIR_CC_NE, mir_reg(MIR_CX, 1));
+    mir_emit(data->mir, MIR_MOVZB, 2, mir_reg(MIR_CX, 1), GA_ECX);
+    ga_add_counter(data, mir_reg(MIR_CX, GA_WORD(data)), GA_COUNTER_OFFSET(probe, 1));
+}
+
+static bool ga_true_percent(ga_data_t* data, size_t probe, int* percent) {
+    return data->options->profile && profile_true_percent(data->options->profile, probe, percent);
+}
+
+static uint64_t ga_probe_count(ga_data_t* data, size_t probe) {
+    uint64_t count = 0, unused;
+    if(data->options->profile) profile_counts(data->options->profile, probe, &count, &unused);
+    return count;
+}
+
+static size_t ga_cold(ga_data_t* data, int value, size_t resume) {
+    if(data->cold_count == data->cold_capacity) {
+        data->cold_capacity = data->cold_capacity ? data->cold_capacity * 2 : 16;
+        data->colds = (ga_cold_t*)realloc(data->colds, data->cold_capacity * sizeof(ga_cold_t));
+    }
+    ga_cold_t* cold = &data->colds[data->cold_count++];
+    cold->label = data->label_index++;
+    cold->value = value;
+    cold->resume = resume;
+    return cold->label;
+}
+
+// immediates holding an address subtract nothing from it
+#define GA_NO_LABEL mir_symbol(NULL)
+
+// i386 system calls through int $0x80, pushal keeps every register
+static void ga_profile_dump32(mir_t* mir, profile_t* profile, size_t header_size, size_t counters_size) {
+    mir_operand_t eax = mir_reg(MIR_AX, 4), ebx = mir_reg(MIR_BX, 4), ecx = mir_reg(MIR_CX, 4);
+    mir_operand_t edx = mir_reg(MIR_DX, 4), esi = mir_reg(MIR_SI, 4), edi = mir_reg(MIR_DI, 4);
+    mir_emit_label(mir, mir_symbol(".pdump"));
+    mir_emit(mir, MIR_PUSHA, 0);
+    // open(path, O_RDONLY) and read the old profile
+    mir_emit(mir, MIR_MOV, 2, mir_imm(5), eax);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".ppath"), GA_NO_LABEL), ebx);
+    mir_emit(mir, MIR_XOR, 2, ecx, ecx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_TEST, 2, eax, eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_S, mir_target(mir_symbol(".pwrite")));
+    mir_emit(mir, MIR_MOV, 2, eax, esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(3), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".pscratch"), GA_NO_LABEL), ecx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(header_size + counters_size), edx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_MOV, 2, eax, edi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(6), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_CMP, 2, mir_imm(header_size + counters_size), edi);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".pwrite")));
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".pscratch"), GA_NO_LABEL), esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".pheader"), GA_NO_LABEL), edi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(header_size), ecx);
+    mir_emit(mir, MIR_CLD, 0);
+    mir_emit(mir, MIR_REPE_CMPSB, 0);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".pwrite")));
+    // esi now points at the old counters
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".pcounters"), GA_NO_LABEL), edi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(2 * profile->probe_count), ecx);
+    mir_emit_label(mir, mir_symbol(".pmerge"));
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SI, 0, 4), eax);
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SI, 4, 4), edx);
+    mir_emit(mir, MIR_ADD, 2, eax, mir_mem(MIR_DI, 0, 4));
+    mir_emit(mir, MIR_ADC, 2, edx, mir_mem(MIR_DI, 4, 4));
+    mir_emit(mir, MIR_ADD, 2, mir_imm(8), esi);
+    mir_emit(mir, MIR_ADD, 2, mir_imm(8), edi);
+    mir_emit(mir, MIR_DEC, 1, ecx);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".pmerge")));
+    // open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) and write the header then the counters
+    mir_emit_label(mir, mir_symbol(".pwrite"));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(5), eax);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".ppath"), GA_NO_LABEL), ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0x241), ecx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0644), edx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_TEST, 2, eax, eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_S, mir_target(mir_symbol(".pdone")));
+    mir_emit(mir, MIR_MOV, 2, eax, esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(4), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".pheader"), GA_NO_LABEL), ecx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(header_size), edx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(4), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".pcounters"), GA_NO_LABEL), ecx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(counters_size), edx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(6), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit_label(mir, mir_symbol(".pdone"));
+    mir_emit(mir, MIR_POPA, 0);
+    mir_emit(mir, MIR_RET, 0);
+}
+
+// x86-64 system calls, only eax of the caller's registers needs keeping
+static void ga_profile_dump64(mir_t* mir, profile_t* profile, size_t header_size, size_t counters_size) {
+    mir_operand_t eax = mir_reg(MIR_AX, 4), ecx = mir_reg(MIR_CX, 4), edx = mir_reg(MIR_DX, 4), esi = mir_reg(MIR_SI, 4);
+    mir_operand_t rax = mir_reg(MIR_AX, 8), rsi = mir_reg(MIR_SI, 8), rdi = mir_reg(MIR_DI, 8);
+    mir_operand_t r8 = mir_reg(MIR_R8, 8), r9 = mir_reg(MIR_R9, 8);
+    mir_emit_label(mir, mir_symbol(".pdump"));
+    mir_emit(mir, MIR_PUSH, 1, rax);
+    // open(path, O_RDONLY) and read the old profile
+    mir_emit(mir, MIR_MOV, 2, mir_imm(2), eax);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".ppath"), MIR_RIP, 0, 8), rdi);
+    mir_emit(mir, MIR_XOR, 2, esi, esi);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_TEST, 2, rax, rax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_S, mir_target(mir_symbol(".pwrite")));
+    mir_emit(mir, MIR_MOV, 2, rax, r8);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".pscratch"), MIR_RIP, 0, 8), rsi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(header_size + counters_size), edx);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_MOV, 2, rax, r9);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(3), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_CMP, 2, mir_imm(header_size + counters_size), r9);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".pwrite")));
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".pscratch"), MIR_RIP, 0, 8), rsi);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".pheader"), MIR_RIP, 0, 8), rdi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(header_size), ecx);
+    mir_emit(mir, MIR_CLD, 0);
+    mir_emit(mir, MIR_REPE_CMPSB, 0);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".pwrite")));
+    // rsi now points at the old counters
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".pcounters"), MIR_RIP, 0, 8), rdi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(2 * profile->probe_count), ecx);
+    mir_emit_label(mir, mir_symbol(".pmerge"));
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SI, 0, 8), rax);
+    mir_emit(mir, MIR_ADD, 2, rax, mir_mem(MIR_DI, 0, 8));
+    mir_emit(mir, MIR_ADD, 2, mir_imm(8), rsi);
+    mir_emit(mir, MIR_ADD, 2, mir_imm(8), rdi);
+    mir_emit(mir, MIR_DEC, 1, ecx);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".pmerge")));
+    // open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) and write the header then the counters
+    mir_emit_label(mir, mir_symbol(".pwrite"));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(2), eax);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".ppath"), MIR_RIP, 0, 8), rdi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0x241), esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0644), edx);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_TEST, 2, rax, rax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_S, mir_target(mir_symbol(".pdone")));
+    mir_emit(mir, MIR_MOV, 2, rax, r8);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(1), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".pheader"), MIR_RIP, 0, 8), rsi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(header_size), edx);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(1), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".pcounters"), MIR_RIP, 0, 8), rsi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(counters_size), edx);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(3), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit_label(mir, mir_symbol(".pdone"));
+    mir_emit(mir, MIR_POP, 1, rax);
+    mir_emit(mir, MIR_RET, 0);
+}
+
+// The counters live in .bss, main calls .pdump before returning. It adds the
+// counters of an earlier run when the file holds a profile with the same header,
+// then rewrites the file. Only system calls are used, so no libc is needed.
+static void ga_profile_runtime(ga_data_t* data) {
+    mir_t* mir = data->mir;
+    profile_t* profile = data->options->profile;
+
+    size_t header_size = strlen(PROFILE_MAGIC) + 8;
+    for(size_t i = 0; i < profile->func_count; ++i)
+        header_size += 12 + strlen(profile->funcs[i].name);
+    size_t counters_size = 16 * profile->probe_count;
+
+    mir_emit_section(mir, MIR_SECTION_TEXT);
+    if(GA_IS_64(data)) ga_profile_dump64(mir, profile, header_size, counters_size);
+    else ga_profile_dump32(mir, profile, header_size, counters_size);
+
+    mir_emit_section(mir, MIR_SECTION_RODATA);
+    mir_emit_label(mir, mir_symbol(".pheader"));
+    mir_emit(mir, MIR_ASCII, 1, mir_string(PROFILE_MAGIC));
+    mir_emit(mir, MIR_LONG, 1, mir_imm(profile->probe_count));
+    mir_emit(mir, MIR_LONG, 1, mir_imm(profile->func_count));
+    for(size_t i = 0; i < profile->func_count; ++i) {
+        profile_func_t* func = &profile->funcs[i];
+        mir_emit(mir, MIR_LONG, 1, mir_imm(strlen(func->name)));
+        mir_emit(mir, MIR_ASCII, 1, mir_string(func->name));
+        mir_emit(mir, MIR_LONG, 1, mir_imm(func->first));
+        mir_emit(mir, MIR_LONG, 1, mir_imm(func->count));
+    }
+    mir_emit_label(mir, mir_symbol(".ppath"));
+    mir_emit(mir, MIR_ASCII, 1, mir_string(data->options->profile_path));
+    mir_emit(mir, MIR_BYTE, 1, mir_imm(0));
+
+    mir_emit_section(mir, MIR_SECTION_BSS);
+    mir_emit(mir, MIR_ALIGN, 1, mir_imm(8));
+    mir_emit_label(mir, mir_symbol(".pcounters"));
+    mir_emit(mir, MIR_ZERO, 1, mir_imm(counters_size));
+    mir_emit_label(mir, mir_symbol(".pscratch"));
+    mir_emit(mir, MIR_ZERO, 1, mir_imm(header_size + counters_size));
+}
+
+// INSTRUMENTATION
+
+#define GA_INSTRUMENTING(_data) ((_data)->options->instrument != GA_INSTRUMENT_NONE)
+#define GA_TIMING(_data) ((_data)->options->instrument == GA_INSTRUMENT_CYCLES)
+#define GA_INSTRUMENT_MAIN(_data) (GA_INSTRUMENTING(_data) && strcmp((_data)->curr_func->function_name, "main") == 0)
+// each function's record holds its calls, its cycles, a mark the report sorts
+// with and how many of its calls are running
+#define GA_RECORD_SIZE 24
+#define GA_RECORD_CALLS 0
+#define GA_RECORD_CYCLES 8
+#define GA_RECORD_DONE 16
+#define GA_RECORD_DEPTH 20
+// digits of the largest 64 bit count, every count is padded to them
+#define GA_NUMBER_WIDTH 20
+
+// a field of the current function's record
+static mir_operand_t ga_record(ga_data_t* data, size_t offset) {
+    offset += GA_RECORD_SIZE * data->instrumented_count;
+    if(GA_IS_64(data)) return mir_mem_label(mir_symbol(".irecords"), MIR_RIP, offset, 8);
+    return mir_mem_label(mir_symbol(".irecords"), MIR_NO_REG, offset, 4);
+}
+
+// rdtsc splits the counter between edx and eax
+static void ga_read_tsc(mir_t* mir) {
+    mir_emit(mir, MIR_RDTSC, 0);
+    if(!mir->is_64) return;
+    mir_emit(mir, MIR_SHL, 2, mir_imm(32), mir_reg(MIR_DX, 8));
+    mir_emit(mir, MIR_OR, 2, mir_reg(MIR_DX, 8), mir_reg(MIR_AX, 8));
+}
+
+// Entry counts the call and, unless the function is already running, takes
+// the time stamp counter off its cycles. The return that ends the outermost
+// call adds the counter back, so the cycles are of the calls and everything
+// they called, recursion counted once. Nothing is live yet, eax and edx are free.
+static void ga_instrument_entry(ga_data_t* data) {
+    if(!GA_INSTRUMENTING(data)) return;
+    mir_t* mir = data->mir;
+    mir_emit(mir, MIR_ADD, 2, mir_imm(1), ga_record(data, GA_RECORD_CALLS));
+    if(!GA_IS_64(data)) mir_emit(mir, MIR_ADC, 2, mir_imm(0), ga_record(data, GA_RECORD_CALLS + 4));
+    if(!GA_TIMING(data)) return;
+
+    mir_operand_t depth = ga_record(data, GA_RECORD_DEPTH);
+    depth.size = 4;
+    size_t running = data->label_index++;
+    mir_emit(mir, MIR_CMP, 2, mir_imm(0), depth);
+    ga_jcc(data, MIR_CC_NE, ".i", running);
+    ga_read_tsc(mir);
+    if(GA_IS_64(data)) {
+        mir_emit(mir, MIR_SUB, 2, mir_reg(MIR_AX, 8), ga_record(data, GA_RECORD_CYCLES));
+    } else {
+        mir_emit(mir, MIR_SUB, 2, GA_EAX, ga_record(data, GA_RECORD_CYCLES));
+        mir_emit(mir, MIR_SBB, 2, GA_EDX, ga_record(data, GA_RECORD_CYCLES + 4));
+    }
+    ga_label(data, ".i", running);
+    mir_emit(mir, MIR_ADD, 2, mir_imm(1), depth);
+}
+
+// ecx keeps the value returned in eax while the counter is read
+static void ga_instrument_exit(ga_data_t* data) {
+    if(!GA_TIMING(data)) return;
+    mir_t* mir = data->mir;
+    mir_operand_t depth = ga_record(data, GA_RECORD_DEPTH);
+    depth.size = 4;
+    size_t running = data->label_index++;
+    mir_emit(mir, MIR_SUB, 2, mir_imm(1), depth);
+    ga_jcc(data, MIR_CC_NE, ".i", running);
+    mir_emit(mir, MIR_MOV, 2, GA_EAX, GA_ECX);
+    ga_read_tsc(mir);
+    if(GA_IS_64(data)) {
+        mir_emit(mir, MIR_ADD, 2, mir_reg(MIR_AX, 8), ga_record(data, GA_RECORD_CYCLES));
+    } else {
+        mir_emit(mir, MIR_ADD, 2, GA_EAX, ga_record(data, GA_RECORD_CYCLES));
+        mir_emit(mir, MIR_ADC, 2, GA_EDX, ga_record(data, GA_RECORD_CYCLES + 4));
+    }
+    mir_emit(mir, MIR_MOV, 2, GA_ECX, GA_EAX);
+    ga_label(data, ".i", running);
+}
+
+// instructions ga_instrument_exit takes
+static size_t ga_instrument_exit_length(ga_data_t* data) {
+    if(!GA_TIMING(data)) return 0;
+    return GA_IS_64(data) ? 8 : 7;
+}
+
+// Each line of the report is the record sorted first of those left, the record
+// is marked and the next line looks again, so sorting needs no more memory. A
+// line holds the cycles when they were counted, the calls and the name.
+static void ga_instrument_dump64(ga_data_t* data, size_t stride) {
+    mir_t* mir = data->mir;
+    size_t count = data->instrumented_count;
+    mir_operand_t eax = mir_reg(MIR_AX, 4), ecx = mir_reg(MIR_CX, 4), edx = mir_reg(MIR_DX, 4), esi = mir_reg(MIR_SI, 4);
+    mir_operand_t rax = mir_reg(MIR_AX, 8), rcx = mir_reg(MIR_CX, 8), rdx = mir_reg(MIR_DX, 8);
+    mir_operand_t rsi = mir_reg(MIR_SI, 8), rdi = mir_reg(MIR_DI, 8);
+    mir_operand_t r8 = mir_reg(MIR_R8, 8), r9 = mir_reg(MIR_R9, 8), r10 = mir_reg(MIR_R10, 8), r11 = mir_reg(MIR_R11, 8);
+    int64_t key = GA_TIMING(data) ? GA_RECORD_CYCLES : GA_RECORD_CALLS;
+
+    mir_emit_label(mir, mir_symbol(".idump"));
+    mir_emit(mir, MIR_PUSH, 1, rax);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".ibuffer"), MIR_RIP, 0, 8), rdi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(count), mir_reg(MIR_R8, 4));
+    // r9 points at the largest record not reported yet, r10 holds its key and r11 its index
+    mir_emit_label(mir, mir_symbol(".inext"));
+    mir_emit(mir, MIR_XOR, 2, mir_reg(MIR_R9, 4), mir_reg(MIR_R9, 4));
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".irecords"), MIR_RIP, 0, 8), rsi);
+    mir_emit(mir, MIR_XOR, 2, ecx, ecx);
+    mir_emit_label(mir, mir_symbol(".iscan"));
+    mir_emit(mir, MIR_CMP, 2, mir_imm(0), mir_mem(MIR_SI, GA_RECORD_DONE, 4));
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".iskip")));
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SI, key, 8), rax);
+    mir_emit(mir, MIR_TEST, 2, r9, r9);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_E, mir_target(mir_symbol(".itake")));
+    mir_emit(mir, MIR_CMP, 2, r10, rax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_BE, mir_target(mir_symbol(".iskip")));
+    mir_emit_label(mir, mir_symbol(".itake"));
+    mir_emit(mir, MIR_MOV, 2, rsi, r9);
+    mir_emit(mir, MIR_MOV, 2, rax, r10);
+    mir_emit(mir, MIR_MOV, 2, rcx, r11);
+    mir_emit_label(mir, mir_symbol(".iskip"));
+    mir_emit(mir, MIR_ADD, 2, mir_imm(GA_RECORD_SIZE), rsi);
+    mir_emit(mir, MIR_INC, 1, ecx);
+    mir_emit(mir, MIR_CMP, 2, mir_imm(count), ecx);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".iscan")));
+
+    mir_emit(mir, MIR_MOV, 2, mir_imm(1), mir_mem(MIR_R9, GA_RECORD_DONE, 4));
+    mir_emit(mir, MIR_IMUL, 3, mir_imm(stride), r11, rsi);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".inames"), MIR_RIP, 0, 8), rax);
+    mir_emit(mir, MIR_ADD, 2, rax, rsi);
+    if(GA_TIMING(data)) {
+        mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_R9, GA_RECORD_CYCLES, 8), rax);
+        mir_emit(mir, MIR_CALL, 1, mir_target(mir_symbol(".inumber")));
+    }
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_R9, GA_RECORD_CALLS, 8), rax);
+    mir_emit(mir, MIR_CALL, 1, mir_target(mir_symbol(".inumber")));
+    mir_emit_label(mir, mir_symbol(".icopy"));
+    mir_emit(mir, MIR_MOVZB, 2, mir_mem(MIR_SI, 0, 1), eax);
+    mir_emit(mir, MIR_TEST, 2, eax, eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_E, mir_target(mir_symbol(".icopied")));
+    mir_emit(mir, MIR_MOV, 2, GA_AL, mir_mem(MIR_DI, 0, 1));
+    mir_emit(mir, MIR_INC, 1, rsi);
+    mir_emit(mir, MIR_INC, 1, rdi);
+    mir_emit(mir, MIR_JMP, 1, mir_target(mir_symbol(".icopy")));
+    mir_emit_label(mir, mir_symbol(".icopied"));
+    mir_emit(mir, MIR_MOV, 2, mir_imm('\n'), mir_mem(MIR_DI, 0, 1));
+    mir_emit(mir, MIR_INC, 1, rdi);
+    mir_emit(mir, MIR_DEC, 1, mir_reg(MIR_R8, 4));
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".inext")));
+
+    // open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) and write the lines
+    mir_emit(mir, MIR_MOV, 2, rdi, r9);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".ibuffer"), MIR_RIP, 0, 8), rax);
+    mir_emit(mir, MIR_SUB, 2, rax, r9);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(2), eax);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".ipath"), MIR_RIP, 0, 8), rdi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0x241), esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0644), edx);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_TEST, 2, rax, rax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_S, mir_target(mir_symbol(".idone")));
+    mir_emit(mir, MIR_MOV, 2, rax, r8);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(1), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_symbol(".ibuffer"), MIR_RIP, 0, 8), rsi);
+    mir_emit(mir, MIR_MOV, 2, r9, rdx);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(3), eax);
+    mir_emit(mir, MIR_MOV, 2, r8, rdi);
+    mir_emit(mir, MIR_SYSCALL, 0);
+    mir_emit_label(mir, mir_symbol(".idone"));
+    mir_emit(mir, MIR_POP, 1, rax);
+    mir_emit(mir, MIR_RET, 0);
+
+    // rax written right aligned at rdi in GA_NUMBER_WIDTH digits and a space,
+    // rdi moves past them
+    mir_emit_label(mir, mir_symbol(".inumber"));
+    mir_emit(mir, MIR_ADD, 2, mir_imm(GA_NUMBER_WIDTH), rdi);
+    mir_emit(mir, MIR_MOV, 2, rdi, r10);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(10), mir_reg(MIR_R11, 4));
+    mir_emit_label(mir, mir_symbol(".idigit"));
+    mir_emit(mir, MIR_XOR, 2, edx, edx);
+    mir_emit(mir, MIR_DIV, 1, r11);
+    mir_emit(mir, MIR_ADD, 2, mir_imm('0'), edx);
+    mir_emit(mir, MIR_DEC, 1, r10);
+    mir_emit(mir, MIR_MOV, 2, mir_reg(MIR_DX, 1), mir_mem(MIR_R10, 0, 1));
+    mir_emit(mir, MIR_TEST, 2, rax, rax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".idigit")));
+    mir_emit(mir, MIR_LEA, 2, mir_mem(MIR_DI, -GA_NUMBER_WIDTH, 8), rax);
+    mir_emit_label(mir, mir_symbol(".ipad"));
+    mir_emit(mir, MIR_CMP, 2, rax, r10);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_E, mir_target(mir_symbol(".ipadded")));
+    mir_emit(mir, MIR_DEC, 1, r10);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(' '), mir_mem(MIR_R10, 0, 1));
+    mir_emit(mir, MIR_JMP, 1, mir_target(mir_symbol(".ipad")));
+    mir_emit_label(mir, mir_symbol(".ipadded"));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(' '), mir_mem(MIR_DI, 0, 1));
+    mir_emit(mir, MIR_INC, 1, rdi);
+    mir_emit(mir, MIR_RET, 0);
+}
+
+// the same with the 32 bit system calls, keys compared and counts divided a
+// half at a time
+static void ga_instrument_dump32(ga_data_t* data, size_t stride) {
+    mir_t* mir = data->mir;
+    size_t count = data->instrumented_count;
+    mir_operand_t eax = mir_reg(MIR_AX, 4), ebx = mir_reg(MIR_BX, 4), ecx = mir_reg(MIR_CX, 4), edx = mir_reg(MIR_DX, 4);
+    mir_operand_t esi = mir_reg(MIR_SI, 4), edi = mir_reg(MIR_DI, 4), ebp = mir_reg(MIR_BP, 4);
+    mir_operand_t left = mir_mem_label(mir_symbol(".ileft"), MIR_NO_REG, 0, 4);
+    mir_operand_t ten = mir_mem_label(mir_symbol(".iten"), MIR_NO_REG, 0, 4);
+    int64_t key = GA_TIMING(data) ? GA_RECORD_CYCLES : GA_RECORD_CALLS;
+
+    mir_emit_label(mir, mir_symbol(".idump"));
+    mir_emit(mir, MIR_PUSHA, 0);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".ibuffer"), GA_NO_LABEL), edi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(count), left);
+    // ebx points at the largest record not reported yet and ebp at its name
+    mir_emit_label(mir, mir_symbol(".inext"));
+    mir_emit(mir, MIR_XOR, 2, ebx, ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".irecords"), GA_NO_LABEL), esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".inames"), GA_NO_LABEL), edx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(count), ecx);
+    mir_emit_label(mir, mir_symbol(".iscan"));
+    mir_emit(mir, MIR_CMP, 2, mir_imm(0), mir_mem(MIR_SI, GA_RECORD_DONE, 4));
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".iskip")));
+    mir_emit(mir, MIR_TEST, 2, ebx, ebx);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_E, mir_target(mir_symbol(".itake")));
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SI, key + 4, 4), eax);
+    mir_emit(mir, MIR_CMP, 2, mir_mem(MIR_BX, key + 4, 4), eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_A, mir_target(mir_symbol(".itake")));
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_B, mir_target(mir_symbol(".iskip")));
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SI, key, 4), eax);
+    mir_emit(mir, MIR_CMP, 2, mir_mem(MIR_BX, key, 4), eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_BE, mir_target(mir_symbol(".iskip")));
+    mir_emit_label(mir, mir_symbol(".itake"));
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_MOV, 2, edx, ebp);
+    mir_emit_label(mir, mir_symbol(".iskip"));
+    mir_emit(mir, MIR_ADD, 2, mir_imm(GA_RECORD_SIZE), esi);
+    mir_emit(mir, MIR_ADD, 2, mir_imm(stride), edx);
+    mir_emit(mir, MIR_DEC, 1, ecx);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".iscan")));
+
+    mir_emit(mir, MIR_MOV, 2, mir_imm(1), mir_mem(MIR_BX, GA_RECORD_DONE, 4));
+    if(GA_TIMING(data)) {
+        mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_BX, GA_RECORD_CYCLES, 4), eax);
+        mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_BX, GA_RECORD_CYCLES + 4, 4), edx);
+        mir_emit(mir, MIR_CALL, 1, mir_target(mir_symbol(".inumber")));
+    }
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_BX, GA_RECORD_CALLS, 4), eax);
+    mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_BX, GA_RECORD_CALLS + 4, 4), edx);
+    mir_emit(mir, MIR_CALL, 1, mir_target(mir_symbol(".inumber")));
+    mir_emit_label(mir, mir_symbol(".icopy"));
+    mir_emit(mir, MIR_MOVZB, 2, mir_mem(MIR_BP, 0, 1), eax);
+    mir_emit(mir, MIR_TEST, 2, eax, eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_E, mir_target(mir_symbol(".icopied")));
+    mir_emit(mir, MIR_MOV, 2, GA_AL, mir_mem(MIR_DI, 0, 1));
+    mir_emit(mir, MIR_INC, 1, ebp);
+    mir_emit(mir, MIR_INC, 1, edi);
+    mir_emit(mir, MIR_JMP, 1, mir_target(mir_symbol(".icopy")));
+    mir_emit_label(mir, mir_symbol(".icopied"));
+    mir_emit(mir, MIR_MOV, 2, mir_imm('\n'), mir_mem(MIR_DI, 0, 1));
+    mir_emit(mir, MIR_INC, 1, edi);
+    mir_emit(mir, MIR_DEC, 1, left);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".inext")));
+
+    // open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) and write the lines
+    mir_emit(mir, MIR_SUB, 2, mir_imm_label(mir_symbol(".ibuffer"), GA_NO_LABEL), edi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(5), eax);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".ipath"), GA_NO_LABEL), ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0x241), ecx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(0644), edx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_TEST, 2, eax, eax);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_S, mir_target(mir_symbol(".idone")));
+    mir_emit(mir, MIR_MOV, 2, eax, esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(4), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_MOV, 2, mir_imm_label(mir_symbol(".ibuffer"), GA_NO_LABEL), ecx);
+    mir_emit(mir, MIR_MOV, 2, edi, edx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(6), eax);
+    mir_emit(mir, MIR_MOV, 2, esi, ebx);
+    mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    mir_emit_label(mir, mir_symbol(".idone"));
+    mir_emit(mir, MIR_POPA, 0);
+    mir_emit(mir, MIR_RET, 0);
+
+    // edx:eax written right aligned at edi in GA_NUMBER_WIDTH digits and a
+    // space, edi moves past them. ecx holds the high half being divided.
+    mir_emit_label(mir, mir_symbol(".inumber"));
+    mir_emit(mir, MIR_ADD, 2, mir_imm(GA_NUMBER_WIDTH), edi);
+    mir_emit(mir, MIR_MOV, 2, edi, esi);
+    mir_emit(mir, MIR_MOV, 2, edx, ecx);
+    mir_emit_label(mir, mir_symbol(".idigit"));
+    mir_emit(mir, MIR_XCHG, 2, ecx, eax);
+    mir_emit(mir, MIR_XOR, 2, edx, edx);
+    mir_emit(mir, MIR_DIV, 1, ten);
+    mir_emit(mir, MIR_XCHG, 2, ecx, eax);
+    mir_emit(mir, MIR_DIV, 1, ten);
+    mir_emit(mir, MIR_ADD, 2, mir_imm('0'), edx);
+    mir_emit(mir, MIR_DEC, 1, esi);
+    mir_emit(mir, MIR_MOV, 2, mir_reg(MIR_DX, 1), mir_mem(MIR_SI, 0, 1));
+    mir_emit(mir, MIR_MOV, 2, ecx, edx);
+    mir_emit(mir, MIR_OR, 2, eax, edx);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_NE, mir_target(mir_symbol(".idigit")));
+    mir_emit(mir, MIR_LEA, 2, mir_mem(MIR_DI, -GA_NUMBER_WIDTH, 4), eax);
+    mir_emit_label(mir, mir_symbol(".ipad"));
+    mir_emit(mir, MIR_CMP, 2, eax, esi);
+    mir_emit_cc(mir, MIR_JCC, MIR_CC_E, mir_target(mir_symbol(".ipadded")));
+    mir_emit(mir, MIR_DEC, 1, esi);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(' '), mir_mem(MIR_SI, 0, 1));
+    mir_emit(mir, MIR_JMP, 1, mir_target(mir_symbol(".ipad")));
+    mir_emit_label(mir, mir_symbol(".ipadded"));
+    mir_emit(mir, MIR_MOV, 2, mir_imm(' '), mir_mem(MIR_DI, 0, 1));
+    mir_emit(mir, MIR_INC, 1, edi);
+    mir_emit(mir, MIR_RET, 0);
+}
+
+// The records live in .bss, main calls .idump before returning. The names are
+// padded to one length so a record's index finds its name, the report is
+// formatted in .bss too and written at once. Only system calls are used.
+static void ga_instrument_runtime(ga_data_t* data) {
+    mir_t* mir = data->mir;
+    size_t count = data->instrumented_count;
+    if(!count) return;
+
+    size_t stride = 1;
+    for(size_t i = 0; i < count; ++i) {
+        size_t length = strlen(data->instrumented[i]) + 1;
+        if(length > stride) stride = length;
+    }
+    size_t line_size = (GA_TIMING(data) ? 2 : 1) * (GA_NUMBER_WIDTH + 1) + stride;
+
+    mir_emit_section(mir, MIR_SECTION_TEXT);
+    if(GA_IS_64(data)) ga_instrument_dump64(data, stride);
+    else ga_instrument_dump32(data, stride);
+
+    mir_emit_section(mir, MIR_SECTION_RODATA);
+    mir_emit_label(mir, mir_symbol(".inames"));
+    for(size_t i = 0; i < count; ++i) {
+        mir_emit(mir, MIR_ASCII, 1, mir_string(data->instrumented[i]));
+        mir_emit(mir, MIR_ZERO, 1, mir_imm(stride - strlen(data->instrumented[i])));
+    }
+    mir_emit_label(mir, mir_symbol(".ipath"));
+    mir_emit(mir, MIR_ASCII, 1, mir_string(data->options->instrument_path));
+    mir_emit(mir, MIR_BYTE, 1, mir_imm(0));
+    if(!GA_IS_64(data)) {
+        mir_emit(mir, MIR_ALIGN, 1, mir_imm(4));
+        mir_emit_label(mir, mir_symbol(".iten"));
+        mir_emit(mir, MIR_LONG, 1, mir_imm(10));
+    }
+
+    mir_emit_section(mir, MIR_SECTION_BSS);
+    mir_emit(mir, MIR_ALIGN, 1, mir_imm(8));
+    mir_emit_label(mir, mir_symbol(".irecords"));
+    mir_emit(mir, MIR_ZERO, 1, mir_imm(GA_RECORD_SIZE * count));
+    if(!GA_IS_64(data)) {
+        mir_emit_label(mir, mir_symbol(".ileft"));
+        mir_emit(mir, MIR_ZERO, 1, mir_imm(4));
+    }
+    mir_emit_label(mir, mir_symbol(".ibuffer"));
+    mir_emit(mir, MIR_ZERO, 1, mir_imm(line_size * count));
+}
+
+// The entry point of executables linked without libc. The kernel leaves argc then
+// argv on a 16 byte aligned stack, already where 32 bit main looks for them, the
+// call makes it what main expects, and what main returns is the status passed
+// to exit.
+static void ga_start(ga_data_t* data) {
+    mir_t* mir = data->mir;
+    mir_emit_section(mir, MIR_SECTION_TEXT);
+    mir_emit(mir, MIR_GLOBL, 1, mir_target(mir_symbol("_start")));
+    mir_emit_label(mir, mir_symbol("_start"));
+    if(GA_IS_64(data)) {
+        mir_emit(mir, MIR_MOV, 2, mir_mem(MIR_SP, 0, 4), mir_reg(MIR_DI, 4));
+        mir_emit(mir, MIR_LEA, 2, mir_mem(MIR_SP, 8, 8), mir_reg(MIR_SI, 8));
+    }
+    mir_emit(mir, MIR_CALL, 1, mir_target(mir_symbol("main")));
+    if(GA_IS_64(data)) {
+        mir_emit(mir, MIR_MOV, 2, GA_EAX, mir_reg(MIR_DI, 4));
+        mir_emit(mir, MIR_MOV, 2, mir_imm(60), GA_EAX);
+        mir_emit(mir, MIR_SYSCALL, 0);
+    } else {
+        mir_emit(mir, MIR_MOV, 2, GA_EAX, mir_reg(MIR_BX, 4));
+        mir_emit(mir, MIR_MOV, 2, mir_imm(1), GA_EAX);
+        mir_emit(mir, MIR_INT, 1, mir_imm(0x80));
+    }
+}
+
+// 64 bit frames hold the register parameters and the spill slots, then the saved
+// registers, padded so calls made with nothing pushed are aligned
+static void ga_prologue(ga_data_t* data, node_func_t* func) {
+    mir_t* mir = data->mir;
+    if(!GA_IS_64(data)) {
+        if(GA_HAS_FRAME(data, func)) {
+            mir_emit(mir, MIR_PUSH, 1, mir_reg(MIR_BP, 4));
+            mir_emit(mir, MIR_MOV, 2, mir_reg(MIR_SP, 4), mir_reg(MIR_BP, 4));
+        }
+        if(data->spill_slots) mir_emit(mir, MIR_SUB, 2, mir_imm(4 * data->spill_slots), mir_reg(MIR_SP, 4));
+        for(size_t i = 0; i < GA_REG_COUNT; ++i) {
+            if(data->saved & RA_BIT(i)) mir_emit(mir, MIR_PUSH, 1, mir_reg(ga_regs[i], 4));
+        }
+        return;
+    }
+
+    size_t reg_params = func->param_count < GA_REG_ARGS ? func->param_count : GA_REG_ARGS;
+    size_t saved = 0;
+    for(size_t i = 0; i < GA_REG_COUNT; ++i) saved += (data->saved >> i) & 1;
+    size_t slots = reg_params + (data->spill_slots + 1) / 2;
+    slots += (slots + saved) % 2;
+    mir_emit(mir, MIR_PUSH, 1, mir_reg(MIR_BP, 8));
+    mir_emit(mir, MIR_MOV, 2, mir_reg(MIR_SP, 8), mir_reg(MIR_BP, 8));
+    if(slots) mir_emit(mir, MIR_SUB, 2, mir_imm(8 * slots), mir_reg(MIR_SP, 8));
+    for(size_t i = 0; i < GA_REG_COUNT; ++i) {
+        if(data->saved & RA_BIT(i)) mir_emit(mir, MIR_PUSH, 1, mir_reg(ga_regs[i], 8));
+    }
+    for(size_t i = 0; i < reg_params; ++i)
+        mir_emit(mir, MIR_MOV, 2, mir_reg(ga_arg_regs[i], 4), ga_param(data, i));
+}
+
+static void ga_epilogue(ga_data_t* data) {
+    ga_instrument_exit(data);
+    if(GA_INSTRUMENT_MAIN(data))
+        mir_emit(data->mir, MIR_CALL, 1, mir_target(mir_symbol(".idump")));
+    if(GA_PROFILE_MAIN(data))
+        mir_emit(data->mir, MIR_CALL, 1, mir_target(mir_symbol(".pdump")));
+    for(size_t i = GA_REG_COUNT; i > 0; --i) {
+        if(data->saved & RA_BIT(i - 1))
+            mir_emit(data->mir, MIR_POP, 1, mir_reg(ga_regs[i - 1], GA_WORD(data)));
+    }
+    if(GA_IS_64(data) || data->spill_slots)
+        mir_emit(data->mir, MIR_LEAVE, 0);
+    else if(GA_HAS_FRAME(data, data->curr_func))
+        mir_emit(data->mir, MIR_POP, 1, mir_reg(MIR_BP, 4));
+}
+
+// instructions the epilogue and ret take
+static size_t ga_epilogue_length(ga_data_t* data) {
+    size_t length = GA_PROFILE_MAIN(data) ? 2 : 1;
+    length += ga_instrument_exit_length(data) + GA_INSTRUMENT_MAIN(data);
+    for(size_t i = 0; i < GA_REG_COUNT; ++i) length += (data->saved >> i) & 1;
+    if(GA_IS_64(data) || data->spill_slots || GA_HAS_FRAME(data, data->curr_func)) length++;
+    return length;
+}
+
+// optimizing for size, returns jump to the epilogue the body ends with when it
+// takes more than the jump does
+static void ga_return(ga_data_t* data) {
+    if(data->options->optimize_size && ga_epilogue_length(data) > 2) {
+        if(!data->shares_epilogue) data->epilogue_label = data->label_index++;
+        data->shares_epilogue = true;
+        ga_jmp(data, ".r", data->epilogue_label);
+        return;
+    }
+    ga_epilogue(data);
+    mir_emit(data->mir, MIR_RET, 0);
+}
+
+static bool ga_body(ga_data_t* data, node_func_t* func) {
+    data->shares_epilogue = false;
+    if(!ga_statement(data, func->stat)) return false;
+
+    // falling off the end returns 0, like main does
+    node_stat_t* last = func->stat->stats;
+    while(last && last->node.next) last = (node_stat_t*)last->node.next;
+    bool falls_off = !last || last->type != STAT_RETURN;
+    if(falls_off) mir_emit(data->mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+    if(falls_off || data->shares_epilogue) {
+        if(data->shares_epilogue) ga_label(data, ".r", data->epilogue_label);
+        ga_epilogue(data);
+        mir_emit(data->mir, MIR_RET, 0);
     }
 
-    return true; // TODO: change back
+    for(size_t i = 0; i < data->cold_count; ++i) {
+        ga_cold_t* cold = &data->colds[i];
+        ga_label(data, ".c", cold->label);
+        mir_emit(data->mir, MIR_MOV, 2, mir_imm(cold->value), GA_EAX);
+        ga_jmp(data, ".oe", cold->resume);
+    }
+    data->cold_count = 0;
+    return true;
 }
 
 bool ga_function(ga_data_t* data, node_func_t* func) {
-    fprintf(data->fp, ".globl %s\n%s:\n", func->function_name, func->function_name);
-    return ga_statement(data, func->stat);
+    // declarations only describe functions defined elsewhere
+    if(!func->stat) return true;
+
+    // with a profile, functions are grouped by how often they ran
+    profile_t* profile = data->options->profile;
+    if(profile && profile->counters) {
+        data->text_section = MIR_SECTION_TEXT;
+        if(profile_is_hot(profile, func)) data->text_section = MIR_SECTION_TEXT_HOT;
+        else if(profile_is_cold(profile, func)) data->text_section = MIR_SECTION_TEXT_UNLIKELY;
+        mir_emit_section(data->mir, data->text_section);
+    }
+
+    mir_func_t* mir_func = mir_begin_func(data->mir, func->function_name);
+    if(func->file) mir_func->file = mir_add_file(data->mir, func->file);
+    mir_func->line = func->line;
+    mir_func->column = func->column;
+    if(!func->is_static) mir_emit(data->mir, MIR_GLOBL, 1, mir_target(mir_symbol(func->function_name)));
+    mir_emit_label(data->mir, mir_symbol(func->function_name));
+    data->curr_func = func;
+    data->depth = data->stack_bytes = 0;
+    data->saved = 0;
+    data->spill_slots = 0;
+
+    ga_label_statement(data, func->stat);
+
+    // a first pass, dropped afterwards, finds the live intervals of the temporaries
+    size_t mark = data->mir->count;
+    size_t label_index = data->label_index;
+    data->measuring = true;
+    data->interval_count = data->position = 0;
+    data->entry_label = data->label_index++;
+    bool success = ga_body(data, func);
+    mir_truncate(data->mir, mark);
+    data->label_index = label_index;
+    data->measuring = false;
+    if(!success) return false;
+
+    ra_result_t result;
+    if(GA_IS_64(data))
+        ra_linear_scan(data->intervals, data->interval_count, ga_pool64, sizeof(ga_pool64) / sizeof(int), &result);
+    else
+        ra_linear_scan(data->intervals, data->interval_count, ga_pool32, sizeof(ga_pool32) / sizeof(int), &result);
+    data->saved = result.used & ~GA_CALLER_SAVED(data);
+    data->spill_slots = result.slots;
+    data->depth = data->next_interval = 0;
+
+    // the prologue is located at the function's name
+    data->mir->line = func->line;
+    data->mir->column = func->column;
+    ga_prologue(data, func);
+    ga_count(data, func->probe);
+    ga_instrument_entry(data);
+    data->entry_label = data->label_index++;
+    ga_label(data, ".f", data->entry_label);
+
+    success = ga_body(data, func);
+    mir_end_func(data->mir);
+    data->mir->line = data->mir->column = 0;
+    if(GA_INSTRUMENTING(data)) {
+        if(data->instrumented_count == data->instrumented_capacity) {
+            data->instrumented_capacity = data->instrumented_capacity ? data->instrumented_capacity * 2 : 16;
+            data->instrumented = (const char**)realloc(data->instrumented, data->instrumented_capacity * sizeof(char*));
+        }
+        data->instrumented[data->instrumented_count++] = func->function_name;
+    }
+    return success;
 }
 
+#define IS_LABEL_STAT(_stat) ((_stat) && ((_stat)->type == STAT_CASE || (_stat)->type == STAT_DEFAULT))
+
 bool ga_statement(ga_data_t* data, node_stat_t* stat) {
-    if(!ga_expression(data, stat->exp)) return false;
-    fprintf(data->fp, "\tret\n");
+    ga_switch_t* sw = data->curr_switch;
+    data->mir->line = stat->line;
+    data->mir->column = stat->column;
+
+    switch(stat->type) {
+    case STAT_RETURN:
+        return ga_stat_return(data, stat);
+    case STAT_BLOCK:
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next) {
+            if(!ga_statement(data, sub)) return false;
+        }
+        return true;
+    case STAT_SWITCH:
+        return ga_stat_switch(data, stat);
+    case STAT_CASE:
+        if(!sw || sw->next_case >= sw->case_count) return false;
+        sw->next_case++;
+        // a label directly after another label shares its target
+        if(!IS_LABEL_STAT((node_stat_t*)stat->node.prev))
+            ga_label(data, ".s", sw->cases[sw->next_case - 1].label);
+        return true;
+    case STAT_DEFAULT:
+        if(!sw) return false;
+        if(!IS_LABEL_STAT((node_stat_t*)stat->node.prev))
+            ga_label(data, ".s", sw->default_label);
+        return true;
+    case STAT_BREAK:
+        if(!sw) return false;
+        ga_jmp(data, ".s", sw->end_label);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// the call a return statement's value is made of, if any
+static node_factor_t* ga_tail_call(node_exp_t* exp) {
+    while(1) {
+        if(exp->subexps || exp->and_exp->subexps) return NULL;
+        node_exp_equals_t* equals = exp->and_exp->equals;
+        if(equals->subexps || equals->relation->subexps) return NULL;
+        node_exp_sum_t* sum = equals->relation->sum;
+        if(sum->subexps || sum->term->subterms) return NULL;
+
+        node_factor_t* factor = sum->term->factor;
+        if(factor->type == FACTOR_PAREN) {
+            exp = factor->exp;
+            continue;
+        }
+        return factor->type == FACTOR_CALL ? factor : NULL;
+    }
+}
+
+// push call arguments right to left
+static bool ga_push_args(ga_data_t* data, node_exp_t* arg) {
+    if(!arg) return true;
+    if(!ga_push_args(data, (node_exp_t*)arg->node.next)) return false;
+    if(!ga_expression(data, arg)) return false;
+    mir_emit(data->mir, MIR_PUSH, 1, mir_reg(MIR_AX, GA_WORD(data)));
+    if(GA_IS_64(data)) data->stack_bytes += 8;
     return true;
 }
 
-// bool ga_subexpression(ga_data_t* data, node_exp_subexp_t* sub) {
+// evaluate the arguments passed in registers onto the value stack, the first one last
+// so it can go straight from eax
+static bool ga_reg_args(ga_data_t* data, node_factor_t* call) {
+    size_t count = call->arg_count < GA_REG_ARGS ? call->arg_count : GA_REG_ARGS;
+    node_exp_t* arg = call->args;
+    for(size_t i = 0; i < count; ++i, arg = (node_exp_t*)arg->node.next) {
+        if(!ga_expression(data, arg)) return false;
+        if(i + 1 < count) ga_push(data);
+    }
+    if(count) {
+        ga_clobber(data, ga_reg_bit(ga_arg_regs[count - 1]));
+        mir_emit(data->mir, MIR_MOV, 2, GA_EAX, mir_reg(ga_arg_regs[count - 1], 4));
+    }
+    for(size_t i = count; i > 1; --i)
+        ga_pop_to(data, ga_arg_regs[i - 2]);
+    return true;
+}
 
-// }
+// 64 bit tail calls overwrite our own parameters when calling ourselves, otherwise
+// the callee must take all of its arguments in registers
+static bool ga_tail_call64(ga_data_t* data, node_factor_t* call) {
+    node_func_t* func = data->curr_func;
+    if(strcmp(call->name, func->function_name) == 0 && call->arg_count == func->param_count) {
+        size_t i = 0;
+        for(node_exp_t* arg = call->args; arg; arg = (node_exp_t*)arg->node.next, ++i) {
+            if(!ga_expression(data, arg)) return false;
+            if(arg->node.next) ga_push(data);
+        }
+        for(i = call->arg_count; i > 0; --i) {
+            if(i < call->arg_count) ga_pop_to(data, MIR_AX);
+            mir_emit(data->mir, MIR_MOV, 2, GA_EAX, ga_param(data, i - 1));
+        }
+        ga_jmp(data, ".f", data->entry_label);
+        return true;
+    }
 
-bool ga_expression(ga_data_t* data, node_exp_t* exp) {
-    if(!ga_exp_and(data, exp->and_exp)) return false;
+    if(!ga_reg_args(data, call)) return false;
+    ga_epilogue(data);
+    mir_emit(data->mir, MIR_JMP, 1, mir_target(mir_symbol(call->name)));
+    return true;
+}
 
-    // TODO:
-    node_exp_subexp_t* sub = exp->subexps;
-    while(sub) {
-        size_t currIndex = data->label_index++;
-        fprintf(data->fp, "\tcmpl\t$0, %%eax\n\tje\t\t.o%02lu\n\tmovl\t$1, %%eax\n\tjmp\t\t.oe%02lu\n.o%02lu:\n", currIndex, currIndex, currIndex);
-        
-        if(!ga_exp_and(data, sub->and_exp)) return false;
+bool ga_stat_return(ga_data_t* data, node_stat_t* stat) {
+    node_func_t* func = data->curr_func;
+    // an instrumented main has to dump its counters before it returns, and
+    // every call of an instrumented function goes through its entry and exit
+    node_factor_t* call = GA_PROFILE_MAIN(data) || GA_INSTRUMENTING(data) ? NULL : ga_tail_call(stat->exp);
 
-        fprintf(data->fp, "\tcmpl\t$0, %%eax\n\tmovl\t$0, %%eax\n\tsetne\t%%al\n.oe%02lu:\n", currIndex);
+    if(GA_IS_64(data)) {
+        if(call && (call->arg_count <= GA_REG_ARGS || strcmp(call->name, func->function_name) == 0))
+            return ga_tail_call64(data, call);
 
-        sub = sub->next;
+        if(!ga_expression(data, stat->exp)) return false;
+        ga_return(data);
+        return true;
+    }
+
+    // a call in tail position reuses our incoming argument slots, which the caller
+    // sized for our parameters and cleans up after we return
+    if(!call || call->arg_count > func->param_count) {
+        if(!ga_expression(data, stat->exp)) return false;
+        ga_return(data);
+        return true;
+    }
+
+    // every argument is evaluated before any parameter is overwritten, the
+    // first one is evaluated last and can be stored straight from eax
+    if(call->args) {
+        if(!ga_push_args(data, (node_exp_t*)call->args->node.next)) return false;
+        if(!ga_expression(data, call->args)) return false;
+        mir_emit(data->mir, MIR_MOV, 2, GA_EAX, ga_param(data, 0));
+    }
+    for(size_t i = 1; i < call->arg_count; ++i)
+        mir_emit(data->mir, MIR_POP, 1, ga_param(data, i));
+
+    if(strcmp(call->name, func->function_name) == 0 && call->arg_count == func->param_count) {
+        ga_jmp(data, ".f", data->entry_label);
+    } else {
+        ga_epilogue(data);
+        mir_emit(data->mir, MIR_JMP, 1, mir_target(mir_symbol(call->name)));
     }
-    
     return true;
 }
 
-bool ga_exp_and(ga_data_t* data, node_exp_and_t* and) {
-    if(!ga_exp_equals(data, and->equals)) return false;
+// SWITCH lowering
 
-    node_exp_and_subexp_t* sub = and->subexps;
-    while(sub) {
-        size_t currIndex = data->label_index++;
-        fprintf(data->fp, "\tcmpl\t$0, %%eax\n\tjne\t\t.a%02lu\n\tjmp\t\t.ae%02lu\n.a%02lu:\n", currIndex, currIndex, currIndex);
-        
-        if(!ga_exp_equals(data, sub->equals)) return false;
+// case counts and densities deciding how a run of sorted cases is dispatched
+#define GA_TABLE_MIN_CASES 4
+#define GA_TABLE_MIN_DENSITY 40 // percent of the range that must be real cases
+// the same optimizing for size, where a small switch compares in fewer bytes
+// than its table takes
+#define GA_TABLE_MIN_CASES_SIZE 12
+#define GA_TABLE_MIN_DENSITY_SIZE 75
+#define GA_TABLE_MAX_RANGE 4096
+#define GA_BITS_MIN_CASES 3
+#define GA_BITS_MAX_TARGETS 3
+#define GA_BITS_WIDTH 32
+#define GA_LINEAR_MAX 3 // clusters compared in sequence before splitting the search
+
+typedef enum ga_cluster_type_e {
+    GA_CLUSTER_CASE,
+    GA_CLUSTER_TABLE,
+    GA_CLUSTER_BITS
+} ga_cluster_type;
+
+typedef struct ga_cluster_s {
+    ga_cluster_type type;
+    ga_case_t* cases;
+    size_t count;
+    int64_t lo, hi;
+    // profiled dispatches into the cluster
+    uint64_t weight;
+} ga_cluster_t;
 
-        fprintf(data->fp, "\tcmpl\t$0, %%eax\n\tmovl\t$0, %%eax\n\tsetne\t%%al\n.ae%02lu:\n", currIndex);
+typedef struct ga_dispatch_s {
+    ga_cluster_t* clusters;
+    size_t default_label;
+} ga_dispatch_t;
 
-        sub = sub->next;
+// gather the case labels belonging to this switch, not to nested ones
+static bool ga_switch_collect(ga_data_t* data, ga_switch_t* sw, node_stat_t* stat) {
+    node_stat_t* prev = (node_stat_t*)stat->node.prev;
+    size_t shared = sw->case_count ? sw->cases[sw->case_count - 1].label : 0;
+    // the previous label statement was collected last, find its target
+    if(prev && prev->type == STAT_DEFAULT) shared = sw->default_label;
+
+    switch(stat->type) {
+    case STAT_BLOCK:
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next) {
+            if(!ga_switch_collect(data, sw, sub)) return false;
+        }
+        return true;
+    case STAT_CASE:
+        if(sw->case_count == sw->case_capacity) {
+            sw->case_capacity = sw->case_capacity ? sw->case_capacity * 2 : 16;
+            sw->cases = (ga_case_t*)realloc(sw->cases, sw->case_capacity * sizeof(ga_case_t));
+        }
+        sw->cases[sw->case_count].value = stat->case_value;
+        sw->cases[sw->case_count].label = IS_LABEL_STAT(prev) ? shared : data->label_index++;
+        sw->cases[sw->case_count].probe = stat->probe;
+        sw->cases[sw->case_count].count = ga_probe_count(data, stat->probe);
+        sw->case_count++;
+        return true;
+    case STAT_DEFAULT:
+        if(sw->has_default) return false;
+        sw->has_default = true;
+        sw->default_label = IS_LABEL_STAT(prev) ? shared : data->label_index++;
+        sw->default_probe = stat->probe;
+        return true;
+    default:
+        return true;
     }
+}
 
-    return true;
+static int ga_case_compare(const void* a, const void* b) {
+    int lhs = ((const ga_case_t*)a)->value, rhs = ((const ga_case_t*)b)->value;
+    return (lhs > rhs) - (lhs < rhs);
 }
 
-bool ga_exp_equals(ga_data_t* data, node_exp_equals_t* equals) {
-    if(!ga_exp_relation(data, equals->relation)) return false;
-
-    node_exp_equals_subexp_t* sub = equals->subexps;
-    while(sub) {
-        fputs("\tpush\t%eax\n", data->fp);
-        if(!ga_exp_relation(data, sub->relation)) return false;
-
-        if(sub->operator == OPERATOR_EQUALS) {
-            fputs("\tpop\t\t%ecx\n\tcmpl\t%eax, %ecx\n\tmovl\t$0, %eax\n\tsete\t%al\n", data->fp);
-        } else if(sub->operator == OPERATOR_NOT_EQUAL) {
-            fputs("\tpop\t\t%ecx\n\tcmpl\t%eax, %ecx\n\tmovl\t$0, %eax\n\tsetne\t%al\n", data->fp);
-        } else
+static size_t ga_cluster_targets(ga_case_t* cases, size_t count) {
+    size_t targets = 0;
+    for(size_t i = 0; i < count; ++i) {
+        size_t j = 0;
+        while(j < i && cases[j].label != cases[i].label) ++j;
+        if(j == i) targets++;
+    }
+    return targets;
+}
+
+// greedily split sorted cases into jump table, bit test and single case clusters
+static size_t ga_switch_cluster(ga_case_t* cases, size_t count, size_t min_cases, int min_density, ga_cluster_t* out) {
+    size_t clusters = 0;
+    size_t i = 0;
+    while(i < count) {
+        ga_cluster_t* cl = &out[clusters++];
+        cl->cases = &cases[i];
+        cl->lo = cases[i].value;
+
+        size_t best = i;
+        for(size_t j = i + min_cases - 1; j < count; ++j) {
+            int64_t range = (int64_t)cases[j].value - cases[i].value + 1;
+            if(range > GA_TABLE_MAX_RANGE) break;
+            if((int64_t)(j - i + 1) * 100 >= range * min_density) best = j;
+        }
+        if(best > i) {
+            cl->type = GA_CLUSTER_TABLE;
+            cl->count = best - i + 1;
+            cl->hi = cases[best].value;
+            i = best + 1;
+            continue;
+        }
+
+        for(size_t j = i + 1; j < count; ++j) {
+            if((int64_t)cases[j].value - cases[i].value >= GA_BITS_WIDTH) break;
+            if(ga_cluster_targets(&cases[i], j - i + 1) > GA_BITS_MAX_TARGETS) break;
+            best = j;
+        }
+        // only worth it when some target collects several cases
+        if(best - i + 1 >= GA_BITS_MIN_CASES && ga_cluster_targets(&cases[i], best - i + 1) < best - i + 1) {
+            cl->type = GA_CLUSTER_BITS;
+            cl->count = best - i + 1;
+            cl->hi = cases[best].value;
+            i = best + 1;
+            continue;
+        }
+
+        cl->type = GA_CLUSTER_CASE;
+        cl->count = 1;
+        cl->hi = cl->lo;
+        i++;
+    }
+
+    return clusters;
+}
+
+// dispatch on the switch value in eax, lo and hi bound the values that can reach here
+// flags_lo means the flags still hold the compare of eax against lo
+static void ga_switch_emit_cluster(ga_data_t* data, ga_dispatch_t* dispatch, ga_cluster_t* cl, int64_t lo, int64_t hi, bool flags_lo) {
+    if(cl->type == GA_CLUSTER_CASE) {
+        if(lo == cl->lo && hi == cl->hi) {
+            ga_jmp(data, ".s", cl->cases[0].label);
+        } else {
+            if(!flags_lo || lo != cl->lo) mir_emit(data->mir, MIR_CMP, 2, mir_imm(cl->cases[0].value), GA_EAX);
+            ga_jcc(data, MIR_CC_E, ".s", cl->cases[0].label);
+        }
+        return;
+    }
+
+    // rebase so one unsigned compare checks both ends of the range
+    bool checked = lo < cl->lo || hi > cl->hi;
+    size_t miss = data->label_index++;
+    if(cl->lo)
+        mir_emit(data->mir, MIR_LEA, 2, mir_mem(MIR_AX, (int)(0u - (unsigned int)cl->lo), 4), GA_ECX);
+    else
+        mir_emit(data->mir, MIR_MOV, 2, GA_EAX, GA_ECX);
+    if(checked) {
+        mir_emit(data->mir, MIR_CMP, 2, mir_imm(cl->hi - cl->lo), GA_ECX);
+        ga_jcc(data, MIR_CC_A, ".s", miss);
+    }
+
+    if(cl->type == GA_CLUSTER_TABLE) {
+        // position independent table of offsets from the table itself
+        size_t table = data->label_index++;
+        mir_t* mir = data->mir;
+        ga_clobber(data, RA_BIT(GA_REG_EDX));
+        if(GA_IS_64(data)) {
+            mir_emit(mir, MIR_LEA, 2, mir_mem_label(mir_label(".s", table), MIR_RIP, 0, 8), mir_reg(MIR_DX, 8));
+            mir_emit(mir, MIR_MOVSL, 2, mir_mem_index(MIR_DX, MIR_CX, 4, 0, 4), mir_reg(MIR_CX, 8));
+            mir_emit(mir, MIR_ADD, 2, mir_reg(MIR_DX, 8), mir_reg(MIR_CX, 8));
+            mir_emit(mir, MIR_JMP, 1, mir_reg(MIR_CX, 8));
+        } else {
+            size_t pc = data->label_index++;
+            mir_emit(mir, MIR_CALL, 1, ga_local(".s", pc));
+            ga_label(data, ".s", pc);
+            mir_emit(mir, MIR_POP, 1, GA_EDX);
+            mir_emit(mir, MIR_ADD, 2, mir_imm_label(mir_label(".s", table), mir_label(".s", pc)), GA_EDX);
+            mir_emit(mir, MIR_ADD, 2, mir_mem_index(MIR_DX, MIR_CX, 4, 0, 4), GA_EDX);
+            mir_emit(mir, MIR_JMP, 1, GA_EDX);
+        }
+
+        mir_emit_section(mir, MIR_SECTION_RODATA);
+        mir_emit(mir, MIR_ALIGN, 1, mir_imm(4));
+        ga_label(data, ".s", table);
+        size_t next = 0;
+        for(int64_t value = cl->lo; value <= cl->hi; ++value) {
+            size_t label = dispatch->default_label;
+            if(cl->cases[next].value == value) label = cl->cases[next++].label;
+            mir_emit(mir, MIR_LONG, 1, mir_imm_label(mir_label(".s", label), mir_label(".s", table)));
+        }
+        mir_emit_section(mir, data->text_section);
+    } else {
+        // one mask of case bits per distinct target
+        for(size_t i = 0; i < cl->count; ++i) {
+            size_t j = 0;
+            while(j < i && cl->cases[j].label != cl->cases[i].label) ++j;
+            if(j != i) continue;
+
+            unsigned int mask = 0;
+            for(j = i; j < cl->count; ++j) {
+                if(cl->cases[j].label == cl->cases[i].label)
+                    mask |= 1u << (cl->cases[j].value - cl->lo);
+            }
+            ga_clobber(data, RA_BIT(GA_REG_EDX));
+            mir_emit(data->mir, MIR_MOV, 2, mir_imm(mask), GA_EDX);
+            mir_emit(data->mir, MIR_BT, 2, GA_ECX, GA_EDX);
+            ga_jcc(data, MIR_CC_B, ".s", cl->cases[i].label);
+        }
+    }
+
+    if(checked) ga_label(data, ".s", miss);
+}
+
+// balanced binary search over the clusters, by profiled weight when there is one
+static void ga_switch_emit_tree(ga_data_t* data, ga_dispatch_t* dispatch, size_t first, size_t last, int64_t lo, int64_t hi, bool flags_lo) {
+    ga_cluster_t* clusters = dispatch->clusters;
+    uint64_t total = 0;
+    for(size_t i = first; i < last; ++i) total += clusters[i].weight;
+
+    if(last - first <= GA_LINEAR_MAX) {
+        // compare the hottest clusters first, the flags only survive for the first one
+        size_t order[GA_LINEAR_MAX];
+        for(size_t i = first; i < last; ++i) {
+            size_t j = i - first;
+            for(; j > 0 && clusters[order[j - 1]].weight < clusters[i].weight; --j) order[j] = order[j - 1];
+            order[j] = i;
+        }
+        for(size_t i = 0; i < last - first; ++i)
+            ga_switch_emit_cluster(data, dispatch, &clusters[order[i]], lo, hi, flags_lo && i == 0 && order[0] == first);
+        ga_jmp(data, ".s", dispatch->default_label);
+        return;
+    }
+
+    size_t mid = first + (last - first) / 2;
+    if(total) {
+        uint64_t below = clusters[first].weight;
+        for(mid = first + 1; mid < last - 1 && below * 2 < total; ++mid) below += clusters[mid].weight;
+    }
+    int64_t pivot = dispatch->clusters[mid].lo;
+    size_t left = data->label_index++;
+    mir_emit(data->mir, MIR_CMP, 2, mir_imm(pivot), GA_EAX);
+    ga_jcc(data, MIR_CC_L, ".s", left);
+    ga_switch_emit_tree(data, dispatch, mid, last, pivot, hi, true);
+    ga_label(data, ".s", left);
+    ga_switch_emit_tree(data, dispatch, first, mid, lo, pivot - 1, false);
+}
+
+static bool ga_switch_dispatch(ga_data_t* data, ga_switch_t* sw) {
+    ga_dispatch_t dispatch;
+    dispatch.default_label = sw->has_default ? sw->default_label : sw->end_label;
+    size_t target_default = dispatch.default_label;
+
+    // cases sharing the default target need no dispatch of their own
+    ga_case_t* cases = (ga_case_t*)malloc((sw->case_count + 1) * sizeof(ga_case_t));
+    memcpy(cases, sw->cases, sw->case_count * sizeof(ga_case_t));
+    qsort(cases, sw->case_count, sizeof(ga_case_t), ga_case_compare);
+
+    size_t count = 0;
+    for(size_t i = 0; i < sw->case_count; ++i) {
+        if(i > 0 && cases[i].value == cases[i - 1].value) {
+            free(cases);
             return false;
+        }
+        if(sw->has_default && cases[i].label == sw->default_label) continue;
+        cases[count++] = cases[i];
+    }
+
+    // instrumented dispatch goes through a stub counting the case it picked
+    size_t* targets = NULL;
+    if(GA_PROFILING(data)) {
+        targets = (size_t*)malloc((count + 1) * sizeof(size_t));
+        for(size_t i = 0; i < count; ++i) {
+            targets[i] = cases[i].label;
+            cases[i].label = data->label_index++;
+        }
+        dispatch.default_label = data->label_index++;
+    }
 
-        sub = sub->next;
+    // a case taking most dispatches is tested before the search
+    uint64_t total = ga_probe_count(data, sw->default_probe);
+    for(size_t i = 0; i < count; ++i) total += cases[i].count;
+    for(size_t i = 0; i < count && total; ++i) {
+        if(cases[i].count * 2 <= total) continue;
+        mir_emit(data->mir, MIR_CMP, 2, mir_imm(cases[i].value), GA_EAX);
+        ga_jcc(data, MIR_CC_E, ".s", cases[i].label);
+        memmove(&cases[i], &cases[i + 1], (count - i - 1) * sizeof(ga_case_t));
+        count--;
+        break;
     }
 
+    dispatch.clusters = (ga_cluster_t*)malloc((count + 1) * sizeof(ga_cluster_t));
+    bool size = data->options->optimize_size;
+    size_t clusters = ga_switch_cluster(cases, count, size ? GA_TABLE_MIN_CASES_SIZE : GA_TABLE_MIN_CASES,
+        size ? GA_TABLE_MIN_DENSITY_SIZE : GA_TABLE_MIN_DENSITY, dispatch.clusters);
+    for(size_t i = 0; i < clusters; ++i) {
+        ga_cluster_t* cl = &dispatch.clusters[i];
+        cl->weight = 0;
+        for(size_t j = 0; j < cl->count; ++j) cl->weight += cl->cases[j].count;
+    }
+    ga_switch_emit_tree(data, &dispatch, 0, clusters, INT32_MIN, INT32_MAX, false);
+
+    if(targets) {
+        for(size_t i = 0; i < count; ++i) {
+            ga_label(data, ".s", cases[i].label);
+            ga_count(data, cases[i].probe);
+            ga_jmp(data, ".s", targets[i]);
+        }
+        ga_label(data, ".s", dispatch.default_label);
+        ga_count(data, sw->default_probe);
+        ga_jmp(data, ".s", target_default);
+        free(targets);
+    }
+
+    free(dispatch.clusters);
+    free(cases);
     return true;
 }
 
-bool ga_exp_relation(ga_data_t* data, node_exp_relation_t* relation) {
-    if(!ga_exp_sum(data, relation->sum)) return false;
-
-    node_exp_relation_subexp_t* sub = relation->subexps;
-    while(sub) {
-        fputs("\tpush\t%eax\n", data->fp);
-        if(!ga_exp_sum(data, sub->sum)) return false;
-
-        fputs("\tpop\t\t%ecx\n\tcmpl\t%eax, %ecx\n\tmovl\t$0, %eax\n\tset", data->fp);
-        if(sub->relation == OPERATOR_LESS_THAN) {
-            fputc('l', data->fp);
-        } else if(sub->relation == OPERATOR_LESS_THAN_OR_EQUAL) {
-            fputc('l', data->fp);
-            fputc('e', data->fp);
-        } else if(sub->relation == OPERATOR_GREATER_THAN) {
-            fputc('g', data->fp);
-        } else if(sub->relation == OPERATOR_GREATER_THAN_OR_EQUAL) {
-            fputc('g', data->fp);
-            fputc('e', data->fp);
-        } else
-            return false;
-        
-        fputs("\t%al\n", data->fp);
+// a switch on a known value goes straight to its label
+static bool ga_switch_jump(ga_data_t* data, ga_switch_t* sw, int value) {
+    size_t label = sw->has_default ? sw->default_label : sw->end_label;
+    for(size_t i = 0; i < sw->case_count; ++i) {
+        if(sw->cases[i].value == value) label = sw->cases[i].label;
+    }
+    ga_jmp(data, ".s", label);
+    return true;
+}
+
+bool ga_stat_switch(ga_data_t* data, node_stat_t* stat) {
+    int value;
+    bool constant = ce_expression(stat->exp, &value);
+    if(!constant && !ga_expression(data, stat->exp)) return false;
+
+    ga_switch_t sw;
+    memset(&sw, 0, sizeof(ga_switch_t));
+    sw.end_label = data->label_index++;
+    // without a default the switch probe counts values matching no case
+    sw.default_probe = stat->probe;
+
+    bool success = ga_switch_collect(data, &sw, stat->stat) &&
+        (constant ? ga_switch_jump(data, &sw, value) : ga_switch_dispatch(data, &sw));
+    if(success) {
+        ga_switch_t* outer = data->curr_switch;
+        data->curr_switch = &sw;
+        success = ga_statement(data, stat->stat);
+        data->curr_switch = outer;
+
+        ga_label(data, ".s", sw.end_label);
+    }
+
+    free(sw.cases);
+    return success;
+}
+
+// SETHI-ULLMAN labels, the temporaries needed to evaluate an expression when
+// every operator starts with its more demanding operand
+
+static size_t ga_need_combine(size_t left, size_t right) {
+    if(left == right) return left + 1;
+    return left > right ? left : right;
+}
+
+static size_t ga_label_expression(ga_data_t* data, node_exp_t* exp);
+
+static size_t ga_label_factor(ga_data_t* data, node_factor_t* factor) {
+    size_t need = 0;
+    if(factor->type == FACTOR_PAREN) {
+        need = ga_label_expression(data, factor->exp);
+    } else if(factor->type == FACTOR_UNARY_OP) {
+        need = ga_label_factor(data, factor->factor);
+    } else if(factor->type == FACTOR_CALL) {
+        // 64 bit register arguments wait in temporaries for the ones after them.
+        // A call needs one at least, so it runs before values that would have
+        // to live through it.
+        need = 1;
+        size_t i = 0;
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next, ++i) {
+            size_t arg_need = ga_label_expression(data, arg);
+            if(GA_IS_64(data) && i < GA_REG_ARGS) arg_need += i;
+            if(arg_need > need) need = arg_need;
+        }
+    }
+    factor->node.need = need;
+    return need;
+}
+
+static size_t ga_label_term(ga_data_t* data, node_term_t* term) {
+    size_t need = ga_label_factor(data, term->factor);
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next)
+        need = ga_need_combine(need, ga_label_factor(data, sub->factor));
+    term->node.need = need;
+    return need;
+}
+
+static size_t ga_label_sum(ga_data_t* data, node_exp_sum_t* sum) {
+    size_t need = ga_label_term(data, sum->term);
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next)
+        need = ga_need_combine(need, ga_label_term(data, sub->term));
+    sum->node.need = need;
+    return need;
+}
+
+static size_t ga_label_relation(ga_data_t* data, node_exp_relation_t* relation) {
+    size_t need = ga_label_sum(data, relation->sum);
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next)
+        need = ga_need_combine(need, ga_label_sum(data, sub->sum));
+    relation->node.need = need;
+    return need;
+}
+
+static size_t ga_label_equals(ga_data_t* data, node_exp_equals_t* equals) {
+    size_t need = ga_label_relation(data, equals->relation);
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next)
+        need = ga_need_combine(need, ga_label_relation(data, sub->relation));
+    equals->node.need = need;
+    return need;
+}
+
+// && and || operands are evaluated one at a time, nothing waits in between
+static size_t ga_label_and(ga_data_t* data, node_exp_and_t* and) {
+    size_t need = ga_label_equals(data, and->equals);
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) {
+        size_t sub_need = ga_label_equals(data, sub->equals);
+        if(sub_need > need) need = sub_need;
+    }
+    and->node.need = need;
+    return need;
+}
+
+static size_t ga_label_expression(ga_data_t* data, node_exp_t* exp) {
+    size_t need = ga_label_and(data, exp->and_exp);
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) {
+        size_t sub_need = ga_label_and(data, sub->and_exp);
+        if(sub_need > need) need = sub_need;
+    }
+    exp->node.need = need;
+    return need;
+}
+
+static void ga_label_statement(ga_data_t* data, node_stat_t* stat) {
+    if(stat->exp) ga_label_expression(data, stat->exp);
+    if(stat->type == STAT_SWITCH) {
+        ga_label_statement(data, stat->stat);
+    } else if(stat->type == STAT_BLOCK) {
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next)
+            ga_label_statement(data, sub);
+    }
+}
+
+// OPERATOR CHAINS, left associative operators are emitted from the last one
+// down. Each evaluates its more demanding operand first and keeps it in a
+// temporary while the other one is evaluated.
+
+typedef bool (*ga_operand_gen)(ga_data_t* data, void* operand);
+typedef bool (*ga_constant_test)(void* operand, int* value);
+// join the left operand and the right one, one in eax and the other in the
+// temporary popped, reversed when eax holds the left one
+typedef bool (*ga_operator_gen)(ga_data_t* data, operator_type operator, bool reversed);
+// join a constant right operand to eax
+typedef bool (*ga_constant_gen)(ga_data_t* data, operator_type operator, int value);
+
+typedef struct ga_chain_s {
+    ga_operand_gen operand;
+    ga_operator_gen join;
+    // chains whose operators take constants directly, NULL for the rest
+    ga_constant_test constant;
+    ga_constant_gen join_constant;
+    // leave the last comparison in the flags rather than in eax
+    bool flags;
+    void** operands;
+    // operators[i] joins operands[i] to the chain before it
+    operator_type* operators;
+    size_t count;
+    size_t capacity;
+} ga_chain_t;
+
+static void ga_chain_init(ga_chain_t* chain, ga_operand_gen operand, ga_operator_gen join) {
+    memset(chain, 0, sizeof(ga_chain_t));
+    chain->operand = operand;
+    chain->join = join;
+}
+
+static void ga_chain_add(ga_chain_t* chain, void* operand, operator_type operator) {
+    if(chain->count == chain->capacity) {
+        chain->capacity = chain->capacity ? chain->capacity * 2 : 8;
+        chain->operands = (void**)realloc(chain->operands, chain->capacity * sizeof(void*));
+        chain->operators = (operator_type*)realloc(chain->operators, chain->capacity * sizeof(operator_type));
+    }
+    chain->operands[chain->count] = operand;
+    chain->operators[chain->count] = operator;
+    chain->count++;
+}
+
+// needs[i] is the label of the chain up to operands[i]
+static bool ga_chain_emit(ga_data_t* data, ga_chain_t* chain, size_t* needs, size_t last) {
+    if(!last) return chain->operand(data, chain->operands[0]);
+
+    int value;
+    bool top = chain->flags && last == chain->count - 1;
+    if(chain->join_constant) {
+        if(chain->constant(chain->operands[last], &value)) {
+            if(!ga_chain_emit(data, chain, needs, last - 1)) return false;
+            data->flags_only = top;
+            bool success = chain->join_constant(data, chain->operators[last], value);
+            data->flags_only = false;
+            return success;
+        }
+        // a constant first operand of +, *, == or != trades places with the second
+        operator_type first = chain->operators[1];
+        bool commutes = first == OPERATOR_ADD || first == OPERATOR_MULT || first == OPERATOR_EQUALS || first == OPERATOR_NOT_EQUAL;
+        if(last == 1 && commutes && chain->constant(chain->operands[0], &value)) {
+            if(!chain->operand(data, chain->operands[1])) return false;
+            data->flags_only = top;
+            bool success = chain->join_constant(data, first, value);
+            data->flags_only = false;
+            return success;
+        }
+    }
+
+    bool reversed = ((node_t*)chain->operands[last])->need > needs[last - 1];
+    if(reversed) {
+        if(!chain->operand(data, chain->operands[last])) return false;
+        ga_push(data);
+        if(!ga_chain_emit(data, chain, needs, last - 1)) return false;
+    } else {
+        if(!ga_chain_emit(data, chain, needs, last - 1)) return false;
+        ga_push(data);
+        if(!chain->operand(data, chain->operands[last])) return false;
+    }
+    data->flags_only = top;
+    bool success = chain->join(data, chain->operators[last], reversed);
+    data->flags_only = false;
+    return success;
+}
+
+static bool ga_chain_run(ga_data_t* data, ga_chain_t* chain) {
+    size_t* needs = (size_t*)malloc(chain->count * sizeof(size_t));
+    needs[0] = ((node_t*)chain->operands[0])->need;
+    for(size_t i = 1; i < chain->count; ++i)
+        needs[i] = ga_need_combine(needs[i - 1], ((node_t*)chain->operands[i])->need);
+
+    bool success = ga_chain_emit(data, chain, needs, chain->count - 1);
+    free(needs);
+    free(chain->operands);
+    free(chain->operators);
+    return success;
+}
+
+static bool ga_relation_operand(ga_data_t* data, void* relation) {
+    return ga_exp_relation(data, (node_exp_relation_t*)relation);
+}
+
+static bool ga_sum_operand(ga_data_t* data, void* sum) {
+    return ga_exp_sum(data, (node_exp_sum_t*)sum);
+}
+
+static bool ga_term_operand(ga_data_t* data, void* term) {
+    return ga_term(data, (node_term_t*)term);
+}
+
+static bool ga_factor_operand(ga_data_t* data, void* factor) {
+    return ga_factor(data, (node_factor_t*)factor);
+}
 
-        sub = sub->next;
+// CONSTANT OPERANDS, joined straight into eax without a temporary
+
+static bool ga_is_power_of_two(uint32_t value) {
+    return value && !(value & (value - 1));
+}
+
+// shifts, lea for 3, 5 and 9, and a shifted copy added or subtracted for
+// 2^n + 1 and 2^n - 1, each followed by a shift for the even part, where the
+// core is no slower at them than at imul
+static void ga_mul_constant(ga_data_t* data, int value) {
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    mir_t* mir = data->mir;
+    if(!magnitude) {
+        mir_emit(mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+        return;
+    }
+
+    int shift = __builtin_ctz(magnitude);
+    uint32_t odd = magnitude >> shift;
+    // for size, no more than one instruction beats the three bytes of imul
+    bool single = value == -1 || (value > 0 && (odd == 1 || (!shift && (odd == 3 || odd == 5 || odd == 9))));
+    if(data->options->optimize_size && !single) {
+        mir_emit(mir, MIR_IMUL, 3, mir_imm(value), GA_EAX, GA_EAX);
+        return;
+    }
+
+    // otherwise imul unless the core gets through the sequence sooner
+    const tune_table_t* tune = data->options->tune;
+    tune_sequence_t sequence = { 0, 0, 0 }, imul = { 0, 0, 0 };
+    tune_add(&imul, tune, TUNE_IMUL);
+    if(odd == 3 || odd == 5 || odd == 9) {
+        tune_add(&sequence, tune, TUNE_LEA_SCALED);
+    } else if(odd != 1) {
+        tune_add(&sequence, tune, TUNE_MOV);
+        tune_add(&sequence, tune, TUNE_SHIFT);
+        tune_add(&sequence, tune, TUNE_ALU);
+    }
+    if(shift) tune_add(&sequence, tune, TUNE_SHIFT);
+    if(value < 0) tune_add(&sequence, tune, TUNE_ALU);
+    if(!tune_no_slower(&sequence, &imul)) {
+        mir_emit(mir, MIR_IMUL, 3, mir_imm(value), GA_EAX, GA_EAX);
+        return;
+    }
+
+    if(odd == 3 || odd == 5 || odd == 9) {
+        mir_emit(mir, MIR_LEA, 2, mir_mem_index(MIR_AX, MIR_AX, odd - 1, 0, 4), GA_EAX);
+    } else if(odd != 1 && (ga_is_power_of_two(odd - 1) || ga_is_power_of_two(odd + 1))) {
+        bool add = ga_is_power_of_two(odd - 1);
+        ga_clobber(data, RA_BIT(GA_REG_ECX));
+        mir_emit(mir, MIR_MOV, 2, GA_EAX, GA_ECX);
+        mir_emit(mir, MIR_SHL, 2, mir_imm(__builtin_ctz(add ? odd - 1 : odd + 1)), GA_EAX);
+        mir_emit(mir, add ? MIR_ADD : MIR_SUB, 2, GA_ECX, GA_EAX);
+    } else if(odd != 1) {
+        mir_emit(mir, MIR_IMUL, 3, mir_imm(value), GA_EAX, GA_EAX);
+        return;
+    }
+    if(shift) mir_emit(mir, MIR_SHL, 2, mir_imm(shift), GA_EAX);
+    if(value < 0) mir_emit(mir, MIR_NEG, 1, GA_EAX);
+}
+
+// multiplier and shift dividing a signed 32 bit value by d, |d| > 1 and not a power
+// of two, as derived in Hacker's Delight 10-6
+static void ga_magic(int d, int* multiplier, int* shift) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? -(uint32_t)d : (uint32_t)d;
+    uint32_t t = two31 + ((uint32_t)d >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    int p = 31;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if(r1 >= anc) { q1++; r1 -= anc; }
+        q2 *= 2;
+        r2 *= 2;
+        if(r2 >= ad) { q2++; r2 -= ad; }
+        delta = ad - r2;
+    } while(q1 < delta || (q1 == delta && r1 == 0));
+
+    *multiplier = (int)(q2 + 1);
+    if(d < 0) *multiplier = -*multiplier;
+    *shift = p - 32;
+}
+
+static void ga_idiv_constant(ga_data_t* data, int value) {
+    ga_clobber(data, GA_DIVISION_CLOBBERS);
+    mir_emit(data->mir, MIR_MOV, 2, mir_imm(value), GA_ECX);
+    mir_emit(data->mir, MIR_CDQ, 0);
+    mir_emit(data->mir, MIR_IDIV, 1, GA_ECX);
+}
+
+// division rounds toward zero, so negative dividends are biased before an
+// arithmetic shift and magic quotients are corrected by their sign
+static void ga_div_constant(ga_data_t* data, int value) {
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    mir_t* mir = data->mir;
+    // 0 still traps like the division it is, and for size idiv is never longer
+    // than what replaces it except halving
+    if(!magnitude || (data->options->optimize_size && magnitude > 1 && value != 2)) {
+        ga_idiv_constant(data, value);
+        return;
+    }
+
+    if(ga_is_power_of_two(magnitude)) {
+        int shift = __builtin_ctz(magnitude);
+        if(shift) {
+            ga_clobber(data, RA_BIT(GA_REG_EDX));
+            mir_emit(mir, MIR_CDQ, 0);
+            mir_emit(mir, MIR_SHR, 2, mir_imm(32 - shift), GA_EDX);
+            mir_emit(mir, MIR_ADD, 2, GA_EDX, GA_EAX);
+            mir_emit(mir, MIR_SAR, 2, mir_imm(shift), GA_EAX);
+        }
+        if(value < 0) mir_emit(mir, MIR_NEG, 1, GA_EAX);
+        return;
+    }
+
+    int multiplier, shift;
+    ga_magic(value, &multiplier, &shift);
+    bool corrects = (value > 0 && multiplier < 0) || (value < 0 && multiplier > 0);
+
+    // a core dividing about as fast as it multiplies is better off with idiv
+    const tune_table_t* tune = data->options->tune;
+    tune_sequence_t magic = { 0, 0, 0 }, divide = { 0, 0, 0 };
+    tune_add(&magic, tune, TUNE_MOV);
+    tune_add(&magic, tune, TUNE_IMUL_WIDE);
+    if(corrects) tune_add(&magic, tune, TUNE_ALU);
+    if(shift) tune_add(&magic, tune, TUNE_SHIFT);
+    tune_add(&magic, tune, TUNE_ALU);
+    tune_add(&magic, tune, TUNE_MOV);
+    tune_add(&divide, tune, TUNE_CDQ);
+    tune_add(&divide, tune, TUNE_IDIV);
+    if(tune_no_slower(&divide, &magic)) {
+        ga_idiv_constant(data, value);
+        return;
     }
 
+    ga_clobber(data, GA_DIVISION_CLOBBERS);
+    mir_emit(mir, MIR_MOV, 2, GA_EAX, GA_ECX);
+    mir_emit(mir, MIR_MOV, 2, mir_imm(multiplier), GA_EDX);
+    mir_emit(mir, MIR_IMUL, 1, GA_EDX);
+    if(corrects) mir_emit(mir, value > 0 ? MIR_ADD : MIR_SUB, 2, GA_ECX, GA_EDX);
+    if(shift) mir_emit(mir, MIR_SAR, 2, mir_imm(shift), GA_EDX);
+    if(value > 0) {
+        mir_emit(mir, MIR_MOV, 2, GA_ECX, GA_EAX);
+        mir_emit(mir, MIR_SAR, 2, mir_imm(31), GA_EAX);
+        mir_emit(mir, MIR_SUB, 2, GA_EAX, GA_EDX);
+        mir_emit(mir, MIR_MOV, 2, GA_EDX, GA_EAX);
+    } else {
+        mir_emit(mir, MIR_MOV, 2, GA_EDX, GA_EAX);
+        mir_emit(mir, MIR_SHR, 2, mir_imm(31), GA_EAX);
+        mir_emit(mir, MIR_ADD, 2, GA_EDX, GA_EAX);
+    }
+}
+
+static bool ga_factor_constant(void* factor, int* value) {
+    node_factor_t* f = (node_factor_t*)factor;
+    if(f->type != FACTOR_CONST) return false;
+    *value = (int)f->literal;
     return true;
 }
 
-// sum eax, with next term store in eax
-bool ga_subexp_sum(ga_data_t* data, node_exp_sum_subexp_t* sub) {
-    fputs("\tmovl\t%eax, %ecx\n", data->fp);
-    if(!ga_term(data, sub->term)) return false;
+static bool ga_term_constant(void* term, int* value) {
+    node_term_t* t = (node_term_t*)term;
+    return !t->subterms && ga_factor_constant(t->factor, value);
+}
 
-    if(sub->operator == OPERATOR_ADD) {
-        fputs("\taddl\t%ecx, %eax\n", data->fp);
-        return true;
-    } else if(sub->operator == OPERATOR_MINUS) {
-        fputs("\tsubl\t%eax, %ecx\n", data->fp);
-        fputs("\txchg\t%eax, %ecx\n", data->fp);
-        return true;
+static bool ga_sum_constant(void* sum, int* value) {
+    node_exp_sum_t* s = (node_exp_sum_t*)sum;
+    return !s->subexps && ga_term_constant(s->term, value);
+}
+
+static bool ga_relation_constant(void* relation, int* value) {
+    node_exp_relation_t* r = (node_exp_relation_t*)relation;
+    return !r->subexps && ga_sum_constant(r->sum, value);
+}
+
+static bool ga_sum_constant_operator(ga_data_t* data, operator_type operator, int value) {
+    if(operator == OPERATOR_ADD) {
+        if(value) mir_emit(data->mir, MIR_ADD, 2, mir_imm(value), GA_EAX);
+    } else if(operator == OPERATOR_MINUS) {
+        if(value) mir_emit(data->mir, MIR_SUB, 2, mir_imm(value), GA_EAX);
+    } else
+        return false;
+    return true;
+}
+
+static bool ga_term_constant_operator(ga_data_t* data, operator_type operator, int value) {
+    if(operator == OPERATOR_MULT)
+        ga_mul_constant(data, value);
+    else if(operator == OPERATOR_DIVID)
+        ga_div_constant(data, value);
+    else
+        return false;
+    return true;
+}
+
+// condition codes of the comparison operators
+static bool ga_condition(operator_type operator, mir_cc* cc) {
+    switch(operator) {
+    case OPERATOR_EQUALS: *cc = MIR_CC_E; return true;
+    case OPERATOR_NOT_EQUAL: *cc = MIR_CC_NE; return true;
+    case OPERATOR_LESS_THAN: *cc = MIR_CC_L; return true;
+    case OPERATOR_LESS_THAN_OR_EQUAL: *cc = MIR_CC_LE; return true;
+    case OPERATOR_GREATER_THAN: *cc = MIR_CC_G; return true;
+    case OPERATOR_GREATER_THAN_OR_EQUAL: *cc = MIR_CC_GE; return true;
+    default: return false;
     }
+}
 
-    return false;
+// a branch reads the flags itself, a value is set from them
+static void ga_compare_result(ga_data_t* data, mir_cc cc) {
+    if(data->flags_only) {
+        data->cc = cc;
+    } else {
+        mir_emit(data->mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+        mir_emit_cc(data->mir, MIR_SETCC, cc, GA_AL);
+    }
 }
 
-bool ga_exp_sum(ga_data_t* data, node_exp_sum_t* sum) {
-    if(!ga_term(data, sum->term)) return false;
-    //fputs("\tpush\t%eax\n", fp);
+// cmpl sets the flags from left - right either way round
+static bool ga_compare_operator(ga_data_t* data, operator_type operator, bool reversed) {
+    mir_cc cc;
+    if(!ga_condition(operator, &cc)) return false;
+    if(reversed)
+        mir_emit(data->mir, MIR_CMP, 2, ga_pop(data), GA_EAX);
+    else
+        mir_emit(data->mir, MIR_CMP, 2, GA_EAX, ga_pop(data));
+    ga_compare_result(data, cc);
+    return true;
+}
+
+static bool ga_compare_constant_operator(ga_data_t* data, operator_type operator, int value) {
+    mir_cc cc;
+    if(!ga_condition(operator, &cc)) return false;
+    if(value)
+        mir_emit(data->mir, MIR_CMP, 2, mir_imm(value), GA_EAX);
+    else
+        mir_emit(data->mir, MIR_TEST, 2, GA_EAX, GA_EAX);
+    ga_compare_result(data, cc);
+    return true;
+}
 
-    node_exp_sum_subexp_t* sub = sum->subexps;
-    while(sub) {
-        fputs("\tpush\t%eax\n", data->fp);
-        if(!ga_term(data, sub->term)) return false;
-        fputs("\tpop\t\t%ecx\n", data->fp);
+static bool ga_subtract_in_place(ga_data_t* data) {
+    const tune_table_t* tune = data->options->tune;
+    tune_sequence_t in_place = { 0, 0, 0 }, negated = { 0, 0, 0 };
+    tune_add(&in_place, tune, TUNE_ALU);
+    tune_add(&in_place, tune, TUNE_MOV);
+    tune_add(&negated, tune, TUNE_ALU);
+    tune_add(&negated, tune, TUNE_ALU);
+    return !tune_no_slower(&negated, &in_place);
+}
 
-        if(sub->operator == OPERATOR_ADD) {
-            fputs("\taddl\t%ecx, %eax\n", data->fp);
-        } else if(sub->operator == OPERATOR_MINUS) {
-            fputs("\tsubl\t%eax, %ecx\n", data->fp);
-            fputs("\txchg\t%eax, %ecx\n", data->fp);
+static bool ga_sum_operator(ga_data_t* data, operator_type operator, bool reversed) {
+    if(operator == OPERATOR_ADD) {
+        mir_emit(data->mir, MIR_ADD, 2, ga_pop(data), GA_EAX);
+    } else if(operator == OPERATOR_MINUS) {
+        // left - right is -right + left when the left operand waited, or is
+        // subtracted in the left's register and moved back where the core
+        // renames the move away
+        if(reversed) {
+            mir_emit(data->mir, MIR_SUB, 2, ga_pop(data), GA_EAX);
+            return true;
         }
+        mir_operand_t left = ga_pop(data);
+        if(left.kind == MIR_OPERAND_REG && ga_subtract_in_place(data)) {
+            mir_emit(data->mir, MIR_SUB, 2, GA_EAX, left);
+            mir_emit(data->mir, MIR_MOV, 2, left, GA_EAX);
+        } else {
+            mir_emit(data->mir, MIR_NEG, 1, GA_EAX);
+            mir_emit(data->mir, MIR_ADD, 2, left, GA_EAX);
+        }
+    } else
+        return false;
+    return true;
+}
+
+static bool ga_term_operator(ga_data_t* data, operator_type operator, bool reversed) {
+    if(operator == OPERATOR_MULT) {
+        mir_emit(data->mir, MIR_IMUL, 2, ga_pop(data), GA_EAX);
+    } else if(operator == OPERATOR_DIVID) {
+        // the dividend has to be in eax, a waiting left operand moves there through ecx
+        if(reversed) {
+            // cdq overwrites edx before idiv reads the divisor
+            ga_clobber(data, RA_BIT(GA_REG_EDX));
+            mir_operand_t divisor = ga_pop(data);
+            mir_emit(data->mir, MIR_CDQ, 0);
+            mir_emit(data->mir, MIR_IDIV, 1, divisor);
+        } else {
+            ga_clobber(data, GA_DIVISION_CLOBBERS);
+            mir_emit(data->mir, MIR_MOV, 2, GA_EAX, GA_ECX);
+            mir_emit(data->mir, MIR_MOV, 2, ga_pop(data), GA_EAX);
+            mir_emit(data->mir, MIR_CDQ, 0);
+            mir_emit(data->mir, MIR_IDIV, 1, GA_ECX);
+        }
+    } else
+        return false;
+    return true;
+}
 
-        sub = sub->next;
+// CONDITIONS, a boolean operand of && or || branches on the flags of its own
+// comparison instead of producing 0 or 1 and testing that
+
+static bool ga_equals_chain(ga_data_t* data, node_exp_equals_t* equals, bool flags);
+static bool ga_relation_chain(ga_data_t* data, node_exp_relation_t* relation, bool flags);
+static bool ga_cond_expression(ga_data_t* data, node_exp_t* exp, bool jump_if, const char* prefix, size_t label);
+
+static void ga_jump(ga_data_t* data, mir_cc cc, bool jump_if, const char* prefix, size_t label) {
+    ga_jcc(data, jump_if ? cc : MIR_CC_INVERSE(cc), prefix, label);
+}
+
+// jump to prefix label when the factor's truth is jump_if, fall through otherwise
+static bool ga_cond_factor(ga_data_t* data, node_factor_t* factor, bool jump_if, const char* prefix, size_t label) {
+    if(factor->type == FACTOR_PAREN)
+        return ga_cond_expression(data, factor->exp, jump_if, prefix, label);
+    if(factor->type == FACTOR_UNARY_OP && factor->operator == OPERATOR_LOGICAL_NOT)
+        return ga_cond_factor(data, factor->factor, !jump_if, prefix, label);
+    if(factor->type == FACTOR_CONST) {
+        if((factor->literal != 0) == jump_if) ga_jmp(data, prefix, label);
+        return true;
+    }
+
+    if(!ga_factor(data, factor)) return false;
+    mir_emit(data->mir, MIR_TEST, 2, GA_EAX, GA_EAX);
+    ga_jump(data, MIR_CC_NE, jump_if, prefix, label);
+    return true;
+}
+
+static bool ga_cond_sum(ga_data_t* data, node_exp_sum_t* sum, bool jump_if, const char* prefix, size_t label) {
+    if(!sum->subexps && !sum->term->subterms)
+        return ga_cond_factor(data, sum->term->factor, jump_if, prefix, label);
+
+    if(!ga_exp_sum(data, sum)) return false;
+    mir_emit(data->mir, MIR_TEST, 2, GA_EAX, GA_EAX);
+    ga_jump(data, MIR_CC_NE, jump_if, prefix, label);
+    return true;
+}
+
+static bool ga_cond_relation(ga_data_t* data, node_exp_relation_t* relation, bool jump_if, const char* prefix, size_t label) {
+    if(!relation->subexps) return ga_cond_sum(data, relation->sum, jump_if, prefix, label);
+
+    if(!ga_relation_chain(data, relation, true)) return false;
+    ga_jump(data, data->cc, jump_if, prefix, label);
+    return true;
+}
+
+static bool ga_cond_equals(ga_data_t* data, node_exp_equals_t* equals, bool jump_if, const char* prefix, size_t label) {
+    if(!equals->subexps) return ga_cond_relation(data, equals->relation, jump_if, prefix, label);
+
+    if(!ga_equals_chain(data, equals, true)) return false;
+    ga_jump(data, data->cc, jump_if, prefix, label);
+    return true;
+}
+
+// a false operand decides &&, so jumping when it is true needs a way past the rest
+static bool ga_cond_and(ga_data_t* data, node_exp_and_t* and, bool jump_if, const char* prefix, size_t label) {
+    if(!and->subexps) return ga_cond_equals(data, and->equals, jump_if, prefix, label);
+
+    size_t skip = jump_if ? data->label_index++ : 0;
+    node_exp_equals_t* equals = and->equals;
+    for(node_exp_and_subexp_t* sub = and->subexps; equals; sub = sub ? sub->next : NULL) {
+        node_exp_equals_t* next = sub ? sub->equals : NULL;
+        bool success;
+        if(!jump_if)
+            success = ga_cond_equals(data, equals, false, prefix, label);
+        else if(next)
+            success = ga_cond_equals(data, equals, false, ".b", skip);
+        else
+            success = ga_cond_equals(data, equals, true, prefix, label);
+        if(!success) return false;
+        equals = next;
     }
+    if(jump_if) ga_label(data, ".b", skip);
+    return true;
+}
 
+static bool ga_cond_expression(ga_data_t* data, node_exp_t* exp, bool jump_if, const char* prefix, size_t label) {
+    if(!exp->subexps) return ga_cond_and(data, exp->and_exp, jump_if, prefix, label);
+
+    size_t skip = jump_if ? 0 : data->label_index++;
+    node_exp_and_t* and = exp->and_exp;
+    for(node_exp_subexp_t* sub = exp->subexps; and; sub = sub ? sub->next : NULL) {
+        node_exp_and_t* next = sub ? sub->and_exp : NULL;
+        bool success;
+        if(jump_if)
+            success = ga_cond_and(data, and, true, prefix, label);
+        else if(next)
+            success = ga_cond_and(data, and, true, ".b", skip);
+        else
+            success = ga_cond_and(data, and, false, prefix, label);
+        if(!success) return false;
+        and = next;
+    }
+    if(!jump_if) ga_label(data, ".b", skip);
     return true;
 }
 
-// mult eax, with next subterm (can't use ecx)
-bool ga_subterm(ga_data_t* data, node_term_subterm_t* term) {
-    fputs("\tmovl\t%eax, %ebx\n", data->fp);
-    ga_factor(data, term->factor);
+// BRANCHLESS, when the operands after the first cannot trap or call out all of
+// them may be evaluated, their truth values combined with andl or orl
+
+// factors the later operands may cost before a branch is cheaper, each about a
+// cycle against half a mispredict, the share of the branches it gets wrong
+#define GA_BRANCHLESS_COST(_data) ((_data)->options->tune->branch_miss / 2)
+// an operand true or false this often in the profile predicts its branch well
+#define GA_PREDICTABLE_PERCENT 10
+
+static bool ga_predictable(ga_data_t* data, size_t probe) {
+    int percent;
+    return ga_true_percent(data, probe, &percent) &&
+        (percent <= GA_PREDICTABLE_PERCENT || percent >= 100 - GA_PREDICTABLE_PERCENT);
+}
+
+// cost is 0 when some later operand is unsafe, predictable when every branch is
+static bool ga_branchless_pays(ga_data_t* data, size_t cost, bool predictable) {
+    if(!cost || data->options->branchless == GA_BRANCHLESS_NEVER) return false;
+    if(data->options->branchless == GA_BRANCHLESS_ALWAYS) return true;
+    // evaluating everything is never the shorter lowering
+    if(data->options->optimize_size) return false;
+    return cost <= GA_BRANCHLESS_COST(data) && !predictable;
+}
+
+static bool ga_branchless_or(ga_data_t* data, node_exp_t* exp) {
+    size_t cost = 0;
+    bool predictable = ga_predictable(data, exp->and_exp->probe);
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) {
+        size_t operand = profile_cost_and(sub->and_exp);
+        if(!operand) return false;
+        cost += operand;
+        if(sub->next) predictable = predictable && ga_predictable(data, sub->and_exp->probe);
+    }
+    return ga_branchless_pays(data, cost, predictable);
+}
+
+static bool ga_branchless_and(ga_data_t* data, node_exp_and_t* and) {
+    size_t cost = 0;
+    bool predictable = ga_predictable(data, and->equals->probe);
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) {
+        size_t operand = profile_cost_equals(sub->equals);
+        if(!operand) return false;
+        cost += operand;
+        if(sub->next) predictable = predictable && ga_predictable(data, sub->equals->probe);
+    }
+    return ga_branchless_pays(data, cost, predictable);
+}
+
+// eax becomes 1 when it was not 0, tested with testl or compared with cmpl $0
+static void ga_truth(ga_data_t* data, mir_opcode test) {
+    if(test == MIR_TEST)
+        mir_emit(data->mir, MIR_TEST, 2, GA_EAX, GA_EAX);
+    else
+        mir_emit(data->mir, MIR_CMP, 2, mir_imm(0), GA_EAX);
+    mir_emit(data->mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+    mir_emit_cc(data->mir, MIR_SETCC, MIR_CC_NE, GA_AL);
+}
+
+// 0 or 1 in eax, comparisons and logical operators produce one already
+static bool ga_truth_equals_operand(ga_data_t* data, void* operand) {
+    node_exp_equals_t* equals = (node_exp_equals_t*)operand;
+    if(!ga_exp_equals(data, equals)) return false;
+    if(!equals->subexps && !equals->relation->subexps)
+        ga_truth(data, MIR_TEST);
+    return true;
+}
+
+static bool ga_truth_and_operand(ga_data_t* data, void* operand) {
+    node_exp_and_t* and = (node_exp_and_t*)operand;
+    if(and->subexps) return ga_exp_and(data, and);
+    return ga_truth_equals_operand(data, and->equals);
+}
+
+static bool ga_logic_operator(ga_data_t* data, operator_type operator, bool reversed) {
+    mir_emit(data->mir, operator == OPERATOR_AND ? MIR_AND : MIR_OR, 2, ga_pop(data), GA_EAX);
+    return true;
+}
+
+static bool ga_branchless_or_chain(ga_data_t* data, node_exp_t* exp) {
+    ga_chain_t chain;
+    ga_chain_init(&chain, ga_truth_and_operand, ga_logic_operator);
+    ga_chain_add(&chain, exp->and_exp, OPERATOR_INVALID);
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next)
+        ga_chain_add(&chain, sub->and_exp, OPERATOR_OR);
+    return ga_chain_run(data, &chain);
+}
+
+static bool ga_branchless_and_chain(ga_data_t* data, node_exp_and_t* and) {
+    ga_chain_t chain;
+    ga_chain_init(&chain, ga_truth_equals_operand, ga_logic_operator);
+    ga_chain_add(&chain, and->equals, OPERATOR_INVALID);
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next)
+        ga_chain_add(&chain, sub->equals, OPERATOR_AND);
+    return ga_chain_run(data, &chain);
+}
+
+// instrumented builds count every operand of && and || and whether it was
+// true, so they keep each operand's value in eax
+static bool ga_expression_counted(ga_data_t* data, node_exp_t* exp) {
+    if(!ga_exp_and(data, exp->and_exp)) return false;
+    ga_count_operand(data, exp->and_exp->probe);
+
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) {
+        size_t currIndex = data->label_index++;
+        mir_emit(data->mir, MIR_CMP, 2, mir_imm(0), GA_EAX);
+        ga_jcc(data, MIR_CC_E, ".o", currIndex);
+        mir_emit(data->mir, MIR_MOV, 2, mir_imm(1), GA_EAX);
+        ga_jmp(data, ".oe", currIndex);
+        ga_label(data, ".o", currIndex);
+
+        if(!ga_exp_and(data, sub->and_exp)) return false;
+        ga_count_operand(data, sub->and_exp->probe);
+
+        ga_truth(data, MIR_CMP);
+        ga_label(data, ".oe", currIndex);
+    }
+    return true;
+}
 
-    if(term->operator == OPERATOR_MULT) {
-        fputs("\timul\t%ebx, %eax\n", data->fp);
+static bool ga_exp_and_counted(ga_data_t* data, node_exp_and_t* and) {
+    if(!ga_exp_equals(data, and->equals)) return false;
+    ga_count_operand(data, and->equals->probe);
+
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) {
+        size_t currIndex = data->label_index++;
+        mir_emit(data->mir, MIR_CMP, 2, mir_imm(0), GA_EAX);
+        ga_jcc(data, MIR_CC_NE, ".a", currIndex);
+        ga_jmp(data, ".ae", currIndex);
+        ga_label(data, ".a", currIndex);
+
+        if(!ga_exp_equals(data, sub->equals)) return false;
+        ga_count_operand(data, sub->equals->probe);
+
+        ga_truth(data, MIR_CMP);
+        ga_label(data, ".ae", currIndex);
+    }
+    return true;
+}
+
+// the operands branch to a block storing 1, placed out of line in a cold block
+// unless the profile says some operand is usually true or size matters more,
+// the branches to it being short when it is inline
+bool ga_expression(ga_data_t* data, node_exp_t* exp) {
+    if(GA_PROFILING(data)) return ga_expression_counted(data, exp);
+    if(!exp->subexps) return ga_exp_and(data, exp->and_exp);
+    if(ga_branchless_or(data, exp)) return ga_branchless_or_chain(data, exp);
+
+    bool usually_true = data->options->optimize_size;
+    int percent;
+    if(ga_true_percent(data, exp->and_exp->probe, &percent) && percent >= 50) usually_true = true;
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) {
+        if(ga_true_percent(data, sub->and_exp->probe, &percent) && percent >= 50) usually_true = true;
+    }
+
+    size_t end = data->label_index++;
+    size_t target = usually_true ? data->label_index++ : ga_cold(data, 1, end);
+    const char* prefix = usually_true ? ".o" : ".c";
+    if(!ga_cond_and(data, exp->and_exp, true, prefix, target)) return false;
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) {
+        if(!ga_cond_and(data, sub->and_exp, true, prefix, target)) return false;
+    }
+
+    mir_emit(data->mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+    if(usually_true) {
+        ga_jmp(data, ".oe", end);
+        ga_label(data, ".o", target);
+        mir_emit(data->mir, MIR_MOV, 2, mir_imm(1), GA_EAX);
+    }
+    ga_label(data, ".oe", end);
+    return true;
+}
+
+// the mirror of ||, operands branch to a block storing 0
+bool ga_exp_and(ga_data_t* data, node_exp_and_t* and) {
+    if(GA_PROFILING(data)) return ga_exp_and_counted(data, and);
+    if(!and->subexps) return ga_exp_equals(data, and->equals);
+    if(ga_branchless_and(data, and)) return ga_branchless_and_chain(data, and);
+
+    bool usually_false = data->options->optimize_size;
+    int percent;
+    if(ga_true_percent(data, and->equals->probe, &percent) && percent < 50) usually_false = true;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) {
+        if(ga_true_percent(data, sub->equals->probe, &percent) && percent < 50) usually_false = true;
+    }
+
+    size_t end = data->label_index++;
+    size_t target = usually_false ? data->label_index++ : ga_cold(data, 0, end);
+    const char* prefix = usually_false ? ".a" : ".c";
+    if(!ga_cond_equals(data, and->equals, false, prefix, target)) return false;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) {
+        if(!ga_cond_equals(data, sub->equals, false, prefix, target)) return false;
+    }
+
+    mir_emit(data->mir, MIR_MOV, 2, mir_imm(1), GA_EAX);
+    if(usually_false) {
+        ga_jmp(data, ".oe", end);
+        ga_label(data, ".a", target);
+        mir_emit(data->mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+    }
+    ga_label(data, ".oe", end);
+    return true;
+}
+
+static bool ga_equals_chain(ga_data_t* data, node_exp_equals_t* equals, bool flags) {
+    ga_chain_t chain;
+    ga_chain_init(&chain, ga_relation_operand, ga_compare_operator);
+    chain.constant = ga_relation_constant;
+    chain.join_constant = ga_compare_constant_operator;
+    chain.flags = flags;
+    ga_chain_add(&chain, equals->relation, OPERATOR_INVALID);
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next)
+        ga_chain_add(&chain, sub->relation, sub->operator);
+    return ga_chain_run(data, &chain);
+}
+
+bool ga_exp_equals(ga_data_t* data, node_exp_equals_t* equals) {
+    if(!equals->subexps) return ga_exp_relation(data, equals->relation);
+    return ga_equals_chain(data, equals, false);
+}
+
+static bool ga_relation_chain(ga_data_t* data, node_exp_relation_t* relation, bool flags) {
+    ga_chain_t chain;
+    ga_chain_init(&chain, ga_sum_operand, ga_compare_operator);
+    chain.constant = ga_sum_constant;
+    chain.join_constant = ga_compare_constant_operator;
+    chain.flags = flags;
+    ga_chain_add(&chain, relation->sum, OPERATOR_INVALID);
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next)
+        ga_chain_add(&chain, sub->sum, sub->relation);
+    return ga_chain_run(data, &chain);
+}
+
+bool ga_exp_relation(ga_data_t* data, node_exp_relation_t* relation) {
+    if(!relation->subexps) return ga_exp_sum(data, relation->sum);
+    return ga_relation_chain(data, relation, false);
+}
+
+// sum eax, with next term store in eax
+bool ga_subexp_sum(ga_data_t* data, node_exp_sum_subexp_t* sub) {
+    mir_emit(data->mir, MIR_MOV, 2, GA_EAX, GA_ECX);
+    if(!ga_term(data, sub->term)) return false;
+
+    if(sub->operator == OPERATOR_ADD) {
+        mir_emit(data->mir, MIR_ADD, 2, GA_ECX, GA_EAX);
         return true;
-    } else if(term->operator == OPERATOR_DIVID) {
-        fputs("\txchg\t%eax, %ebx\n\tcdq\n", data->fp);
-        fputs("\tidiv\t%ebx\n", data->fp);
+    } else if(sub->operator == OPERATOR_MINUS) {
+        mir_emit(data->mir, MIR_SUB, 2, GA_EAX, GA_ECX);
+        mir_emit(data->mir, MIR_XCHG, 2, GA_EAX, GA_ECX);
         return true;
     }
 
     return false;
 }
 
+bool ga_exp_sum(ga_data_t* data, node_exp_sum_t* sum) {
+    if(!sum->subexps) return ga_term(data, sum->term);
+
+    ga_chain_t chain;
+    ga_chain_init(&chain, ga_term_operand, ga_sum_operator);
+    chain.constant = ga_term_constant;
+    chain.join_constant = ga_sum_constant_operator;
+    ga_chain_add(&chain, sum->term, OPERATOR_INVALID);
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next)
+        ga_chain_add(&chain, sub->term, sub->operator);
+    return ga_chain_run(data, &chain);
+}
+
 // save result in eax
 bool ga_term(ga_data_t* data, node_term_t* term) {
-    if(!ga_factor(data, term->factor)) return false;
-    
-    node_term_subterm_t* sub = term->subterms;
-    while(sub) {
-        if(!ga_subterm(data, sub)) return false;
-        sub = sub->next;
-    }
+    if(!term->subterms) return ga_factor(data, term->factor);
 
-    return true;
+    ga_chain_t chain;
+    ga_chain_init(&chain, ga_factor_operand, ga_term_operator);
+    chain.constant = ga_factor_constant;
+    chain.join_constant = ga_term_constant_operator;
+    ga_chain_add(&chain, term->factor, OPERATOR_INVALID);
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next)
+        ga_chain_add(&chain, sub->factor, sub->operator);
+    return ga_chain_run(data, &chain);
 }
 
-// set eax to factors value, save ebx, ecx
+// set eax to factors value, operands waiting on the value stack are kept
 bool ga_factor(ga_data_t* data, node_factor_t* factor) {
     if(factor->type == FACTOR_CONST) {
-        fprintf(data->fp, "\tmovl\t$%u, %%eax\n", factor->literal);
+        mir_emit(data->mir, MIR_MOV, 2, mir_imm((int32_t)factor->literal), GA_EAX);
         return true;
     } else if(factor->type == FACTOR_UNARY_OP) {
         if(!ga_factor(data, factor->factor)) return false;
         switch(factor->operator) {
         case OPERATOR_BITWISE_COMPLEMENT:
-            fputs("\tnot\t\t%eax\n", data->fp);
+            mir_emit(data->mir, MIR_NOT, 1, GA_EAX);
             return true;
         case OPERATOR_MINUS:
-            fputs("\tneg\t\t%eax\n", data->fp);
+            mir_emit(data->mir, MIR_NEG, 1, GA_EAX);
             return true;
         case OPERATOR_LOGICAL_NOT:
-            fputs("\tcmpl\t$0, %eax\n\tmovl\t$0, %eax\n\tsete\t%al\n", data->fp);
+            mir_emit(data->mir, MIR_CMP, 2, mir_imm(0), GA_EAX);
+            mir_emit(data->mir, MIR_MOV, 2, mir_imm(0), GA_EAX);
+            mir_emit_cc(data->mir, MIR_SETCC, MIR_CC_E, GA_AL);
             return true;
         default:
             return false;
         }
     } else if(factor->type == FACTOR_PAREN) {
-        fputs("\tpush\t%ebx\n\tpush\t%ecx\n", data->fp);
-        if(!ga_expression(data, factor->exp)) return false;
-        fputs("\tpop\t\t%ecx\n\tpop\t\t%ebx\n", data->fp);
-        return true;
+        return ga_expression(data, factor->exp);
+    } else if(factor->type == FACTOR_VARIABLE) {
+        node_func_t* func = data->curr_func;
+        for(size_t i = 0; i < func->param_count; ++i) {
+            if(strcmp(func->params[i], factor->name) == 0) {
+                mir_emit(data->mir, MIR_MOV, 2, ga_param(data, i), GA_EAX);
+                return true;
+            }
+        }
+        return false;
+    } else if(factor->type == FACTOR_CALL) {
+        return ga_call(data, factor);
     }
 
     return false;
 }
+
+// SysV call, arguments past the sixth go on the stack right to left above
+// whatever padding keeps the call aligned
+static bool ga_call64(ga_data_t* data, node_factor_t* call) {
+    size_t stack_args = call->arg_count > GA_REG_ARGS ? call->arg_count - GA_REG_ARGS : 0;
+    size_t pad = (data->stack_bytes + 8 * stack_args) % 16;
+    if(pad) mir_emit(data->mir, MIR_SUB, 2, mir_imm(pad), mir_reg(MIR_SP, 8));
+    data->stack_bytes += pad;
+
+    node_exp_t* arg = call->args;
+    for(size_t i = 0; i < GA_REG_ARGS && arg; ++i) arg = (node_exp_t*)arg->node.next;
+    if(!ga_push_args(data, arg)) return false;
+    if(!ga_reg_args(data, call)) return false;
+
+    ga_clobber(data, GA_CALLER_SAVED64);
+    mir_emit(data->mir, MIR_CALL, 1, mir_target(mir_symbol(call->name)));
+    if(stack_args || pad)
+        mir_emit(data->mir, MIR_ADD, 2, mir_imm(8 * stack_args + pad), mir_reg(MIR_SP, 8));
+    data->stack_bytes -= 8 * stack_args + pad;
+    return true;
+}
+
+// cdecl call, result in eax
+bool ga_call(ga_data_t* data, node_factor_t* call) {
+    if(GA_IS_64(data)) return ga_call64(data, call);
+    if(!ga_push_args(data, call->args)) return false;
+    ga_clobber(data, GA_CALLER_SAVED32);
+    mir_emit(data->mir, MIR_CALL, 1, mir_target(mir_symbol(call->name)));
+    if(call->arg_count)
+        mir_emit(data->mir, MIR_ADD, 2, mir_imm(4 * call->arg_count), mir_reg(MIR_SP, 4));
+    return true;
+}
@@ -8,16 +8,147 @@
 
 #include <stdio.h>
 #include "nodes.h"
+#include "profile.h"
+#include "mir.h"
+#include "regalloc.h"
+#include "peephole.h"
+#include "cfg.h"
+#include "tune.h"
+
+typedef struct ga_case_s {
+    int value;
+    size_t label;
+    // profile probe of the case statement and the dispatches it counted
+    size_t probe;
+    uint64_t count;
+} ga_case_t;
+
+typedef struct ga_switch_s {
+    // case labels in source order, adjacent labels share a target
+    ga_case_t* cases;
+    size_t case_count;
+    size_t case_capacity;
+    // cursor into cases while emitting the body
+    size_t next_case;
+
+    bool has_default;
+    size_t default_label;
+    size_t default_probe;
+    size_t end_label;
+} ga_switch_t;
+
+// out of line block storing a short circuit result, placed after the function
+typedef struct ga_cold_s {
+    size_t label;
+    int value;
+    size_t resume;
+} ga_cold_t;
+
+typedef enum ga_target_e {
+    GA_TARGET_X86_64,
+    GA_TARGET_I386
+} ga_target;
+
+// lowering of && and || whose later operands are cheap and cannot trap or call out
+typedef enum ga_branchless_e {
+    GA_BRANCHLESS_AUTO,
+    GA_BRANCHLESS_ALWAYS,
+    GA_BRANCHLESS_NEVER
+} ga_branchless;
+
+// counters kept for every function the program runs, reported when main returns
+typedef enum ga_instrument_e {
+    GA_INSTRUMENT_NONE,
+    // how often each function was called
+    GA_INSTRUMENT_CALLS,
+    // and the time stamp counter cycles spent in it and what it called
+    GA_INSTRUMENT_CYCLES
+} ga_instrument;
+
+typedef struct ga_options_s {
+    ga_target target;
+    // probes numbered on the program, with counters when a profile was loaded
+    profile_t* profile;
+    // count every probe and dump the counters to profile_path when main returns
+    bool profile_generate;
+    const char* profile_path;
+    // run the output through the peephole optimizer counting the rules fired, NULL to skip it
+    ph_stats_t* peephole;
+    // then thread jumps and lay the blocks out again counting what changed, NULL to skip it
+    cfg_stats_t* cfg;
+    // evaluate every operand and combine their truth instead of branching
+    ga_branchless branchless;
+    // emit a _start that calls main and exits with its value, for executables without libc
+    bool start;
+    // prefer the shorter of two sequences over the faster one
+    bool optimize_size;
+    // costs of the core to pick the faster sequence for
+    const tune_table_t* tune;
+    // locate the instructions in the source and describe the frames for debuggers and profilers
+    bool debug_info;
+    // count calls or cycles of every function and write the report to instrument_path
+    ga_instrument instrument;
+    const char* instrument_path;
+} ga_options_t;
 
 typedef struct ga_data_s {
-    FILE* fp;
+    mir_t* mir;
     size_t label_index;
+    ga_options_t* options;
+    // section the current function is emitted to
+    mir_section text_section;
+
+    // innermost switch, target of case labels and break
+    ga_switch_t* curr_switch;
+
+    node_func_t* curr_func;
+    // label after the prologue, self recursive tail calls loop back here
+    size_t entry_label;
+    // returns jump to one shared epilogue when optimizing for size
+    bool shares_epilogue;
+    size_t epilogue_label;
+
+    // temporaries of the current function, a first pass whose instructions are
+    // dropped finds their live intervals and they are allocated before the real one
+    ra_interval_t* intervals;
+    size_t interval_count;
+    size_t interval_capacity;
+    bool measuring;
+    // events seen so far, positions of the intervals
+    size_t position;
+    // temporaries waiting for the right operand of a binary operator, innermost last
+    size_t* live;
+    size_t depth;
+    size_t live_capacity;
+    // temporary the next binary operator writes
+    size_t next_interval;
+    // callee saved registers the prologue saves and slots for spilled temporaries
+    uint32_t saved;
+    size_t spill_slots;
+    // a comparison in a branch leaves its result in the flags, cc names the
+    // condition that holds when it is true
+    bool flags_only;
+    mir_cc cc;
+    // bytes pushed since the prologue, calls keep the 64 bit stack 16 byte aligned
+    size_t stack_bytes;
+
+    ga_cold_t* colds;
+    size_t cold_count;
+    size_t cold_capacity;
+
+    // names of the functions instrumented so far, in the order of their records
+    const char** instrumented;
+    size_t instrumented_count;
+    size_t instrumented_capacity;
 } ga_data_t;
 
-bool generate_asm(FILE* fp, node_root_t* root);
+// instructions of the whole program, peephole optimized when the options ask for it
+bool generate_mir(mir_t* mir, node_root_t* root, ga_options_t* options);
 
 bool ga_function(ga_data_t* data, node_func_t* func);
 bool ga_statement(ga_data_t* data, node_stat_t* stat);
+bool ga_stat_switch(ga_data_t* data, node_stat_t* stat);
+bool ga_stat_return(ga_data_t* data, node_stat_t* stat);
 
 //bool ga_subexpression(ga_data_t* data, node_exp_subexp_t* sub);
 bool ga_expression(ga_data_t* data, node_exp_t* exp);
@@ -31,9 +162,9 @@ bool ga_exp_relation(ga_data_t* data, node_exp_relation_t* relation);
 bool ga_subexp_sum(ga_data_t* data, node_exp_sum_subexp_t* sub);
 bool ga_exp_sum(ga_data_t* data, node_exp_sum_t* sum);
 
-bool ga_subterm(ga_data_t* data, node_term_subterm_t* term);
 bool ga_term(ga_data_t* data, node_term_t* term);
 
 bool ga_factor(ga_data_t* data, node_factor_t* factor);
+bool ga_call(ga_data_t* data, node_factor_t* call);
 
 #endif
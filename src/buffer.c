@@ -0,0 +1,83 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "buffer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BUF_MIN_CAPACITY 4096
+
+void buf_init(buf_t* buf) {
+    memset(buf, 0, sizeof(buf_t));
+}
+
+void free_buf(buf_t* buf) {
+    free(buf->data);
+    memset(buf, 0, sizeof(buf_t));
+}
+
+char* buf_reserve(buf_t* buf, size_t len) {
+    if(buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : BUF_MIN_CAPACITY;
+        while(buf->len + len > capacity) capacity *= 2;
+        buf->data = (char*)realloc(buf->data, capacity);
+        buf->capacity = capacity;
+    }
+    char* start = &buf->data[buf->len];
+    buf->len += len;
+    return start;
+}
+
+void buf_write(buf_t* buf, const void* data, size_t len) {
+    memcpy(buf_reserve(buf, len), data, len);
+}
+
+void buf_putc(buf_t* buf, char c) {
+    *buf_reserve(buf, 1) = c;
+}
+
+void buf_puts(buf_t* buf, const char* str) {
+    buf_write(buf, str, strlen(str));
+}
+
+void buf_put_uint(buf_t* buf, uint64_t value, size_t width) {
+    // digits come out least significant first
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while(value);
+    while(count < width && count < sizeof(digits)) digits[count++] = '0';
+
+    char* out = buf_reserve(buf, count);
+    for(size_t i = 0; i < count; ++i) out[i] = digits[count - 1 - i];
+}
+
+void buf_put_int(buf_t* buf, int64_t value) {
+    if(value < 0) {
+        buf_putc(buf, '-');
+        buf_put_uint(buf, 0 - (uint64_t)value, 0);
+    } else {
+        buf_put_uint(buf, value, 0);
+    }
+}
+
+bool buf_flush(buf_t* buf, int fd) {
+    size_t written = 0;
+    while(written < buf->len) {
+        ssize_t count = write(fd, &buf->data[written], buf->len - written);
+        if(count < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        written += count;
+    }
+    buf->len = 0;
+    return true;
+}
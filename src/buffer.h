@@ -0,0 +1,35 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include "fwd.h"
+
+// Append only bytes, formatted by hand instead of through stdio and written
+// out with a single system call once everything is in.
+
+typedef struct buf_s {
+    char* data;
+    size_t len;
+    size_t capacity;
+} buf_t;
+
+void buf_init(buf_t* buf);
+void free_buf(buf_t* buf);
+
+// room for len more bytes, returned for the caller to fill
+char* buf_reserve(buf_t* buf, size_t len);
+void buf_write(buf_t* buf, const void* data, size_t len);
+void buf_putc(buf_t* buf, char c);
+void buf_puts(buf_t* buf, const char* str);
+// decimal, padded with zeros to at least width digits
+void buf_put_uint(buf_t* buf, uint64_t value, size_t width);
+void buf_put_int(buf_t* buf, int64_t value);
+
+// write everything to fd, retrying short writes
+bool buf_flush(buf_t* buf, int fd);
+
+#endif
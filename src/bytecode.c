@@ -0,0 +1,584 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "bytecode.h"
+#include "const_eval.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char* bc_opcode_names[BC_OPCODE_COUNT] = {
+    BC_OPCODE_LIST(STIRNG_LIST_ITEM, )
+};
+
+// no enclosing switch, or one without a default
+#define BC_NONE ((size_t)-1)
+// end of a list of jumps waiting for their target, chained through c
+#define BC_NO_JUMP -1
+
+typedef struct bc_data_s {
+    bc_program_t* program;
+    node_func_t* func;
+    // registers below next_reg are parameters or hold live values
+    size_t next_reg;
+    size_t reg_count;
+
+    // innermost switch and the breaks out of it
+    size_t curr_switch;
+    int32_t breaks;
+} bc_data_t;
+
+static size_t bc_emit(bc_data_t* data, bc_opcode opcode, size_t a, size_t b, int32_t c) {
+    bc_program_t* program = data->program;
+    if(program->count == program->capacity) {
+        program->capacity = program->capacity ? program->capacity * 2 : 256;
+        program->insns = (bc_insn_t*)realloc(program->insns, program->capacity * sizeof(bc_insn_t));
+    }
+    bc_insn_t* insn = &program->insns[program->count];
+    insn->opcode = opcode;
+    insn->a = a;
+    insn->b = b;
+    insn->c = c;
+    return program->count++;
+}
+
+// point a list of jumps at target
+static void bc_patch(bc_data_t* data, int32_t list, size_t target) {
+    while(list != BC_NO_JUMP) {
+        bc_insn_t* insn = &data->program->insns[list];
+        list = insn->c;
+        insn->c = target;
+    }
+}
+
+static bool bc_alloc(bc_data_t* data, size_t* reg) {
+    if(data->next_reg >= BC_MAX_REGS) {
+        printf("Function %s needs too many registers\n", data->func->function_name);
+        return false;
+    }
+    *reg = data->next_reg++;
+    if(data->next_reg > data->reg_count) data->reg_count = data->next_reg;
+    return true;
+}
+
+static int bc_func_compare(const void* a, const void* b) {
+    return strcmp((*(bc_func_t* const*)a)->name, (*(bc_func_t* const*)b)->name);
+}
+
+bc_func_t* bc_find_func(bc_program_t* program, const char* name) {
+    size_t lo = 0, hi = program->func_count;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int order = strcmp(program->by_name[mid]->name, name);
+        if(order == 0) return program->by_name[mid];
+        if(order < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+// OPERANDS
+
+// the factor an expression is made of alone, looking through parentheses
+static node_factor_t* bc_single_expression(node_exp_t* exp);
+
+static node_factor_t* bc_single_factor(node_factor_t* factor) {
+    return factor->type == FACTOR_PAREN ? bc_single_expression(factor->exp) : factor;
+}
+
+static node_factor_t* bc_single_term(node_term_t* term) {
+    return term->subterms ? NULL : bc_single_factor(term->factor);
+}
+
+static node_factor_t* bc_single_sum(node_exp_sum_t* sum) {
+    return sum->subexps ? NULL : bc_single_term(sum->term);
+}
+
+static node_factor_t* bc_single_relation(node_exp_relation_t* relation) {
+    return relation->subexps ? NULL : bc_single_sum(relation->sum);
+}
+
+static node_factor_t* bc_single_equals(node_exp_equals_t* equals) {
+    return equals->subexps ? NULL : bc_single_relation(equals->relation);
+}
+
+static node_factor_t* bc_single_and(node_exp_and_t* and) {
+    return and->subexps ? NULL : bc_single_equals(and->equals);
+}
+
+static node_factor_t* bc_single_expression(node_exp_t* exp) {
+    return exp->subexps ? NULL : bc_single_and(exp->and_exp);
+}
+
+static bool bc_expression(bc_data_t* data, node_exp_t* exp, size_t dst);
+static bool bc_exp_and(bc_data_t* data, node_exp_and_t* and, size_t dst);
+static bool bc_exp_equals(bc_data_t* data, node_exp_equals_t* equals, size_t dst);
+static bool bc_exp_relation(bc_data_t* data, node_exp_relation_t* relation, size_t dst);
+static bool bc_exp_sum(bc_data_t* data, node_exp_sum_t* sum, size_t dst);
+static bool bc_term(bc_data_t* data, node_term_t* term, size_t dst);
+static bool bc_factor(bc_data_t* data, node_factor_t* factor, size_t dst);
+
+// how to generate, see through and fold the operands of one level of the tree
+typedef struct bc_level_s {
+    bool (*gen)(bc_data_t* data, void* operand, size_t dst);
+    node_factor_t* (*single)(void* operand);
+    bool (*constant)(void* operand, int* value);
+} bc_level_t;
+
+#define BC_LEVEL(_name, _type, _gen, _single, _constant) \
+    static bool bc_gen_##_name(bc_data_t* data, void* operand, size_t dst) { return _gen(data, (_type*)operand, dst); } \
+    static node_factor_t* bc_see_##_name(void* operand) { return _single((_type*)operand); } \
+    static bool bc_fold_##_name(void* operand, int* value) { return _constant((_type*)operand, value); } \
+    static const bc_level_t bc_##_name##_level = { bc_gen_##_name, bc_see_##_name, bc_fold_##_name };
+
+BC_LEVEL(expression, node_exp_t, bc_expression, bc_single_expression, ce_expression)
+BC_LEVEL(and, node_exp_and_t, bc_exp_and, bc_single_and, ce_exp_and)
+BC_LEVEL(equals, node_exp_equals_t, bc_exp_equals, bc_single_equals, ce_exp_equals)
+BC_LEVEL(relation, node_exp_relation_t, bc_exp_relation, bc_single_relation, ce_exp_relation)
+BC_LEVEL(sum, node_exp_sum_t, bc_exp_sum, bc_single_sum, ce_exp_sum)
+BC_LEVEL(term, node_term_t, bc_term, bc_single_term, ce_term)
+BC_LEVEL(factor, node_factor_t, bc_factor, bc_single_factor, ce_factor)
+
+static bool bc_param(bc_data_t* data, node_factor_t* factor, size_t* reg) {
+    for(size_t i = 0; i < data->func->param_count; ++i) {
+        if(strcmp(data->func->params[i], factor->name) == 0) {
+            *reg = i;
+            return true;
+        }
+    }
+    printf("Unknown variable %s in %s\n", factor->name, data->func->function_name);
+    return false;
+}
+
+// the register holding an operand: a parameter is read where it is, anything
+// else is computed into dst
+static bool bc_operand_into(bc_data_t* data, const bc_level_t* level, void* operand, size_t dst, size_t* reg) {
+    node_factor_t* factor = level->single(operand);
+    if(factor && factor->type == FACTOR_VARIABLE) return bc_param(data, factor, reg);
+    *reg = dst;
+    return level->gen(data, operand, dst);
+}
+
+// the same into a new temporary, which the caller frees by resetting next_reg
+static bool bc_operand(bc_data_t* data, const bc_level_t* level, void* operand, size_t* reg) {
+    node_factor_t* factor = level->single(operand);
+    if(factor && factor->type == FACTOR_VARIABLE) return bc_param(data, factor, reg);
+    return bc_alloc(data, reg) && level->gen(data, operand, *reg);
+}
+
+// dst = lhs opcode operand, with a constant operand as the immediate
+static bool bc_binary(bc_data_t* data, bc_opcode opcode, size_t dst, size_t lhs, const bc_level_t* level, void* operand) {
+    int value;
+    if(level->constant(operand, &value)) {
+        bc_emit(data, BC_IMMEDIATE(opcode), dst, lhs, value);
+        return true;
+    }
+
+    size_t mark = data->next_reg, reg;
+    if(!bc_operand(data, level, operand, &reg)) return false;
+    bc_emit(data, opcode, dst, lhs, reg);
+    data->next_reg = mark;
+    return true;
+}
+
+static bool bc_operator(operator_type operator, bc_opcode* opcode) {
+    switch(operator) {
+    case OPERATOR_ADD: *opcode = BC_ADD; return true;
+    case OPERATOR_MINUS: *opcode = BC_SUB; return true;
+    case OPERATOR_MULT: *opcode = BC_MUL; return true;
+    case OPERATOR_DIVID: *opcode = BC_DIV; return true;
+    case OPERATOR_EQUALS: *opcode = BC_EQ; return true;
+    case OPERATOR_NOT_EQUAL: *opcode = BC_NE; return true;
+    case OPERATOR_LESS_THAN: *opcode = BC_LT; return true;
+    case OPERATOR_LESS_THAN_OR_EQUAL: *opcode = BC_LE; return true;
+    case OPERATOR_GREATER_THAN: *opcode = BC_GT; return true;
+    case OPERATOR_GREATER_THAN_OR_EQUAL: *opcode = BC_GE; return true;
+    default: return false;
+    }
+}
+
+// EXPRESSIONS
+
+// && and || jump out at the first operand that decides them, jump_if is the
+// truth that does, the last operand's truth is the value otherwise
+static bool bc_short_circuit(bc_data_t* data, const bc_level_t* level, void** operands, size_t count, bool jump_if, size_t dst) {
+    int32_t decided = BC_NO_JUMP;
+    for(size_t i = 0; i < count; ++i) {
+        size_t mark = data->next_reg, reg;
+        if(!bc_operand_into(data, level, operands[i], dst, &reg)) return false;
+        if(i + 1 < count) decided = bc_emit(data, jump_if ? BC_JNZ : BC_JZ, 0, reg, decided);
+        else bc_emit(data, BC_NEI, dst, reg, 0);
+        data->next_reg = mark;
+    }
+    size_t end = bc_emit(data, BC_JMP, 0, 0, BC_NO_JUMP);
+    bc_patch(data, decided, data->program->count);
+    bc_emit(data, BC_CONST, dst, 0, jump_if);
+    bc_patch(data, end, data->program->count);
+    return true;
+}
+
+static bool bc_expression(bc_data_t* data, node_exp_t* exp, size_t dst) {
+    if(!exp->subexps) return bc_exp_and(data, exp->and_exp, dst);
+
+    size_t count = 1;
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) count++;
+    void** operands = (void**)malloc(count * sizeof(void*));
+    operands[0] = exp->and_exp;
+    count = 1;
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) operands[count++] = sub->and_exp;
+    bool success = bc_short_circuit(data, &bc_and_level, operands, count, true, dst);
+    free(operands);
+    return success;
+}
+
+static bool bc_exp_and(bc_data_t* data, node_exp_and_t* and, size_t dst) {
+    if(!and->subexps) return bc_exp_equals(data, and->equals, dst);
+
+    size_t count = 1;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) count++;
+    void** operands = (void**)malloc(count * sizeof(void*));
+    operands[0] = and->equals;
+    count = 1;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) operands[count++] = sub->equals;
+    bool success = bc_short_circuit(data, &bc_equals_level, operands, count, false, dst);
+    free(operands);
+    return success;
+}
+
+// the operator chains of the other levels are evaluated left to right into dst,
+// the first operand is read from lhs
+static bool bc_chain(bc_data_t* data, operator_type operator, size_t dst, size_t* lhs, const bc_level_t* level, void* operand) {
+    bc_opcode opcode;
+    if(!bc_operator(operator, &opcode)) return false;
+    if(!bc_binary(data, opcode, dst, *lhs, level, operand)) return false;
+    *lhs = dst;
+    return true;
+}
+
+static bool bc_exp_equals(bc_data_t* data, node_exp_equals_t* equals, size_t dst) {
+    if(!equals->subexps) return bc_exp_relation(data, equals->relation, dst);
+    size_t lhs;
+    if(!bc_operand_into(data, &bc_relation_level, equals->relation, dst, &lhs)) return false;
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next) {
+        if(!bc_chain(data, sub->operator, dst, &lhs, &bc_relation_level, sub->relation)) return false;
+    }
+    return true;
+}
+
+static bool bc_exp_relation(bc_data_t* data, node_exp_relation_t* relation, size_t dst) {
+    if(!relation->subexps) return bc_exp_sum(data, relation->sum, dst);
+    size_t lhs;
+    if(!bc_operand_into(data, &bc_sum_level, relation->sum, dst, &lhs)) return false;
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next) {
+        if(!bc_chain(data, sub->relation, dst, &lhs, &bc_sum_level, sub->sum)) return false;
+    }
+    return true;
+}
+
+static bool bc_exp_sum(bc_data_t* data, node_exp_sum_t* sum, size_t dst) {
+    if(!sum->subexps) return bc_term(data, sum->term, dst);
+    size_t lhs;
+    if(!bc_operand_into(data, &bc_term_level, sum->term, dst, &lhs)) return false;
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next) {
+        if(!bc_chain(data, sub->operator, dst, &lhs, &bc_term_level, sub->term)) return false;
+    }
+    return true;
+}
+
+static bool bc_term(bc_data_t* data, node_term_t* term, size_t dst) {
+    if(!term->subterms) return bc_factor(data, term->factor, dst);
+    size_t lhs;
+    if(!bc_operand_into(data, &bc_factor_level, term->factor, dst, &lhs)) return false;
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next) {
+        if(!bc_chain(data, sub->operator, dst, &lhs, &bc_factor_level, sub->factor)) return false;
+    }
+    return true;
+}
+
+// the arguments go in the registers above the live ones, where the callee's window starts
+static bool bc_call(bc_data_t* data, node_factor_t* call, size_t dst, bool tail) {
+    bc_func_t* func = bc_find_func(data->program, call->name);
+    if(!func) {
+        printf("Undefined reference to %s\n", call->name);
+        return false;
+    }
+
+    size_t base = data->next_reg;
+    for(node_exp_t* arg = call->args; arg; arg = (node_exp_t*)arg->node.next) {
+        size_t reg;
+        if(!bc_alloc(data, &reg)) return false;
+        if(!bc_expression(data, arg, reg)) return false;
+    }
+    bc_emit(data, tail ? BC_TAILCALL : BC_CALL, dst, base, func - data->program->funcs);
+    data->next_reg = base;
+    return true;
+}
+
+static bool bc_factor(bc_data_t* data, node_factor_t* factor, size_t dst) {
+    size_t mark = data->next_reg, reg;
+    switch(factor->type) {
+    case FACTOR_CONST:
+        bc_emit(data, BC_CONST, dst, 0, (int)factor->literal);
+        return true;
+    case FACTOR_VARIABLE:
+        if(!bc_param(data, factor, &reg)) return false;
+        bc_emit(data, BC_MOV, dst, reg, 0);
+        return true;
+    case FACTOR_PAREN:
+        return bc_expression(data, factor->exp, dst);
+    case FACTOR_UNARY_OP:
+        if(!bc_operand_into(data, &bc_factor_level, factor->factor, dst, &reg)) return false;
+        if(factor->operator == OPERATOR_MINUS) bc_emit(data, BC_NEG, dst, reg, 0);
+        else if(factor->operator == OPERATOR_BITWISE_COMPLEMENT) bc_emit(data, BC_NOT, dst, reg, 0);
+        else if(factor->operator == OPERATOR_LOGICAL_NOT) bc_emit(data, BC_LNOT, dst, reg, 0);
+        else return false;
+        data->next_reg = mark;
+        return true;
+    case FACTOR_CALL:
+        return bc_call(data, factor, dst, false);
+    default:
+        return false;
+    }
+}
+
+// STATEMENTS
+
+static bool bc_statement(bc_data_t* data, node_stat_t* stat);
+
+static bool bc_return(bc_data_t* data, node_exp_t* exp) {
+    // a call whose value is returned reuses the window
+    node_factor_t* call = bc_single_expression(exp);
+    if(call && call->type == FACTOR_CALL) return bc_call(data, call, 0, true);
+
+    size_t mark = data->next_reg, reg;
+    if(!bc_operand(data, &bc_expression_level, exp, &reg)) return false;
+    bc_emit(data, BC_RET, 0, reg, 0);
+    data->next_reg = mark;
+    return true;
+}
+
+static int bc_case_compare(const void* a, const void* b) {
+    int lhs = ((const bc_case_t*)a)->value, rhs = ((const bc_case_t*)b)->value;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static bool bc_switch(bc_data_t* data, node_stat_t* stat) {
+    bc_program_t* program = data->program;
+    size_t mark = data->next_reg, reg;
+    if(!bc_operand(data, &bc_expression_level, stat->exp, &reg)) return false;
+    data->next_reg = mark;
+
+    if(program->switch_count == program->switch_capacity) {
+        program->switch_capacity = program->switch_capacity ? program->switch_capacity * 2 : 16;
+        program->switches = (bc_switch_t*)realloc(program->switches, program->switch_capacity * sizeof(bc_switch_t));
+    }
+    size_t index = program->switch_count++;
+    memset(&program->switches[index], 0, sizeof(bc_switch_t));
+    program->switches[index].default_target = BC_NONE;
+    bc_emit(data, BC_SWITCH, 0, reg, index);
+
+    size_t outer_switch = data->curr_switch;
+    int32_t outer_breaks = data->breaks;
+    data->curr_switch = index;
+    data->breaks = BC_NO_JUMP;
+    bool success = bc_statement(data, stat->stat);
+
+    bc_switch_t* sw = &program->switches[index];
+    bc_patch(data, data->breaks, program->count);
+    if(sw->default_target == BC_NONE) sw->default_target = program->count;
+    qsort(sw->cases, sw->case_count, sizeof(bc_case_t), bc_case_compare);
+    // the front end rejects duplicates, the dispatch searches assume there are none
+    for(size_t i = 1; i < sw->case_count; ++i) {
+        if(sw->cases[i].value == sw->cases[i - 1].value) success = false;
+    }
+    data->curr_switch = outer_switch;
+    data->breaks = outer_breaks;
+    return success;
+}
+
+static bool bc_case(bc_data_t* data, node_stat_t* stat) {
+    if(data->curr_switch == BC_NONE) return false;
+    bc_switch_t* sw = &data->program->switches[data->curr_switch];
+    if(stat->type == STAT_DEFAULT) {
+        if(sw->default_target != BC_NONE) return false;
+        sw->default_target = data->program->count;
+        return true;
+    }
+
+    if(sw->case_count == sw->case_capacity) {
+        sw->case_capacity = sw->case_capacity ? sw->case_capacity * 2 : 16;
+        sw->cases = (bc_case_t*)realloc(sw->cases, sw->case_capacity * sizeof(bc_case_t));
+    }
+    sw->cases[sw->case_count].value = stat->case_value;
+    sw->cases[sw->case_count].target = data->program->count;
+    sw->case_count++;
+    return true;
+}
+
+static bool bc_statement(bc_data_t* data, node_stat_t* stat) {
+    switch(stat->type) {
+    case STAT_RETURN:
+        return bc_return(data, stat->exp);
+    case STAT_BLOCK:
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next) {
+            if(!bc_statement(data, sub)) return false;
+        }
+        return true;
+    case STAT_SWITCH:
+        return bc_switch(data, stat);
+    case STAT_CASE:
+    case STAT_DEFAULT:
+        return bc_case(data, stat);
+    case STAT_BREAK:
+        if(data->curr_switch == BC_NONE) return false;
+        data->breaks = bc_emit(data, BC_JMP, 0, 0, data->breaks);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool bc_function(bc_data_t* data, node_func_t* func, bc_func_t* out) {
+    data->func = func;
+    data->next_reg = data->reg_count = func->param_count;
+    data->curr_switch = BC_NONE;
+    data->breaks = BC_NO_JUMP;
+    out->entry = data->program->count;
+    if(!bc_statement(data, func->stat)) return false;
+
+    // falling off the end returns 0, like main does
+    node_stat_t* last = func->stat->stats;
+    while(last && last->node.next) last = (node_stat_t*)last->node.next;
+    if(!last || last->type != STAT_RETURN) {
+        size_t reg;
+        if(!bc_alloc(data, &reg)) return false;
+        bc_emit(data, BC_CONST, reg, 0, 0);
+        bc_emit(data, BC_RET, 0, reg, 0);
+    }
+    out->reg_count = data->reg_count;
+    return true;
+}
+
+bool bc_compile(bc_program_t* program, program_t* source) {
+    memset(program, 0, sizeof(bc_program_t));
+    for(node_t* node = source->root->functions; node; node = node->next) {
+        if(((node_func_t*)node)->stat) program->func_count++;
+    }
+
+    // every function has its index before any call to it is lowered
+    program->funcs = (bc_func_t*)calloc(program->func_count ? program->func_count : 1, sizeof(bc_func_t));
+    program->by_name = (bc_func_t**)malloc((program->func_count ? program->func_count : 1) * sizeof(bc_func_t*));
+    size_t index = 0;
+    for(node_t* node = source->root->functions; node; node = node->next) {
+        node_func_t* func = (node_func_t*)node;
+        if(!func->stat) continue;
+        program->funcs[index].name = func->function_name;
+        program->funcs[index].param_count = func->param_count;
+        program->by_name[index] = &program->funcs[index];
+        index++;
+    }
+    qsort(program->by_name, program->func_count, sizeof(bc_func_t*), bc_func_compare);
+
+    bc_data_t data;
+    memset(&data, 0, sizeof(bc_data_t));
+    data.program = program;
+    index = 0;
+    for(node_t* node = source->root->functions; node; node = node->next) {
+        node_func_t* func = (node_func_t*)node;
+        if(!func->stat) continue;
+        if(!bc_function(&data, func, &program->funcs[index++])) {
+            printf("Failed to compile function %s to bytecode\n", func->function_name);
+            return false;
+        }
+    }
+    return true;
+}
+
+void free_bc_program(bc_program_t* program) {
+    for(size_t i = 0; i < program->switch_count; ++i) free(program->switches[i].cases);
+    free(program->switches);
+    free(program->insns);
+    free(program->funcs);
+    free(program->by_name);
+    memset(program, 0, sizeof(bc_program_t));
+}
+
+// LISTING
+
+static void bc_print_reg(buf_t* buf, size_t reg) {
+    buf_putc(buf, 'r');
+    buf_put_uint(buf, reg, 0);
+}
+
+void bc_print(bc_program_t* program, buf_t* buf) {
+    size_t func = 0;
+    for(size_t i = 0; i < program->count; ++i) {
+        while(func < program->func_count && program->funcs[func].entry == i) {
+            buf_puts(buf, program->funcs[func++].name);
+            buf_puts(buf, ":\n");
+        }
+
+        bc_insn_t* insn = &program->insns[i];
+        buf_put_uint(buf, i, 5);
+        buf_puts(buf, "  ");
+        buf_puts(buf, bc_opcode_names[insn->opcode]);
+        buf_putc(buf, ' ');
+        switch(insn->opcode) {
+        case BC_CONST:
+            bc_print_reg(buf, insn->a);
+            buf_puts(buf, ", ");
+            buf_put_int(buf, insn->c);
+            break;
+        case BC_MOV: case BC_NEG: case BC_NOT: case BC_LNOT:
+            bc_print_reg(buf, insn->a);
+            buf_puts(buf, ", ");
+            bc_print_reg(buf, insn->b);
+            break;
+        case BC_JMP:
+            buf_put_uint(buf, insn->c, 0);
+            break;
+        case BC_JZ: case BC_JNZ:
+            bc_print_reg(buf, insn->b);
+            buf_puts(buf, ", ");
+            buf_put_uint(buf, insn->c, 0);
+            break;
+        case BC_CALL: case BC_TAILCALL:
+            if(insn->opcode == BC_CALL) {
+                bc_print_reg(buf, insn->a);
+                buf_puts(buf, ", ");
+            }
+            buf_puts(buf, program->funcs[insn->c].name);
+            buf_puts(buf, " at ");
+            bc_print_reg(buf, insn->b);
+            break;
+        case BC_RET:
+            bc_print_reg(buf, insn->b);
+            break;
+        case BC_SWITCH: {
+            bc_switch_t* sw = &program->switches[insn->c];
+            bc_print_reg(buf, insn->b);
+            for(size_t j = 0; j < sw->case_count; ++j) {
+                buf_puts(buf, ", ");
+                buf_put_int(buf, sw->cases[j].value);
+                buf_putc(buf, ':');
+                buf_put_uint(buf, sw->cases[j].target, 0);
+            }
+            buf_puts(buf, ", default:");
+            buf_put_uint(buf, sw->default_target, 0);
+            break;
+        }
+        default:
+            bc_print_reg(buf, insn->a);
+            buf_puts(buf, ", ");
+            bc_print_reg(buf, insn->b);
+            buf_puts(buf, ", ");
+            if(insn->opcode >= BC_ADDI) buf_put_int(buf, insn->c);
+            else bc_print_reg(buf, insn->c);
+            break;
+        }
+        buf_putc(buf, '\n');
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "fwd.h"
+#include "buffer.h"
+#include "program.h"
+
+// Register based bytecode the interpreter runs, lowered from the same tree the
+// native code is generated from. A function works in a window of int registers
+// with its parameters first. Call arguments go to the top of the caller's
+// window, where they already are the parameters of the callee's.
+
+// a = destination, b = first operand, c = second operand register or
+// immediate (the I forms), jump target, function or switch table
+#define BC_OPCODE_LIST(__item, _uargs) \
+    __item(CONST, _uargs) \
+    __item(MOV, _uargs) \
+    __item(NEG, _uargs) \
+    __item(NOT, _uargs) \
+    __item(LNOT, _uargs) \
+    __item(ADD, _uargs) \
+    __item(SUB, _uargs) \
+    __item(MUL, _uargs) \
+    __item(DIV, _uargs) \
+    __item(EQ, _uargs) \
+    __item(NE, _uargs) \
+    __item(LT, _uargs) \
+    __item(LE, _uargs) \
+    __item(GT, _uargs) \
+    __item(GE, _uargs) \
+    __item(ADDI, _uargs) \
+    __item(SUBI, _uargs) \
+    __item(MULI, _uargs) \
+    __item(DIVI, _uargs) \
+    __item(EQI, _uargs) \
+    __item(NEI, _uargs) \
+    __item(LTI, _uargs) \
+    __item(LEI, _uargs) \
+    __item(GTI, _uargs) \
+    __item(GEI, _uargs) \
+    __item(JMP, _uargs) \
+    __item(JZ, _uargs) \
+    __item(JNZ, _uargs) \
+    __item(CALL, _uargs) \
+    __item(TAILCALL, _uargs) \
+    __item(RET, _uargs) \
+    __item(SWITCH, _uargs)
+
+enum bc_opcode_e {
+    BC_OPCODE_LIST(ENUM_LIST_ITEM, BC_)
+    BC_OPCODE_COUNT
+};
+typedef enum bc_opcode_e bc_opcode;
+
+extern const char* bc_opcode_names[BC_OPCODE_COUNT];
+
+// the immediate form of a register operator
+#define BC_IMMEDIATE(_opcode) ((bc_opcode)((_opcode) - BC_ADD + BC_ADDI))
+
+// windows are at most this many registers
+#define BC_MAX_REGS UINT16_MAX
+
+typedef struct bc_insn_s {
+    uint8_t opcode;
+    uint16_t a;
+    uint16_t b;
+    int32_t c;
+} bc_insn_t;
+
+typedef struct bc_case_s {
+    int value;
+    size_t target;
+} bc_case_t;
+
+typedef struct bc_switch_s {
+    // sorted by value
+    bc_case_t* cases;
+    size_t case_count;
+    size_t case_capacity;
+    // where no case matches, the end of the switch without a default
+    size_t default_target;
+} bc_switch_t;
+
+typedef struct bc_func_s {
+    const char* name;
+    size_t param_count;
+    // size of the window, parameters included
+    size_t reg_count;
+    // first instruction
+    size_t entry;
+} bc_func_t;
+
+typedef struct bc_program_s {
+    // every function's code, jump targets index in here
+    bc_insn_t* insns;
+    size_t count;
+    size_t capacity;
+
+    bc_func_t* funcs;
+    size_t func_count;
+    // the same functions sorted by name
+    bc_func_t** by_name;
+
+    bc_switch_t* switches;
+    size_t switch_count;
+    size_t switch_capacity;
+} bc_program_t;
+
+// false when the program uses something the interpreter cannot run
+bool bc_compile(bc_program_t* program, program_t* source);
+void free_bc_program(bc_program_t* program);
+
+// the function defined as name, NULL when there is none
+bc_func_t* bc_find_func(bc_program_t* program, const char* name);
+
+// append a listing of the program
+void bc_print(bc_program_t* program, buf_t* buf);
+
+#endif
@@ -0,0 +1,639 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "cfg.h"
+
+#include "peephole.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// blocks a jump is followed through before giving up, against cycles
+#define CFG_THREAD_LIMIT 8
+// instructions, the ret among them, of a return block worth copying
+#define CFG_DUPLICATE_LIMIT 4
+// rounds of every rewrite before settling for what they reached
+#define CFG_ROUND_LIMIT 16
+
+#define CFG_NONE ((size_t)-1)
+// slots of a label table before it first grows
+#define CFG_MIN_TABLE 256
+
+typedef struct cfg_entry_s {
+    mir_label_t label;
+    // where the label is in the function, CFG_NONE when it is not
+    size_t at;
+    // operands of the function's instructions naming it
+    size_t refs;
+    // the label before it that cfg_remove_labels merges it into, unnamed otherwise
+    mir_label_t merged;
+} cfg_entry_t;
+
+// labels found by hashing into slots holding the index of their entry plus one
+typedef struct cfg_table_s {
+    cfg_entry_t* entries;
+    size_t count;
+    size_t capacity;
+    size_t* slots;
+    size_t size;
+} cfg_table_t;
+
+typedef struct cfg_data_s {
+    // the function being rewritten, as a program of its own
+    mir_t code;
+    // where a rewrite sweeping the function writes it anew
+    mir_t next;
+    // the labels of the function, kept until an instruction is inserted
+    cfg_table_t labels;
+    bool indexed;
+    // numbered labels the instructions outside every function refer to
+    cfg_table_t outside;
+    // labels added where a jump now lands in the middle of a block
+    size_t next_label;
+    bool optimize_size;
+    cfg_stats_t* stats;
+} cfg_data_t;
+
+// LABEL TABLES
+
+static size_t cfg_hash(mir_label_t label) {
+    size_t hash = 5381;
+    for(const char* c = label.name; *c; c++) hash = hash * 33 + (unsigned char)*c;
+    return hash ^ (label.number * 0x9e3779b97f4a7c15ull);
+}
+
+// the slot label is in, or the empty one it would go in
+static size_t* cfg_slot(cfg_table_t* table, mir_label_t label) {
+    size_t slot = cfg_hash(label) & (table->size - 1);
+    while(table->slots[slot] && !mir_label_equal(table->entries[table->slots[slot] - 1].label, label))
+        slot = (slot + 1) & (table->size - 1);
+    return &table->slots[slot];
+}
+
+static void cfg_grow_table(cfg_table_t* table) {
+    free(table->slots);
+    table->size = table->size ? table->size * 2 : CFG_MIN_TABLE;
+    table->slots = (size_t*)calloc(table->size, sizeof(size_t));
+    for(size_t i = 0; i < table->count; ++i) *cfg_slot(table, table->entries[i].label) = i + 1;
+}
+
+static cfg_entry_t* cfg_lookup(cfg_table_t* table, mir_label_t label) {
+    if(!table->size || !label.name) return NULL;
+    size_t* slot = cfg_slot(table, label);
+    return *slot ? &table->entries[*slot - 1] : NULL;
+}
+
+static cfg_entry_t* cfg_add(cfg_table_t* table, mir_label_t label) {
+    if((table->count + 1) * 2 > table->size) cfg_grow_table(table);
+    size_t* slot = cfg_slot(table, label);
+    if(*slot) return &table->entries[*slot - 1];
+
+    if(table->count == table->capacity) {
+        table->capacity = table->capacity ? table->capacity * 2 : CFG_MIN_TABLE;
+        table->entries = (cfg_entry_t*)realloc(table->entries, table->capacity * sizeof(cfg_entry_t));
+    }
+    cfg_entry_t* entry = &table->entries[table->count];
+    memset(entry, 0, sizeof(cfg_entry_t));
+    entry->label = label;
+    entry->at = CFG_NONE;
+    *slot = ++table->count;
+    return entry;
+}
+
+static void cfg_clear_table(cfg_table_t* table) {
+    table->count = 0;
+    if(table->size) memset(table->slots, 0, table->size * sizeof(size_t));
+}
+
+static void free_cfg_table(cfg_table_t* table) {
+    free(table->entries);
+    free(table->slots);
+}
+
+// QUERIES
+
+static bool cfg_is_numbered(mir_label_t label) {
+    return label.name && label.number != MIR_UNNUMBERED;
+}
+
+static bool cfg_is_label(cfg_data_t* data, size_t i) {
+    return i < data->code.count && data->code.insns[i].opcode == MIR_LABEL;
+}
+
+// a jmp or jcc to a label, not through a register
+static bool cfg_is_direct(mir_insn_t* insn) {
+    if(insn->opcode != MIR_JMP && insn->opcode != MIR_JCC) return false;
+    return insn->operand_count == 1 && insn->operands[0].kind == MIR_OPERAND_LABEL;
+}
+
+static bool cfg_is_jump(mir_insn_t* insn) {
+    return insn->opcode == MIR_JMP && cfg_is_direct(insn);
+}
+
+// the first instruction after the labels starting at i
+static size_t cfg_skip_labels(cfg_data_t* data, size_t i) {
+    while(cfg_is_label(data, i)) ++i;
+    return i;
+}
+
+// where every label of the function is and how often it is named, in one pass
+// over it instead of one for each label looked up
+static void cfg_index(cfg_data_t* data) {
+    cfg_clear_table(&data->labels);
+    for(size_t i = 0; i < data->code.count; ++i) {
+        mir_insn_t* insn = &data->code.insns[i];
+        if(insn->opcode == MIR_LABEL) {
+            cfg_add(&data->labels, insn->operands[0].symbol)->at = i;
+            continue;
+        }
+        for(size_t a = 0; a < insn->operand_count; ++a) {
+            if(insn->operands[a].symbol.name) cfg_add(&data->labels, insn->operands[a].symbol)->refs++;
+            if(insn->operands[a].minus.name) cfg_add(&data->labels, insn->operands[a].minus)->refs++;
+        }
+    }
+    data->indexed = true;
+}
+
+static size_t cfg_find(cfg_data_t* data, mir_label_t label) {
+    if(!data->indexed) cfg_index(data);
+    cfg_entry_t* entry = cfg_lookup(&data->labels, label);
+    return entry ? entry->at : CFG_NONE;
+}
+
+static bool cfg_referenced_outside(cfg_data_t* data, mir_label_t label) {
+    return cfg_lookup(&data->outside, label) != NULL;
+}
+
+// EDITING
+
+static void cfg_insert(cfg_data_t* data, size_t at, mir_insn_t insn) {
+    mir_t* code = &data->code;
+    if(code->count == code->capacity) {
+        code->capacity = code->capacity ? code->capacity * 2 : 256;
+        code->insns = (mir_insn_t*)realloc(code->insns, code->capacity * sizeof(mir_insn_t));
+    }
+    memmove(&code->insns[at + 1], &code->insns[at], (code->count - at) * sizeof(mir_insn_t));
+    code->insns[at] = insn;
+    code->count++;
+    data->indexed = false;
+}
+
+// a label for instruction i, added in front of it when it has none
+static mir_label_t cfg_label_at(cfg_data_t* data, size_t i) {
+    if(cfg_is_label(data, i)) return data->code.insns[i].operands[0].symbol;
+    mir_label_t label = mir_label(".j", data->next_label++);
+    mir_insn_t insn;
+    memset(&insn, 0, sizeof(mir_insn_t));
+    insn.opcode = MIR_LABEL;
+    insn.operand_count = 1;
+    insn.operands[0] = mir_target(label);
+    cfg_insert(data, i, insn);
+    return label;
+}
+
+// rewrites that change many instructions write the function anew and take
+// the new copy at the end, rather than moving the rest of it for every change
+static void cfg_emit(cfg_data_t* data, mir_insn_t* insn) {
+    mir_t* next = &data->next;
+    if(next->count == next->capacity) {
+        next->capacity = next->capacity ? next->capacity * 2 : 256;
+        next->insns = (mir_insn_t*)realloc(next->insns, next->capacity * sizeof(mir_insn_t));
+    }
+    next->insns[next->count++] = *insn;
+}
+
+static void cfg_take_next(cfg_data_t* data) {
+    mir_t code = data->code;
+    data->code = data->next;
+    data->next = code;
+    data->next.count = 0;
+    data->indexed = false;
+}
+
+// REWRITES
+
+// a jump to a block holding only jmp M goes to M
+static bool cfg_thread_jumps(cfg_data_t* data) {
+    bool changed = false;
+    for(size_t i = 0; i < data->code.count; ++i) {
+        mir_insn_t* jump = &data->code.insns[i];
+        if(!cfg_is_direct(jump)) continue;
+        mir_label_t target = jump->operands[0].symbol;
+        for(size_t n = 0; n < CFG_THREAD_LIMIT; ++n) {
+            size_t at = cfg_find(data, target);
+            if(at == CFG_NONE) break;
+            size_t next = cfg_skip_labels(data, at);
+            if(next == i || next >= data->code.count || !cfg_is_jump(&data->code.insns[next])) break;
+            target = data->code.insns[next].operands[0].symbol;
+        }
+        if(mir_label_equal(target, jump->operands[0].symbol)) continue;
+        jump->operands[0].symbol = target;
+        data->stats->threaded++;
+        changed = true;
+    }
+    return changed;
+}
+
+// the value cmp $value, %eax compares eax with, test %eax, %eax compares it with 0
+static bool cfg_compares_eax(mir_insn_t* insn, int32_t* against) {
+    if(insn->operand_count != 2) return false;
+    mir_operand_t* right = &insn->operands[1];
+    if(right->kind != MIR_OPERAND_REG || right->reg != MIR_AX || right->size != 4) return false;
+    mir_operand_t* left = &insn->operands[0];
+    if(insn->opcode == MIR_TEST && mir_operand_equal(left, right)) {
+        *against = 0;
+        return true;
+    }
+    if(insn->opcode != MIR_CMP || left->kind != MIR_OPERAND_IMM || left->symbol.name) return false;
+    *against = (int32_t)left->value;
+    return true;
+}
+
+static bool cfg_taken(mir_cc cc, int32_t value, int32_t against) {
+    uint32_t a = (uint32_t)value;
+    uint32_t b = (uint32_t)against;
+    switch(cc) {
+    case MIR_CC_E: return value == against;
+    case MIR_CC_NE: return value != against;
+    case MIR_CC_L: return value < against;
+    case MIR_CC_GE: return value >= against;
+    case MIR_CC_LE: return value <= against;
+    case MIR_CC_G: return value > against;
+    case MIR_CC_B: return a < b;
+    case MIR_CC_AE: return a >= b;
+    case MIR_CC_BE: return a <= b;
+    case MIR_CC_A: return a > b;
+    case MIR_CC_S: return (int32_t)(a - b) < 0;
+    case MIR_CC_NS: return (int32_t)(a - b) >= 0;
+    default: return false;
+    }
+}
+
+// where the code from i leads with value in eax, through jumps and branches on
+// compares of eax, counting the compares decided
+static size_t cfg_follow(cfg_data_t* data, size_t i, int32_t value, size_t* decided) {
+    mir_insn_t* insns = data->code.insns;
+    for(size_t n = 0; n < CFG_THREAD_LIMIT; ++n) {
+        size_t at = cfg_skip_labels(data, i);
+        if(at + 1 >= data->code.count) break;
+        size_t target;
+        int32_t against;
+        if(cfg_is_jump(&insns[at])) {
+            target = cfg_find(data, insns[at].operands[0].symbol);
+        } else if(cfg_compares_eax(&insns[at], &against) && insns[at + 1].opcode == MIR_JCC && cfg_is_direct(&insns[at + 1])) {
+            target = at + 2;
+            if(cfg_taken(insns[at + 1].cc, value, against)) target = cfg_find(data, insns[at + 1].operands[0].symbol);
+            ++*decided;
+        } else {
+            break;
+        }
+        if(target == CFG_NONE || target >= data->code.count) break;
+        i = target;
+    }
+    return i;
+}
+
+// mov $K, %eax then a jump, or falling into a label, to blocks branching on eax
+// goes straight to where K leads
+static bool cfg_thread_constants(cfg_data_t* data) {
+    bool changed = false;
+    for(size_t i = 0; i + 1 < data->code.count; ++i) {
+        mir_insn_t* move = &data->code.insns[i];
+        if(move->opcode != MIR_MOV || move->operand_count != 2) continue;
+        mir_operand_t* value = &move->operands[0];
+        mir_operand_t* dest = &move->operands[1];
+        if(value->kind != MIR_OPERAND_IMM || value->symbol.name) continue;
+        if(dest->kind != MIR_OPERAND_REG || dest->reg != MIR_AX || dest->size != 4) continue;
+
+        mir_insn_t* next = &data->code.insns[i + 1];
+        bool jumps = cfg_is_jump(next);
+        if(!jumps && next->opcode != MIR_LABEL) continue;
+        size_t from = jumps ? cfg_find(data, next->operands[0].symbol) : i + 1;
+        if(from == CFG_NONE) continue;
+        size_t decided = 0;
+        size_t to = cfg_follow(data, from, (int32_t)value->value, &decided);
+        // the compares skipped set flags the destination might have read
+        if(!decided || !ph_flags_dead(&data->code, cfg_skip_labels(data, to) - 1)) continue;
+
+        if(to <= i && !cfg_is_label(data, to)) ++i;
+        mir_label_t label = cfg_label_at(data, to);
+        if(jumps) {
+            data->code.insns[i + 1].operands[0].symbol = label;
+        } else {
+            mir_insn_t jump;
+            memset(&jump, 0, sizeof(mir_insn_t));
+            jump.opcode = MIR_JMP;
+            jump.operand_count = 1;
+            jump.operands[0] = mir_target(label);
+            cfg_insert(data, i + 1, jump);
+        }
+        data->stats->constants++;
+        changed = true;
+    }
+    return changed;
+}
+
+// a jmp to a short block ending in ret becomes a copy of the block
+static bool cfg_duplicate_returns(cfg_data_t* data) {
+    if(data->optimize_size) return false;
+    bool changed = false;
+    for(size_t i = 0; i < data->code.count; ++i) {
+        mir_insn_t* insn = &data->code.insns[i];
+        size_t at = cfg_is_jump(insn) ? cfg_find(data, insn->operands[0].symbol) : CFG_NONE;
+        size_t first = at == CFG_NONE ? at : cfg_skip_labels(data, at);
+        size_t end = first;
+        for(; end < data->code.count && end - first < CFG_DUPLICATE_LIMIT; ++end) {
+            mir_opcode opcode = data->code.insns[end].opcode;
+            if(!MIR_IS_INSN(opcode) || opcode == MIR_JMP || opcode == MIR_JCC || opcode == MIR_RET) break;
+        }
+        if(end >= data->code.count || data->code.insns[end].opcode != MIR_RET || end + 1 - first > CFG_DUPLICATE_LIMIT) {
+            cfg_emit(data, insn);
+            continue;
+        }
+
+        for(size_t k = first; k <= end; ++k) cfg_emit(data, &data->code.insns[k]);
+        data->stats->duplicated++;
+        changed = true;
+    }
+    if(changed) cfg_take_next(data);
+    else data->next.count = 0;
+    return changed;
+}
+
+static bool cfg_is_code(mir_section section) {
+    return section == MIR_SECTION_TEXT || section == MIR_SECTION_TEXT_HOT || section == MIR_SECTION_TEXT_UNLIKELY;
+}
+
+// past the data at i placed in another section, like a jump table, when the
+// code picks up again after it, otherwise i
+static size_t cfg_skip_data(cfg_data_t* data, size_t i) {
+    if(i >= data->code.count || data->code.insns[i].opcode != MIR_SECTION || cfg_is_code(data->code.insns[i].section)) return i;
+    for(size_t j = i + 1; j < data->code.count; ++j) {
+        mir_insn_t* insn = &data->code.insns[j];
+        if(insn->opcode == MIR_SECTION) return cfg_is_code(insn->section) ? j + 1 : i;
+        if(MIR_IS_INSN(insn->opcode)) return i;
+    }
+    return i;
+}
+
+// instructions after a jmp or ret no label leads to, and jumps to the next label
+static bool cfg_remove_unreachable(cfg_data_t* data) {
+    bool changed = false;
+    for(size_t i = 0; i < data->code.count;) {
+        mir_insn_t* insn = &data->code.insns[i];
+        if(insn->opcode != MIR_JMP && insn->opcode != MIR_RET) {
+            cfg_emit(data, insn);
+            ++i;
+            continue;
+        }
+        // data in between, such as the table of an indirect jmp, does not end the dead code
+        size_t end = i + 1;
+        while(1) {
+            while(end < data->code.count && MIR_IS_INSN(data->code.insns[end].opcode)) ++end;
+            size_t after = cfg_skip_data(data, end);
+            if(after == end) break;
+            end = after;
+        }
+
+        bool to_next = false;
+        for(size_t j = end; cfg_is_jump(insn) && cfg_is_label(data, j) && !to_next; ++j)
+            to_next = mir_label_equal(data->code.insns[j].operands[0].symbol, insn->operands[0].symbol);
+        if(to_next) changed = true;
+        else cfg_emit(data, insn);
+        for(size_t j = i + 1; j < end; ++j) {
+            if(MIR_IS_INSN(data->code.insns[j].opcode)) changed = true;
+            else cfg_emit(data, &data->code.insns[j]);
+        }
+        i = end;
+    }
+    if(changed) cfg_take_next(data);
+    else data->next.count = 0;
+    return changed;
+}
+
+static void cfg_merge_operand(cfg_data_t* data, mir_label_t* label) {
+    cfg_entry_t* entry = cfg_lookup(&data->labels, *label);
+    if(entry && entry->merged.name) *label = entry->merged;
+}
+
+// labels after another numbered one are merged into it, then those nothing refers to go
+static bool cfg_remove_labels(cfg_data_t* data) {
+    cfg_index(data);
+    bool changed = false;
+    // the label kept last when nothing came between it and the one at i
+    mir_label_t before = { NULL, 0 };
+    for(size_t i = 0; i < data->code.count; ++i) {
+        mir_insn_t* insn = &data->code.insns[i];
+        if(insn->opcode != MIR_LABEL) {
+            before.name = NULL;
+            continue;
+        }
+        mir_label_t label = insn->operands[0].symbol;
+        if(!cfg_is_numbered(label) || cfg_referenced_outside(data, label)) {
+            before = label;
+            continue;
+        }
+        cfg_entry_t* entry = cfg_lookup(&data->labels, label);
+        if(cfg_is_numbered(before)) entry->merged = before;
+        else if(entry->refs) {
+            before = label;
+            continue;
+        }
+        // a removed label is no longer anywhere in the code
+        entry->at = CFG_NONE;
+        data->stats->labels_removed++;
+        changed = true;
+    }
+    if(!changed) return false;
+
+    for(size_t i = 0; i < data->code.count; ++i) {
+        mir_insn_t* insn = &data->code.insns[i];
+        if(insn->opcode == MIR_LABEL) {
+            if(cfg_lookup(&data->labels, insn->operands[0].symbol)->at == CFG_NONE) continue;
+        } else {
+            for(size_t a = 0; a < insn->operand_count; ++a) {
+                cfg_merge_operand(data, &insn->operands[a].symbol);
+                cfg_merge_operand(data, &insn->operands[a].minus);
+            }
+        }
+        cfg_emit(data, insn);
+    }
+    cfg_take_next(data);
+    return true;
+}
+
+// the instructions in the order blocks are being moved into, linked so a move
+// takes the same time however far the block goes
+typedef struct cfg_layout_s {
+    size_t* next;
+    size_t* prev;
+    size_t first;
+} cfg_layout_t;
+
+// the last instruction of the blocks from first, which only jumps enter, when
+// they leave by a jmp or ret and can be moved as one, CFG_NONE otherwise
+static size_t cfg_island(cfg_data_t* data, cfg_layout_t* layout, size_t first) {
+    size_t before = layout->prev[first];
+    if(before == CFG_NONE) return CFG_NONE;
+    mir_opcode opcode = data->code.insns[before].opcode;
+    if(opcode != MIR_JMP && opcode != MIR_RET) return CFG_NONE;
+    for(size_t i = first; i != CFG_NONE; i = layout->next[i]) {
+        mir_insn_t* insn = &data->code.insns[i];
+        if(insn->opcode == MIR_LABEL) {
+            if(!cfg_is_numbered(insn->operands[0].symbol)) return CFG_NONE;
+            continue;
+        }
+        if(!MIR_IS_INSN(insn->opcode)) return CFG_NONE;
+        if(insn->opcode == MIR_JMP || insn->opcode == MIR_RET) return i;
+    }
+    return CFG_NONE;
+}
+
+static void cfg_link(cfg_layout_t* layout, size_t before, size_t after) {
+    if(before == CFG_NONE) layout->first = after;
+    else layout->next[before] = after;
+    if(after != CFG_NONE) layout->prev[after] = before;
+}
+
+// blocks only jumped to are moved after the first jmp to them, so it falls
+// through instead. Code generation puts the likely path first, moving blocks
+// only later keeps the unlikely ones at the end.
+static bool cfg_move_blocks(cfg_data_t* data) {
+    size_t count = data->code.count;
+    cfg_layout_t layout;
+    layout.next = (size_t*)malloc((count + 1) * sizeof(size_t));
+    layout.prev = (size_t*)malloc((count + 1) * sizeof(size_t));
+    layout.first = count ? 0 : CFG_NONE;
+    for(size_t i = 0; i < count; ++i) {
+        layout.next[i] = i + 1 < count ? i + 1 : CFG_NONE;
+        layout.prev[i] = i ? i - 1 : CFG_NONE;
+    }
+    // the walk has passed everything before the jump it is at, so a target
+    // it has not seen yet comes after the jump
+    bool* seen = (bool*)calloc(count + 1, sizeof(bool));
+
+    bool changed = false;
+    for(size_t i = layout.first; i != CFG_NONE; i = layout.next[i]) {
+        seen[i] = true;
+        if(!cfg_is_jump(&data->code.insns[i])) continue;
+        size_t first = cfg_find(data, data->code.insns[i].operands[0].symbol);
+        if(first == CFG_NONE || seen[first]) continue;
+        while(layout.prev[first] != CFG_NONE && data->code.insns[layout.prev[first]].opcode == MIR_LABEL) first = layout.prev[first];
+        size_t last = cfg_island(data, &layout, first);
+        if(last == CFG_NONE) continue;
+
+        // the blocks take the place of the jump
+        cfg_link(&layout, layout.prev[first], layout.next[last]);
+        size_t after = layout.next[i];
+        cfg_link(&layout, layout.prev[i], first);
+        cfg_link(&layout, last, after);
+        i = first;
+        seen[i] = true;
+        data->stats->moved++;
+        changed = true;
+    }
+
+    if(changed) {
+        for(size_t i = layout.first; i != CFG_NONE; i = layout.next[i]) cfg_emit(data, &data->code.insns[i]);
+        cfg_take_next(data);
+    }
+    free(seen);
+    free(layout.next);
+    free(layout.prev);
+    return changed;
+}
+
+static bool cfg_function(cfg_data_t* data) {
+    bool changed = false;
+    for(size_t round = 0; round < CFG_ROUND_LIMIT; ++round) {
+        bool again = cfg_thread_jumps(data);
+        again |= cfg_thread_constants(data);
+        // dead blocks go before they can be copied into
+        again |= cfg_remove_unreachable(data);
+        again |= cfg_duplicate_returns(data);
+        again |= cfg_remove_labels(data);
+        again |= cfg_move_blocks(data);
+        if(!again) break;
+        changed = true;
+    }
+    return changed;
+}
+
+// PROGRAM
+
+// instructions [first, end) of from on the end of to, leaving out NOPs
+static void cfg_append(mir_t* to, mir_t* from, size_t first, size_t end) {
+    for(size_t i = first; i < end; ++i) {
+        if(from->insns[i].opcode == MIR_NOP) continue;
+        if(to->count == to->capacity) {
+            to->capacity = to->capacity ? to->capacity * 2 : 256;
+            to->insns = (mir_insn_t*)realloc(to->insns, to->capacity * sizeof(mir_insn_t));
+        }
+        to->insns[to->count++] = from->insns[i];
+    }
+}
+
+static void cfg_add_outside(cfg_data_t* data, mir_label_t label) {
+    if(cfg_is_numbered(label)) cfg_add(&data->outside, label);
+}
+
+static void cfg_find_outside(cfg_data_t* data, mir_t* mir, size_t first, size_t end) {
+    for(size_t i = first; i < end; ++i) {
+        mir_insn_t* insn = &mir->insns[i];
+        if(insn->opcode == MIR_LABEL) continue;
+        for(size_t a = 0; a < insn->operand_count; ++a) {
+            cfg_add_outside(data, insn->operands[a].symbol);
+            cfg_add_outside(data, insn->operands[a].minus);
+        }
+    }
+}
+
+bool cfg_optimize(mir_t* mir, bool optimize_size, cfg_stats_t* stats) {
+    cfg_stats_t unused;
+    memset(&unused, 0, sizeof(cfg_stats_t));
+    cfg_data_t data;
+    memset(&data, 0, sizeof(cfg_data_t));
+    data.optimize_size = optimize_size;
+    data.stats = stats ? stats : &unused;
+    mir_init(&data.code, mir->is_64);
+    mir_init(&data.next, mir->is_64);
+
+    size_t done = 0;
+    for(size_t f = 0; f < mir->func_count; ++f) {
+        cfg_find_outside(&data, mir, done, mir->funcs[f].first);
+        done = mir->funcs[f].end;
+    }
+    cfg_find_outside(&data, mir, done, mir->count);
+
+    // the functions are rewritten one at a time into a new copy of the program
+    mir_t out;
+    mir_init(&out, mir->is_64);
+    bool changed = false;
+    done = 0;
+    for(size_t f = 0; f < mir->func_count; ++f) {
+        mir_func_t* func = &mir->funcs[f];
+        cfg_append(&out, mir, done, func->first);
+        data.code.count = 0;
+        data.indexed = false;
+        cfg_append(&data.code, mir, func->first, func->end);
+        done = func->end;
+
+        changed |= cfg_function(&data);
+        func->first = out.count;
+        cfg_append(&out, &data.code, 0, data.code.count);
+        func->end = out.count;
+    }
+    cfg_append(&out, mir, done, mir->count);
+
+    free(mir->insns);
+    mir->insns = out.insns;
+    mir->count = out.count;
+    mir->capacity = out.capacity;
+    free_mir(&data.code);
+    free_mir(&data.next);
+    free_cfg_table(&data.labels);
+    free_cfg_table(&data.outside);
+    return changed;
+}
@@ -0,0 +1,33 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef CFG_H
+#define CFG_H
+
+#include "fwd.h"
+#include "mir.h"
+
+// Control flow cleanups across the blocks of each function, after the peephole
+// rules have shortened them. Jumps are threaded through blocks holding only a
+// jump, or only a test of a constant just moved to eax, short return blocks are
+// copied into the jumps to them, and blocks entered only by a jump are moved
+// to fall out of it. Labels nothing refers to anymore go.
+
+typedef struct cfg_stats_s {
+    // jumps sent straight on to where the block they landed in led
+    size_t threaded;
+    // jumps decided by a constant in eax
+    size_t constants;
+    // jumps replaced by a copy of the return block they led to
+    size_t duplicated;
+    // blocks moved after the jump to them
+    size_t moved;
+    size_t labels_removed;
+} cfg_stats_t;
+
+// rewrite the functions of the program, true when anything changed
+bool cfg_optimize(mir_t* mir, bool optimize_size, cfg_stats_t* stats);
+
+#endif
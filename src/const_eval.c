@@ -0,0 +1,154 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "const_eval.h"
+
+#include <limits.h>
+
+// arithmetic wraps like the generated code does, so do it unsigned
+#define WRAP_ADD(_a, _b) (int)((unsigned int)(_a) + (unsigned int)(_b))
+#define WRAP_SUB(_a, _b) (int)((unsigned int)(_a) - (unsigned int)(_b))
+#define WRAP_MUL(_a, _b) (int)((unsigned int)(_a) * (unsigned int)(_b))
+
+bool ce_expression(node_exp_t* exp, int* out) {
+    int value;
+    if(!ce_exp_and(exp->and_exp, &value)) return false;
+
+    node_exp_subexp_t* sub = exp->subexps;
+    while(sub) {
+        int rhs;
+        if(!ce_exp_and(sub->and_exp, &rhs)) return false;
+        value = value || rhs;
+        sub = sub->next;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool ce_exp_and(node_exp_and_t* and, int* out) {
+    int value;
+    if(!ce_exp_equals(and->equals, &value)) return false;
+
+    node_exp_and_subexp_t* sub = and->subexps;
+    while(sub) {
+        int rhs;
+        if(!ce_exp_equals(sub->equals, &rhs)) return false;
+        value = value && rhs;
+        sub = sub->next;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool ce_exp_equals(node_exp_equals_t* equals, int* out) {
+    int value;
+    if(!ce_exp_relation(equals->relation, &value)) return false;
+
+    node_exp_equals_subexp_t* sub = equals->subexps;
+    while(sub) {
+        int rhs;
+        if(!ce_exp_relation(sub->relation, &rhs)) return false;
+
+        if(sub->operator == OPERATOR_EQUALS) value = value == rhs;
+        else if(sub->operator == OPERATOR_NOT_EQUAL) value = value != rhs;
+        else return false;
+
+        sub = sub->next;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool ce_exp_relation(node_exp_relation_t* relation, int* out) {
+    int value;
+    if(!ce_exp_sum(relation->sum, &value)) return false;
+
+    node_exp_relation_subexp_t* sub = relation->subexps;
+    while(sub) {
+        int rhs;
+        if(!ce_exp_sum(sub->sum, &rhs)) return false;
+
+        switch(sub->relation) {
+        case OPERATOR_LESS_THAN: value = value < rhs; break;
+        case OPERATOR_LESS_THAN_OR_EQUAL: value = value <= rhs; break;
+        case OPERATOR_GREATER_THAN: value = value > rhs; break;
+        case OPERATOR_GREATER_THAN_OR_EQUAL: value = value >= rhs; break;
+        default: return false;
+        }
+
+        sub = sub->next;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool ce_exp_sum(node_exp_sum_t* sum, int* out) {
+    int value;
+    if(!ce_term(sum->term, &value)) return false;
+
+    node_exp_sum_subexp_t* sub = sum->subexps;
+    while(sub) {
+        int rhs;
+        if(!ce_term(sub->term, &rhs)) return false;
+
+        if(sub->operator == OPERATOR_ADD) value = WRAP_ADD(value, rhs);
+        else if(sub->operator == OPERATOR_MINUS) value = WRAP_SUB(value, rhs);
+        else return false;
+
+        sub = sub->next;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool ce_term(node_term_t* term, int* out) {
+    int value;
+    if(!ce_factor(term->factor, &value)) return false;
+
+    node_term_subterm_t* sub = term->subterms;
+    while(sub) {
+        int rhs;
+        if(!ce_factor(sub->factor, &rhs)) return false;
+
+        if(sub->operator == OPERATOR_MULT) {
+            value = WRAP_MUL(value, rhs);
+        } else if(sub->operator == OPERATOR_DIVID) {
+            if(rhs == 0 || (value == INT_MIN && rhs == -1)) return false;
+            value = value / rhs;
+        } else
+            return false;
+
+        sub = sub->next;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool ce_factor(node_factor_t* factor, int* out) {
+    if(factor->type == FACTOR_CONST) {
+        *out = (int)factor->literal;
+        return true;
+    } else if(factor->type == FACTOR_UNARY_OP) {
+        int value;
+        if(!ce_factor(factor->factor, &value)) return false;
+
+        switch(factor->operator) {
+        case OPERATOR_BITWISE_COMPLEMENT: *out = ~value; return true;
+        case OPERATOR_MINUS: *out = WRAP_SUB(0, value); return true;
+        case OPERATOR_LOGICAL_NOT: *out = !value; return true;
+        default: return false;
+        }
+    } else if(factor->type == FACTOR_PAREN) {
+        return ce_expression(factor->exp, out);
+    }
+
+    return false;
+}
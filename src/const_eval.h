@@ -0,0 +1,22 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef CONST_EVAL_H
+#define CONST_EVAL_H
+
+#include "nodes.h"
+
+// Evaluate an expression tree as a 32 bit int constant expression.
+// Returns false when the tree is not constant or would trap (division by zero, INT_MIN / -1).
+
+bool ce_expression(node_exp_t* exp, int* out);
+bool ce_exp_and(node_exp_and_t* and, int* out);
+bool ce_exp_equals(node_exp_equals_t* equals, int* out);
+bool ce_exp_relation(node_exp_relation_t* relation, int* out);
+bool ce_exp_sum(node_exp_sum_t* sum, int* out);
+bool ce_term(node_term_t* term, int* out);
+bool ce_factor(node_factor_t* factor, int* out);
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "dwarf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// bytes the stack pointer is below the frame address, and while the frame
+// pointer is set what it was when it was set
+typedef struct dw_state_s {
+    int64_t sp;
+    bool frame;
+    int64_t frame_offset;
+} dw_state_t;
+
+typedef struct dw_pending_s {
+    size_t index;
+    dw_state_t state;
+} dw_pending_t;
+
+typedef struct dw_data_s {
+    mir_t* mir;
+    mir_func_t* func;
+    int64_t word;
+    dw_state_t* states;
+    bool* reached;
+    // paths still to follow
+    dw_pending_t* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+} dw_data_t;
+
+static bool dw_is_reg(mir_operand_t* operand, mir_register reg) {
+    return operand->kind == MIR_OPERAND_REG && operand->reg == reg;
+}
+
+static void dw_push(dw_data_t* data, size_t index, dw_state_t state) {
+    if(data->pending_count == data->pending_capacity) {
+        data->pending_capacity = data->pending_capacity ? data->pending_capacity * 2 : 16;
+        data->pending = (dw_pending_t*)realloc(data->pending, data->pending_capacity * sizeof(dw_pending_t));
+    }
+    data->pending[data->pending_count].index = index;
+    data->pending[data->pending_count].state = state;
+    data->pending_count++;
+}
+
+// a jump to a label of the function continues there, symbols of other
+// functions are tail calls
+static void dw_follow(dw_data_t* data, mir_label_t label, dw_state_t state) {
+    for(size_t i = data->func->first; i < data->func->end; ++i) {
+        mir_insn_t* insn = &data->mir->insns[i];
+        if(insn->opcode == MIR_LABEL && mir_label_equal(insn->operands[0].symbol, label)) {
+            dw_push(data, i, state);
+            return;
+        }
+    }
+}
+
+// an indirect jump goes to the entries of the function's switch tables
+static void dw_follow_tables(dw_data_t* data, dw_state_t state) {
+    for(size_t i = data->func->first; i < data->func->end; ++i) {
+        mir_insn_t* insn = &data->mir->insns[i];
+        if(insn->opcode == MIR_LONG) dw_follow(data, insn->operands[0].symbol, state);
+    }
+}
+
+// run from index until the path leaves or meets one followed before
+static void dw_walk(dw_data_t* data, size_t index, dw_state_t state) {
+    for(size_t i = index; i < data->func->end; ++i) {
+        size_t at = i - data->func->first;
+        if(data->reached[at]) return;
+        data->reached[at] = true;
+        data->states[at] = state;
+
+        mir_insn_t* insn = &data->mir->insns[i];
+        mir_operand_t* src = &insn->operands[0];
+        mir_operand_t* dst = &insn->operands[insn->operand_count ? insn->operand_count - 1 : 0];
+        switch(insn->opcode) {
+        case MIR_PUSH:
+            state.sp += data->word;
+            break;
+        case MIR_PUSHA:
+            state.sp += 8 * data->word;
+            break;
+        case MIR_POPA:
+            state.sp -= 8 * data->word;
+            break;
+        case MIR_POP:
+            state.sp -= data->word;
+            if(state.frame && dw_is_reg(src, MIR_BP)) {
+                state.sp = state.frame_offset - data->word;
+                state.frame = false;
+            }
+            break;
+        case MIR_LEAVE:
+            state.sp = state.frame_offset - data->word;
+            state.frame = false;
+            break;
+        case MIR_MOV:
+            if(dw_is_reg(src, MIR_SP) && dw_is_reg(dst, MIR_BP)) {
+                state.frame = true;
+                state.frame_offset = state.sp;
+            }
+            break;
+        case MIR_SUB:
+            if(dw_is_reg(dst, MIR_SP) && src->kind == MIR_OPERAND_IMM) state.sp += src->value;
+            break;
+        case MIR_ADD:
+            if(dw_is_reg(dst, MIR_SP) && src->kind == MIR_OPERAND_IMM) state.sp -= src->value;
+            break;
+        case MIR_LEA:
+            if(dw_is_reg(dst, MIR_SP) && src->reg == MIR_SP && src->index == MIR_NO_REG) state.sp -= src->value;
+            break;
+        case MIR_CALL:
+            // calling a label of the function pushes the address a pop then reads
+            if(src->kind == MIR_OPERAND_LABEL && src->symbol.number != MIR_UNNUMBERED) {
+                state.sp += data->word;
+                dw_follow(data, src->symbol, state);
+                return;
+            }
+            break;
+        case MIR_JMP:
+            if(src->kind == MIR_OPERAND_LABEL) dw_follow(data, src->symbol, state);
+            else dw_follow_tables(data, state);
+            return;
+        case MIR_JCC:
+            dw_follow(data, src->symbol, state);
+            break;
+        case MIR_RET:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+static bool dw_is_callee_saved(mir_register reg) {
+    return reg == MIR_BX || reg == MIR_BP || reg == MIR_SI || reg == MIR_DI || reg >= MIR_R12;
+}
+
+// the prologue pushes the registers it saves before anything else is done
+static void dw_prologue_saves(dw_data_t* data, dw_frame_t* frames) {
+    uint32_t seen = 0;
+    for(size_t i = data->func->first; i < data->func->end; ++i) {
+        size_t at = i - data->func->first;
+        mir_insn_t* insn = &data->mir->insns[i];
+        mir_operand_t* src = &insn->operands[0];
+        if(insn->opcode == MIR_GLOBL) continue;
+        if(insn->opcode == MIR_LABEL && src->symbol.number == MIR_UNNUMBERED) continue;
+        if(insn->opcode == MIR_MOV && dw_is_reg(src, MIR_SP) && dw_is_reg(&insn->operands[1], MIR_BP)) continue;
+        if(insn->opcode == MIR_SUB && dw_is_reg(&insn->operands[1], MIR_SP)) continue;
+        if(insn->opcode != MIR_PUSH || src->kind != MIR_OPERAND_REG) return;
+        if(!dw_is_callee_saved(src->reg) || (seen & (1u << src->reg)) || !data->reached[at]) return;
+        seen |= 1u << src->reg;
+        frames[at].saved = data->states[at].sp + data->word;
+    }
+}
+
+void dw_frames(mir_t* mir, mir_func_t* func, dw_frame_t* frames) {
+    size_t count = func->end - func->first;
+    dw_data_t data;
+    memset(&data, 0, sizeof(dw_data_t));
+    data.mir = mir;
+    data.func = func;
+    data.word = mir->is_64 ? 8 : 4;
+    data.states = (dw_state_t*)calloc(count + 1, sizeof(dw_state_t));
+    data.reached = (bool*)calloc(count + 1, sizeof(bool));
+
+    // the call left the return address below the frame address
+    dw_state_t entry = { data.word, false, 0 };
+    dw_push(&data, func->first, entry);
+    while(data.pending_count) {
+        dw_pending_t next = data.pending[--data.pending_count];
+        dw_walk(&data, next.index, next.state);
+    }
+
+    for(size_t i = 0; i < count; ++i) {
+        dw_state_t* state = &data.states[i];
+        frames[i].reg = !data.reached[i] ? MIR_NO_REG : state->frame ? MIR_BP : MIR_SP;
+        frames[i].offset = state->frame ? state->frame_offset : state->sp;
+        frames[i].depth = state->sp;
+        frames[i].saved = 0;
+    }
+    dw_prologue_saves(&data, frames);
+
+    free(data.pending);
+    free(data.reached);
+    free(data.states);
+}
@@ -0,0 +1,34 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef DWARF_H
+#define DWARF_H
+
+#include "fwd.h"
+#include "mir.h"
+
+// Where the canonical frame address, the stack pointer of the caller before
+// its call, is at every instruction of a function, for the call frame
+// information printed with -g and the stack usage report. Pushes, pops and
+// frame changes are followed along every path, through the jumps and the
+// tables of switches.
+
+typedef struct dw_frame_s {
+    // the frame address is reg plus offset before the instruction, reg is
+    // MIR_NO_REG where no path reaches it
+    mir_register reg;
+    int64_t offset;
+    // bytes the stack pointer is below the frame address before the
+    // instruction, whether or not the frame pointer holds it
+    int64_t depth;
+    // bytes below the frame address the register a prologue push saves is
+    // stored at, 0 for every other instruction
+    int64_t saved;
+} dw_frame_t;
+
+// fill one frame for each instruction of func, the first at frames[0]
+void dw_frames(mir_t* mir, mir_func_t* func, dw_frame_t* frames);
+
+#endif
@@ -0,0 +1,803 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "encode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENC_MAX_INSN 16
+#define ENC_MAX_FIXUPS 2
+#define ENC_MIN_TABLE 256
+
+#define ENC_REX 0x40
+#define ENC_REX_W 0x08
+#define ENC_REX_R 0x04
+#define ENC_REX_X 0x02
+#define ENC_REX_B 0x01
+
+typedef enum enc_fixup_kind_e {
+    // address of the symbol, or the difference with minus
+    ENC_FIXUP_ABS,
+    // relative to the end of the instruction, rip based memory
+    ENC_FIXUP_PC,
+    // relative to the end of the instruction and left to the linker for globals
+    ENC_FIXUP_JUMP,
+    ENC_FIXUP_CALL
+} enc_fixup_kind;
+
+// a field of the instruction that depends on where a symbol ends up
+typedef struct enc_fixup_s {
+    enc_fixup_kind kind;
+    size_t at;
+    uint8_t size;
+    mir_operand_t* operand;
+} enc_fixup_t;
+
+typedef struct enc_insn_s {
+    uint8_t bytes[ENC_MAX_INSN];
+    size_t len;
+    enc_fixup_t fixups[ENC_MAX_FIXUPS];
+    size_t fixup_count;
+} enc_insn_t;
+
+typedef struct enc_data_s {
+    mir_t* mir;
+    enc_object_t* obj;
+    // per instruction: its section, its offset in there, its size, the symbol a
+    // branch that may be short goes to and whether it went long
+    mir_section* sections;
+    size_t* offsets;
+    size_t* sizes;
+    size_t* targets;
+    bool* long_jumps;
+} enc_data_t;
+
+// x86 numbers the conditions differently from mir_cc
+static const uint8_t enc_cc_codes[MIR_CC_COUNT] = {
+    [MIR_CC_E] = 0x4, [MIR_CC_NE] = 0x5, [MIR_CC_L] = 0xc, [MIR_CC_GE] = 0xd,
+    [MIR_CC_LE] = 0xe, [MIR_CC_G] = 0xf, [MIR_CC_B] = 0x2, [MIR_CC_AE] = 0x3,
+    [MIR_CC_BE] = 0x6, [MIR_CC_A] = 0x7, [MIR_CC_S] = 0x8, [MIR_CC_NS] = 0x9
+};
+
+// the /digit of the group 1 arithmetic, also the row of their register forms
+static uint8_t enc_alu_code(mir_opcode opcode) {
+    switch(opcode) {
+    case MIR_ADD: return 0;
+    case MIR_OR: return 1;
+    case MIR_ADC: return 2;
+    case MIR_SBB: return 3;
+    case MIR_AND: return 4;
+    case MIR_SUB: return 5;
+    case MIR_XOR: return 6;
+    default: return 7;
+    }
+}
+
+static bool enc_fits_byte(int64_t value) {
+    return value >= -128 && value <= 127;
+}
+
+// SYMBOLS
+
+static size_t enc_hash(mir_label_t label) {
+    size_t hash = 5381;
+    for(const char* c = label.name; *c; c++) hash = hash * 33 + (unsigned char)*c;
+    return hash ^ (label.number * 0x9e3779b97f4a7c15ull);
+}
+
+static void enc_grow_table(enc_object_t* obj) {
+    free(obj->table);
+    obj->table_size = obj->table_size ? obj->table_size * 2 : ENC_MIN_TABLE;
+    obj->table = (size_t*)calloc(obj->table_size, sizeof(size_t));
+    for(size_t i = 0; i < obj->symbol_count; i++) {
+        size_t slot = enc_hash(obj->symbols[i].label) & (obj->table_size - 1);
+        while(obj->table[slot]) slot = (slot + 1) & (obj->table_size - 1);
+        obj->table[slot] = i + 1;
+    }
+}
+
+// the slot label is in, or the empty one it would go in
+static size_t* enc_slot(enc_object_t* obj, mir_label_t label) {
+    size_t slot = enc_hash(label) & (obj->table_size - 1);
+    while(obj->table[slot] && !mir_label_equal(obj->symbols[obj->table[slot] - 1].label, label))
+        slot = (slot + 1) & (obj->table_size - 1);
+    return &obj->table[slot];
+}
+
+size_t enc_find_symbol(enc_object_t* obj, mir_label_t label) {
+    if(!obj->table_size) return ENC_UNDEFINED;
+    size_t* slot = enc_slot(obj, label);
+    return *slot ? *slot - 1 : ENC_UNDEFINED;
+}
+
+static size_t enc_symbol(enc_object_t* obj, mir_label_t label) {
+    if((obj->symbol_count + 1) * 2 > obj->table_size) enc_grow_table(obj);
+    size_t* slot = enc_slot(obj, label);
+    if(*slot) return *slot - 1;
+
+    if(obj->symbol_count == obj->symbol_capacity) {
+        obj->symbol_capacity = obj->symbol_capacity ? obj->symbol_capacity * 2 : ENC_MIN_TABLE;
+        obj->symbols = (enc_symbol_t*)realloc(obj->symbols, obj->symbol_capacity * sizeof(enc_symbol_t));
+    }
+    enc_symbol_t* symbol = &obj->symbols[obj->symbol_count];
+    memset(symbol, 0, sizeof(enc_symbol_t));
+    symbol->label = label;
+    symbol->section = ENC_UNDEFINED;
+    *slot = ++obj->symbol_count;
+    return obj->symbol_count - 1;
+}
+
+static void enc_add_reloc(enc_section_t* section, size_t offset, enc_reloc_kind kind, size_t symbol, int64_t addend) {
+    if(section->reloc_count == section->reloc_capacity) {
+        section->reloc_capacity = section->reloc_capacity ? section->reloc_capacity * 2 : ENC_MIN_TABLE;
+        section->relocs = (enc_reloc_t*)realloc(section->relocs, section->reloc_capacity * sizeof(enc_reloc_t));
+    }
+    section->relocs[section->reloc_count++] = (enc_reloc_t){ offset, kind, symbol, addend };
+}
+
+// INSTRUCTIONS
+
+static void enc_byte(enc_insn_t* out, uint8_t byte) {
+    out->bytes[out->len++] = byte;
+}
+
+static void enc_value(enc_insn_t* out, int64_t value, size_t size) {
+    for(size_t i = 0; i < size; i++) enc_byte(out, (uint8_t)(value >> (i * 8)));
+}
+
+static void enc_fixup(enc_insn_t* out, enc_fixup_kind kind, mir_operand_t* operand, uint8_t size) {
+    out->fixups[out->fixup_count++] = (enc_fixup_t){ kind, out->len, size, operand };
+    enc_value(out, 0, size);
+}
+
+// an immediate as wide as size, which stays 4 bytes for 64 bit operations
+static void enc_imm(enc_insn_t* out, mir_operand_t* imm, size_t size) {
+    if(size == 8) size = 4;
+    if(imm->symbol.name) enc_fixup(out, ENC_FIXUP_ABS, imm, size);
+    else enc_value(out, imm->value, size);
+}
+
+static bool enc_is_byte_reg(enc_data_t* data, mir_operand_t* operand) {
+    return data->mir->is_64 && operand && operand->kind == MIR_OPERAND_REG && operand->size == 1
+        && operand->reg >= MIR_SP && operand->reg <= MIR_DI;
+}
+
+// operand size and REX prefixes for an instruction whose ModRM names reg and rm
+static void enc_prefix(enc_data_t* data, enc_insn_t* out, uint8_t size, mir_operand_t* reg, mir_operand_t* rm) {
+    if(size == 2) enc_byte(out, 0x66);
+    uint8_t rex = size == 8 ? ENC_REX_W : 0;
+    if(reg && reg->reg >= MIR_R8) rex |= ENC_REX_R;
+    if(rm && rm->kind == MIR_OPERAND_REG && rm->reg >= MIR_R8) rex |= ENC_REX_B;
+    if(rm && rm->kind == MIR_OPERAND_MEM) {
+        if(rm->reg >= MIR_R8 && rm->reg < MIR_RIP) rex |= ENC_REX_B;
+        if(rm->index >= MIR_R8 && rm->index < MIR_RIP) rex |= ENC_REX_X;
+    }
+    if(rex || enc_is_byte_reg(data, reg) || enc_is_byte_reg(data, rm)) enc_byte(out, ENC_REX | rex);
+}
+
+static uint8_t enc_scale(uint8_t scale) {
+    switch(scale) {
+    case 2: return 1;
+    case 4: return 2;
+    case 8: return 3;
+    default: return 0;
+    }
+}
+
+// the ModRM byte with reg_field and whatever rm needs after it
+static bool enc_modrm(enc_data_t* data, enc_insn_t* out, uint8_t reg_field, mir_operand_t* rm) {
+    reg_field = (reg_field & 7) << 3;
+    if(rm->kind == MIR_OPERAND_REG) {
+        enc_byte(out, 0xc0 | reg_field | (rm->reg & 7));
+        return true;
+    }
+    if(rm->kind != MIR_OPERAND_MEM) return false;
+
+    if(rm->reg == MIR_RIP) {
+        enc_byte(out, 0x05 | reg_field);
+        if(rm->symbol.name) enc_fixup(out, ENC_FIXUP_PC, rm, 4);
+        else enc_value(out, rm->value, 4);
+        return true;
+    }
+
+    uint8_t mod;
+    if(rm->reg == MIR_NO_REG) {
+        // an absolute address, which 64 bit code can only reach through a SIB
+        if(rm->index == MIR_NO_REG && !data->mir->is_64) {
+            enc_byte(out, 0x05 | reg_field);
+        } else {
+            enc_byte(out, 0x04 | reg_field);
+            uint8_t index = rm->index == MIR_NO_REG ? 4 : rm->index & 7;
+            enc_byte(out, (enc_scale(rm->scale) << 6) | (index << 3) | 5);
+        }
+        mod = 2;
+    } else {
+        if(rm->symbol.name || !enc_fits_byte(rm->value)) mod = 2;
+        else if(rm->value || (rm->reg & 7) == MIR_BP) mod = 1;
+        else mod = 0;
+
+        if(rm->index != MIR_NO_REG || (rm->reg & 7) == MIR_SP) {
+            enc_byte(out, (mod << 6) | reg_field | 4);
+            uint8_t index = rm->index == MIR_NO_REG ? 4 : rm->index & 7;
+            enc_byte(out, (enc_scale(rm->scale) << 6) | (index << 3) | (rm->reg & 7));
+        } else {
+            enc_byte(out, (mod << 6) | reg_field | (rm->reg & 7));
+        }
+    }
+
+    if(rm->symbol.name) enc_fixup(out, ENC_FIXUP_ABS, rm, 4);
+    else if(mod == 1) enc_value(out, rm->value, 1);
+    else if(mod == 2) enc_value(out, rm->value, 4);
+    return true;
+}
+
+// opcode /digit or opcode /r, the digit given as a register of the same number
+static bool enc_op_modrm(enc_data_t* data, enc_insn_t* out, uint8_t size, uint32_t opcode, mir_operand_t* reg, uint8_t digit, mir_operand_t* rm) {
+    enc_prefix(data, out, size, reg, rm);
+    if(opcode > 0xff) enc_byte(out, opcode >> 8);
+    enc_byte(out, opcode & 0xff);
+    return enc_modrm(data, out, reg ? reg->reg : digit, rm);
+}
+
+// opcode +r, the register in the low bits of the opcode
+static void enc_op_reg(enc_data_t* data, enc_insn_t* out, uint8_t size, uint8_t opcode, mir_operand_t* reg) {
+    enc_prefix(data, out, size, NULL, reg);
+    enc_byte(out, opcode + (reg->reg & 7));
+}
+
+static bool enc_is_reg(mir_operand_t* operand, mir_register reg) {
+    return operand->kind == MIR_OPERAND_REG && operand->reg == reg;
+}
+
+// a branch to a label in its own section can be short if the label is close
+static size_t enc_relax_target(enc_data_t* data, size_t i) {
+    mir_insn_t* insn = &data->mir->insns[i];
+    if(insn->opcode != MIR_JMP && insn->opcode != MIR_JCC) return ENC_UNDEFINED;
+    if(insn->operands[0].kind != MIR_OPERAND_LABEL) return ENC_UNDEFINED;
+    size_t symbol = enc_find_symbol(data->obj, insn->operands[0].symbol);
+    if(symbol == ENC_UNDEFINED || data->obj->symbols[symbol].section != data->sections[i]) return ENC_UNDEFINED;
+    return symbol;
+}
+
+static bool enc_is_long(enc_data_t* data, size_t i) {
+    return data->long_jumps[i] || data->targets[i] == ENC_UNDEFINED;
+}
+
+static bool enc_mov(enc_data_t* data, enc_insn_t* out, mir_operand_t* src, mir_operand_t* dst) {
+    uint8_t size = dst->size;
+    if(src->kind == MIR_OPERAND_IMM) {
+        if(dst->kind == MIR_OPERAND_REG && size != 8) {
+            enc_op_reg(data, out, size, size == 1 ? 0xb0 : 0xb8, dst);
+            enc_imm(out, src, size);
+            return true;
+        }
+        if(dst->kind == MIR_OPERAND_REG && !src->symbol.name && src->value != (int32_t)src->value) {
+            enc_op_reg(data, out, size, 0xb8, dst);
+            enc_value(out, src->value, 8);
+            return true;
+        }
+        if(!enc_op_modrm(data, out, size, size == 1 ? 0xc6 : 0xc7, NULL, 0, dst)) return false;
+        enc_imm(out, src, size);
+        return true;
+    }
+    if(src->kind == MIR_OPERAND_REG)
+        return enc_op_modrm(data, out, size, size == 1 ? 0x88 : 0x89, src, 0, dst);
+    if(dst->kind == MIR_OPERAND_REG)
+        return enc_op_modrm(data, out, size, size == 1 ? 0x8a : 0x8b, dst, 0, src);
+    return false;
+}
+
+static bool enc_alu(enc_data_t* data, enc_insn_t* out, uint8_t code, mir_operand_t* src, mir_operand_t* dst) {
+    uint8_t size = dst->size;
+    if(src->kind == MIR_OPERAND_IMM) {
+        int64_t value = size == 4 ? (int32_t)src->value : src->value;
+        if(!src->symbol.name && size != 1 && enc_fits_byte(value)) {
+            if(!enc_op_modrm(data, out, size, 0x83, NULL, code, dst)) return false;
+            enc_value(out, value, 1);
+            return true;
+        }
+        if(enc_is_reg(dst, MIR_AX)) {
+            enc_prefix(data, out, size, NULL, dst);
+            enc_byte(out, (code << 3) + (size == 1 ? 4 : 5));
+        } else if(!enc_op_modrm(data, out, size, size == 1 ? 0x80 : 0x81, NULL, code, dst)) {
+            return false;
+        }
+        enc_imm(out, src, size);
+        return true;
+    }
+    if(src->kind == MIR_OPERAND_REG)
+        return enc_op_modrm(data, out, size, (code << 3) + (size == 1 ? 0 : 1), src, 0, dst);
+    if(dst->kind == MIR_OPERAND_REG)
+        return enc_op_modrm(data, out, size, (code << 3) + (size == 1 ? 2 : 3), dst, 0, src);
+    return false;
+}
+
+static bool enc_shift(enc_data_t* data, enc_insn_t* out, uint8_t code, mir_operand_t* count, mir_operand_t* dst) {
+    uint8_t size = dst->size;
+    if(count->kind == MIR_OPERAND_REG)
+        return enc_op_modrm(data, out, size, size == 1 ? 0xd2 : 0xd3, NULL, code, dst);
+    if(count->value == 1)
+        return enc_op_modrm(data, out, size, size == 1 ? 0xd0 : 0xd1, NULL, code, dst);
+    if(!enc_op_modrm(data, out, size, size == 1 ? 0xc0 : 0xc1, NULL, code, dst)) return false;
+    enc_value(out, count->value, 1);
+    return true;
+}
+
+// NEG, NOT, IMUL, IDIV and DIV of a single operand
+static bool enc_unary(enc_data_t* data, enc_insn_t* out, uint8_t code, mir_operand_t* operand) {
+    return enc_op_modrm(data, out, operand->size, operand->size == 1 ? 0xf6 : 0xf7, NULL, code, operand);
+}
+
+static bool enc_branch(enc_data_t* data, enc_insn_t* out, mir_insn_t* insn, bool long_jump) {
+    mir_operand_t* target = &insn->operands[0];
+    if(insn->opcode == MIR_CALL || insn->opcode == MIR_JMP) {
+        bool call = insn->opcode == MIR_CALL;
+        if(target->kind != MIR_OPERAND_LABEL)
+            return enc_op_modrm(data, out, 4, 0xff, NULL, call ? 2 : 4, target);
+        if(!call && !long_jump) {
+            enc_byte(out, 0xeb);
+            enc_fixup(out, ENC_FIXUP_JUMP, target, 1);
+            return true;
+        }
+        enc_byte(out, call ? 0xe8 : 0xe9);
+        enc_fixup(out, call ? ENC_FIXUP_CALL : ENC_FIXUP_JUMP, target, 4);
+        return true;
+    }
+
+    uint8_t cc = enc_cc_codes[insn->cc];
+    if(long_jump) {
+        enc_byte(out, 0x0f);
+        enc_byte(out, 0x80 | cc);
+        enc_fixup(out, ENC_FIXUP_JUMP, target, 4);
+    } else {
+        enc_byte(out, 0x70 | cc);
+        enc_fixup(out, ENC_FIXUP_JUMP, target, 1);
+    }
+    return true;
+}
+
+static bool enc_insn(enc_data_t* data, mir_insn_t* insn, bool long_jump, enc_insn_t* out) {
+    memset(out, 0, sizeof(enc_insn_t));
+    mir_operand_t* ops = insn->operands;
+    mir_operand_t* last = insn->operand_count ? &ops[insn->operand_count - 1] : NULL;
+
+    switch(insn->opcode) {
+    case MIR_MOV:
+        return enc_mov(data, out, &ops[0], &ops[1]);
+    case MIR_MOVZB:
+        return enc_op_modrm(data, out, ops[1].size, 0x0fb6, &ops[1], 0, &ops[0]);
+    case MIR_MOVSL:
+        return enc_op_modrm(data, out, 8, 0x63, &ops[1], 0, &ops[0]);
+    case MIR_LEA:
+        return enc_op_modrm(data, out, ops[1].size, 0x8d, &ops[1], 0, &ops[0]);
+    case MIR_ADD:
+    case MIR_ADC:
+    case MIR_SBB:
+    case MIR_SUB:
+    case MIR_AND:
+    case MIR_OR:
+    case MIR_XOR:
+    case MIR_CMP:
+        return enc_alu(data, out, enc_alu_code(insn->opcode), &ops[0], &ops[1]);
+    case MIR_TEST:
+        if(ops[0].kind == MIR_OPERAND_IMM) {
+            if(enc_is_reg(&ops[1], MIR_AX)) {
+                enc_prefix(data, out, ops[1].size, NULL, &ops[1]);
+                enc_byte(out, ops[1].size == 1 ? 0xa8 : 0xa9);
+            } else if(!enc_op_modrm(data, out, ops[1].size, ops[1].size == 1 ? 0xf6 : 0xf7, NULL, 0, &ops[1])) {
+                return false;
+            }
+            enc_imm(out, &ops[0], ops[1].size);
+            return true;
+        }
+        if(ops[0].kind == MIR_OPERAND_REG)
+            return enc_op_modrm(data, out, ops[1].size, ops[1].size == 1 ? 0x84 : 0x85, &ops[0], 0, &ops[1]);
+        return enc_op_modrm(data, out, ops[1].size, ops[1].size == 1 ? 0x84 : 0x85, &ops[1], 0, &ops[0]);
+    case MIR_NOT:
+        return enc_unary(data, out, 2, &ops[0]);
+    case MIR_NEG:
+        return enc_unary(data, out, 3, &ops[0]);
+    case MIR_IDIV:
+        return enc_unary(data, out, 7, &ops[0]);
+    case MIR_DIV:
+        return enc_unary(data, out, 6, &ops[0]);
+    case MIR_INC:
+    case MIR_DEC:
+        // the one byte forms are REX prefixes in 64 bit mode
+        if(!data->mir->is_64 && ops[0].kind == MIR_OPERAND_REG && ops[0].size != 1) {
+            enc_op_reg(data, out, ops[0].size, insn->opcode == MIR_INC ? 0x40 : 0x48, &ops[0]);
+            return true;
+        }
+        return enc_op_modrm(data, out, ops[0].size, ops[0].size == 1 ? 0xfe : 0xff, NULL, insn->opcode == MIR_INC ? 0 : 1, &ops[0]);
+    case MIR_IMUL:
+        if(insn->operand_count == 1) return enc_unary(data, out, 5, &ops[0]);
+        if(insn->operand_count == 2) return enc_op_modrm(data, out, ops[1].size, 0x0faf, &ops[1], 0, &ops[0]);
+        if(enc_fits_byte(ops[0].value)) {
+            if(!enc_op_modrm(data, out, ops[2].size, 0x6b, &ops[2], 0, &ops[1])) return false;
+            enc_value(out, ops[0].value, 1);
+        } else {
+            if(!enc_op_modrm(data, out, ops[2].size, 0x69, &ops[2], 0, &ops[1])) return false;
+            enc_imm(out, &ops[0], ops[2].size);
+        }
+        return true;
+    case MIR_SHL:
+        return enc_shift(data, out, 4, &ops[0], &ops[1]);
+    case MIR_SHR:
+        return enc_shift(data, out, 5, &ops[0], &ops[1]);
+    case MIR_SAR:
+        return enc_shift(data, out, 7, &ops[0], &ops[1]);
+    case MIR_BT:
+        if(ops[0].kind == MIR_OPERAND_IMM) {
+            if(!enc_op_modrm(data, out, ops[1].size, 0x0fba, NULL, 4, &ops[1])) return false;
+            enc_value(out, ops[0].value, 1);
+            return true;
+        }
+        return enc_op_modrm(data, out, ops[1].size, 0x0fa3, &ops[0], 0, &ops[1]);
+    case MIR_XCHG: {
+        // either register against the accumulator takes the one byte form
+        mir_operand_t* other = enc_is_reg(&ops[0], MIR_AX) ? &ops[1] : enc_is_reg(&ops[1], MIR_AX) ? &ops[0] : NULL;
+        if(other && other->kind == MIR_OPERAND_REG && other->size != 1 && !(data->mir->is_64 && other->reg == MIR_AX)) {
+            enc_op_reg(data, out, other->size, 0x90, other);
+            return true;
+        }
+        return enc_op_modrm(data, out, ops[1].size, ops[1].size == 1 ? 0x86 : 0x87, &ops[0], 0, &ops[1]);
+    }
+    case MIR_CDQ:
+        enc_byte(out, 0x99);
+        return true;
+    case MIR_PUSH:
+        if(ops[0].kind == MIR_OPERAND_REG) {
+            enc_op_reg(data, out, 4, 0x50, &ops[0]);
+            return true;
+        }
+        if(ops[0].kind == MIR_OPERAND_IMM) {
+            if(!ops[0].symbol.name && enc_fits_byte(ops[0].value)) {
+                enc_byte(out, 0x6a);
+                enc_value(out, ops[0].value, 1);
+            } else {
+                enc_byte(out, 0x68);
+                enc_imm(out, &ops[0], 4);
+            }
+            return true;
+        }
+        return enc_op_modrm(data, out, 4, 0xff, NULL, 6, &ops[0]);
+    case MIR_POP:
+        if(ops[0].kind == MIR_OPERAND_REG) {
+            enc_op_reg(data, out, 4, 0x58, &ops[0]);
+            return true;
+        }
+        return enc_op_modrm(data, out, 4, 0x8f, NULL, 0, &ops[0]);
+    case MIR_PUSHA:
+        enc_byte(out, 0x60);
+        return true;
+    case MIR_POPA:
+        enc_byte(out, 0x61);
+        return true;
+    case MIR_CALL:
+    case MIR_JMP:
+    case MIR_JCC:
+        return enc_branch(data, out, insn, long_jump);
+    case MIR_RET:
+        enc_byte(out, 0xc3);
+        return true;
+    case MIR_LEAVE:
+        enc_byte(out, 0xc9);
+        return true;
+    case MIR_SETCC:
+        return enc_op_modrm(data, out, 1, 0x0f90 | enc_cc_codes[insn->cc], NULL, 0, last);
+    case MIR_INT:
+        enc_byte(out, 0xcd);
+        enc_value(out, ops[0].value, 1);
+        return true;
+    case MIR_SYSCALL:
+        enc_byte(out, 0x0f);
+        enc_byte(out, 0x05);
+        return true;
+    case MIR_CLD:
+        enc_byte(out, 0xfc);
+        return true;
+    case MIR_RDTSC:
+        enc_byte(out, 0x0f);
+        enc_byte(out, 0x31);
+        return true;
+    case MIR_REPE_CMPSB:
+        enc_byte(out, 0xf3);
+        enc_byte(out, 0xa6);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// bytes the pseudo instruction at i lays down where it is
+static size_t enc_pseudo_size(mir_insn_t* insn, size_t offset) {
+    switch(insn->opcode) {
+    case MIR_ALIGN:
+        return (insn->operands[0].value - offset % insn->operands[0].value) % insn->operands[0].value;
+    case MIR_BYTE:
+        return 1;
+    case MIR_LONG:
+        return 4;
+    case MIR_ASCII:
+        return strlen(insn->operands[0].text);
+    case MIR_ZERO:
+        return insn->operands[0].value;
+    default:
+        return 0;
+    }
+}
+
+// LAYOUT
+
+// the section of every instruction and label, and the size of all but ALIGN
+static bool enc_prepare(enc_data_t* data) {
+    mir_t* mir = data->mir;
+    enc_object_t* obj = data->obj;
+    mir_section section = MIR_SECTION_TEXT;
+    obj->sections[section].used = true;
+
+    for(size_t i = 0; i < mir->count; i++) {
+        mir_insn_t* insn = &mir->insns[i];
+        if(insn->opcode == MIR_SECTION) {
+            section = insn->section;
+            obj->sections[section].used = true;
+        } else if(insn->opcode == MIR_LABEL) {
+            size_t index = enc_symbol(obj, insn->operands[0].symbol);
+            enc_symbol_t* symbol = &obj->symbols[index];
+            // a label defined twice has no single address
+            if(symbol->section != ENC_UNDEFINED) return false;
+            symbol->section = section;
+        } else if(insn->opcode == MIR_GLOBL) {
+            size_t index = enc_symbol(obj, insn->operands[0].symbol);
+            obj->symbols[index].global = true;
+        } else if(insn->opcode == MIR_ALIGN) {
+            if(insn->operands[0].value <= 0) return false;
+            if((size_t)insn->operands[0].value > obj->sections[section].align)
+                obj->sections[section].align = insn->operands[0].value;
+        }
+        data->sections[i] = section;
+    }
+
+    for(size_t i = 0; i < mir->count; i++) {
+        mir_insn_t* insn = &mir->insns[i];
+        data->targets[i] = enc_relax_target(data, i);
+        if(MIR_IS_INSN(insn->opcode)) {
+            enc_insn_t out;
+            if(!enc_insn(data, insn, enc_is_long(data, i), &out)) return false;
+            data->sizes[i] = out.len;
+        } else {
+            data->sizes[i] = enc_pseudo_size(insn, 0);
+        }
+    }
+    return true;
+}
+
+static void enc_layout(enc_data_t* data) {
+    size_t offsets[MIR_SECTION_COUNT] = { 0 };
+    for(size_t i = 0; i < data->mir->count; i++) {
+        mir_insn_t* insn = &data->mir->insns[i];
+        size_t* offset = &offsets[data->sections[i]];
+        if(insn->opcode == MIR_ALIGN) data->sizes[i] = enc_pseudo_size(insn, *offset);
+        if(insn->opcode == MIR_LABEL)
+            data->obj->symbols[enc_find_symbol(data->obj, insn->operands[0].symbol)].value = *offset;
+        data->offsets[i] = *offset;
+        *offset += data->sizes[i];
+    }
+}
+
+// start every branch short and lengthen the ones that cannot reach until none change
+static void enc_relax(enc_data_t* data) {
+    bool changed = true;
+    while(changed) {
+        enc_layout(data);
+        changed = false;
+        for(size_t i = 0; i < data->mir->count; i++) {
+            if(enc_is_long(data, i)) continue;
+            mir_insn_t* insn = &data->mir->insns[i];
+            enc_symbol_t* target = &data->obj->symbols[data->targets[i]];
+            int64_t distance = (int64_t)target->value - (int64_t)(data->offsets[i] + data->sizes[i]);
+            if(enc_fits_byte(distance)) continue;
+            data->long_jumps[i] = true;
+            data->sizes[i] = insn->opcode == MIR_JMP ? 5 : 6;
+            changed = true;
+        }
+    }
+}
+
+// EMISSION
+
+static bool enc_is_code(mir_section section) {
+    return section == MIR_SECTION_TEXT || section == MIR_SECTION_TEXT_HOT || section == MIR_SECTION_TEXT_UNLIKELY;
+}
+
+static void enc_patch(uint8_t* field, int64_t value, size_t size) {
+    for(size_t i = 0; i < size; i++) field[i] = (uint8_t)(value >> (i * 8));
+}
+
+// fill in a field the instruction at section offset start left for a symbol
+static bool enc_resolve(enc_data_t* data, mir_section section, size_t start, size_t end, uint8_t* field, enc_fixup_t* fixup) {
+    enc_object_t* obj = data->obj;
+    mir_operand_t* operand = fixup->operand;
+    size_t offset = start + fixup->at;
+    // looked up before taking pointers, adding a symbol may move them all
+    size_t index = enc_symbol(obj, operand->symbol);
+    size_t minus_index = operand->minus.name ? enc_symbol(obj, operand->minus) : ENC_UNDEFINED;
+    enc_symbol_t* symbol = &obj->symbols[index];
+    bool local = symbol->section == section;
+
+    if(fixup->kind == ENC_FIXUP_ABS) {
+        if(!operand->minus.name) {
+            if(fixup->size != 4) return false;
+            enc_add_reloc(&obj->sections[section], offset, ENC_RELOC_ABS32, index, operand->value);
+            return true;
+        }
+        enc_symbol_t* minus = &obj->symbols[minus_index];
+        if(minus->section != ENC_UNDEFINED && minus->section == symbol->section && !symbol->global) {
+            enc_patch(field, (int64_t)symbol->value - (int64_t)minus->value + operand->value, fixup->size);
+            return true;
+        }
+        // only a difference with the field's own section can be made relative to it
+        if(minus->section != section || fixup->size != 4) return false;
+        enc_add_reloc(&obj->sections[section], offset, ENC_RELOC_PC32, index, operand->value + (int64_t)(offset - minus->value));
+        return true;
+    }
+
+    int64_t value = fixup->kind == ENC_FIXUP_PC ? operand->value : 0;
+    // calls to globals go through the linker even when they are right here
+    if(local && (fixup->kind != ENC_FIXUP_CALL || !symbol->global)) {
+        int64_t distance = (int64_t)symbol->value + value - (int64_t)end;
+        if(fixup->size == 1 && !enc_fits_byte(distance)) return false;
+        enc_patch(field, distance, fixup->size);
+        return true;
+    }
+    if(fixup->size != 4) return false;
+    enc_reloc_kind kind = fixup->kind != ENC_FIXUP_PC && (symbol->global || symbol->section == ENC_UNDEFINED)
+        ? ENC_RELOC_PLT32 : ENC_RELOC_PC32;
+    enc_add_reloc(&obj->sections[section], offset, kind, index, value - (int64_t)(end - offset));
+    return true;
+}
+
+static bool enc_emit(enc_data_t* data) {
+    for(size_t i = 0; i < data->mir->count; i++) {
+        mir_insn_t* insn = &data->mir->insns[i];
+        mir_section id = data->sections[i];
+        enc_section_t* section = &data->obj->sections[id];
+        if(!data->sizes[i]) continue;
+
+        if(id == MIR_SECTION_BSS) {
+            if(insn->opcode != MIR_ZERO && insn->opcode != MIR_ALIGN) return false;
+            section->size += data->sizes[i];
+            continue;
+        }
+
+        if(MIR_IS_INSN(insn->opcode)) {
+            enc_insn_t out;
+            if(!enc_insn(data, insn, enc_is_long(data, i), &out)) return false;
+            if(out.len != data->sizes[i]) return false;
+            size_t start = section->data.len;
+            uint8_t* bytes = (uint8_t*)buf_reserve(&section->data, out.len);
+            memcpy(bytes, out.bytes, out.len);
+            for(size_t f = 0; f < out.fixup_count; f++) {
+                if(!enc_resolve(data, id, start, start + out.len, &bytes[out.fixups[f].at], &out.fixups[f])) return false;
+            }
+            continue;
+        }
+
+        mir_operand_t* operand = &insn->operands[0];
+        size_t start = section->data.len;
+        uint8_t* bytes = (uint8_t*)buf_reserve(&section->data, data->sizes[i]);
+        switch(insn->opcode) {
+        case MIR_ALIGN:
+            // executable padding has to decode
+            memset(bytes, enc_is_code(id) ? 0x90 : 0, data->sizes[i]);
+            break;
+        case MIR_BYTE:
+            bytes[0] = (uint8_t)operand->value;
+            break;
+        case MIR_LONG:
+            if(operand->symbol.name) {
+                enc_fixup_t fixup = { ENC_FIXUP_ABS, 0, 4, operand };
+                memset(bytes, 0, 4);
+                if(!enc_resolve(data, id, start, start + 4, bytes, &fixup)) return false;
+            } else {
+                enc_patch(bytes, operand->value, 4);
+            }
+            break;
+        case MIR_ASCII:
+            memcpy(bytes, operand->text, data->sizes[i]);
+            break;
+        case MIR_ZERO:
+            memset(bytes, 0, data->sizes[i]);
+            break;
+        default:
+            break;
+        }
+    }
+
+    for(size_t i = 0; i < MIR_SECTION_COUNT; i++) {
+        enc_section_t* section = &data->obj->sections[i];
+        if(i != MIR_SECTION_BSS) section->size = section->data.len;
+        if(!section->align) section->align = 1;
+    }
+    return true;
+}
+
+bool enc_assemble(mir_t* mir, enc_object_t* obj) {
+    memset(obj, 0, sizeof(enc_object_t));
+    obj->is_64 = mir->is_64;
+
+    enc_data_t data = { 0 };
+    data.mir = mir;
+    data.obj = obj;
+    data.sections = (mir_section*)calloc(mir->count + 1, sizeof(mir_section));
+    data.offsets = (size_t*)calloc(mir->count + 1, sizeof(size_t));
+    data.sizes = (size_t*)calloc(mir->count + 1, sizeof(size_t));
+    data.targets = (size_t*)calloc(mir->count + 1, sizeof(size_t));
+    data.long_jumps = (bool*)calloc(mir->count + 1, sizeof(bool));
+
+    bool success = enc_prepare(&data);
+    if(success) {
+        enc_relax(&data);
+        success = enc_emit(&data);
+    }
+
+    obj->func_sizes = (size_t*)calloc(mir->func_count + 1, sizeof(size_t));
+    obj->func_count = mir->func_count;
+    for(size_t f = 0; f < mir->func_count; f++) {
+        for(size_t i = mir->funcs[f].first; i < mir->funcs[f].end; i++) {
+            if(enc_is_code(data.sections[i])) obj->func_sizes[f] += data.sizes[i];
+        }
+    }
+
+    free(data.sections);
+    free(data.offsets);
+    free(data.sizes);
+    free(data.targets);
+    free(data.long_jumps);
+    return success;
+}
+
+bool enc_link(enc_object_t* obj, const uint64_t addresses[MIR_SECTION_COUNT]) {
+    buf_t name;
+    buf_init(&name);
+    bool success = true;
+    for(size_t i = 0; i < MIR_SECTION_COUNT && success; i++) {
+        enc_section_t* section = &obj->sections[i];
+        for(size_t r = 0; r < section->reloc_count; r++) {
+            enc_reloc_t* reloc = &section->relocs[r];
+            enc_symbol_t* symbol = &obj->symbols[reloc->symbol];
+            if(symbol->section == ENC_UNDEFINED) {
+                mir_print_label(&name, symbol->label);
+                buf_putc(&name, '\0');
+                printf("Undefined reference to %s\n", name.data);
+                success = false;
+                break;
+            }
+
+            int64_t value = addresses[symbol->section] + symbol->value + reloc->addend;
+            if(reloc->kind != ENC_RELOC_ABS32) value -= addresses[i] + reloc->offset;
+            if(reloc->kind == ENC_RELOC_ABS32 ? (uint64_t)value > UINT32_MAX : value != (int32_t)value) {
+                success = false;
+                break;
+            }
+            enc_patch((uint8_t*)&section->data.data[reloc->offset], value, 4);
+        }
+    }
+    free_buf(&name);
+    return success;
+}
+
+void free_enc_object(enc_object_t* obj) {
+    for(size_t i = 0; i < MIR_SECTION_COUNT; i++) {
+        free_buf(&obj->sections[i].data);
+        free(obj->sections[i].relocs);
+    }
+    free(obj->symbols);
+    free(obj->table);
+    free(obj->func_sizes);
+    memset(obj, 0, sizeof(enc_object_t));
+}
@@ -0,0 +1,84 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include "fwd.h"
+#include "buffer.h"
+#include "mir.h"
+
+// Machine code for a program's instructions, laid out section by section with
+// the symbols its labels define and the relocations the addresses it cannot
+// know yet are left as. Branches are relaxed to their short forms where the
+// target is close enough, the same as GNU as does.
+
+typedef enum enc_reloc_kind_e {
+    // the 32 bit address of the symbol
+    ENC_RELOC_ABS32,
+    // the symbol less the address of the field
+    ENC_RELOC_PC32,
+    // a call or jump to a function that may be in another object
+    ENC_RELOC_PLT32
+} enc_reloc_kind;
+
+typedef struct enc_reloc_s {
+    size_t offset;
+    enc_reloc_kind kind;
+    size_t symbol;
+    int64_t addend;
+} enc_reloc_t;
+
+// the section of a symbol only referred to
+#define ENC_UNDEFINED ((size_t)-1)
+
+typedef struct enc_symbol_s {
+    mir_label_t label;
+    size_t section;
+    size_t value;
+    bool global;
+} enc_symbol_t;
+
+typedef struct enc_section_s {
+    // switched to at least once, even if nothing went in
+    bool used;
+    // bss only counts its size and leaves data empty
+    buf_t data;
+    size_t size;
+    size_t align;
+
+    enc_reloc_t* relocs;
+    size_t reloc_count;
+    size_t reloc_capacity;
+} enc_section_t;
+
+typedef struct enc_object_s {
+    bool is_64;
+    enc_section_t sections[MIR_SECTION_COUNT];
+
+    enc_symbol_t* symbols;
+    size_t symbol_count;
+    size_t symbol_capacity;
+    // open addressing from labels to symbol index + 1
+    size_t* table;
+    size_t table_size;
+
+    // bytes of code each of the program's functions took, in its order
+    size_t* func_sizes;
+    size_t func_count;
+} enc_object_t;
+
+// false when an instruction has no encoding
+bool enc_assemble(mir_t* mir, enc_object_t* obj);
+void free_enc_object(enc_object_t* obj);
+
+// the symbol for label, ENC_UNDEFINED when the program never mentions it
+size_t enc_find_symbol(enc_object_t* obj, mir_label_t label);
+
+// resolve every relocation in place for the sections loaded at addresses,
+// false when a symbol is undefined or out of reach
+bool enc_link(enc_object_t* obj, const uint64_t addresses[MIR_SECTION_COUNT]);
+
+#endif
@@ -62,7 +62,12 @@ extern const char* operator_type_names[OPERATOR_TYPE_COUNT];
 
 #define KEYWORD_TYPE_LIST(__item, _uargs) \
     __item(INVALID, _uargs) \
-    __item(RETURN, _uargs)
+    __item(RETURN, _uargs) \
+    __item(SWITCH, _uargs) \
+    __item(CASE, _uargs) \
+    __item(DEFAULT, _uargs) \
+    __item(BREAK, _uargs) \
+    __item(STATIC, _uargs)
 
 typedef enum keyword_type_e {
     KEYWORD_TYPE_LIST(ENUM_LIST_ITEM, KEYWORD_)
@@ -0,0 +1,93 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "jit.h"
+#include "encode.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// laid out like a static executable, the code and read only data in pages that
+// are made executable once linked, then the zeroed bss pages
+static const mir_section jit_load_order[] = {
+    MIR_SECTION_TEXT_UNLIKELY, MIR_SECTION_TEXT_HOT, MIR_SECTION_TEXT, MIR_SECTION_RODATA
+};
+
+typedef int (*jit_main_t)(int argc, char** argv);
+
+bool jit_run(mir_t* mir, int argc, char** argv, int* status) {
+#ifndef __x86_64__
+    printf("Running programs needs an x86-64 host\n");
+    return false;
+#else
+    if(!mir->is_64) {
+        printf("Running programs needs 64 bit code\n");
+        return false;
+    }
+
+    enc_object_t obj;
+    if(!enc_assemble(mir, &obj)) {
+        printf("Failed to encode machine code\n");
+        free_enc_object(&obj);
+        return false;
+    }
+
+    size_t entry = enc_find_symbol(&obj, mir_symbol("main"));
+    if(entry == ENC_UNDEFINED || obj.symbols[entry].section == ENC_UNDEFINED) {
+        printf("Undefined reference to main\n");
+        free_enc_object(&obj);
+        return false;
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t offsets[MIR_SECTION_COUNT] = { 0 };
+    size_t text_size = 0;
+    for(size_t i = 0; i < sizeof(jit_load_order) / sizeof(jit_load_order[0]); i++) {
+        enc_section_t* section = &obj.sections[jit_load_order[i]];
+        if(!section->used) continue;
+        text_size = (text_size + section->align - 1) / section->align * section->align;
+        offsets[jit_load_order[i]] = text_size;
+        text_size += section->size;
+    }
+    text_size = (text_size + page - 1) / page * page;
+    offsets[MIR_SECTION_BSS] = text_size;
+    size_t size = text_size + (obj.sections[MIR_SECTION_BSS].size + page - 1) / page * page;
+
+    // anonymous pages start zeroed, so bss needs nothing copied
+    uint8_t* memory = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED) {
+        printf("Failed to map memory for the program\n");
+        free_enc_object(&obj);
+        return false;
+    }
+
+    uint64_t addresses[MIR_SECTION_COUNT] = { 0 };
+    for(size_t i = 0; i < MIR_SECTION_COUNT; i++)
+        addresses[i] = (uintptr_t)memory + offsets[i];
+    bool success = enc_link(&obj, addresses);
+    if(success) {
+        for(size_t i = 0; i < sizeof(jit_load_order) / sizeof(jit_load_order[0]); i++) {
+            enc_section_t* section = &obj.sections[jit_load_order[i]];
+            if(section->data.len) memcpy(memory + offsets[jit_load_order[i]], section->data.data, section->data.len);
+        }
+        success = mprotect(memory, text_size, PROT_READ | PROT_EXEC) == 0;
+        if(!success) printf("Failed to make the program executable\n");
+    }
+
+    if(success) {
+        jit_main_t main_func = (jit_main_t)(uintptr_t)(addresses[obj.symbols[entry].section] + obj.symbols[entry].value);
+        free_enc_object(&obj);
+        // the program writes with system calls, what the compiler printed goes out first
+        fflush(stdout);
+        *status = main_func(argc, argv);
+    } else {
+        free_enc_object(&obj);
+    }
+    munmap(memory, size);
+    return success;
+#endif
+}
@@ -0,0 +1,19 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef JIT_H
+#define JIT_H
+
+#include "fwd.h"
+#include "mir.h"
+
+// Running a program inside the compiler. Its machine code is encoded straight
+// into executable memory and main is called like any other function, without
+// writing a file or starting a process.
+
+// false when the program cannot be encoded or loaded, otherwise status is what main returned
+bool jit_run(mir_t* mir, int argc, char** argv, int* status);
+
+#endif
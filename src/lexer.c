@@ -34,6 +34,17 @@ const char* keyword_type_names[KEYWORD_TYPE_COUNT] = {
             _curr->next->prev = _curr; \
             _curr = _curr->next
 
+// keyword names are upper case, source keywords are lower case and must not run into an identifier
+static size_t match_keyword(const char* remaining, const char* name) {
+    size_t i = 0;
+    for(; name[i]; ++i) {
+        if(remaining[i] != tolower(name[i])) return 0;
+    }
+
+    if(isalnum(remaining[i]) || remaining[i] == '_') return 0;
+    return i;
+}
+
 token_t* lex(const char* content, size_t len) {
     assert(len > 0);
     assert(content);
@@ -41,12 +52,22 @@ token_t* lex(const char* content, size_t len) {
     token_t* head;
     ZMALLOC(token_t, head);
     token_t* curr = head;
+    // line being read and where it starts, for the locations of the tokens
+    size_t line = 1, line_start = 0;
     for(size_t i = 0; i < len; ++i) {
         char c = content[i], n = 0;
         if(i < len) n = content[i + 1];
         if(c == '\0') break;
 
-        if(c == ' ' || c == '\n') continue; // end current token
+        if(c == '\n') {
+            line++;
+            line_start = i + 1;
+            continue;
+        }
+        if(c == ' ') continue; // end current token
+
+        curr->line = line;
+        curr->column = i - line_start + 1;
 
         // look for structural elements
 
@@ -80,6 +101,18 @@ token_t* lex(const char* content, size_t len) {
             continue;
         }
 
+        if(c == ':') {
+            curr->type = TOKEN_COLON;
+            CREATE_NEXT(curr);
+            continue;
+        }
+
+        if(c == ',') {
+            curr->type = TOKEN_COMMA;
+            CREATE_NEXT(curr);
+            continue;
+        }
+
         if(c == '=' && n == '=') {
             curr->type = TOKEN_OPERATOR;
             curr->operator_type = OPERATOR_EQUALS;
@@ -179,15 +212,26 @@ token_t* lex(const char* content, size_t len) {
             curr->type = TOKEN_BUILTIN_TYPE;
             curr->builtin_type = BUILTIN_INT;
             CREATE_NEXT(curr);
-            i += 3;
+            // the blank after it is skipped like any other, counting a line break
+            i += 2;
             continue;
         }
 
-        if(strncmp("return", remaining, 6) == 0 && (isblank(remaining[6]) || remaining[6] == '\n')) {
+        keyword_type keyword = KEYWORD_INVALID;
+        size_t keyword_len = 0;
+        for(size_t k = KEYWORD_INVALID + 1; k < KEYWORD_TYPE_COUNT; ++k) {
+            keyword_len = match_keyword(remaining, keyword_type_names[k]);
+            if(keyword_len) {
+                keyword = (keyword_type)k;
+                break;
+            }
+        }
+
+        if(keyword != KEYWORD_INVALID) {
             curr->type = TOKEN_KEYWORD;
-            curr->keyword_type = KEYWORD_RETURN;
+            curr->keyword_type = keyword;
             CREATE_NEXT(curr);
-            i += 6;
+            i += keyword_len - 1;
             continue;
         }
 
@@ -212,11 +256,11 @@ token_t* lex(const char* content, size_t len) {
             continue;
         }
 
-        if(isalpha(c)) {
+        if(isalpha(c) || c == '_') {
             // create non nested loop for this
             size_t j = i;
             for(; j < len; ++j) {
-                if(!isalnum(content[j])) {
+                if(!isalnum(content[j]) && content[j] != '_') {
                     break;
                 }
             }
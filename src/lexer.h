@@ -15,6 +15,8 @@
     __item(OPEN_PAREN, _uargs) \
     __item(CLOSE_PAREN, _uargs) \
     __item(SEMICOLON, _uargs) \
+    __item(COLON, _uargs) \
+    __item(COMMA, _uargs) \
     __item(BUILTIN_TYPE, _uargs) \
     __item(OPERATOR, _uargs) \
     __item(KEYWORD, _uargs) \
@@ -41,6 +43,9 @@ struct token_s {
         };
         unsigned int literal_value;
     };
+    // where the token starts, lines and columns count from 1
+    size_t line;
+    size_t column;
     struct token_s* next;
     struct token_s* prev;
 };
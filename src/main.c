@@ -11,31 +11,32 @@
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
 
 #include "asm_gen.h"
+#include "program.h"
+#include "optimize.h"
+#include "profile.h"
+#include "encode.h"
+#include "object.h"
+#include "jit.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "tune.h"
+#include "stack_usage.h"
 
 #include <assert.h>
 
 static int verbose;
 
-int main(int argc, char** argv) {
-    if(argc < 2) {
-        printf("Usage: %s [file]\n", argv[0]);
-        exit(-1);
-    }
-
-    verbose = 0;
-    if(argc >= 3) {
-        if(strcmp(argv[2], "-vv") == 0)
-            verbose = 2;
-        else if(strcmp(argv[2], "-v") == 0)
-            verbose = 1;
-    }
-
+static node_root_t* parse_file(const char* path) {
     FILE* fp;
-    fp = fopen(argv[1], "r");
+    fp = fopen(path, "r");
     if(!fp || errno != 0) {
-        printf("Failed to open file at %s\n", argv[1]);
+        printf("Failed to open file at %s\n", path);
         exit(-1);
     }
 
@@ -62,11 +63,11 @@ fail:
     token_t* tokens = lex(data, len);
     free(data);
 
-    if(!tokens) { 
-        printf("Failed to tokenize file\n"); 
+    if(!tokens) {
+        printf("Failed to tokenize file %s\n", path);
         exit(-1);
     }
-    if(verbose) { 
+    if(verbose) {
         debug_print_list(tokens);
         printf("\n\n");
     }
@@ -74,42 +75,403 @@ fail:
     node_root_t* root = parse(tokens);
     free_token_list(tokens);
     if(!root) {
-        printf("Failed to parse file\n");
+        printf("Failed to parse file %s\n", path);
         exit(-1);
     }
+    for(node_t* func = root->functions; func; func = func->next) ((node_func_t*)func)->file = path;
 
-    if(verbose) {debug_print_node_tree(root);}
+    return root;
+}
 
-    argv[1][strlen(argv[1]) - 2] = '\0';
+typedef enum output_kind_e {
+    OUTPUT_ASSEMBLY,
+    OUTPUT_OBJECT,
+    OUTPUT_EXECUTABLE
+} output_kind;
 
-    size_t outfile_len = strlen(argv[1]) + 2;
-    char* outassembly = (char*)malloc(outfile_len + 1);
-    strncpy(outassembly, argv[1], outfile_len);
-    strncat(outassembly, ".s", outfile_len);
+static const char* output_names[] = { "assembly", "object code", "executable" };
 
-    fp = fopen(outassembly, "w+");
-    if(!fp || errno) {
-        printf("Failed to write assembly intermediate");
-        exit(-1);
+// the whole file is formatted or encoded in memory and written at once
+static bool write_output(mir_t* mir, int fd, output_kind kind, mir_syntax syntax) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    buf_t buf;
+    buf_init(&buf);
+    bool success = true;
+    if(kind == OUTPUT_ASSEMBLY) {
+        mir_print(mir, &buf, syntax);
+    } else {
+        enc_object_t obj;
+        success = enc_assemble(mir, &obj);
+        if(!success) printf("Failed to encode machine code\n");
+        else if(kind == OUTPUT_OBJECT) obj_write_relocatable(&obj, &buf);
+        else success = obj_write_executable(&obj, &buf, mir_symbol("_start"));
+        free_enc_object(&obj);
+    }
+    size_t bytes = buf.len;
+    if(success && !buf_flush(&buf, fd)) {
+        printf("Failed to write %s\n", output_names[kind]);
+        success = false;
     }
+    free_buf(&buf);
+    clock_gettime(CLOCK_MONOTONIC, &end);
 
-    bool success = generate_asm(fp, root);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if(success && verbose && seconds > 0)
+        printf("Wrote %lu bytes of %s in %.3f ms, %.1f MB/s\n", bytes, output_names[kind], seconds * 1e3, bytes / seconds / 1e6);
+    return success;
+}
 
-    fclose(fp);
+typedef struct func_size_s {
+    const char* name;
+    size_t bytes;
+} func_size_t;
+
+static int compare_func_sizes(const void* a, const void* b) {
+    const func_size_t* left = (const func_size_t*)a;
+    const func_size_t* right = (const func_size_t*)b;
+    if(left->bytes != right->bytes) return left->bytes < right->bytes ? 1 : -1;
+    return strcmp(left->name, right->name);
+}
+
+// the bytes of code each function encodes to, largest first
+static bool print_sizes(mir_t* mir) {
+    enc_object_t obj;
+    if(!enc_assemble(mir, &obj)) {
+        printf("Failed to encode machine code\n");
+        free_enc_object(&obj);
+        return false;
+    }
+    func_size_t* sizes = (func_size_t*)malloc((obj.func_count + 1) * sizeof(func_size_t));
+    size_t total = 0;
+    for(size_t i = 0; i < obj.func_count; ++i) {
+        sizes[i].name = mir->funcs[i].name;
+        sizes[i].bytes = obj.func_sizes[i];
+        total += obj.func_sizes[i];
+    }
+    qsort(sizes, obj.func_count, sizeof(func_size_t), compare_func_sizes);
+    for(size_t i = 0; i < obj.func_count; ++i)
+        printf("%8lu  %s\n", sizes[i].bytes, sizes[i].name);
+    printf("%8lu  total\n", total);
+    free(sizes);
+    free_enc_object(&obj);
+    return true;
+}
 
-    free_root_node(root);
+// lower the program to bytecode and call its main in the interpreter, a trap
+// ends the compiler with the signal the native program would have died of
+static bool interpret(program_t* program, int* status) {
+    bc_program_t bytecode;
+    bool success = bc_compile(&bytecode, program);
+    bc_func_t* entry = success ? bc_find_func(&bytecode, "main") : NULL;
+    if(success && !entry) {
+        printf("Undefined reference to main\n");
+        success = false;
+    }
+    if(success && verbose > 1) {
+        buf_t buf;
+        buf_init(&buf);
+        bc_print(&bytecode, &buf);
+        fflush(stdout);
+        buf_flush(&buf, STDOUT_FILENO);
+        free_buf(&buf);
+    }
 
+    vm_result result = VM_RETURNED;
     if(success) {
+        int args[] = { 1 };
+        result = vm_run(&bytecode, entry, args, 1, status);
+    }
+    free_bc_program(&bytecode);
+
+    fflush(stdout);
+    if(result == VM_DIVIDE_ERROR) raise(SIGFPE);
+    else if(result == VM_STACK_OVERFLOW) raise(SIGSEGV);
+    return success;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2) {
+        printf("Usage: %s [-v|-vv] [-O0|-Os] [-g] [-m32|-m64] [-mtune=%s] [-fbranchless|-fno-branchless] [-masm=att|-masm=intel] [-fprofile-generate[=file]|-fprofile-use[=file]] [-finstrument=calls|cycles] [-fstack-usage] [-S|-c|-static|--run|--interp] [-o output] file...\n", argv[0], tune_names());
+        exit(-1);
+    }
+
+    verbose = 0;
+    bool optimize = true;
+    bool optimize_size = false;
+    ga_target target = GA_TARGET_X86_64;
+    const tune_table_t* tune = tune_lookup(TUNE_DEFAULT);
+    const char* output = NULL;
+    bool profile_generate = false, profile_use = false;
+    const char* profile_path = NULL;
+    ga_branchless branchless = GA_BRANCHLESS_AUTO;
+    mir_syntax syntax = MIR_SYNTAX_ATT;
+    bool compile_only = false;
+    bool assembly_only = false;
+    bool static_executable = false;
+    bool run = false;
+    bool interp = false;
+    bool debug_info = false;
+    ga_instrument instrument = GA_INSTRUMENT_NONE;
+    bool stack_usage = false;
+    const char** inputs = (const char**)malloc(argc * sizeof(char*));
+    size_t input_count = 0;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "-vv") == 0)
+            verbose = 2;
+        else if(strcmp(argv[i], "-v") == 0)
+            verbose = 1;
+        else if(strcmp(argv[i], "-O0") == 0)
+            optimize = false;
+        else if(strcmp(argv[i], "-Os") == 0)
+            optimize = optimize_size = true;
+        else if(strcmp(argv[i], "-g") == 0)
+            debug_info = true;
+        else if(strcmp(argv[i], "-m32") == 0)
+            target = GA_TARGET_I386;
+        else if(strcmp(argv[i], "-m64") == 0)
+            target = GA_TARGET_X86_64;
+        else if(strncmp(argv[i], "-mtune=", 7) == 0) {
+            tune = tune_lookup(&argv[i][7]);
+            if(!tune) {
+                printf("Unknown -mtune %s, expected one of %s\n", &argv[i][7], tune_names());
+                exit(-1);
+            }
+        }
+        else if(strcmp(argv[i], "-fbranchless") == 0)
+            branchless = GA_BRANCHLESS_ALWAYS;
+        else if(strcmp(argv[i], "-fno-branchless") == 0)
+            branchless = GA_BRANCHLESS_NEVER;
+        else if(strcmp(argv[i], "-S") == 0)
+            assembly_only = true;
+        else if(strcmp(argv[i], "-c") == 0)
+            compile_only = true;
+        else if(strcmp(argv[i], "-static") == 0)
+            static_executable = true;
+        else if(strcmp(argv[i], "--run") == 0)
+            run = true;
+        else if(strcmp(argv[i], "--interp") == 0)
+            interp = true;
+        else if(strcmp(argv[i], "-masm=att") == 0)
+            syntax = MIR_SYNTAX_ATT;
+        else if(strcmp(argv[i], "-masm=intel") == 0)
+            syntax = MIR_SYNTAX_INTEL;
+        else if(strcmp(argv[i], "-fprofile-generate") == 0 || strncmp(argv[i], "-fprofile-generate=", 19) == 0) {
+            profile_generate = true;
+            if(argv[i][18]) profile_path = &argv[i][19];
+        } else if(strcmp(argv[i], "-fprofile-use") == 0 || strncmp(argv[i], "-fprofile-use=", 14) == 0) {
+            profile_use = true;
+            if(argv[i][13]) profile_path = &argv[i][14];
+        } else if(strcmp(argv[i], "-finstrument=calls") == 0)
+            instrument = GA_INSTRUMENT_CALLS;
+        else if(strcmp(argv[i], "-finstrument=cycles") == 0)
+            instrument = GA_INSTRUMENT_CYCLES;
+        else if(strcmp(argv[i], "-fstack-usage") == 0)
+            stack_usage = true;
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else
+            inputs[input_count++] = argv[i];
+    }
+
+    if(!input_count) {
+        printf("No input files\n");
+        exit(-1);
+    }
+    if(profile_generate && profile_use) {
+        printf("Cannot generate and use a profile at once\n");
+        exit(-1);
+    }
+    if(profile_generate && interp) {
+        printf("Cannot generate a profile while interpreting\n");
+        exit(-1);
+    }
+    if(instrument != GA_INSTRUMENT_NONE && interp) {
+        printf("Cannot instrument while interpreting\n");
+        exit(-1);
+    }
+    if(stack_usage && interp) {
+        printf("Cannot report stack usage while interpreting\n");
+        exit(-1);
+    }
+
+    // every file is parsed on its own then merged into one program
+    node_root_t** roots = (node_root_t**)malloc(input_count * sizeof(node_root_t*));
+    for(size_t i = 0; i < input_count; ++i)
+        roots[i] = parse_file(inputs[i]);
+
+    program_t* program = program_merge(roots, input_count);
+    free(roots);
+    if(!program) {
+        printf("Failed to link program\n");
+        exit(-1);
+    }
+
+    // a single input names the binary after itself, without the .c, an object keeps the name without its .o
+    char* outbinary;
+    if(output) {
+        outbinary = strdup(output);
+        size_t len = strlen(outbinary);
+        if(compile_only && len > 2 && strcmp(&outbinary[len - 2], ".o") == 0) outbinary[len - 2] = '\0';
+        if(assembly_only && len > 2 && strcmp(&outbinary[len - 2], ".s") == 0) outbinary[len - 2] = '\0';
+    } else if(input_count == 1) {
+        outbinary = strdup(inputs[0]);
+        size_t len = strlen(outbinary);
+        if(len > 2 && strcmp(&outbinary[len - 2], ".c") == 0) outbinary[len - 2] = '\0';
+    } else {
+        outbinary = strdup(compile_only || assembly_only ? "a" : "a.out");
+    }
+    free(inputs);
+
+    // the profile defaults to living next to the binary
+    char* profile_file = NULL;
+    if(profile_path) {
+        profile_file = strdup(profile_path);
+    } else {
+        profile_file = (char*)malloc(strlen(outbinary) + 9);
+        sprintf(profile_file, "%s.profile", outbinary);
+    }
+    // and the report of an instrumented run too
+    char* instrument_file = (char*)malloc(strlen(outbinary) + 12);
+    sprintf(instrument_file, "%s.instrument", outbinary);
+    // and the stack usage, like gcc's .su files
+    char* stack_usage_file = (char*)malloc(strlen(outbinary) + 4);
+    sprintf(stack_usage_file, "%s.su", outbinary);
+
+    // probes are numbered before optimizing so both builds agree on them
+    profile_t* profile = NULL;
+    if(profile_generate || profile_use) profile = profile_number(program);
+    if(profile_use && !profile_load(profile, profile_file)) {
+        printf("Continuing without a profile\n");
+        free(profile->counters);
+        profile->counters = NULL;
+    }
+
+    if(optimize) {
+        opt_stats_t stats;
+        // an object, or the assembly of one, may be linked with others calling what it exports
+        optimize_program(program, profile_use ? profile : NULL, !profile_generate, optimize_size, !compile_only && !assembly_only, &stats);
+        if(verbose)
+            printf("Inlined %lu calls, propagated %lu constants, folded %lu expressions, removed %lu statements and %lu functions\n",
+                stats.inlined, stats.propagated, stats.folded, stats.removed_statements, stats.removed_functions);
+    }
+    if(profile_use) {
+        size_t reordered = profile_reorder(program, profile);
+        if(verbose) printf("Reordered %lu conditions by profile\n", reordered);
+    }
+
+    if(verbose) {debug_print_node_tree(program->root);}
+
+    // --interp needs neither the native backend nor any file
+    if(interp) {
+        int status = 0;
+        bool success = interpret(program, &status);
+        free_program(program);
+        if(profile) free_profile(profile);
+        free(profile_file);
+        free(instrument_file);
+        free(stack_usage_file);
+        free(outbinary);
+        exit(success ? status : -1);
+    }
+
+    // -c encodes an object and -static a whole executable itself, otherwise gcc assembles and links
+    // unless -S keeps just the assembly
+    output_kind kind = compile_only ? OUTPUT_OBJECT : static_executable ? OUTPUT_EXECUTABLE : OUTPUT_ASSEMBLY;
+    bool keep_assembly = assembly_only && kind == OUTPUT_ASSEMBLY;
+    size_t outfile_len = strlen(outbinary) + 2;
+    char* outfile;
+    if(kind == OUTPUT_EXECUTABLE || ((kind == OUTPUT_OBJECT || keep_assembly) && output)) {
+        outfile = strdup(kind == OUTPUT_EXECUTABLE ? outbinary : output);
+    } else {
+        outfile = (char*)malloc(outfile_len + 1);
+        strncpy(outfile, outbinary, outfile_len);
+        strncat(outfile, kind == OUTPUT_OBJECT ? ".o" : ".s", outfile_len);
+    }
+
+    // --run calls main in this process and leaves no file behind
+    int fd = run ? -1 : open(outfile, O_WRONLY | O_CREAT | O_TRUNC, kind == OUTPUT_EXECUTABLE ? 0755 : 0644);
+    if(!run && fd < 0) {
+        printf("Failed to write %s", kind == OUTPUT_ASSEMBLY ? "assembly intermediate" : output_names[kind]);
+        exit(-1);
+    }
+
+    ga_options_t options;
+    options.target = target;
+    options.profile = profile;
+    options.profile_generate = profile_generate;
+    options.profile_path = profile_file;
+    ph_stats_t peephole;
+    memset(&peephole, 0, sizeof(ph_stats_t));
+    options.peephole = optimize ? &peephole : NULL;
+    cfg_stats_t cfg;
+    memset(&cfg, 0, sizeof(cfg_stats_t));
+    options.cfg = optimize ? &cfg : NULL;
+    options.branchless = branchless;
+    options.start = !run && kind == OUTPUT_EXECUTABLE;
+    options.optimize_size = optimize_size;
+    options.tune = tune;
+    // only the assembler turns the directives into line tables and frame descriptions
+    options.debug_info = debug_info && !run && kind == OUTPUT_ASSEMBLY;
+    options.instrument = instrument;
+    options.instrument_path = instrument_file;
+    if(debug_info && !options.debug_info) printf("Debug information is only written through assembly, ignoring -g\n");
+    mir_t mir;
+    bool success = generate_mir(&mir, program->root, &options);
+    // -Os reports what each function came to
+    if(success && optimize_size) success = print_sizes(&mir);
+    if(success && stack_usage) success = su_report(&mir, stack_usage_file);
+    int status = 0;
+    if(success && run) {
+        char* run_argv[] = { outbinary, NULL };
+        success = jit_run(&mir, 1, run_argv, &status);
+    } else if(success) {
+        success = write_output(&mir, fd, kind, syntax);
+    }
+    if(fd >= 0) close(fd);
+
+    if(verbose && optimize) {
+        for(size_t i = 0; i < PH_RULE_COUNT; ++i)
+            printf("Peephole rule %s fired %lu times\n", ph_rule_names[i], peephole.fired[i]);
+        printf("Control flow: %lu jumps threaded, %lu decided by constants, %lu returns duplicated, %lu blocks moved, %lu labels removed\n",
+            cfg.threaded, cfg.constants, cfg.duplicated, cfg.moved, cfg.labels_removed);
+    }
+    if(verbose && success) {
+        for(size_t i = 0; i < mir.func_count; ++i)
+            printf("Function %s: %lu instructions in %lu blocks\n", mir.funcs[i].name,
+                mir_insn_count(&mir, &mir.funcs[i]), mir.funcs[i].block_count);
+    }
+
+    // the instructions point into the program and the profile and report paths
+    free_mir(&mir);
+    free_program(program);
+    if(profile) free_profile(profile);
+    free(profile_file);
+    free(instrument_file);
+    free(stack_usage_file);
+
+    // nothing half written is left behind to be run or linked
+    if(!success && !run && (kind != OUTPUT_ASSEMBLY || keep_assembly)) remove(outfile);
+
+    if(success && !run && kind == OUTPUT_ASSEMBLY && !keep_assembly) {
         size_t cmd_len = 14 + outfile_len + outfile_len - 3 + 200;
         char* cmd_buf = (char*)malloc(cmd_len + 1);
-        snprintf(cmd_buf, cmd_len, "gcc -m32 %s -o %s", outassembly, argv[1]);
+        // 32 bit profile counters and instrumentation records are addressed absolutely
+        bool absolute = profile_generate || instrument != GA_INSTRUMENT_NONE;
+        if(target == GA_TARGET_I386)
+            snprintf(cmd_buf, cmd_len, "gcc -m32%s %s -o %s", absolute ? " -no-pie" : "", outfile, outbinary);
+        else
+            snprintf(cmd_buf, cmd_len, "gcc %s -o %s", outfile, outbinary);
 
-        system(cmd_buf);
+        if(system(cmd_buf) != 0) success = false;
         free(cmd_buf);
 
-        remove(outassembly);
+        remove(outfile);
     }
 
-    free(outassembly);
-    exit(0);
+    free(outfile);
+    free(outbinary);
+    // make and scripts see a failed build the same way a failed run is seen
+    if(!success) exit(-1);
+    exit(run ? status : 0);
 }
@@ -0,0 +1,775 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "mir.h"
+#include "dwarf.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+const char* mir_opcode_names[MIR_OPCODE_COUNT] = {
+    MIR_OPCODE_LIST(STIRNG_LIST_ITEM, )
+};
+
+typedef struct mir_opcode_info_s {
+    const char* att;
+    const char* intel;
+    // AT&T appends the size of the last operand
+    bool sized;
+} mir_opcode_info_t;
+
+static const mir_opcode_info_t mir_opcodes[MIR_OPCODE_COUNT] = {
+    [MIR_NOP] = { "nop", "nop", false },
+    [MIR_MOV] = { "mov", "mov", true },
+    [MIR_MOVZB] = { "movzb", "movzx", true },
+    [MIR_MOVSL] = { "movsl", "movsxd", true },
+    [MIR_LEA] = { "lea", "lea", true },
+    [MIR_ADD] = { "add", "add", true },
+    [MIR_ADC] = { "adc", "adc", true },
+    [MIR_SBB] = { "sbb", "sbb", true },
+    [MIR_SUB] = { "sub", "sub", true },
+    [MIR_AND] = { "and", "and", true },
+    [MIR_OR] = { "or", "or", true },
+    [MIR_XOR] = { "xor", "xor", true },
+    [MIR_CMP] = { "cmp", "cmp", true },
+    [MIR_TEST] = { "test", "test", true },
+    [MIR_NEG] = { "neg", "neg", true },
+    [MIR_NOT] = { "not", "not", true },
+    [MIR_INC] = { "inc", "inc", true },
+    [MIR_DEC] = { "dec", "dec", true },
+    [MIR_IMUL] = { "imul", "imul", true },
+    [MIR_IDIV] = { "idiv", "idiv", true },
+    [MIR_DIV] = { "div", "div", true },
+    [MIR_SHL] = { "shl", "shl", true },
+    [MIR_SHR] = { "shr", "shr", true },
+    [MIR_SAR] = { "sar", "sar", true },
+    [MIR_BT] = { "bt", "bt", true },
+    [MIR_XCHG] = { "xchg", "xchg", true },
+    [MIR_CDQ] = { "cdq", "cdq", false },
+    [MIR_PUSH] = { "push", "push", true },
+    [MIR_POP] = { "pop", "pop", true },
+    [MIR_PUSHA] = { "pushal", "pushad", false },
+    [MIR_POPA] = { "popal", "popad", false },
+    [MIR_CALL] = { "call", "call", false },
+    [MIR_RET] = { "ret", "ret", false },
+    [MIR_LEAVE] = { "leave", "leave", false },
+    [MIR_JMP] = { "jmp", "jmp", false },
+    [MIR_JCC] = { "j", "j", false },
+    [MIR_SETCC] = { "set", "set", false },
+    [MIR_INT] = { "int", "int", false },
+    [MIR_SYSCALL] = { "syscall", "syscall", false },
+    [MIR_CLD] = { "cld", "cld", false },
+    [MIR_RDTSC] = { "rdtsc", "rdtsc", false },
+    [MIR_REPE_CMPSB] = { "repe cmpsb", "repe cmpsb", false },
+    [MIR_LABEL] = { NULL, NULL, false },
+    [MIR_SECTION] = { NULL, NULL, false },
+    [MIR_GLOBL] = { NULL, NULL, false },
+    [MIR_ALIGN] = { NULL, NULL, false },
+    [MIR_BYTE] = { NULL, NULL, false },
+    [MIR_LONG] = { NULL, NULL, false },
+    [MIR_ASCII] = { NULL, NULL, false },
+    [MIR_ZERO] = { NULL, NULL, false }
+};
+
+static const char* mir_cc_names[MIR_CC_COUNT] = {
+    "e", "ne", "l", "ge", "le", "g", "b", "ae", "be", "a", "s", "ns"
+};
+
+static const char* mir_section_names[MIR_SECTION_COUNT] = {
+    ".text",
+    ".section .text.hot,\"ax\",@progbits",
+    ".section .text.unlikely,\"ax\",@progbits",
+    ".section .rodata",
+    ".bss",
+    ".section .note.GNU-stack,\"\",@progbits"
+};
+
+static const char* mir_reg_names64[MIR_REG_COUNT] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "rip", ""
+};
+static const char* mir_reg_names32[MIR_REG_COUNT] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d", "eip", ""
+};
+static const char* mir_reg_names8[MIR_REG_COUNT] = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b", "", ""
+};
+
+void mir_init(mir_t* mir, bool is_64) {
+    memset(mir, 0, sizeof(mir_t));
+    mir->is_64 = is_64;
+}
+
+void free_mir(mir_t* mir) {
+    for(size_t i = 0; i < mir->func_count; ++i) free(mir->funcs[i].blocks);
+    free(mir->funcs);
+    free(mir->insns);
+    free(mir->files);
+    memset(mir, 0, sizeof(mir_t));
+}
+
+// OPERANDS
+
+static mir_operand_t mir_operand(mir_operand_kind kind) {
+    mir_operand_t operand;
+    memset(&operand, 0, sizeof(mir_operand_t));
+    operand.kind = kind;
+    operand.reg = operand.index = MIR_NO_REG;
+    return operand;
+}
+
+mir_operand_t mir_reg(mir_register reg, uint8_t size) {
+    mir_operand_t operand = mir_operand(MIR_OPERAND_REG);
+    operand.reg = reg;
+    operand.size = size;
+    return operand;
+}
+
+mir_operand_t mir_imm(int64_t value) {
+    mir_operand_t operand = mir_operand(MIR_OPERAND_IMM);
+    operand.value = value;
+    return operand;
+}
+
+mir_operand_t mir_imm_label(mir_label_t label, mir_label_t minus) {
+    mir_operand_t operand = mir_operand(MIR_OPERAND_IMM);
+    operand.symbol = label;
+    operand.minus = minus;
+    return operand;
+}
+
+mir_operand_t mir_mem(mir_register base, int64_t disp, uint8_t size) {
+    return mir_mem_index(base, MIR_NO_REG, 1, disp, size);
+}
+
+mir_operand_t mir_mem_index(mir_register base, mir_register index, uint8_t scale, int64_t disp, uint8_t size) {
+    mir_operand_t operand = mir_operand(MIR_OPERAND_MEM);
+    operand.reg = base;
+    operand.index = index;
+    operand.scale = scale;
+    operand.value = disp;
+    operand.size = size;
+    return operand;
+}
+
+mir_operand_t mir_mem_label(mir_label_t label, mir_register base, int64_t disp, uint8_t size) {
+    mir_operand_t operand = mir_mem(base, disp, size);
+    operand.symbol = label;
+    return operand;
+}
+
+mir_operand_t mir_target(mir_label_t label) {
+    mir_operand_t operand = mir_operand(MIR_OPERAND_LABEL);
+    operand.symbol = label;
+    return operand;
+}
+
+mir_operand_t mir_string(const char* text) {
+    mir_operand_t operand = mir_operand(MIR_OPERAND_STRING);
+    operand.text = text;
+    return operand;
+}
+
+mir_label_t mir_label(const char* name, size_t number) {
+    mir_label_t label = { name, number };
+    return label;
+}
+
+mir_label_t mir_symbol(const char* name) {
+    return mir_label(name, MIR_UNNUMBERED);
+}
+
+bool mir_label_equal(mir_label_t a, mir_label_t b) {
+    if(!a.name || !b.name) return a.name == b.name;
+    return a.number == b.number && strcmp(a.name, b.name) == 0;
+}
+
+bool mir_operand_equal(mir_operand_t* a, mir_operand_t* b) {
+    if(a->kind != b->kind) return false;
+    switch(a->kind) {
+    case MIR_OPERAND_REG:
+        return a->reg == b->reg && a->size == b->size;
+    case MIR_OPERAND_IMM:
+    case MIR_OPERAND_MEM:
+    case MIR_OPERAND_LABEL:
+        return a->reg == b->reg && a->index == b->index && a->scale == b->scale && a->value == b->value &&
+            a->size == b->size && mir_label_equal(a->symbol, b->symbol) && mir_label_equal(a->minus, b->minus);
+    case MIR_OPERAND_STRING:
+        return a->text == b->text;
+    default:
+        return true;
+    }
+}
+
+bool mir_uses_reg(mir_operand_t* operand, mir_register reg) {
+    if(operand->kind == MIR_OPERAND_REG) return operand->reg == reg;
+    if(operand->kind == MIR_OPERAND_MEM) return operand->reg == reg || operand->index == reg;
+    return false;
+}
+
+// EMITTING
+
+static mir_insn_t* mir_append(mir_t* mir, mir_opcode opcode) {
+    if(mir->count == mir->capacity) {
+        mir->capacity = mir->capacity ? mir->capacity * 2 : 256;
+        mir->insns = (mir_insn_t*)realloc(mir->insns, mir->capacity * sizeof(mir_insn_t));
+    }
+    mir_insn_t* insn = &mir->insns[mir->count++];
+    memset(insn, 0, sizeof(mir_insn_t));
+    insn->opcode = opcode;
+    insn->line = mir->line;
+    insn->column = mir->column;
+    return insn;
+}
+
+mir_insn_t* mir_emit(mir_t* mir, mir_opcode opcode, size_t count, ...) {
+    assert(count <= MIR_MAX_OPERANDS);
+    mir_insn_t* insn = mir_append(mir, opcode);
+    va_list args;
+    va_start(args, count);
+    for(size_t i = 0; i < count; ++i) insn->operands[i] = va_arg(args, mir_operand_t);
+    va_end(args);
+    insn->operand_count = count;
+    return insn;
+}
+
+mir_insn_t* mir_emit_cc(mir_t* mir, mir_opcode opcode, mir_cc cc, mir_operand_t operand) {
+    mir_insn_t* insn = mir_emit(mir, opcode, 1, operand);
+    insn->cc = cc;
+    return insn;
+}
+
+void mir_emit_label(mir_t* mir, mir_label_t label) {
+    mir_emit(mir, MIR_LABEL, 1, mir_target(label));
+}
+
+void mir_emit_section(mir_t* mir, mir_section section) {
+    mir_append(mir, MIR_SECTION)->section = section;
+}
+
+// FUNCTIONS AND BLOCKS
+
+mir_func_t* mir_begin_func(mir_t* mir, const char* name) {
+    if(mir->func_count == mir->func_capacity) {
+        mir->func_capacity = mir->func_capacity ? mir->func_capacity * 2 : 16;
+        mir->funcs = (mir_func_t*)realloc(mir->funcs, mir->func_capacity * sizeof(mir_func_t));
+    }
+    mir_func_t* func = &mir->funcs[mir->func_count++];
+    memset(func, 0, sizeof(mir_func_t));
+    func->name = name;
+    func->first = func->end = mir->count;
+    return func;
+}
+
+void mir_end_func(mir_t* mir) {
+    assert(mir->func_count);
+    mir->funcs[mir->func_count - 1].end = mir->count;
+}
+
+size_t mir_add_file(mir_t* mir, const char* path) {
+    for(size_t i = 0; i < mir->file_count; ++i) {
+        if(strcmp(mir->files[i], path) == 0) return i + 1;
+    }
+    mir->files = (const char**)realloc(mir->files, (mir->file_count + 1) * sizeof(char*));
+    mir->files[mir->file_count++] = path;
+    return mir->file_count;
+}
+
+void mir_truncate(mir_t* mir, size_t count) {
+    assert(count <= mir->count);
+    mir->count = count;
+}
+
+void mir_compact(mir_t* mir) {
+    // kept[i] is the new position of instruction i
+    size_t* kept = (size_t*)malloc((mir->count + 1) * sizeof(size_t));
+    size_t count = 0;
+    for(size_t i = 0; i < mir->count; ++i) {
+        kept[i] = count;
+        if(mir->insns[i].opcode != MIR_NOP) mir->insns[count++] = mir->insns[i];
+    }
+    kept[mir->count] = count;
+    mir->count = count;
+
+    for(size_t i = 0; i < mir->func_count; ++i) {
+        mir_func_t* func = &mir->funcs[i];
+        func->first = kept[func->first];
+        func->end = kept[func->end];
+        free(func->blocks);
+        func->blocks = NULL;
+        func->block_count = 0;
+    }
+    free(kept);
+}
+
+static bool mir_ends_block(mir_opcode opcode) {
+    return opcode == MIR_JMP || opcode == MIR_JCC || opcode == MIR_RET;
+}
+
+static void mir_add_block(mir_func_t* func, size_t* capacity, size_t first, size_t end) {
+    if(func->block_count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        func->blocks = (mir_block_t*)realloc(func->blocks, *capacity * sizeof(mir_block_t));
+    }
+    func->blocks[func->block_count].first = first;
+    func->blocks[func->block_count].end = end;
+    func->block_count++;
+}
+
+// a label starts a block and a branch ends one, data in between belongs to none
+static void mir_split_func(mir_t* mir, mir_func_t* func) {
+    free(func->blocks);
+    func->blocks = NULL;
+    func->block_count = 0;
+    size_t capacity = 0;
+
+    bool open = false, has_insn = false;
+    size_t first = 0;
+    for(size_t i = func->first; i <= func->end; ++i) {
+        mir_opcode opcode = i < func->end ? mir->insns[i].opcode : MIR_SECTION;
+        if(opcode == MIR_NOP) continue;
+
+        // labels in a row share a block
+        if(open && (opcode == MIR_LABEL ? has_insn : !MIR_IS_INSN(opcode))) {
+            mir_add_block(func, &capacity, first, i);
+            open = false;
+        }
+        if(opcode != MIR_LABEL && !MIR_IS_INSN(opcode)) continue;
+
+        if(!open) {
+            open = true;
+            has_insn = false;
+            first = i;
+        }
+        if(MIR_IS_INSN(opcode)) has_insn = true;
+        if(mir_ends_block(opcode)) {
+            mir_add_block(func, &capacity, first, i + 1);
+            open = false;
+        }
+    }
+}
+
+void mir_split_blocks(mir_t* mir) {
+    for(size_t i = 0; i < mir->func_count; ++i) mir_split_func(mir, &mir->funcs[i]);
+}
+
+size_t mir_insn_count(mir_t* mir, mir_func_t* func) {
+    size_t count = 0;
+    for(size_t i = func->first; i < func->end; ++i) count += MIR_IS_INSN(mir->insns[i].opcode);
+    return count;
+}
+
+// PRINTING
+
+static const char* mir_reg_name(mir_register reg, uint8_t size) {
+    switch(size) {
+    case 1: return mir_reg_names8[reg];
+    case 8: return mir_reg_names64[reg];
+    default: return mir_reg_names32[reg];
+    }
+}
+
+static char mir_suffix(uint8_t size) {
+    switch(size) {
+    case 1: return 'b';
+    case 2: return 'w';
+    case 8: return 'q';
+    default: return 'l';
+    }
+}
+
+static const char* mir_ptr(uint8_t size) {
+    switch(size) {
+    case 1: return "BYTE PTR ";
+    case 2: return "WORD PTR ";
+    case 8: return "QWORD PTR ";
+    default: return "DWORD PTR ";
+    }
+}
+
+void mir_print_label(buf_t* buf, mir_label_t label) {
+    buf_puts(buf, label.name);
+    if(label.number != MIR_UNNUMBERED) buf_put_uint(buf, label.number, 2);
+}
+
+// a displacement added to what comes before it
+static void mir_print_offset(buf_t* buf, int64_t value) {
+    if(value >= 0) buf_putc(buf, '+');
+    buf_put_int(buf, value);
+}
+
+// symbol less minus plus value, or the value alone
+static void mir_print_expr(buf_t* buf, mir_operand_t* operand) {
+    if(!operand->symbol.name) {
+        buf_put_int(buf, operand->value);
+        return;
+    }
+    mir_print_label(buf, operand->symbol);
+    if(operand->minus.name) {
+        buf_putc(buf, '-');
+        mir_print_label(buf, operand->minus);
+    }
+    if(operand->value) mir_print_offset(buf, operand->value);
+}
+
+static void mir_print_string(buf_t* buf, const char* str) {
+    buf_putc(buf, '"');
+    for(; *str; ++str) {
+        unsigned char c = *str;
+        if(c == '"' || c == '\\') {
+            buf_putc(buf, '\\');
+            buf_putc(buf, c);
+        } else if(c < ' ' || c > '~') {
+            char* out = buf_reserve(buf, 4);
+            out[0] = '\\';
+            out[1] = '0' + (c >> 6);
+            out[2] = '0' + ((c >> 3) & 7);
+            out[3] = '0' + (c & 7);
+        } else {
+            buf_putc(buf, c);
+        }
+    }
+    buf_putc(buf, '"');
+}
+
+static const char* mir_address_reg(mir_t* mir, mir_register reg) {
+    return mir->is_64 ? mir_reg_names64[reg] : mir_reg_names32[reg];
+}
+
+static void mir_print_att_operand(mir_t* mir, buf_t* buf, mir_insn_t* insn, mir_operand_t* operand) {
+    switch(operand->kind) {
+    case MIR_OPERAND_REG:
+        if(insn->opcode == MIR_JMP || insn->opcode == MIR_CALL) buf_putc(buf, '*');
+        buf_putc(buf, '%');
+        buf_puts(buf, mir_reg_name(operand->reg, operand->size));
+        break;
+    case MIR_OPERAND_IMM:
+        buf_putc(buf, '$');
+        mir_print_expr(buf, operand);
+        break;
+    case MIR_OPERAND_MEM:
+        if(operand->symbol.name || operand->value || (operand->reg == MIR_NO_REG && operand->index == MIR_NO_REG))
+            mir_print_expr(buf, operand);
+        if(operand->reg == MIR_NO_REG && operand->index == MIR_NO_REG) break;
+        buf_putc(buf, '(');
+        if(operand->reg != MIR_NO_REG) {
+            buf_putc(buf, '%');
+            buf_puts(buf, mir_address_reg(mir, operand->reg));
+        }
+        if(operand->index != MIR_NO_REG) {
+            buf_puts(buf, ",%");
+            buf_puts(buf, mir_address_reg(mir, operand->index));
+            buf_putc(buf, ',');
+            buf_put_uint(buf, operand->scale, 0);
+        }
+        buf_putc(buf, ')');
+        break;
+    case MIR_OPERAND_LABEL:
+        mir_print_label(buf, operand->symbol);
+        break;
+    case MIR_OPERAND_STRING:
+        mir_print_string(buf, operand->text);
+        break;
+    default:
+        break;
+    }
+}
+
+static void mir_print_intel_operand(mir_t* mir, buf_t* buf, mir_insn_t* insn, mir_operand_t* operand) {
+    switch(operand->kind) {
+    case MIR_OPERAND_REG:
+        buf_puts(buf, mir_reg_name(operand->reg, operand->size));
+        break;
+    case MIR_OPERAND_IMM:
+        if(operand->symbol.name) buf_puts(buf, "OFFSET ");
+        mir_print_expr(buf, operand);
+        break;
+    case MIR_OPERAND_MEM: {
+        if(insn->opcode != MIR_LEA) buf_puts(buf, mir_ptr(operand->size));
+        buf_putc(buf, '[');
+        bool first = true;
+        if(operand->reg != MIR_NO_REG) {
+            buf_puts(buf, mir_address_reg(mir, operand->reg));
+            first = false;
+        }
+        if(operand->index != MIR_NO_REG) {
+            if(!first) buf_putc(buf, '+');
+            buf_puts(buf, mir_address_reg(mir, operand->index));
+            buf_putc(buf, '*');
+            buf_put_uint(buf, operand->scale, 0);
+            first = false;
+        }
+        if(operand->symbol.name) {
+            if(!first) buf_putc(buf, '+');
+            mir_print_expr(buf, operand);
+        } else if(first) {
+            buf_put_int(buf, operand->value);
+        } else if(operand->value) {
+            mir_print_offset(buf, operand->value);
+        }
+        buf_putc(buf, ']');
+        break;
+    }
+    case MIR_OPERAND_LABEL:
+        mir_print_label(buf, operand->symbol);
+        break;
+    case MIR_OPERAND_STRING:
+        mir_print_string(buf, operand->text);
+        break;
+    default:
+        break;
+    }
+}
+
+// words Intel syntax reads as operators or registers wherever they appear
+static const char* mir_intel_words[] = {
+    "offset", "ptr", "byte", "word", "dword", "fword", "qword", "tbyte", "oword", "xmmword", "ymmword", "zmmword",
+    "flat", "short", "near", "far", "and", "or", "not", "xor", "mod", "shl", "shr", "eq", "ne", "lt", "le", "gt", "ge",
+    "ax", "cx", "dx", "bx", "sp", "bp", "si", "di", "ah", "ch", "dh", "bh", "es", "cs", "ss", "ds", "fs", "gs", "st", NULL
+};
+// register families numbered after their name
+static const char* mir_intel_numbered[] = { "xmm", "ymm", "zmm", "mm", "cr", "dr", "tr", "st", "k", "bnd", NULL };
+
+static bool mir_intel_reserved(const char* name) {
+    for(size_t i = 0; mir_intel_words[i]; ++i) {
+        if(strcasecmp(name, mir_intel_words[i]) == 0) return true;
+    }
+    for(size_t i = 0; i < MIR_REG_COUNT; ++i) {
+        if(strcasecmp(name, mir_reg_names64[i]) == 0 || strcasecmp(name, mir_reg_names32[i]) == 0 ||
+            strcasecmp(name, mir_reg_names8[i]) == 0) return name[0] != '\0';
+    }
+    for(size_t i = 0; mir_intel_numbered[i]; ++i) {
+        size_t len = strlen(mir_intel_numbered[i]);
+        if(strncasecmp(name, mir_intel_numbered[i], len) == 0 && name[len] && strspn(&name[len], "0123456789") == strlen(&name[len]))
+            return true;
+    }
+    return false;
+}
+
+static void mir_print_insn(mir_t* mir, buf_t* buf, mir_insn_t* insn, mir_syntax syntax) {
+    const mir_opcode_info_t* info = &mir_opcodes[insn->opcode];
+    bool intel = syntax == MIR_SYNTAX_INTEL;
+    // a function named like a register or an operator can only be called in AT&T syntax
+    if(intel && insn->operand_count == 1 && insn->operands[0].kind == MIR_OPERAND_LABEL &&
+        insn->operands[0].symbol.number == MIR_UNNUMBERED && mir_intel_reserved(insn->operands[0].symbol.name)) {
+        buf_puts(buf, "\t.att_syntax prefix\n");
+        mir_print_insn(mir, buf, insn, MIR_SYNTAX_ATT);
+        buf_puts(buf, "\t.intel_syntax noprefix\n");
+        return;
+    }
+
+    buf_putc(buf, '\t');
+    size_t start = buf->len;
+    buf_puts(buf, intel ? info->intel : info->att);
+    if(insn->opcode == MIR_JCC || insn->opcode == MIR_SETCC)
+        buf_puts(buf, mir_cc_names[insn->cc]);
+    else if(!intel && info->sized && insn->operand_count)
+        buf_putc(buf, mir_suffix(insn->operands[insn->operand_count - 1].size));
+    if(!insn->operand_count) {
+        buf_putc(buf, '\n');
+        return;
+    }
+
+    buf_puts(buf, buf->len - start < 4 ? "\t\t" : "\t");
+    for(size_t i = 0; i < insn->operand_count; ++i) {
+        if(i) buf_puts(buf, ", ");
+        if(intel)
+            mir_print_intel_operand(mir, buf, insn, &insn->operands[insn->operand_count - 1 - i]);
+        else
+            mir_print_att_operand(mir, buf, insn, &insn->operands[i]);
+    }
+    buf_putc(buf, '\n');
+}
+
+// labels, sections and data print the same in either syntax
+static void mir_print_pseudo(mir_t* mir, buf_t* buf, mir_insn_t* insn) {
+    mir_operand_t* operand = &insn->operands[0];
+    switch(insn->opcode) {
+    case MIR_LABEL:
+        mir_print_label(buf, operand->symbol);
+        buf_puts(buf, ":\n");
+        break;
+    case MIR_SECTION:
+        buf_putc(buf, '\t');
+        buf_puts(buf, mir_section_names[insn->section]);
+        buf_putc(buf, '\n');
+        break;
+    case MIR_GLOBL:
+        buf_puts(buf, ".globl ");
+        mir_print_label(buf, operand->symbol);
+        buf_putc(buf, '\n');
+        break;
+    case MIR_ALIGN:
+        buf_puts(buf, "\t.align ");
+        buf_put_int(buf, operand->value);
+        buf_putc(buf, '\n');
+        break;
+    case MIR_BYTE:
+        buf_puts(buf, "\t.byte\t");
+        buf_put_int(buf, operand->value);
+        buf_putc(buf, '\n');
+        break;
+    case MIR_LONG:
+        buf_puts(buf, "\t.long\t");
+        mir_print_expr(buf, operand);
+        buf_putc(buf, '\n');
+        break;
+    case MIR_ASCII:
+        buf_puts(buf, "\t.ascii\t");
+        mir_print_string(buf, operand->text);
+        buf_putc(buf, '\n');
+        break;
+    case MIR_ZERO:
+        buf_puts(buf, "\t.zero\t");
+        buf_put_int(buf, operand->value);
+        buf_putc(buf, '\n');
+        break;
+    default:
+        break;
+    }
+}
+
+// what the line table and call frame information say so far
+typedef struct mir_debug_s {
+    mir_func_t* func;
+    dw_frame_t* frames;
+    // last real instruction of the function, its frame description ends there
+    size_t last;
+    bool started;
+    dw_frame_t cfa;
+    // register the last instruction saved, described once the frame address moved too
+    size_t saving;
+    size_t line;
+    size_t column;
+} mir_debug_t;
+
+static void mir_print_cfa_reg(mir_t* mir, buf_t* buf, mir_register reg, mir_syntax syntax) {
+    if(syntax == MIR_SYNTAX_ATT) buf_putc(buf, '%');
+    buf_puts(buf, mir_address_reg(mir, reg));
+}
+
+static void mir_begin_debug(mir_t* mir, mir_debug_t* debug, mir_func_t* func) {
+    debug->func = func;
+    debug->frames = (dw_frame_t*)malloc((func->end - func->first + 1) * sizeof(dw_frame_t));
+    dw_frames(mir, func, debug->frames);
+    debug->last = func->end;
+    for(size_t i = func->first; i < func->end; ++i) {
+        if(MIR_IS_INSN(mir->insns[i].opcode)) debug->last = i;
+    }
+    debug->started = false;
+    debug->saving = 0;
+    debug->line = debug->column = 0;
+}
+
+// where the register the previous instruction pushed is kept
+static void mir_print_saved(mir_t* mir, buf_t* buf, mir_debug_t* debug, mir_syntax syntax) {
+    if(!debug->saving) return;
+    buf_puts(buf, "\t.cfi_offset ");
+    mir_print_cfa_reg(mir, buf, mir->insns[debug->saving].operands[0].reg, syntax);
+    buf_puts(buf, ", ");
+    buf_put_int(buf, -debug->frames[debug->saving - debug->func->first].saved);
+    buf_putc(buf, '\n');
+    debug->saving = 0;
+}
+
+// the location and frame address of a function's instruction when they change
+static void mir_print_debug(mir_t* mir, buf_t* buf, mir_debug_t* debug, size_t i, mir_syntax syntax) {
+    mir_insn_t* insn = &mir->insns[i];
+    if(!debug->started) {
+        buf_puts(buf, "\t.cfi_startproc\n");
+        debug->cfa.reg = MIR_SP;
+        debug->cfa.offset = mir->is_64 ? 8 : 4;
+        debug->started = true;
+    }
+
+    if(debug->func->file && insn->line && (insn->line != debug->line || insn->column != debug->column)) {
+        buf_puts(buf, "\t.loc ");
+        buf_put_int(buf, debug->func->file);
+        buf_putc(buf, ' ');
+        buf_put_int(buf, insn->line);
+        buf_putc(buf, ' ');
+        buf_put_int(buf, insn->column);
+        buf_putc(buf, '\n');
+        debug->line = insn->line;
+        debug->column = insn->column;
+    }
+
+    dw_frame_t* frame = &debug->frames[i - debug->func->first];
+    if(frame->reg == MIR_NO_REG) {
+        mir_print_saved(mir, buf, debug, syntax);
+        return;
+    }
+    bool reg_changed = frame->reg != debug->cfa.reg, offset_changed = frame->offset != debug->cfa.offset;
+    if(reg_changed && offset_changed) {
+        buf_puts(buf, "\t.cfi_def_cfa ");
+        mir_print_cfa_reg(mir, buf, frame->reg, syntax);
+        buf_puts(buf, ", ");
+        buf_put_int(buf, frame->offset);
+        buf_putc(buf, '\n');
+    } else if(reg_changed) {
+        buf_puts(buf, "\t.cfi_def_cfa_register ");
+        mir_print_cfa_reg(mir, buf, frame->reg, syntax);
+        buf_putc(buf, '\n');
+    } else if(offset_changed) {
+        buf_puts(buf, "\t.cfi_def_cfa_offset ");
+        buf_put_int(buf, frame->offset);
+        buf_putc(buf, '\n');
+    }
+    debug->cfa = *frame;
+    mir_print_saved(mir, buf, debug, syntax);
+}
+
+// the function's frame description ends after its last instruction
+static void mir_print_debug_after(mir_t* mir, buf_t* buf, mir_debug_t* debug, size_t i, mir_syntax syntax) {
+    if(debug->frames[i - debug->func->first].saved) debug->saving = i;
+    if(i != debug->last) return;
+    mir_print_saved(mir, buf, debug, syntax);
+    buf_puts(buf, "\t.cfi_endproc\n");
+}
+
+void mir_print(mir_t* mir, buf_t* buf, mir_syntax syntax) {
+    if(syntax == MIR_SYNTAX_INTEL) buf_puts(buf, "\t.intel_syntax noprefix\n");
+    mir_debug_t debug;
+    memset(&debug, 0, sizeof(mir_debug_t));
+    size_t next_func = 0;
+    if(mir->debug_info) {
+        for(size_t i = 0; i < mir->file_count; ++i) {
+            buf_puts(buf, "\t.file ");
+            buf_put_int(buf, i + 1);
+            buf_putc(buf, ' ');
+            mir_print_string(buf, mir->files[i]);
+            buf_putc(buf, '\n');
+        }
+    }
+
+    for(size_t i = 0; i < mir->count; ++i) {
+        // functions are in the order of their instructions
+        while(mir->debug_info && !debug.func && next_func < mir->func_count && mir->funcs[next_func].first <= i) {
+            mir_func_t* func = &mir->funcs[next_func++];
+            if(i < func->end) mir_begin_debug(mir, &debug, func);
+        }
+
+        mir_insn_t* insn = &mir->insns[i];
+        if(insn->opcode != MIR_NOP) {
+            bool described = debug.func && MIR_IS_INSN(insn->opcode);
+            if(described) mir_print_debug(mir, buf, &debug, i, syntax);
+            if(MIR_IS_INSN(insn->opcode))
+                mir_print_insn(mir, buf, insn, syntax);
+            else
+                mir_print_pseudo(mir, buf, insn);
+            if(described) mir_print_debug_after(mir, buf, &debug, i, syntax);
+        }
+
+        if(debug.func && i + 1 == debug.func->end) {
+            free(debug.frames);
+            debug.func = NULL;
+        }
+    }
+}
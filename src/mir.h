@@ -0,0 +1,286 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef MIR_H
+#define MIR_H
+
+#include "fwd.h"
+#include "buffer.h"
+
+// Machine instructions as code generation produces them, kept in memory so
+// later passes can inspect and rewrite them. Nothing becomes text before the
+// whole program is printed in AT&T or Intel syntax. Pseudo instructions carry
+// the labels, sections and data between the real ones.
+
+#define MIR_OPCODE_LIST(__item, _uargs) \
+    __item(NOP, _uargs) \
+    __item(MOV, _uargs) \
+    __item(MOVZB, _uargs) \
+    __item(MOVSL, _uargs) \
+    __item(LEA, _uargs) \
+    __item(ADD, _uargs) \
+    __item(ADC, _uargs) \
+    __item(SBB, _uargs) \
+    __item(SUB, _uargs) \
+    __item(AND, _uargs) \
+    __item(OR, _uargs) \
+    __item(XOR, _uargs) \
+    __item(CMP, _uargs) \
+    __item(TEST, _uargs) \
+    __item(NEG, _uargs) \
+    __item(NOT, _uargs) \
+    __item(INC, _uargs) \
+    __item(DEC, _uargs) \
+    __item(IMUL, _uargs) \
+    __item(IDIV, _uargs) \
+    __item(DIV, _uargs) \
+    __item(SHL, _uargs) \
+    __item(SHR, _uargs) \
+    __item(SAR, _uargs) \
+    __item(BT, _uargs) \
+    __item(XCHG, _uargs) \
+    __item(CDQ, _uargs) \
+    __item(PUSH, _uargs) \
+    __item(POP, _uargs) \
+    __item(PUSHA, _uargs) \
+    __item(POPA, _uargs) \
+    __item(CALL, _uargs) \
+    __item(RET, _uargs) \
+    __item(LEAVE, _uargs) \
+    __item(JMP, _uargs) \
+    __item(JCC, _uargs) \
+    __item(SETCC, _uargs) \
+    __item(INT, _uargs) \
+    __item(SYSCALL, _uargs) \
+    __item(CLD, _uargs) \
+    __item(RDTSC, _uargs) \
+    __item(REPE_CMPSB, _uargs) \
+    __item(LABEL, _uargs) \
+    __item(SECTION, _uargs) \
+    __item(GLOBL, _uargs) \
+    __item(ALIGN, _uargs) \
+    __item(BYTE, _uargs) \
+    __item(LONG, _uargs) \
+    __item(ASCII, _uargs) \
+    __item(ZERO, _uargs)
+
+enum mir_opcode_e {
+    MIR_OPCODE_LIST(ENUM_LIST_ITEM, MIR_)
+    MIR_OPCODE_COUNT
+};
+typedef enum mir_opcode_e mir_opcode;
+
+extern const char* mir_opcode_names[MIR_OPCODE_COUNT];
+
+// real instructions, not NOP or the pseudo instructions from LABEL on
+#define MIR_IS_INSN(_opcode) ((_opcode) != MIR_NOP && (_opcode) < MIR_LABEL)
+
+// numbered like their encodings
+#define MIR_REG_LIST(__item, _uargs) \
+    __item(AX, _uargs) \
+    __item(CX, _uargs) \
+    __item(DX, _uargs) \
+    __item(BX, _uargs) \
+    __item(SP, _uargs) \
+    __item(BP, _uargs) \
+    __item(SI, _uargs) \
+    __item(DI, _uargs) \
+    __item(R8, _uargs) \
+    __item(R9, _uargs) \
+    __item(R10, _uargs) \
+    __item(R11, _uargs) \
+    __item(R12, _uargs) \
+    __item(R13, _uargs) \
+    __item(R14, _uargs) \
+    __item(R15, _uargs) \
+    __item(RIP, _uargs) \
+    __item(NO_REG, _uargs)
+
+enum mir_reg_e {
+    MIR_REG_LIST(ENUM_LIST_ITEM, MIR_)
+    MIR_REG_COUNT
+};
+typedef enum mir_reg_e mir_register;
+
+#define MIR_CC_LIST(__item, _uargs) \
+    __item(E, _uargs) \
+    __item(NE, _uargs) \
+    __item(L, _uargs) \
+    __item(GE, _uargs) \
+    __item(LE, _uargs) \
+    __item(G, _uargs) \
+    __item(B, _uargs) \
+    __item(AE, _uargs) \
+    __item(BE, _uargs) \
+    __item(A, _uargs) \
+    __item(S, _uargs) \
+    __item(NS, _uargs)
+
+// conditions come in pairs, each the inverse of the other
+enum mir_cc_e {
+    MIR_CC_LIST(ENUM_LIST_ITEM, MIR_CC_)
+    MIR_CC_COUNT
+};
+typedef enum mir_cc_e mir_cc;
+
+#define MIR_CC_INVERSE(_cc) ((mir_cc)((_cc) ^ 1))
+
+#define MIR_SECTION_LIST(__item, _uargs) \
+    __item(TEXT, _uargs) \
+    __item(TEXT_HOT, _uargs) \
+    __item(TEXT_UNLIKELY, _uargs) \
+    __item(RODATA, _uargs) \
+    __item(BSS, _uargs) \
+    __item(NOTE_GNU_STACK, _uargs)
+
+enum mir_section_e {
+    MIR_SECTION_LIST(ENUM_LIST_ITEM, MIR_SECTION_)
+    MIR_SECTION_COUNT
+};
+typedef enum mir_section_e mir_section;
+
+typedef enum mir_syntax_e {
+    MIR_SYNTAX_ATT,
+    MIR_SYNTAX_INTEL
+} mir_syntax;
+
+typedef enum mir_operand_kind_e {
+    MIR_OPERAND_NONE,
+    MIR_OPERAND_REG,
+    MIR_OPERAND_IMM,
+    MIR_OPERAND_MEM,
+    MIR_OPERAND_LABEL,
+    MIR_OPERAND_STRING
+} mir_operand_kind;
+
+// a local label prints as its name followed by its number, a symbol has no number
+#define MIR_UNNUMBERED ((size_t)-1)
+
+typedef struct mir_label_s {
+    // NULL when there is no label
+    const char* name;
+    size_t number;
+} mir_label_t;
+
+typedef struct mir_operand_s {
+    mir_operand_kind kind;
+    // bytes read or written, the width of a register or of a memory access
+    uint8_t size;
+    // REG register, MEM base and index, which are MIR_NO_REG when absent
+    mir_register reg;
+    mir_register index;
+    uint8_t scale;
+    // IMM value or MEM displacement, added to symbol less minus when they are set
+    int64_t value;
+    mir_label_t symbol;
+    mir_label_t minus;
+    // STRING text, not owned
+    const char* text;
+} mir_operand_t;
+
+#define MIR_MAX_OPERANDS 3
+
+// operands are in AT&T order, the destination last
+typedef struct mir_insn_s {
+    mir_opcode opcode;
+    // condition of JCC and SETCC
+    mir_cc cc;
+    // section SECTION switches to
+    mir_section section;
+    size_t operand_count;
+    mir_operand_t operands[MIR_MAX_OPERANDS];
+    // source line and column the instruction was generated for, 0 when unknown
+    size_t line;
+    size_t column;
+} mir_insn_t;
+
+// straight line instructions entered only at the first and left only after the last
+typedef struct mir_block_s {
+    size_t first;
+    size_t end;
+} mir_block_t;
+
+typedef struct mir_func_s {
+    const char* name;
+    // instructions [first, end) of the program belong to the function
+    size_t first;
+    size_t end;
+    mir_block_t* blocks;
+    size_t block_count;
+    // number of the source file in the program's table and where in it the
+    // function is defined, 0 when unknown
+    size_t file;
+    size_t line;
+    size_t column;
+} mir_func_t;
+
+typedef struct mir_s {
+    // address registers are 64 bit wide
+    bool is_64;
+    mir_insn_t* insns;
+    size_t count;
+    size_t capacity;
+
+    mir_func_t* funcs;
+    size_t func_count;
+    size_t func_capacity;
+
+    // print line tables for the source files, numbered from 1, and call frame
+    // information for every function
+    bool debug_info;
+    const char** files;
+    size_t file_count;
+    // source location instructions are emitted for
+    size_t line;
+    size_t column;
+} mir_t;
+
+void mir_init(mir_t* mir, bool is_64);
+void free_mir(mir_t* mir);
+
+mir_operand_t mir_reg(mir_register reg, uint8_t size);
+mir_operand_t mir_imm(int64_t value);
+// the address of a label, less another one when minus is given
+mir_operand_t mir_imm_label(mir_label_t label, mir_label_t minus);
+mir_operand_t mir_mem(mir_register base, int64_t disp, uint8_t size);
+mir_operand_t mir_mem_index(mir_register base, mir_register index, uint8_t scale, int64_t disp, uint8_t size);
+// memory at a label, relative to rip when base is MIR_RIP and absolute for MIR_NO_REG
+mir_operand_t mir_mem_label(mir_label_t label, mir_register base, int64_t disp, uint8_t size);
+mir_operand_t mir_target(mir_label_t label);
+mir_operand_t mir_string(const char* text);
+
+mir_label_t mir_label(const char* name, size_t number);
+mir_label_t mir_symbol(const char* name);
+bool mir_label_equal(mir_label_t a, mir_label_t b);
+bool mir_operand_equal(mir_operand_t* a, mir_operand_t* b);
+
+// append an instruction with count operands passed as mir_operand_t
+mir_insn_t* mir_emit(mir_t* mir, mir_opcode opcode, size_t count, ...);
+mir_insn_t* mir_emit_cc(mir_t* mir, mir_opcode opcode, mir_cc cc, mir_operand_t operand);
+void mir_emit_label(mir_t* mir, mir_label_t label);
+void mir_emit_section(mir_t* mir, mir_section section);
+
+// functions span the instructions emitted between their begin and end
+mir_func_t* mir_begin_func(mir_t* mir, const char* name);
+void mir_end_func(mir_t* mir);
+// number of a source file, added to the table the first time
+size_t mir_add_file(mir_t* mir, const char* path);
+// drop every instruction from count on
+void mir_truncate(mir_t* mir, size_t count);
+// remove NOPs, keeping the functions' ranges
+void mir_compact(mir_t* mir);
+void mir_split_blocks(mir_t* mir);
+// machine instructions of a function, leaving out the pseudo ones
+size_t mir_insn_count(mir_t* mir, mir_func_t* func);
+
+// whether the operand names reg, as itself or in an address
+bool mir_uses_reg(mir_operand_t* operand, mir_register reg);
+
+// append the name of a label
+void mir_print_label(buf_t* buf, mir_label_t label);
+// append the program as assembly text
+void mir_print(mir_t* mir, buf_t* buf, mir_syntax syntax);
+
+#endif
@@ -16,6 +16,8 @@ typedef enum factor_type_e {
     FACTOR_PAREN,
     FACTOR_UNARY_OP,
     FACTOR_CONST,
+    FACTOR_VARIABLE,
+    FACTOR_CALL,
     FACTOR_TYPE_COUNT
 } factor_type;
 
@@ -30,11 +32,18 @@ typedef struct AST_factor_s {
         };
         struct AST_expression_s* exp;
         unsigned int literal;
+        // VARIABLE and CALL, call arguments are chained through node.next
+        struct {
+            char* name;
+            struct AST_expression_s* args;
+            size_t arg_count;
+        };
     };
 } node_factor_t;
 
 node_factor_t* parse_factor(token_t** list);
 void free_factor(node_factor_t* factor);
+node_factor_t* clone_factor(node_factor_t* factor);
 void debug_print_node_factor(node_factor_t* factor);
 
 // MULT and DIFF
@@ -57,6 +66,7 @@ typedef struct AST_term_s {
 
 node_term_t* parse_term(token_t** list);
 void free_term(node_term_t* term);
+node_term_t* clone_term(node_term_t* term);
 void debug_print_node_term(node_term_t* term);
 
 // SUM and DIFF
@@ -77,6 +87,7 @@ typedef struct AST_exp_sum_s {
 
 node_exp_sum_t* parse_exp_sum(token_t** list);
 void free_exp_sum(node_exp_sum_t* exp);
+node_exp_sum_t* clone_exp_sum(node_exp_sum_t* exp);
 void debug_print_node_exp_sum(node_exp_sum_t* exp);
 
 // GREATER_THAN, LESS_THAN, etc
@@ -97,6 +108,7 @@ typedef struct AST_exp_relation_s {
 
 node_exp_relation_t* parse_exp_relation(token_t** list);
 void free_exp_relation(node_exp_relation_t* exp);
+node_exp_relation_t* clone_exp_relation(node_exp_relation_t* exp);
 void debug_print_node_exp_relation(node_exp_relation_t* exp);
 
 // EQUAL and NOT_EQUAL
@@ -109,6 +121,8 @@ typedef struct AST_exp_equals_subexpression_s {
 
 typedef struct AST_exp_equals_s {
     node_t node;
+    // profile probe when this is an operand of &&, 0 for none
+    size_t probe;
 
     struct AST_exp_relation_s* relation;
 
@@ -117,6 +131,7 @@ typedef struct AST_exp_equals_s {
 
 node_exp_equals_t* parse_exp_equals(token_t** list);
 void free_exp_equals(node_exp_equals_t* exp);
+node_exp_equals_t* clone_exp_equals(node_exp_equals_t* exp);
 void debug_print_node_exp_equals(node_exp_equals_t* exp);
 
 // AND
@@ -128,6 +143,8 @@ typedef struct AST_exp_and_subexpression_s {
 
 typedef struct AST_exp_and_s {
     node_t node;
+    // profile probe when this is an operand of ||, 0 for none
+    size_t probe;
 
     struct AST_exp_equals_s* equals;
 
@@ -136,6 +153,7 @@ typedef struct AST_exp_and_s {
 
 node_exp_and_t* parse_exp_and(token_t** list);
 void free_exp_and(node_exp_and_t* exp);
+node_exp_and_t* clone_exp_and(node_exp_and_t* exp);
 void debug_print_node_exp_and(node_exp_and_t* exp);
 
 // OR
@@ -155,17 +173,43 @@ typedef struct AST_expression_s {
 
 node_exp_t* parse_expression(token_t** list);
 void free_expression(node_exp_t* exp);
+node_exp_t* clone_expression(node_exp_t* exp);
 void debug_print_node_expression(node_exp_t* exp);
 
+typedef enum stat_type_e {
+    STAT_INVALID,
+    STAT_RETURN,
+    STAT_BLOCK,
+    STAT_SWITCH,
+    STAT_CASE,
+    STAT_DEFAULT,
+    STAT_BREAK,
+    STAT_TYPE_COUNT
+} stat_type;
+
 typedef struct AST_statement_s {
     node_t node;
-    
-    //token_t* return_keyword;
+    // profile probe counting dispatches to a CASE or DEFAULT, or to the end of a SWITCH
+    size_t probe;
+    // where the statement starts in its file
+    size_t line;
+    size_t column;
+
+    stat_type type;
+    // RETURN value and SWITCH control expression
     node_exp_t* exp;
-    //token_t* semicolon;
+    union {
+        // SWITCH body
+        struct AST_statement_s* stat;
+        // BLOCK contents, chained through node.next
+        struct AST_statement_s* stats;
+        // CASE label value
+        int case_value;
+    };
 } node_stat_t;
 
 node_stat_t* parse_statement(token_t** list);
+void free_statement(node_stat_t* stat);
 void debug_print_node_statement(node_stat_t* node);
 
 typedef struct AST_function_s {
@@ -175,19 +219,35 @@ typedef struct AST_function_s {
     builtin_type return_type;
     //token_t* function_name;
     char* function_name;
+    // profile probe counting calls
+    size_t probe;
+    // local to its file, or internalized once the whole program is known
+    bool is_static;
+    // file the function was read from and where its name is in it
+    const char* file;
+    size_t line;
+    size_t column;
 
     // Do we really need to store these or just check for them
     //token_t* open_paren;
-    // TODO: parameters
+    char** params;
+    size_t param_count;
     //token_t* close_paren;
 
-    //token_t* open_brace;
+    // BLOCK statement holding the function body, NULL for a declaration
     node_stat_t* stat;
-    //token_t* close_brace;
     
 } node_func_t;
 
 node_func_t* parse_function(token_t** list);
+void free_function(node_func_t* func);
 void debug_print_node_function(node_func_t* node);
 
+// Call visitor on every factor below a node, children before parents
+typedef void (*factor_visitor)(node_factor_t* factor, void* ctx);
+void visit_expression_factors(node_exp_t* exp, factor_visitor visitor, void* ctx);
+// only the factors evaluated whenever the expression is
+void visit_evaluated_factors(node_exp_t* exp, factor_visitor visitor, void* ctx);
+void visit_statement_factors(node_stat_t* stat, factor_visitor visitor, void* ctx);
+
 #endif
@@ -0,0 +1,391 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "object.h"
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// null, each section with its relocations, then the symbol and string tables
+#define OBJ_MAX_SECTIONS (1 + MIR_SECTION_COUNT * 2 + 3)
+
+// executables load at the usual addresses, a page apart for each segment
+#define OBJ_BASE_64 0x400000
+#define OBJ_BASE_32 0x08048000
+#define OBJ_PAGE 0x1000
+
+static const char* obj_section_names[MIR_SECTION_COUNT] = {
+    ".text", ".text.hot", ".text.unlikely", ".rodata", ".bss", ".note.GNU-stack"
+};
+
+static const uint32_t obj_reloc_types_64[] = { R_X86_64_32, R_X86_64_PC32, R_X86_64_PLT32 };
+static const uint32_t obj_reloc_types_32[] = { R_386_32, R_386_PC32, R_386_PC32 };
+
+typedef struct obj_data_s {
+    enc_object_t* obj;
+    buf_t* buf;
+    // kept as 64 bit headers and narrowed when written
+    Elf64_Shdr headers[OBJ_MAX_SECTIONS];
+    size_t header_count;
+    buf_t shstrtab;
+    buf_t strtab;
+    buf_t symtab;
+
+    // header and section symbol of every section, 0 when it is not in the file
+    size_t section_headers[MIR_SECTION_COUNT];
+    size_t section_symbols[MIR_SECTION_COUNT];
+    // ELF symbol of every encoded one
+    size_t* symbols;
+    // where an executable loads each section, all 0 in an object
+    uint64_t addresses[MIR_SECTION_COUNT];
+    bool executable;
+    // symbols before the first global
+    size_t locals;
+} obj_data_t;
+
+static uint32_t obj_string(buf_t* table, const char* prefix, const char* str) {
+    uint32_t offset = table->len;
+    buf_puts(table, prefix);
+    buf_puts(table, str);
+    buf_putc(table, '\0');
+    return offset;
+}
+
+static Elf64_Shdr* obj_header(obj_data_t* data, const char* prefix, const char* name, uint32_t type, uint64_t flags) {
+    Elf64_Shdr* header = &data->headers[data->header_count++];
+    memset(header, 0, sizeof(Elf64_Shdr));
+    header->sh_name = obj_string(&data->shstrtab, prefix, name);
+    header->sh_type = type;
+    header->sh_flags = flags;
+    header->sh_addralign = 1;
+    return header;
+}
+
+static void obj_align(buf_t* buf, size_t align) {
+    size_t pad = (align - buf->len % align) % align;
+    memset(buf_reserve(buf, pad), 0, pad);
+}
+
+// place the contents of a header in the file
+static void obj_contents(obj_data_t* data, Elf64_Shdr* header, const void* contents, size_t size) {
+    obj_align(data->buf, header->sh_addralign);
+    header->sh_offset = data->buf->len;
+    header->sh_size = size;
+    if(size && header->sh_type != SHT_NOBITS) buf_write(data->buf, contents, size);
+}
+
+static void obj_symbol(obj_data_t* data, uint32_t name, uint64_t value, uint8_t info, uint16_t section) {
+    if(data->obj->is_64) {
+        Elf64_Sym symbol = { name, info, STV_DEFAULT, section, value, 0 };
+        buf_write(&data->symtab, &symbol, sizeof(symbol));
+    } else {
+        Elf32_Sym symbol = { name, value, 0, info, STV_DEFAULT, section };
+        buf_write(&data->symtab, &symbol, sizeof(symbol));
+    }
+}
+
+static bool obj_is_local(enc_symbol_t* symbol) {
+    return !symbol->global && symbol->section != ENC_UNDEFINED;
+}
+
+// section symbols first, then the labels local to the object and last the globals
+static void obj_symbols(obj_data_t* data) {
+    enc_object_t* obj = data->obj;
+    buf_t name;
+    buf_init(&name);
+    obj_symbol(data, 0, 0, 0, SHN_UNDEF);
+    size_t count = 1;
+
+    // a section only gets a symbol when a relocation needs it in place of a local label
+    bool referenced[MIR_SECTION_COUNT] = { false };
+    for(size_t i = 0; i < MIR_SECTION_COUNT && !data->executable; i++) {
+        enc_section_t* section = &obj->sections[i];
+        for(size_t r = 0; r < section->reloc_count; r++) {
+            enc_symbol_t* symbol = &obj->symbols[section->relocs[r].symbol];
+            if(obj_is_local(symbol)) referenced[symbol->section] = true;
+        }
+    }
+    for(size_t i = 0; i < MIR_SECTION_COUNT; i++) {
+        if(!referenced[i]) continue;
+        data->section_symbols[i] = count++;
+        obj_symbol(data, 0, 0, ELF64_ST_INFO(STB_LOCAL, STT_SECTION), data->section_headers[i]);
+    }
+
+    for(size_t pass = 0; pass < 2; pass++) {
+        for(size_t i = 0; i < obj->symbol_count; i++) {
+            enc_symbol_t* symbol = &obj->symbols[i];
+            if(obj_is_local(symbol) != (pass == 0)) continue;
+            data->symbols[i] = count++;
+
+            name.len = 0;
+            mir_print_label(&name, symbol->label);
+            buf_putc(&name, '\0');
+            uint16_t section = symbol->section == ENC_UNDEFINED ? SHN_UNDEF : data->section_headers[symbol->section];
+            uint64_t value = symbol->value + (section ? data->addresses[symbol->section] : 0);
+            obj_symbol(data, obj_string(&data->strtab, "", name.data), value,
+                ELF64_ST_INFO(pass == 0 ? STB_LOCAL : STB_GLOBAL, STT_NOTYPE), section);
+        }
+        if(pass == 0) data->locals = count;
+    }
+
+    free_buf(&name);
+}
+
+// relocations against local labels become ones against their section
+static void obj_relocations(obj_data_t* data, mir_section id, buf_t* out) {
+    enc_object_t* obj = data->obj;
+    enc_section_t* section = &obj->sections[id];
+    for(size_t i = 0; i < section->reloc_count; i++) {
+        enc_reloc_t* reloc = &section->relocs[i];
+        enc_symbol_t* symbol = &obj->symbols[reloc->symbol];
+        size_t index = data->symbols[reloc->symbol];
+        int64_t addend = reloc->addend;
+        if(obj_is_local(symbol)) {
+            index = data->section_symbols[symbol->section];
+            addend += symbol->value;
+        }
+
+        if(obj->is_64) {
+            Elf64_Rela rela = { reloc->offset, ELF64_R_INFO(index, obj_reloc_types_64[reloc->kind]), addend };
+            buf_write(out, &rela, sizeof(rela));
+        } else {
+            // the field holds the addend and nothing else yet
+            uint8_t* field = (uint8_t*)&section->data.data[reloc->offset];
+            for(size_t b = 0; b < 4; b++) field[b] = (uint8_t)(addend >> (b * 8));
+            Elf32_Rel rel = { reloc->offset, ELF32_R_INFO(index, obj_reloc_types_32[reloc->kind]) };
+            buf_write(out, &rel, sizeof(rel));
+        }
+    }
+}
+
+static void obj_write_headers(obj_data_t* data) {
+    for(size_t i = 0; i < data->header_count; i++) {
+        Elf64_Shdr* header = &data->headers[i];
+        if(data->obj->is_64) {
+            buf_write(data->buf, header, sizeof(Elf64_Shdr));
+        } else {
+            Elf32_Shdr narrow = {
+                header->sh_name, header->sh_type, header->sh_flags, header->sh_addr, header->sh_offset,
+                header->sh_size, header->sh_link, header->sh_info, header->sh_addralign, header->sh_entsize
+            };
+            buf_write(data->buf, &narrow, sizeof(narrow));
+        }
+    }
+}
+
+static void obj_write_ident(unsigned char* ident, bool is_64) {
+    memcpy(ident, ELFMAG, SELFMAG);
+    ident[EI_CLASS] = is_64 ? ELFCLASS64 : ELFCLASS32;
+    ident[EI_DATA] = ELFDATA2LSB;
+    ident[EI_VERSION] = EV_CURRENT;
+    ident[EI_OSABI] = ELFOSABI_SYSV;
+}
+
+static uint64_t obj_section_flags(mir_section section) {
+    switch(section) {
+    case MIR_SECTION_TEXT:
+    case MIR_SECTION_TEXT_HOT:
+    case MIR_SECTION_TEXT_UNLIKELY:
+        return SHF_ALLOC | SHF_EXECINSTR;
+    case MIR_SECTION_BSS:
+        return SHF_ALLOC | SHF_WRITE;
+    case MIR_SECTION_NOTE_GNU_STACK:
+        return 0;
+    default:
+        return SHF_ALLOC;
+    }
+}
+
+// the ELF header and room for phnum program headers, filled in by obj_end
+static void obj_begin(obj_data_t* data, enc_object_t* obj, buf_t* buf, size_t phnum) {
+    memset(data, 0, sizeof(obj_data_t));
+    data->obj = obj;
+    data->buf = buf;
+    data->symbols = (size_t*)calloc(obj->symbol_count + 1, sizeof(size_t));
+    buf_putc(&data->shstrtab, '\0');
+    buf_putc(&data->strtab, '\0');
+    data->header_count = 1;
+
+    size_t size = obj->is_64 ? sizeof(Elf64_Ehdr) + phnum * sizeof(Elf64_Phdr) : sizeof(Elf32_Ehdr) + phnum * sizeof(Elf32_Phdr);
+    memset(buf_reserve(buf, size), 0, size);
+}
+
+static size_t obj_section_header(obj_data_t* data, mir_section section) {
+    enc_section_t* contents = &data->obj->sections[section];
+    data->section_headers[section] = data->header_count;
+    Elf64_Shdr* header = obj_header(data, "", obj_section_names[section],
+        section == MIR_SECTION_BSS ? SHT_NOBITS : SHT_PROGBITS, obj_section_flags(section));
+    header->sh_addralign = contents->align;
+    header->sh_addr = data->addresses[section];
+    return data->section_headers[section];
+}
+
+// the symbol and string tables, the section headers and the ELF header
+static void obj_end(obj_data_t* data, uint16_t type, uint64_t entry, size_t phnum) {
+    bool is_64 = data->obj->is_64;
+    size_t word = is_64 ? 8 : 4;
+    size_t symtab = data->header_count;
+    Elf64_Shdr* header = obj_header(data, "", ".symtab", SHT_SYMTAB, 0);
+    header->sh_link = symtab + 1;
+    header->sh_info = data->locals;
+    header->sh_addralign = word;
+    header->sh_entsize = is_64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+    obj_header(data, "", ".strtab", SHT_STRTAB, 0);
+    size_t shstrtab = data->header_count;
+    obj_header(data, "", ".shstrtab", SHT_STRTAB, 0);
+
+    obj_contents(data, &data->headers[symtab], data->symtab.data, data->symtab.len);
+    obj_contents(data, &data->headers[symtab + 1], data->strtab.data, data->strtab.len);
+    obj_contents(data, &data->headers[shstrtab], data->shstrtab.data, data->shstrtab.len);
+
+    obj_align(data->buf, word);
+    size_t header_offset = data->buf->len;
+    obj_write_headers(data);
+
+    if(is_64) {
+        Elf64_Ehdr* elf = (Elf64_Ehdr*)data->buf->data;
+        obj_write_ident(elf->e_ident, true);
+        elf->e_type = type;
+        elf->e_machine = EM_X86_64;
+        elf->e_version = EV_CURRENT;
+        elf->e_entry = entry;
+        elf->e_phoff = phnum ? sizeof(Elf64_Ehdr) : 0;
+        elf->e_shoff = header_offset;
+        elf->e_ehsize = sizeof(Elf64_Ehdr);
+        elf->e_phentsize = phnum ? sizeof(Elf64_Phdr) : 0;
+        elf->e_phnum = phnum;
+        elf->e_shentsize = sizeof(Elf64_Shdr);
+        elf->e_shnum = data->header_count;
+        elf->e_shstrndx = shstrtab;
+    } else {
+        Elf32_Ehdr* elf = (Elf32_Ehdr*)data->buf->data;
+        obj_write_ident(elf->e_ident, false);
+        elf->e_type = type;
+        elf->e_machine = EM_386;
+        elf->e_version = EV_CURRENT;
+        elf->e_entry = entry;
+        elf->e_phoff = phnum ? sizeof(Elf32_Ehdr) : 0;
+        elf->e_shoff = header_offset;
+        elf->e_ehsize = sizeof(Elf32_Ehdr);
+        elf->e_phentsize = phnum ? sizeof(Elf32_Phdr) : 0;
+        elf->e_phnum = phnum;
+        elf->e_shentsize = sizeof(Elf32_Shdr);
+        elf->e_shnum = data->header_count;
+        elf->e_shstrndx = shstrtab;
+    }
+
+    free_buf(&data->shstrtab);
+    free_buf(&data->strtab);
+    free_buf(&data->symtab);
+    free(data->symbols);
+}
+
+void obj_write_relocatable(enc_object_t* obj, buf_t* buf) {
+    obj_data_t data;
+    obj_begin(&data, obj, buf, 0);
+    bool is_64 = obj->is_64;
+
+    // each section is followed by its relocations, like GNU as lays them out
+    size_t rel_headers[MIR_SECTION_COUNT] = { 0 };
+    for(size_t i = 0; i < MIR_SECTION_COUNT; i++) {
+        enc_section_t* section = &obj->sections[i];
+        if(!section->used) continue;
+        size_t index = obj_section_header(&data, i);
+        if(section->reloc_count) {
+            rel_headers[i] = data.header_count;
+            Elf64_Shdr* header = obj_header(&data, is_64 ? ".rela" : ".rel", obj_section_names[i], is_64 ? SHT_RELA : SHT_REL, SHF_INFO_LINK);
+            header->sh_info = index;
+            header->sh_addralign = is_64 ? 8 : 4;
+            header->sh_entsize = is_64 ? sizeof(Elf64_Rela) : sizeof(Elf32_Rel);
+        }
+    }
+    obj_symbols(&data);
+
+    for(size_t i = 0; i < MIR_SECTION_COUNT; i++) {
+        if(!data.section_headers[i]) continue;
+        // relocations go first, they store the 32 bit addends into the contents
+        buf_t rels;
+        buf_init(&rels);
+        if(rel_headers[i]) obj_relocations(&data, i, &rels);
+        enc_section_t* section = &obj->sections[i];
+        obj_contents(&data, &data.headers[data.section_headers[i]], section->data.data, section->size);
+        if(rel_headers[i]) {
+            Elf64_Shdr* header = &data.headers[rel_headers[i]];
+            // the symbol table comes right after the last section
+            header->sh_link = data.header_count;
+            obj_contents(&data, header, rels.data, rels.len);
+        }
+        free_buf(&rels);
+    }
+
+    obj_end(&data, ET_REL, 0, 0);
+}
+
+static void obj_program_header(obj_data_t* data, size_t index, uint32_t type, uint32_t flags, uint64_t offset,
+        uint64_t address, uint64_t file_size, uint64_t memory_size, uint64_t align) {
+    if(data->obj->is_64) {
+        Elf64_Phdr* header = (Elf64_Phdr*)&data->buf->data[sizeof(Elf64_Ehdr)] + index;
+        *header = (Elf64_Phdr){ type, flags, offset, address, address, file_size, memory_size, align };
+    } else {
+        Elf32_Phdr* header = (Elf32_Phdr*)&data->buf->data[sizeof(Elf32_Ehdr)] + index;
+        *header = (Elf32_Phdr){ type, offset, address, address, file_size, memory_size, flags, align };
+    }
+}
+
+// cold code first and hot code next to the rest, the order ld uses
+static const mir_section obj_load_order[] = {
+    MIR_SECTION_TEXT_UNLIKELY, MIR_SECTION_TEXT_HOT, MIR_SECTION_TEXT, MIR_SECTION_RODATA
+};
+
+bool obj_write_executable(enc_object_t* obj, buf_t* buf, mir_label_t entry) {
+    bool is_64 = obj->is_64;
+    uint64_t base = is_64 ? OBJ_BASE_64 : OBJ_BASE_32;
+    enc_section_t* bss = &obj->sections[MIR_SECTION_BSS];
+    // code and constants share one segment with the headers, bss gets pages of its own
+    size_t phnum = bss->size ? 3 : 2;
+    size_t offset = is_64 ? sizeof(Elf64_Ehdr) + phnum * sizeof(Elf64_Phdr) : sizeof(Elf32_Ehdr) + phnum * sizeof(Elf32_Phdr);
+
+    uint64_t addresses[MIR_SECTION_COUNT] = { 0 };
+    for(size_t i = 0; i < sizeof(obj_load_order) / sizeof(obj_load_order[0]); i++) {
+        enc_section_t* section = &obj->sections[obj_load_order[i]];
+        if(!section->used) continue;
+        offset = (offset + section->align - 1) / section->align * section->align;
+        addresses[obj_load_order[i]] = base + offset;
+        offset += section->size;
+    }
+    size_t text_size = offset;
+    addresses[MIR_SECTION_BSS] = (base + text_size + OBJ_PAGE - 1) / OBJ_PAGE * OBJ_PAGE;
+
+    size_t start = enc_find_symbol(obj, entry);
+    if(start == ENC_UNDEFINED || obj->symbols[start].section == ENC_UNDEFINED) {
+        printf("Undefined reference to %s\n", entry.name);
+        return false;
+    }
+    if(!enc_link(obj, addresses)) return false;
+
+    obj_data_t data;
+    obj_begin(&data, obj, buf, phnum);
+    data.executable = true;
+    memcpy(data.addresses, addresses, sizeof(addresses));
+    for(size_t i = 0; i < sizeof(obj_load_order) / sizeof(obj_load_order[0]); i++) {
+        enc_section_t* section = &obj->sections[obj_load_order[i]];
+        if(!section->used) continue;
+        size_t index = obj_section_header(&data, obj_load_order[i]);
+        obj_contents(&data, &data.headers[index], section->data.data, section->size);
+    }
+    if(bss->size) obj_contents(&data, &data.headers[obj_section_header(&data, MIR_SECTION_BSS)], NULL, bss->size);
+    obj_symbols(&data);
+
+    obj_program_header(&data, 0, PT_LOAD, PF_R | PF_X, 0, base, text_size, text_size, OBJ_PAGE);
+    if(bss->size) obj_program_header(&data, 1, PT_LOAD, PF_R | PF_W, 0, addresses[MIR_SECTION_BSS], 0, bss->size, OBJ_PAGE);
+    // the stack is never executable
+    obj_program_header(&data, phnum - 1, PT_GNU_STACK, PF_R | PF_W, 0, 0, 0, 0, 16);
+
+    enc_symbol_t* symbol = &obj->symbols[start];
+    obj_end(&data, ET_EXEC, addresses[symbol->section] + symbol->value, phnum);
+    return true;
+}
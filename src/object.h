@@ -0,0 +1,22 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include "fwd.h"
+#include "buffer.h"
+#include "encode.h"
+
+// ELF files from encoded machine code, 64 bit with RELA relocations for x86-64
+// and 32 bit with the addends stored in place for i386. Either starts at the
+// beginning of the buffer.
+
+// a relocatable object for the linker, laid out like GNU as would
+void obj_write_relocatable(enc_object_t* obj, buf_t* buf);
+// a static executable starting at entry, false when a symbol is left undefined
+bool obj_write_executable(enc_object_t* obj, buf_t* buf, mir_label_t entry);
+
+#endif
@@ -0,0 +1,862 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "optimize.h"
+
+#include "const_eval.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// rounds of inlining, propagation and folding before giving up on a fixed point
+#define OPT_MAX_ROUNDS 4
+// largest return expression copied into a caller, counted in factors
+#define OPT_INLINE_MAX_FACTORS 24
+// the same for callees the profile found hot
+#define OPT_INLINE_HOT_FACTORS 96
+// and when optimizing for size, about what the call itself takes
+#define OPT_INLINE_SIZE_FACTORS 3
+
+#define FOR_EACH_FUNCTION(_program, _func) \
+    for(node_func_t* _func = (node_func_t*)(_program)->root->functions; _func; _func = (node_func_t*)_func->node.next)
+
+void optimize_program(program_t* program, profile_t* profile, bool inline_calls, bool optimize_size, bool whole_program, opt_stats_t* stats) {
+    assert(program && stats);
+    memset(stats, 0, sizeof(opt_stats_t));
+
+    for(int round = 0; round < OPT_MAX_ROUNDS; ++round) {
+        size_t inlined = inline_calls ? opt_inline(program, profile, optimize_size, whole_program) : 0;
+        size_t propagated = opt_propagate(program, whole_program);
+        size_t folded = opt_fold(program);
+        size_t removed = opt_dead_code(program);
+
+        stats->inlined += inlined;
+        stats->propagated += propagated;
+        stats->folded += folded;
+        stats->removed_statements += removed;
+        if(!inlined && !propagated && !folded && !removed) break;
+    }
+
+    stats->removed_functions = opt_dead_functions(program, whole_program);
+}
+
+// a whole program with main is only entered through main, anything else may
+// also be called from outside through whatever is not static
+static bool opt_exported(program_t* program, node_func_t* func, bool whole_program) {
+    node_func_t* main_func = program_lookup(program, "main");
+    if(whole_program && main_func && main_func->stat) return func == main_func;
+    return !func->is_static || func == main_func;
+}
+
+// the factor an expression is made of when it has no operators
+static node_factor_t* opt_single_factor(node_exp_t* exp) {
+    if(exp->subexps || exp->and_exp->subexps) return NULL;
+    node_exp_equals_t* equals = exp->and_exp->equals;
+    if(equals->subexps || equals->relation->subexps) return NULL;
+    node_exp_sum_t* sum = equals->relation->sum;
+    if(sum->subexps || sum->term->subterms) return NULL;
+    return sum->term->factor;
+}
+
+static void opt_count_factor(node_factor_t* factor, void* ctx) {
+    (*(size_t*)ctx)++;
+}
+
+static void opt_free_args(node_factor_t* factor) {
+    node_exp_t* arg = factor->args;
+    while(arg) {
+        node_exp_t* next = (node_exp_t*)arg->node.next;
+        free_expression(arg);
+        arg = next;
+    }
+    free(factor->name);
+}
+
+// turn a factor into a constant, releasing whatever it held
+static void opt_const_factor(node_factor_t* factor, int value) {
+    if(factor->type == FACTOR_PAREN) free_expression(factor->exp);
+    else if(factor->type == FACTOR_UNARY_OP) free_factor(factor->factor);
+    else if(factor->type == FACTOR_VARIABLE || factor->type == FACTOR_CALL) opt_free_args(factor);
+
+    node_t node = factor->node;
+    memset(factor, 0, sizeof(node_factor_t));
+    factor->node = node;
+    factor->type = FACTOR_CONST;
+    factor->literal = (unsigned int)value;
+}
+
+// INLINING
+
+typedef struct opt_inline_s {
+    program_t* program;
+    profile_t* profile;
+    bool optimize_size;
+    bool whole_program;
+    node_func_t* caller;
+    size_t count;
+} opt_inline_t;
+
+typedef struct opt_subst_s {
+    node_func_t* callee;
+    node_exp_t** args;
+    size_t* uses;
+    // uses outside the operands && and || may skip
+    size_t* evaluated;
+    bool unresolved;
+} opt_subst_t;
+
+static int opt_param_index(node_func_t* func, const char* name) {
+    for(size_t i = 0; i < func->param_count; ++i) {
+        if(strcmp(func->params[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static void opt_count_uses(node_factor_t* factor, void* ctx) {
+    opt_subst_t* subst = (opt_subst_t*)ctx;
+    if(factor->type != FACTOR_VARIABLE) return;
+
+    int index = opt_param_index(subst->callee, factor->name);
+    if(index < 0) subst->unresolved = true;
+    else subst->uses[index]++;
+}
+
+static void opt_count_evaluated(node_factor_t* factor, void* ctx) {
+    opt_subst_t* subst = (opt_subst_t*)ctx;
+    if(factor->type != FACTOR_VARIABLE) return;
+
+    int index = opt_param_index(subst->callee, factor->name);
+    if(index >= 0) subst->evaluated[index]++;
+}
+
+static void opt_substitute(node_factor_t* factor, void* ctx) {
+    opt_subst_t* subst = (opt_subst_t*)ctx;
+    if(factor->type != FACTOR_VARIABLE) return;
+
+    int index = opt_param_index(subst->callee, factor->name);
+    assert(index >= 0);
+    free(factor->name);
+    factor->name = NULL;
+    factor->type = FACTOR_PAREN;
+    factor->exp = clone_expression(subst->args[index]);
+}
+
+// calls to name, or to anything when it is NULL
+typedef struct opt_find_call_s {
+    const char* name;
+    size_t count;
+} opt_find_call_t;
+
+static void opt_find_call(node_factor_t* factor, void* ctx) {
+    opt_find_call_t* find = (opt_find_call_t*)ctx;
+    if(factor->type == FACTOR_CALL && (!find->name || strcmp(factor->name, find->name) == 0)) find->count++;
+}
+
+// the returned expression of a function whose body is a single return
+static node_stat_t* opt_inline_body(node_func_t* func) {
+    if(!func || !func->stat) return NULL;
+    node_stat_t* body = func->stat->stats;
+    if(!body || body->node.next || body->type != STAT_RETURN) return NULL;
+    return body;
+}
+
+// optimizing for size, a callee too big for the budget is still inlined where
+// that folds it to a constant, or at its only call when it is removed after
+static bool opt_inline_shrinks(opt_inline_t* inl, node_func_t* callee, node_stat_t* body, node_factor_t* factor) {
+    bool removable = !opt_exported(inl->program, callee, inl->whole_program);
+    opt_find_call_t calls = { callee->function_name, 0 };
+    if(removable) {
+        FOR_EACH_FUNCTION(inl->program, func) visit_statement_factors(func->stat, opt_find_call, &calls);
+    }
+    if(calls.count == 1) return true;
+
+    for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next) {
+        node_factor_t* single = opt_single_factor(arg);
+        if(!single || single->type != FACTOR_CONST) return false;
+    }
+    opt_find_call_t nested = { NULL, 0 };
+    visit_expression_factors(body->exp, opt_find_call, &nested);
+    return !nested.count;
+}
+
+static void opt_inline_call(node_factor_t* factor, void* ctx) {
+    opt_inline_t* inl = (opt_inline_t*)ctx;
+    if(factor->type != FACTOR_CALL) return;
+
+    node_func_t* callee = program_lookup(inl->program, factor->name);
+    node_stat_t* body = opt_inline_body(callee);
+    if(!body || callee == inl->caller || callee->param_count != factor->arg_count) return;
+
+    // calls that never ran are not worth growing the caller for
+    size_t budget = inl->optimize_size ? OPT_INLINE_SIZE_FACTORS : OPT_INLINE_MAX_FACTORS;
+    if(inl->profile && profile_is_cold(inl->profile, callee)) return;
+    if(inl->profile && profile_is_hot(inl->profile, callee) && !inl->optimize_size) budget = OPT_INLINE_HOT_FACTORS;
+
+    size_t size = 0;
+    visit_expression_factors(body->exp, opt_count_factor, &size);
+    if(size > budget && !(inl->optimize_size && opt_inline_shrinks(inl, callee, body, factor))) return;
+
+    opt_find_call_t recursion = { callee->function_name, 0 };
+    visit_expression_factors(body->exp, opt_find_call, &recursion);
+    if(recursion.count) return;
+
+    opt_subst_t subst;
+    subst.callee = callee;
+    subst.args = (node_exp_t**)calloc(factor->arg_count + 1, sizeof(node_exp_t*));
+    subst.uses = (size_t*)calloc(factor->arg_count + 1, sizeof(size_t));
+    subst.evaluated = (size_t*)calloc(factor->arg_count + 1, sizeof(size_t));
+    subst.unresolved = false;
+    visit_expression_factors(body->exp, opt_count_uses, &subst);
+    visit_evaluated_factors(body->exp, opt_count_evaluated, &subst);
+    opt_find_call_t body_calls = { NULL, 0 };
+    visit_expression_factors(body->exp, opt_find_call, &body_calls);
+
+    // an argument may only be copied if it is used once or is cheap to repeat,
+    // one making a call has to run exactly once and before the callee's calls,
+    // and with two of them the body could swap their order
+    bool inlinable = !subst.unresolved;
+    size_t calling_args = 0;
+    size_t i = 0;
+    for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next, ++i) {
+        subst.args[i] = arg;
+        node_factor_t* single = opt_single_factor(arg);
+        bool trivial = single && (single->type == FACTOR_CONST || single->type == FACTOR_VARIABLE);
+        if(subst.uses[i] > 1 && !trivial) inlinable = false;
+
+        opt_find_call_t arg_calls = { NULL, 0 };
+        visit_expression_factors(arg, opt_find_call, &arg_calls);
+        if(arg_calls.count && (subst.uses[i] != 1 || subst.evaluated[i] != 1 || body_calls.count)) inlinable = false;
+        if(arg_calls.count && ++calling_args > 1) inlinable = false;
+    }
+
+    if(inlinable) {
+        node_exp_t* exp = clone_expression(body->exp);
+        visit_expression_factors(exp, opt_substitute, &subst);
+
+        opt_free_args(factor);
+        factor->name = NULL;
+        factor->args = NULL;
+        factor->arg_count = 0;
+        factor->type = FACTOR_PAREN;
+        factor->exp = exp;
+        inl->count++;
+    }
+
+    free(subst.args);
+    free(subst.uses);
+    free(subst.evaluated);
+}
+
+size_t opt_inline(program_t* program, profile_t* profile, bool optimize_size, bool whole_program) {
+    opt_inline_t inl = { program, profile, optimize_size, whole_program, NULL, 0 };
+    FOR_EACH_FUNCTION(program, func) {
+        inl.caller = func;
+        visit_statement_factors(func->stat, opt_inline_call, &inl);
+    }
+    return inl.count;
+}
+
+// CONSTANT PROPAGATION
+
+typedef enum opt_lattice_e {
+    OPT_UNSEEN,
+    OPT_CONSTANT,
+    OPT_VARYING
+} opt_lattice;
+
+typedef struct opt_param_s {
+    opt_lattice state;
+    int value;
+} opt_param_t;
+
+typedef struct opt_propagate_s {
+    program_t* program;
+    node_func_t** funcs;
+    opt_param_t** params;
+    size_t count;
+} opt_propagate_t;
+
+static int opt_func_compare(const void* a, const void* b) {
+    uintptr_t lhs = (uintptr_t)*(node_func_t* const*)a, rhs = (uintptr_t)*(node_func_t* const*)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static opt_param_t* opt_params_of(opt_propagate_t* prop, node_func_t* func) {
+    node_func_t** found = (node_func_t**)bsearch(&func, prop->funcs, prop->count, sizeof(node_func_t*), opt_func_compare);
+    return found ? prop->params[found - prop->funcs] : NULL;
+}
+
+static void opt_meet_call(node_factor_t* factor, void* ctx) {
+    opt_propagate_t* prop = (opt_propagate_t*)ctx;
+    if(factor->type != FACTOR_CALL) return;
+
+    node_func_t* callee = program_lookup(prop->program, factor->name);
+    opt_param_t* params = callee ? opt_params_of(prop, callee) : NULL;
+    if(!params) return;
+
+    size_t i = 0;
+    for(node_exp_t* arg = factor->args; arg && i < callee->param_count; arg = (node_exp_t*)arg->node.next, ++i) {
+        int value;
+        if(!ce_expression(arg, &value)) params[i].state = OPT_VARYING;
+        else if(params[i].state == OPT_UNSEEN) {
+            params[i].state = OPT_CONSTANT;
+            params[i].value = value;
+        } else if(params[i].state == OPT_CONSTANT && params[i].value != value)
+            params[i].state = OPT_VARYING;
+    }
+}
+
+typedef struct opt_replace_s {
+    node_func_t* func;
+    opt_param_t* params;
+    size_t count;
+} opt_replace_t;
+
+static void opt_replace_param(node_factor_t* factor, void* ctx) {
+    opt_replace_t* replace = (opt_replace_t*)ctx;
+    if(factor->type != FACTOR_VARIABLE) return;
+
+    int index = opt_param_index(replace->func, factor->name);
+    if(index >= 0 && replace->params[index].state == OPT_CONSTANT) {
+        opt_const_factor(factor, replace->params[index].value);
+        replace->count++;
+    }
+}
+
+// parameters every call site passes the same constant for become that constant,
+// functions called from outside the program keep their parameters
+size_t opt_propagate(program_t* program, bool whole_program) {
+    opt_propagate_t prop;
+    prop.program = program;
+    prop.count = 0;
+    FOR_EACH_FUNCTION(program, func) prop.count++;
+
+    prop.funcs = (node_func_t**)malloc((prop.count + 1) * sizeof(node_func_t*));
+    prop.params = (opt_param_t**)malloc((prop.count + 1) * sizeof(opt_param_t*));
+    size_t i = 0;
+    FOR_EACH_FUNCTION(program, func) prop.funcs[i++] = func;
+    qsort(prop.funcs, prop.count, sizeof(node_func_t*), opt_func_compare);
+    for(i = 0; i < prop.count; ++i)
+        prop.params[i] = (opt_param_t*)calloc(prop.funcs[i]->param_count + 1, sizeof(opt_param_t));
+
+    FOR_EACH_FUNCTION(program, func) visit_statement_factors(func->stat, opt_meet_call, &prop);
+
+    opt_replace_t replace = { NULL, NULL, 0 };
+    for(i = 0; i < prop.count; ++i) {
+        node_func_t* func = prop.funcs[i];
+        if(opt_exported(program, func, whole_program)) continue;
+
+        replace.func = func;
+        replace.params = prop.params[i];
+        visit_statement_factors(func->stat, opt_replace_param, &replace);
+    }
+
+    for(i = 0; i < prop.count; ++i) free(prop.params[i]);
+    free(prop.params);
+    free(prop.funcs);
+    return replace.count;
+}
+
+// CONSTANT FOLDING
+
+// shrink a level to its constant value, the levels below collapse into one constant factor
+
+static void opt_const_term(node_term_t* term, int value) {
+    node_term_subterm_t* sub = term->subterms;
+    while(sub) {
+        node_term_subterm_t* next = sub->next;
+        free_factor(sub->factor);
+        free(sub);
+        sub = next;
+    }
+    term->subterms = NULL;
+    opt_const_factor(term->factor, value);
+}
+
+static void opt_const_sum(node_exp_sum_t* sum, int value) {
+    node_exp_sum_subexp_t* sub = sum->subexps;
+    while(sub) {
+        node_exp_sum_subexp_t* next = sub->next;
+        free_term(sub->term);
+        free(sub);
+        sub = next;
+    }
+    sum->subexps = NULL;
+    opt_const_term(sum->term, value);
+}
+
+static void opt_const_relation(node_exp_relation_t* relation, int value) {
+    node_exp_relation_subexp_t* sub = relation->subexps;
+    while(sub) {
+        node_exp_relation_subexp_t* next = sub->next;
+        free_exp_sum(sub->sum);
+        free(sub);
+        sub = next;
+    }
+    relation->subexps = NULL;
+    opt_const_sum(relation->sum, value);
+}
+
+static void opt_const_equals(node_exp_equals_t* equals, int value) {
+    node_exp_equals_subexp_t* sub = equals->subexps;
+    while(sub) {
+        node_exp_equals_subexp_t* next = sub->next;
+        free_exp_relation(sub->relation);
+        free(sub);
+        sub = next;
+    }
+    equals->subexps = NULL;
+    opt_const_relation(equals->relation, value);
+}
+
+static void opt_const_and(node_exp_and_t* and, int value) {
+    node_exp_and_subexp_t* sub = and->subexps;
+    while(sub) {
+        node_exp_and_subexp_t* next = sub->next;
+        free_exp_equals(sub->equals);
+        free(sub);
+        sub = next;
+    }
+    and->subexps = NULL;
+    opt_const_equals(and->equals, value);
+}
+
+static void opt_const_expression(node_exp_t* exp, int value) {
+    node_exp_subexp_t* sub = exp->subexps;
+    while(sub) {
+        node_exp_subexp_t* next = sub->next;
+        free_exp_and(sub->and_exp);
+        free(sub);
+        sub = next;
+    }
+    exp->subexps = NULL;
+    opt_const_and(exp->and_exp, value);
+}
+
+static size_t opt_fold_expression(node_exp_t* exp);
+
+static size_t opt_fold_factor(node_factor_t* factor) {
+    size_t count = 0;
+    int value;
+
+    if(factor->type == FACTOR_PAREN) {
+        count += opt_fold_expression(factor->exp);
+        if(ce_expression(factor->exp, &value)) {
+            opt_const_factor(factor, value);
+            return count + 1;
+        }
+
+        // parens around a lone factor only cost a save and restore
+        node_factor_t* single = opt_single_factor(factor->exp);
+        if(single) {
+            node_exp_t* exp = factor->exp;
+            node_t node = factor->node;
+            *factor = *single;
+            factor->node = node;
+            exp->and_exp->equals->relation->sum->term->factor = NULL;
+            free(single);
+            free_expression(exp);
+            count++;
+        }
+    } else if(factor->type == FACTOR_UNARY_OP) {
+        count += opt_fold_factor(factor->factor);
+        if(ce_factor(factor, &value)) {
+            opt_const_factor(factor, value);
+            count++;
+        }
+    } else if(factor->type == FACTOR_CALL) {
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next)
+            count += opt_fold_expression(arg);
+    }
+
+    return count;
+}
+
+static size_t opt_fold_term(node_term_t* term) {
+    size_t count = opt_fold_factor(term->factor);
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next)
+        count += opt_fold_factor(sub->factor);
+
+    int value;
+    if(term->subterms && ce_term(term, &value)) {
+        opt_const_term(term, value);
+        return count + 1;
+    }
+
+    // fold a leading run of constants, the chain is left associative
+    while(term->factor->type == FACTOR_CONST && term->subterms && term->subterms->factor->type == FACTOR_CONST) {
+        node_term_subterm_t* sub = term->subterms;
+        node_term_t pair;
+        memset(&pair, 0, sizeof(node_term_t));
+        pair.factor = term->factor;
+        pair.subterms = sub;
+        node_term_subterm_t* rest = sub->next;
+        sub->next = NULL;
+
+        bool constant = ce_term(&pair, &value);
+        sub->next = rest;
+        if(!constant) break;
+
+        term->factor->literal = (unsigned int)value;
+        term->subterms = rest;
+        free_factor(sub->factor);
+        free(sub);
+        count++;
+    }
+
+    return count;
+}
+
+static size_t opt_fold_sum(node_exp_sum_t* sum) {
+    size_t count = opt_fold_term(sum->term);
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next)
+        count += opt_fold_term(sub->term);
+
+    int value;
+    if(sum->subexps && ce_exp_sum(sum, &value)) {
+        opt_const_sum(sum, value);
+        return count + 1;
+    }
+
+    while(sum->subexps && !sum->term->subterms && sum->term->factor->type == FACTOR_CONST) {
+        node_exp_sum_subexp_t* sub = sum->subexps;
+        if(sub->term->subterms || sub->term->factor->type != FACTOR_CONST) break;
+
+        unsigned int lhs = sum->term->factor->literal, rhs = sub->term->factor->literal;
+        sum->term->factor->literal = sub->operator == OPERATOR_ADD ? lhs + rhs : lhs - rhs;
+        sum->subexps = sub->next;
+        free_term(sub->term);
+        free(sub);
+        count++;
+    }
+
+    return count;
+}
+
+static size_t opt_fold_relation(node_exp_relation_t* relation) {
+    size_t count = opt_fold_sum(relation->sum);
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next)
+        count += opt_fold_sum(sub->sum);
+
+    int value;
+    if(relation->subexps && ce_exp_relation(relation, &value)) {
+        opt_const_relation(relation, value);
+        count++;
+    }
+    return count;
+}
+
+static size_t opt_fold_equals(node_exp_equals_t* equals) {
+    size_t count = opt_fold_relation(equals->relation);
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next)
+        count += opt_fold_relation(sub->relation);
+
+    int value;
+    if(equals->subexps && ce_exp_equals(equals, &value)) {
+        opt_const_equals(equals, value);
+        count++;
+    }
+    return count;
+}
+
+static size_t opt_fold_and(node_exp_and_t* and) {
+    size_t count = opt_fold_equals(and->equals);
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next)
+        count += opt_fold_equals(sub->equals);
+
+    // a false operand decides the chain and a true one can go while two operands remain
+    int value;
+    node_exp_and_subexp_t** link = &and->subexps;
+    bool decided = ce_exp_equals(and->equals, &value) && !value;
+    while(*link && !decided) {
+        node_exp_and_subexp_t* sub = *link;
+        if(!ce_exp_equals(sub->equals, &value)) {
+            link = &sub->next;
+        } else if(!value) {
+            decided = true;
+        } else if(and->subexps->next) {
+            *link = sub->next;
+            free_exp_equals(sub->equals);
+            free(sub);
+            count++;
+        } else
+            link = &sub->next;
+    }
+    if(and->subexps && and->subexps->next && ce_exp_equals(and->equals, &value) && value) {
+        node_exp_and_subexp_t* sub = and->subexps;
+        free_exp_equals(and->equals);
+        and->equals = sub->equals;
+        and->subexps = sub->next;
+        free(sub);
+        count++;
+    }
+    if(and->subexps && decided) {
+        opt_const_and(and, 0);
+        return count + 1;
+    }
+
+    if(and->subexps && ce_exp_and(and, &value)) {
+        opt_const_and(and, value);
+        count++;
+    }
+    return count;
+}
+
+static size_t opt_fold_expression(node_exp_t* exp) {
+    size_t count = opt_fold_and(exp->and_exp);
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next)
+        count += opt_fold_and(sub->and_exp);
+
+    // a true operand decides the chain and a false one can go while two operands remain
+    int value;
+    node_exp_subexp_t** link = &exp->subexps;
+    bool decided = ce_exp_and(exp->and_exp, &value) && value;
+    while(*link && !decided) {
+        node_exp_subexp_t* sub = *link;
+        if(!ce_exp_and(sub->and_exp, &value)) {
+            link = &sub->next;
+        } else if(value) {
+            decided = true;
+        } else if(exp->subexps->next) {
+            *link = sub->next;
+            free_exp_and(sub->and_exp);
+            free(sub);
+            count++;
+        } else
+            link = &sub->next;
+    }
+    if(exp->subexps && exp->subexps->next && ce_exp_and(exp->and_exp, &value) && !value) {
+        node_exp_subexp_t* sub = exp->subexps;
+        free_exp_and(exp->and_exp);
+        exp->and_exp = sub->and_exp;
+        exp->subexps = sub->next;
+        free(sub);
+        count++;
+    }
+    if(exp->subexps && decided) {
+        opt_const_expression(exp, 1);
+        return count + 1;
+    }
+
+    if(exp->subexps && ce_expression(exp, &value)) {
+        opt_const_expression(exp, value);
+        count++;
+    }
+    return count;
+}
+
+static size_t opt_fold_statement(node_stat_t* stat) {
+    size_t count = stat->exp ? opt_fold_expression(stat->exp) : 0;
+
+    if(stat->type == STAT_BLOCK) {
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next)
+            count += opt_fold_statement(sub);
+    } else if(stat->type == STAT_SWITCH) {
+        count += opt_fold_statement(stat->stat);
+    }
+    return count;
+}
+
+size_t opt_fold(program_t* program) {
+    size_t count = 0;
+    FOR_EACH_FUNCTION(program, func) count += opt_fold_statement(func->stat);
+    return count;
+}
+
+// DEAD CODE
+
+// the labels a switch can dispatch to, all of them unless its value is known
+typedef struct opt_entries_s {
+    bool constant;
+    int value;
+    bool to_default;
+} opt_entries_t;
+
+// does control enter the statement through one of its labels,
+// labels of a nested switch belong to that switch
+static bool opt_has_entry(node_stat_t* stat, opt_entries_t* entries) {
+    switch(stat->type) {
+    case STAT_CASE:
+        return !entries || !entries->constant || (!entries->to_default && stat->case_value == entries->value);
+    case STAT_DEFAULT:
+        return !entries || !entries->constant || entries->to_default;
+    case STAT_BLOCK:
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next) {
+            if(opt_has_entry(sub, entries)) return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+// is there a case label for value, or a default label
+static bool opt_find_label(node_stat_t* stat, stat_type type, int value) {
+    if(stat->type == type && (type != STAT_CASE || stat->case_value == value)) return true;
+    if(stat->type != STAT_BLOCK) return false;
+    for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next) {
+        if(opt_find_label(sub, type, value)) return true;
+    }
+    return false;
+}
+
+// a break leaving the switch the statement belongs to
+static bool opt_has_break(node_stat_t* stat) {
+    if(stat->type == STAT_BREAK) return true;
+    if(stat->type != STAT_BLOCK) return false;
+    for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next) {
+        if(opt_has_break(sub)) return true;
+    }
+    return false;
+}
+
+static bool opt_falls_through(node_stat_t* stat) {
+    if(stat->type == STAT_RETURN || stat->type == STAT_BREAK) return false;
+    if(stat->type == STAT_SWITCH) {
+        // the end is reached by a break, by the body running off or by no label matching
+        int value;
+        bool matched = opt_find_label(stat->stat, STAT_DEFAULT, 0) ||
+            (ce_expression(stat->exp, &value) && opt_find_label(stat->stat, STAT_CASE, value));
+        return !matched || opt_has_break(stat->stat) || opt_falls_through(stat->stat);
+    }
+    if(stat->type != STAT_BLOCK || !stat->stats) return true;
+
+    node_stat_t* last = stat->stats;
+    while(last->node.next) last = (node_stat_t*)last->node.next;
+    return opt_falls_through(last);
+}
+
+static size_t opt_dead_statement(node_stat_t* stat, bool reachable, opt_entries_t* entries);
+
+// drop statements control cannot reach, an entry label makes code reachable again
+static size_t opt_dead_block(node_stat_t* block, bool reachable, opt_entries_t* entries) {
+    size_t count = 0;
+    node_stat_t* sub = block->stats;
+    while(sub) {
+        node_stat_t* next = (node_stat_t*)sub->node.next;
+        bool entered = opt_has_entry(sub, entries);
+
+        // a switch with a known value matching no label does nothing
+        bool skipped = sub->type == STAT_SWITCH && sub->stat->type == STAT_BLOCK && !sub->stat->stats;
+        if((!reachable && !entered) || skipped) {
+            if(sub->node.prev) sub->node.prev->next = sub->node.next;
+            else block->stats = next;
+            if(next) next->node.prev = sub->node.prev;
+            sub->node.next = sub->node.prev = NULL;
+            free_statement(sub);
+            count++;
+        } else {
+            count += opt_dead_statement(sub, reachable, entries);
+            reachable = opt_falls_through(sub);
+
+            // the body emptied, drop the switch now rather than next round
+            if(sub->type == STAT_SWITCH && sub->stat->type == STAT_BLOCK && !sub->stat->stats) continue;
+        }
+        sub = next;
+    }
+    return count;
+}
+
+static size_t opt_dead_statement(node_stat_t* stat, bool reachable, opt_entries_t* entries) {
+    if(stat->type == STAT_BLOCK) return opt_dead_block(stat, reachable, entries);
+    if(stat->type != STAT_SWITCH || stat->stat->type != STAT_BLOCK) return 0;
+
+    // nothing runs before the first label of a switch body
+    opt_entries_t inner = { false, 0, false };
+    inner.constant = ce_expression(stat->exp, &inner.value);
+    inner.to_default = inner.constant && !opt_find_label(stat->stat, STAT_CASE, inner.value);
+    if(inner.to_default && !opt_find_label(stat->stat, STAT_DEFAULT, 0)) {
+        size_t count = 0;
+        while(stat->stat->stats) {
+            node_stat_t* sub = stat->stat->stats;
+            stat->stat->stats = (node_stat_t*)sub->node.next;
+            sub->node.next = NULL;
+            free_statement(sub);
+            count++;
+        }
+        return count;
+    }
+    return opt_dead_block(stat->stat, false, &inner);
+}
+
+size_t opt_dead_code(program_t* program) {
+    size_t count = 0;
+    FOR_EACH_FUNCTION(program, func) count += opt_dead_statement(func->stat, true, NULL);
+    return count;
+}
+
+// DEAD FUNCTIONS
+
+typedef struct opt_reach_s {
+    program_t* program;
+    node_func_t** worklist;
+    size_t count;
+    // functions known reachable, sorted by address once the walk is done
+    node_func_t** reached;
+    size_t reached_count;
+} opt_reach_t;
+
+static bool opt_mark(opt_reach_t* reach, node_func_t* func) {
+    for(size_t i = 0; i < reach->reached_count; ++i) {
+        if(reach->reached[i] == func) return false;
+    }
+    reach->reached[reach->reached_count++] = func;
+    reach->worklist[reach->count++] = func;
+    return true;
+}
+
+static void opt_reach_call(node_factor_t* factor, void* ctx) {
+    opt_reach_t* reach = (opt_reach_t*)ctx;
+    if(factor->type != FACTOR_CALL) return;
+
+    node_func_t* callee = program_lookup(reach->program, factor->name);
+    if(callee && callee->stat) opt_mark(reach, callee);
+}
+
+// A whole program with main is linked on its own, so every other function
+// becomes local. Otherwise whatever is not static may be called from outside.
+size_t opt_dead_functions(program_t* program, bool whole_program) {
+    FOR_EACH_FUNCTION(program, func) func->is_static = !opt_exported(program, func, whole_program);
+
+    size_t total = 0;
+    FOR_EACH_FUNCTION(program, func) total++;
+
+    opt_reach_t reach;
+    reach.program = program;
+    reach.worklist = (node_func_t**)malloc((total + 1) * sizeof(node_func_t*));
+    reach.reached = (node_func_t**)malloc((total + 1) * sizeof(node_func_t*));
+    reach.count = reach.reached_count = 0;
+
+    FOR_EACH_FUNCTION(program, func) {
+        if(!func->is_static) opt_mark(&reach, func);
+    }
+    while(reach.count) {
+        node_func_t* func = reach.worklist[--reach.count];
+        visit_statement_factors(func->stat, opt_reach_call, &reach);
+    }
+    qsort(reach.reached, reach.reached_count, sizeof(node_func_t*), opt_func_compare);
+
+    size_t removed = 0;
+    node_t* curr = program->root->functions;
+    while(curr) {
+        node_t* next = curr->next;
+        node_func_t* func = (node_func_t*)curr;
+        if(!bsearch(&func, reach.reached, reach.reached_count, sizeof(node_func_t*), opt_func_compare)) {
+            if(curr->prev) curr->prev->next = next;
+            else program->root->functions = next;
+            if(next) next->prev = curr->prev;
+
+            program_remove(program, func->function_name);
+            free_function(func);
+            removed++;
+        }
+        curr = next;
+    }
+
+    free(reach.worklist);
+    free(reach.reached);
+    return removed;
+}
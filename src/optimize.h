@@ -0,0 +1,37 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "program.h"
+#include "profile.h"
+
+typedef struct opt_stats_s {
+    size_t inlined;
+    size_t propagated;
+    size_t folded;
+    size_t removed_statements;
+    size_t removed_functions;
+} opt_stats_t;
+
+// Whole program optimization, run on the merged program before code generation.
+// Calls may have side effects, functions outside the program can be called,
+// so inlining keeps every call an argument makes running once and in order.
+// A loaded profile steers inlining toward calls that actually ran, instrumented
+// builds leave calls alone so every function counts its own entries. Optimizing
+// for size only inlines callees about as small as the call. A whole program is
+// linked on its own, otherwise functions that are not static are exported and
+// may be called from outside it.
+void optimize_program(program_t* program, profile_t* profile, bool inline_calls, bool optimize_size, bool whole_program, opt_stats_t* stats);
+
+size_t opt_inline(program_t* program, profile_t* profile, bool optimize_size, bool whole_program);
+size_t opt_propagate(program_t* program, bool whole_program);
+size_t opt_fold(program_t* program);
+size_t opt_dead_code(program_t* program);
+// functions nothing exported can reach, a whole program with main only exports main
+size_t opt_dead_functions(program_t* program, bool whole_program);
+
+#endif
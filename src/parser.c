@@ -7,6 +7,7 @@
 #include "nodes.h"
 
 #include "lexer.h"
+#include "const_eval.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -20,11 +21,22 @@ node_root_t* parse(token_t* tokens) {
     ZMALLOC(node_root_t, root);
 
     token_t* curr = tokens;
-    root->functions = (node_t*)parse_function(&curr);
+    node_t* last = NULL;
+    while(curr) {
+        node_t* func = (node_t*)parse_function(&curr);
+        if(!func) {
+            free_root_node(root);
+            return NULL;
+        }
+
+        if(last) {
+            last->next = func;
+            func->prev = last;
+        } else
+            root->functions = func;
+        last = func;
 
-    if(!root->functions) {
-        free(root);
-        return NULL;
+        curr = curr->next;
     }
 
     return root;
@@ -33,12 +45,11 @@ node_root_t* parse(token_t* tokens) {
 void free_root_node(node_root_t* root) {
     assert(root);
 
-    // TODO: names are still left floating for identifiers
     if(root->functions) {
         node_t* curr = root->functions;
         while(curr) {
             node_t* next = curr->next;
-            free(curr);
+            free_function((node_func_t*)curr);
             curr = next;
         }
     }
@@ -95,8 +106,40 @@ node_factor_t* parse_factor(token_t** list) {
     } else if(curr->type == TOKEN_LITERAL) {
         fact->type = FACTOR_CONST;
         fact->literal = curr->literal_value;
+    } else if(curr->type == TOKEN_IDENTIFIER) {
+        fact->type = FACTOR_VARIABLE;
+        fact->name = curr->name;
+        curr->name_owner = 0;
+
+        token_t* peek = curr->next;
+        if(!peek || peek->type != TOKEN_OPEN_PAREN) goto done;
+        fact->type = FACTOR_CALL;
+        NEXT(curr);
+        NEXT(curr);
+
+        node_exp_t* last = NULL;
+        while(curr->type != TOKEN_CLOSE_PAREN) {
+            if(last) {
+                if(curr->type != TOKEN_COMMA) goto fail;
+                NEXT(curr);
+            }
+
+            node_exp_t* arg = parse_expression(&curr);
+            if(!arg) goto fail;
+
+            if(last) {
+                last->node.next = (node_t*)arg;
+                arg->node.prev = (node_t*)last;
+            } else
+                fact->args = arg;
+            last = arg;
+            fact->arg_count++;
+
+            NEXT(curr);
+        }
     } else goto fail;
 
+done:
     *list = curr;
     return fact;
 
@@ -111,12 +154,52 @@ void free_factor(node_factor_t* factor) {
             free_expression(factor->exp);
         } else if(factor->type == FACTOR_UNARY_OP) {
             free_factor(factor->factor);
+        } else if(factor->type == FACTOR_VARIABLE || factor->type == FACTOR_CALL) {
+            node_exp_t* arg = factor->args;
+            while(arg) {
+                node_exp_t* next = (node_exp_t*)arg->node.next;
+                free_expression(arg);
+                arg = next;
+            }
+            free(factor->name);
         }
 
         free(factor);
     }
 }
 
+node_factor_t* clone_factor(node_factor_t* factor) {
+    node_factor_t* out;
+    ZMALLOC(node_factor_t, out);
+    out->node.type = NODE_FACTOR;
+    out->type = factor->type;
+
+    if(factor->type == FACTOR_PAREN) {
+        out->exp = clone_expression(factor->exp);
+    } else if(factor->type == FACTOR_UNARY_OP) {
+        out->operator = factor->operator;
+        out->factor = clone_factor(factor->factor);
+    } else if(factor->type == FACTOR_CONST) {
+        out->literal = factor->literal;
+    } else if(factor->type == FACTOR_VARIABLE || factor->type == FACTOR_CALL) {
+        out->name = strdup(factor->name);
+        out->arg_count = factor->arg_count;
+
+        node_exp_t* last = NULL;
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next) {
+            node_exp_t* copy = clone_expression(arg);
+            if(last) {
+                last->node.next = (node_t*)copy;
+                copy->node.prev = (node_t*)last;
+            } else
+                out->args = copy;
+            last = copy;
+        }
+    }
+
+    return out;
+}
+
 void debug_print_node_factor(node_factor_t* factor) {
     if(factor->type == FACTOR_CONST) {
         printf("%u ", factor->literal);
@@ -127,6 +210,15 @@ void debug_print_node_factor(node_factor_t* factor) {
     } else if(factor->type == FACTOR_UNARY_OP) {
         printf("%s ", operator_type_names[factor->operator]);
         debug_print_node_factor(factor->factor);
+    } else if(factor->type == FACTOR_VARIABLE) {
+        printf("%s ", factor->name);
+    } else if(factor->type == FACTOR_CALL) {
+        printf("%s(", factor->name);
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next) {
+            debug_print_node_expression(arg);
+            if(arg->node.next) printf(", ");
+        }
+        printf(") ");
     } else {
         printf("ERR");
     }
@@ -192,6 +284,24 @@ void free_term(node_term_t* term) {
     }
 }
 
+node_term_t* clone_term(node_term_t* term) {
+    node_term_t* out;
+    ZMALLOC(node_term_t, out);
+    out->node.type = NODE_TERM;
+    out->factor = clone_factor(term->factor);
+    out->subterm_count = term->subterm_count;
+
+    node_term_subterm_t** tail = &out->subterms;
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next) {
+        ZMALLOC(node_term_subterm_t, *tail);
+        (*tail)->operator = sub->operator;
+        (*tail)->factor = clone_factor(sub->factor);
+        tail = &(*tail)->next;
+    }
+
+    return out;
+}
+
 void debug_print_node_term(node_term_t* term) {
     debug_print_node_factor(term->factor);
 
@@ -265,6 +375,23 @@ void free_exp_sum(node_exp_sum_t* sum) {
     }
 }
 
+node_exp_sum_t* clone_exp_sum(node_exp_sum_t* sum) {
+    node_exp_sum_t* out;
+    ZMALLOC(node_exp_sum_t, out);
+    out->node.type = NODE_EXPRESSION;
+    out->term = clone_term(sum->term);
+
+    node_exp_sum_subexp_t** tail = &out->subexps;
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next) {
+        ZMALLOC(node_exp_sum_subexp_t, *tail);
+        (*tail)->operator = sub->operator;
+        (*tail)->term = clone_term(sub->term);
+        tail = &(*tail)->next;
+    }
+
+    return out;
+}
+
 void debug_print_node_exp_sum(node_exp_sum_t* sum) {
     debug_print_node_term(sum->term);
 
@@ -338,6 +465,23 @@ void free_exp_relation(node_exp_relation_t* relation) {
     }
 }
 
+node_exp_relation_t* clone_exp_relation(node_exp_relation_t* relation) {
+    node_exp_relation_t* out;
+    ZMALLOC(node_exp_relation_t, out);
+    out->node.type = NODE_EXPRESSION;
+    out->sum = clone_exp_sum(relation->sum);
+
+    node_exp_relation_subexp_t** tail = &out->subexps;
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next) {
+        ZMALLOC(node_exp_relation_subexp_t, *tail);
+        (*tail)->relation = sub->relation;
+        (*tail)->sum = clone_exp_sum(sub->sum);
+        tail = &(*tail)->next;
+    }
+
+    return out;
+}
+
 void debug_print_node_exp_relation(node_exp_relation_t* relation) {
     debug_print_node_exp_sum(relation->sum);
 
@@ -411,6 +555,24 @@ void free_exp_equals(node_exp_equals_t* equals) {
     }
 }
 
+node_exp_equals_t* clone_exp_equals(node_exp_equals_t* equals) {
+    node_exp_equals_t* out;
+    ZMALLOC(node_exp_equals_t, out);
+    out->node.type = NODE_EXPRESSION;
+    out->probe = equals->probe;
+    out->relation = clone_exp_relation(equals->relation);
+
+    node_exp_equals_subexp_t** tail = &out->subexps;
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next) {
+        ZMALLOC(node_exp_equals_subexp_t, *tail);
+        (*tail)->operator = sub->operator;
+        (*tail)->relation = clone_exp_relation(sub->relation);
+        tail = &(*tail)->next;
+    }
+
+    return out;
+}
+
 void debug_print_node_exp_equals(node_exp_equals_t* equals) {
     debug_print_node_exp_relation(equals->relation);
 
@@ -483,6 +645,23 @@ void free_exp_and(node_exp_and_t* and) {
     }
 }
 
+node_exp_and_t* clone_exp_and(node_exp_and_t* and) {
+    node_exp_and_t* out;
+    ZMALLOC(node_exp_and_t, out);
+    out->node.type = NODE_EXPRESSION;
+    out->probe = and->probe;
+    out->equals = clone_exp_equals(and->equals);
+
+    node_exp_and_subexp_t** tail = &out->subexps;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) {
+        ZMALLOC(node_exp_and_subexp_t, *tail);
+        (*tail)->equals = clone_exp_equals(sub->equals);
+        tail = &(*tail)->next;
+    }
+
+    return out;
+}
+
 void debug_print_node_exp_and(node_exp_and_t* and) {
     debug_print_node_exp_equals(and->equals);
 
@@ -550,6 +729,22 @@ void free_expression(node_exp_t* exp) {
     }
 }
 
+node_exp_t* clone_expression(node_exp_t* exp) {
+    node_exp_t* out;
+    ZMALLOC(node_exp_t, out);
+    out->node.type = NODE_EXPRESSION;
+    out->and_exp = clone_exp_and(exp->and_exp);
+
+    node_exp_subexp_t** tail = &out->subexps;
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) {
+        ZMALLOC(node_exp_subexp_t, *tail);
+        (*tail)->and_exp = clone_exp_and(sub->and_exp);
+        tail = &(*tail)->next;
+    }
+
+    return out;
+}
+
 void debug_print_node_expression(node_exp_t* exp) {
     debug_print_node_exp_and(exp->and_exp);
 
@@ -567,30 +762,176 @@ node_stat_t* parse_statement(token_t** list) {
     node_stat_t* out;
     ZMALLOC(node_stat_t, out);
     out->node.type = NODE_STATEMENT;
+    out->line = curr->line;
+    out->column = curr->column;
 
-    if(curr->type != TOKEN_KEYWORD && curr->keyword_type != KEYWORD_RETURN) goto fail;
-    // out->return_keyword = curr;
-    NEXT(curr);
+    if(curr->type == TOKEN_OPEN_BRACE) {
+        out->type = STAT_BLOCK;
+        NEXT(curr);
 
-    out->exp = parse_expression(&curr);
-    if(!out->exp) goto fail;
-    NEXT(curr);
+        node_stat_t* last = NULL;
+        while(curr->type != TOKEN_CLOSE_BRACE) {
+            node_stat_t* stat = parse_statement(&curr);
+            if(!stat) goto fail;
+
+            if(last) {
+                last->node.next = (node_t*)stat;
+                stat->node.prev = (node_t*)last;
+            } else
+                out->stats = stat;
+            last = stat;
+
+            NEXT(curr);
+        }
+    } else if(curr->type == TOKEN_KEYWORD) {
+        switch(curr->keyword_type) {
+        case KEYWORD_RETURN:
+            out->type = STAT_RETURN;
+            NEXT(curr);
+
+            out->exp = parse_expression(&curr);
+            if(!out->exp) goto fail;
+            NEXT(curr);
+
+            if(curr->type != TOKEN_SEMICOLON) goto fail;
+            break;
+        case KEYWORD_SWITCH:
+            out->type = STAT_SWITCH;
+            NEXT(curr);
+
+            if(curr->type != TOKEN_OPEN_PAREN) goto fail;
+            NEXT(curr);
+
+            out->exp = parse_expression(&curr);
+            if(!out->exp) goto fail;
+            NEXT(curr);
+
+            if(curr->type != TOKEN_CLOSE_PAREN) goto fail;
+            NEXT(curr);
+
+            out->stat = parse_statement(&curr);
+            if(!out->stat) goto fail;
+            if(out->stat->type == STAT_CASE || out->stat->type == STAT_DEFAULT) {
+                // a label goes with the statement after it, so a body that is not a
+                // block is its labels and the one statement they label
+                node_stat_t* body;
+                ZMALLOC(node_stat_t, body);
+                body->node.type = NODE_STATEMENT;
+                body->line = out->stat->line;
+                body->column = out->stat->column;
+                body->type = STAT_BLOCK;
+                body->stats = out->stat;
+                out->stat = body;
+
+                node_stat_t* last = body->stats;
+                while(last->type == STAT_CASE || last->type == STAT_DEFAULT) {
+                    NEXT(curr);
+                    node_stat_t* stat = parse_statement(&curr);
+                    if(!stat) goto fail;
+                    last->node.next = (node_t*)stat;
+                    stat->node.prev = (node_t*)last;
+                    last = stat;
+                }
+            }
+            break;
+        case KEYWORD_CASE: {
+            out->type = STAT_CASE;
+            NEXT(curr);
+
+            // case labels must be integer constant expressions
+            node_exp_t* value = parse_expression(&curr);
+            if(!value) goto fail;
+            bool constant = ce_expression(value, &out->case_value);
+            free_expression(value);
+            if(!constant) goto fail;
+            NEXT(curr);
+
+            if(curr->type != TOKEN_COLON) goto fail;
+            break;
+        }
+        case KEYWORD_DEFAULT:
+            out->type = STAT_DEFAULT;
+            NEXT(curr);
+
+            if(curr->type != TOKEN_COLON) goto fail;
+            break;
+        case KEYWORD_BREAK:
+            out->type = STAT_BREAK;
+            NEXT(curr);
+
+            if(curr->type != TOKEN_SEMICOLON) goto fail;
+            break;
+        default:
+            goto fail;
+        }
+    } else goto fail;
 
-    if(curr->type != TOKEN_SEMICOLON) goto fail;
-    // out->semicolon = curr;
-    
     *list = curr;
     return out;
 
 fail:
-    free(out);
+    free_statement(out);
     return NULL;
 }
 
+void free_statement(node_stat_t* stat) {
+    if(stat) {
+        free_expression(stat->exp);
+
+        if(stat->type == STAT_BLOCK) {
+            node_stat_t* sub = stat->stats;
+            while(sub) {
+                node_stat_t* next = (node_stat_t*)sub->node.next;
+                free_statement(sub);
+                sub = next;
+            }
+        } else if(stat->type == STAT_SWITCH) {
+            free_statement(stat->stat);
+        }
+
+        free(stat);
+    }
+}
+
+static void debug_print_statement_indent(node_stat_t* node, int depth) {
+    for(int i = 0; i < depth; ++i) printf("\t");
+
+    switch(node->type) {
+    case STAT_RETURN:
+        printf("RET ");
+        debug_print_node_expression(node->exp);
+        printf("\n");
+        break;
+    case STAT_BLOCK:
+        printf("{\n");
+        for(node_stat_t* sub = node->stats; sub; sub = (node_stat_t*)sub->node.next)
+            debug_print_statement_indent(sub, depth + 1);
+        for(int i = 0; i < depth; ++i) printf("\t");
+        printf("}\n");
+        break;
+    case STAT_SWITCH:
+        printf("SWITCH ");
+        debug_print_node_expression(node->exp);
+        printf("\n");
+        debug_print_statement_indent(node->stat, depth);
+        break;
+    case STAT_CASE:
+        printf("CASE %d:\n", node->case_value);
+        break;
+    case STAT_DEFAULT:
+        printf("DEFAULT:\n");
+        break;
+    case STAT_BREAK:
+        printf("BREAK\n");
+        break;
+    default:
+        printf("ERR\n");
+        break;
+    }
+}
+
 void debug_print_node_statement(node_stat_t* node) {
-    printf("\tRET ");
-    debug_print_node_expression(node->exp);
-    printf("\n");
+    debug_print_statement_indent(node, 1);
 }
 
 node_func_t* parse_function(token_t** list) {
@@ -600,6 +941,11 @@ node_func_t* parse_function(token_t** list) {
     ZMALLOC(node_func_t, out);
     out->node.type = NODE_FUNCTION;
 
+    if(curr->type == TOKEN_KEYWORD && curr->keyword_type == KEYWORD_STATIC) {
+        out->is_static = true;
+        NEXT(curr);
+    }
+
     // TODO: do range checking for keyword type
     if(curr->type != TOKEN_BUILTIN_TYPE) goto fail;
     out->return_type = curr->builtin_type;
@@ -608,38 +954,141 @@ node_func_t* parse_function(token_t** list) {
     if(curr->type != TOKEN_IDENTIFIER) goto fail;
     out->function_name = curr->name;
     curr->name_owner = 0;
+    out->line = curr->line;
+    out->column = curr->column;
     NEXT(curr);
 
     if(curr->type != TOKEN_OPEN_PAREN) goto fail;
     // out->open_paren = curr;
     NEXT(curr);
 
-    if(curr->type != TOKEN_CLOSE_PAREN) goto fail;
+    while(curr->type != TOKEN_CLOSE_PAREN) {
+        if(out->param_count) {
+            if(curr->type != TOKEN_COMMA) goto fail;
+            NEXT(curr);
+        }
+
+        if(curr->type != TOKEN_BUILTIN_TYPE || curr->builtin_type != BUILTIN_INT) goto fail;
+        NEXT(curr);
+
+        if(curr->type != TOKEN_IDENTIFIER) goto fail;
+        out->params = (char**)realloc(out->params, (out->param_count + 1) * sizeof(char*));
+        out->params[out->param_count++] = curr->name;
+        curr->name_owner = 0;
+        NEXT(curr);
+    }
     // out->close_paren = curr;
     NEXT(curr);
-    
-    if(curr->type != TOKEN_OPEN_BRACE) goto fail;
-    // out->open_brace = curr;
-    NEXT(curr);
 
+    // a prototype ends here, otherwise the body is parsed as a block ending on the close brace
+    if(curr->type == TOKEN_SEMICOLON) goto done;
+    if(curr->type != TOKEN_OPEN_BRACE) goto fail;
     out->stat = parse_statement(&curr);
     if(!out->stat) goto fail;
-    NEXT(curr);
-    
-    if(curr->type != TOKEN_CLOSE_BRACE) goto fail;
-    // out->close_brace = curr;
+
+done:
 
     *list = curr;
     return out;
 fail:
-    free(out);
+    free_function(out);
     return NULL;
 }
 
+void free_function(node_func_t* func) {
+    if(func) {
+        free(func->function_name);
+        for(size_t i = 0; i < func->param_count; ++i)
+            free(func->params[i]);
+        free(func->params);
+        free_statement(func->stat);
+        free(func);
+    }
+}
+
 void debug_print_node_function(node_func_t* node) {
-    printf("Name: \"%s\", Returns: %s, Params: \"\", Body: \n", 
-        node->function_name, 
+    printf("Name: \"%s\",%s Returns: %s, Params: \"", 
+        node->function_name, node->is_static ? " Static," : "",
         builtin_type_names[node->return_type]);
+    for(size_t i = 0; i < node->param_count; ++i)
+        printf(i ? ", %s" : "%s", node->params[i]);
+    printf("\", Body: \n");
     
-    debug_print_node_statement(node->stat);
+    if(node->stat) debug_print_node_statement(node->stat);
+}
+
+// FACTOR visiting, children are visited before their parent so the
+// visitor may rewrite the factor it is given, skipped also visits the
+// operands of && and || after the first, which may never be evaluated
+
+static void visit_exp_factors(node_exp_t* exp, bool skipped, factor_visitor visitor, void* ctx);
+
+static void visit_factor(node_factor_t* factor, bool skipped, factor_visitor visitor, void* ctx) {
+    if(factor->type == FACTOR_PAREN) {
+        visit_exp_factors(factor->exp, skipped, visitor, ctx);
+    } else if(factor->type == FACTOR_UNARY_OP) {
+        visit_factor(factor->factor, skipped, visitor, ctx);
+    } else if(factor->type == FACTOR_CALL) {
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next)
+            visit_exp_factors(arg, skipped, visitor, ctx);
+    }
+
+    visitor(factor, ctx);
+}
+
+static void visit_term(node_term_t* term, bool skipped, factor_visitor visitor, void* ctx) {
+    visit_factor(term->factor, skipped, visitor, ctx);
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next)
+        visit_factor(sub->factor, skipped, visitor, ctx);
+}
+
+static void visit_exp_sum(node_exp_sum_t* sum, bool skipped, factor_visitor visitor, void* ctx) {
+    visit_term(sum->term, skipped, visitor, ctx);
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next)
+        visit_term(sub->term, skipped, visitor, ctx);
+}
+
+static void visit_exp_relation(node_exp_relation_t* relation, bool skipped, factor_visitor visitor, void* ctx) {
+    visit_exp_sum(relation->sum, skipped, visitor, ctx);
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next)
+        visit_exp_sum(sub->sum, skipped, visitor, ctx);
+}
+
+static void visit_exp_equals(node_exp_equals_t* equals, bool skipped, factor_visitor visitor, void* ctx) {
+    visit_exp_relation(equals->relation, skipped, visitor, ctx);
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next)
+        visit_exp_relation(sub->relation, skipped, visitor, ctx);
+}
+
+static void visit_exp_and(node_exp_and_t* and, bool skipped, factor_visitor visitor, void* ctx) {
+    visit_exp_equals(and->equals, skipped, visitor, ctx);
+    if(!skipped) return;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next)
+        visit_exp_equals(sub->equals, skipped, visitor, ctx);
+}
+
+static void visit_exp_factors(node_exp_t* exp, bool skipped, factor_visitor visitor, void* ctx) {
+    visit_exp_and(exp->and_exp, skipped, visitor, ctx);
+    if(!skipped) return;
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next)
+        visit_exp_and(sub->and_exp, skipped, visitor, ctx);
+}
+
+void visit_expression_factors(node_exp_t* exp, factor_visitor visitor, void* ctx) {
+    visit_exp_factors(exp, true, visitor, ctx);
+}
+
+void visit_evaluated_factors(node_exp_t* exp, factor_visitor visitor, void* ctx) {
+    visit_exp_factors(exp, false, visitor, ctx);
+}
+
+void visit_statement_factors(node_stat_t* stat, factor_visitor visitor, void* ctx) {
+    if(stat->exp) visit_exp_factors(stat->exp, true, visitor, ctx);
+
+    if(stat->type == STAT_BLOCK) {
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next)
+            visit_statement_factors(sub, visitor, ctx);
+    } else if(stat->type == STAT_SWITCH) {
+        visit_statement_factors(stat->stat, visitor, ctx);
+    }
 }
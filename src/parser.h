@@ -32,6 +32,9 @@ struct AST_node_s {
 
     struct AST_node_s* next;
     struct AST_node_s* prev;
+
+    // temporaries an expression needs, Sethi-Ullman labels set by the code generator
+    size_t need;
 };
 typedef struct AST_node_s node_t;
 
@@ -0,0 +1,335 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "peephole.h"
+
+const char* ph_rule_names[PH_RULE_COUNT] = {
+    PH_RULE_LIST(STIRNG_LIST_ITEM, )
+};
+
+// instructions after each other the flags or eax are followed through
+#define PH_SCAN_LIMIT 16
+
+// QUERIES
+
+static size_t ph_next(mir_t* mir, size_t i) {
+    do { ++i; } while(i < mir->count && mir->insns[i].opcode == MIR_NOP);
+    return i;
+}
+
+// the next instruction when it is a machine one, labels and directives end the window
+static mir_insn_t* ph_next_insn(mir_t* mir, size_t i, size_t* index) {
+    size_t next = ph_next(mir, i);
+    if(index) *index = next;
+    if(next >= mir->count || !MIR_IS_INSN(mir->insns[next].opcode)) return NULL;
+    return &mir->insns[next];
+}
+
+static bool ph_is_label(mir_t* mir, size_t i) {
+    return i < mir->count && mir->insns[i].opcode == MIR_LABEL;
+}
+
+// size is that of the last operand, the one AT&T suffixes name, 0 for any
+static bool ph_is(mir_insn_t* insn, mir_opcode opcode, size_t operand_count, uint8_t size) {
+    if(!insn || insn->opcode != opcode || insn->operand_count != operand_count) return false;
+    return !size || insn->operands[operand_count - 1].size == size;
+}
+
+static void ph_set(mir_insn_t* insn, mir_opcode opcode, size_t operand_count, mir_operand_t first, mir_operand_t second) {
+    insn->opcode = opcode;
+    insn->operand_count = operand_count;
+    insn->operands[0] = first;
+    insn->operands[1] = second;
+}
+
+static bool ph_is_register(mir_operand_t* operand) {
+    return operand->kind == MIR_OPERAND_REG;
+}
+
+static bool ph_is_memory(mir_operand_t* operand) {
+    return operand->kind == MIR_OPERAND_MEM;
+}
+
+static bool ph_is_zero(mir_operand_t* operand) {
+    return operand->kind == MIR_OPERAND_IMM && !operand->symbol.name && operand->value == 0;
+}
+
+static bool ph_mentions_eax(mir_operand_t* operand) {
+    return mir_uses_reg(operand, MIR_AX);
+}
+
+// eax itself or rax
+static bool ph_is_eax(mir_operand_t* operand) {
+    return ph_is_register(operand) && operand->reg == MIR_AX && (operand->size == 4 || operand->size == 8);
+}
+
+static bool ph_is_exactly_eax(mir_operand_t* operand) {
+    return ph_is_register(operand) && operand->reg == MIR_AX && operand->size == 4;
+}
+
+// a jump to a label, not through a register
+static bool ph_is_direct(mir_insn_t* insn) {
+    return insn->operand_count == 1 && insn->operands[0].kind == MIR_OPERAND_LABEL;
+}
+
+// whether a label among those starting at j is the jump's target
+static bool ph_lands_at(mir_t* mir, size_t j, mir_label_t target) {
+    for(; ph_is_label(mir, j); j = ph_next(mir, j)) {
+        if(mir_label_equal(mir->insns[j].operands[0].symbol, target)) return true;
+    }
+    return false;
+}
+
+static bool ph_in_list(mir_opcode opcode, const mir_opcode* list) {
+    for(; *list != MIR_NOP; ++list) {
+        if(opcode == *list) return true;
+    }
+    return false;
+}
+
+// instructions reading or writing registers without naming them
+static const mir_opcode ph_implicit_ops[] = {
+    MIR_RET, MIR_CALL, MIR_SYSCALL, MIR_INT, MIR_PUSHA, MIR_POPA, MIR_CDQ, MIR_IDIV, MIR_DIV, MIR_RDTSC, MIR_REPE_CMPSB, MIR_NOP
+};
+
+// moves writing their last operand without reading it
+static const mir_opcode ph_move_ops[] = {
+    MIR_MOV, MIR_MOVZB, MIR_MOVSL, MIR_LEA, MIR_POP, MIR_NOP
+};
+
+// whether eax is overwritten before anything reads it after instruction i
+static bool ph_eax_dead(mir_t* mir, size_t i) {
+    for(size_t n = 0; n < PH_SCAN_LIMIT; ++n) {
+        mir_insn_t* insn = ph_next_insn(mir, i, &i);
+        if(!insn || insn->opcode == MIR_JMP || insn->opcode == MIR_JCC || ph_in_list(insn->opcode, ph_implicit_ops)) return false;
+        // the one operand multiply takes eax as the other
+        if(insn->opcode == MIR_IMUL && insn->operand_count == 1) return false;
+        if(!insn->operand_count) continue;
+
+        mir_operand_t* dest = &insn->operands[insn->operand_count - 1];
+        if(ph_is(insn, MIR_XOR, 2, 0) && ph_is_eax(&insn->operands[0]) && ph_is_eax(dest)) return true;
+        if(ph_in_list(insn->opcode, ph_move_ops) && ph_is_eax(dest)) {
+            bool reads = false;
+            for(size_t a = 0; a + 1 < insn->operand_count; ++a) reads |= ph_mentions_eax(&insn->operands[a]);
+            return !reads;
+        }
+        for(size_t a = 0; a < insn->operand_count; ++a) {
+            if(ph_mentions_eax(&insn->operands[a])) return false;
+        }
+    }
+    return false;
+}
+
+static const mir_opcode ph_flag_writers[] = {
+    MIR_CMP, MIR_TEST, MIR_ADD, MIR_SUB, MIR_AND, MIR_OR, MIR_XOR, MIR_NEG, MIR_IMUL,
+    MIR_SHL, MIR_SAR, MIR_SHR, MIR_RET, MIR_CALL, MIR_NOP
+};
+
+static const mir_opcode ph_flag_neutral[] = {
+    MIR_MOV, MIR_MOVZB, MIR_MOVSL, MIR_LEA, MIR_PUSH, MIR_POP, MIR_LEAVE, MIR_NOT, MIR_NOP
+};
+
+bool ph_flags_dead(mir_t* mir, size_t i) {
+    for(size_t n = 0; n < PH_SCAN_LIMIT; ++n) {
+        mir_insn_t* insn = ph_next_insn(mir, i, &i);
+        if(!insn) return false;
+        if(ph_in_list(insn->opcode, ph_flag_writers)) return true;
+        if(!ph_in_list(insn->opcode, ph_flag_neutral)) return false;
+    }
+    return false;
+}
+
+// RULES, each is tried with its window starting at instruction i
+
+// jmp L followed by L:
+static bool ph_jump_to_next(mir_t* mir, size_t i) {
+    mir_insn_t* insn = &mir->insns[i];
+    if(insn->opcode != MIR_JMP || !ph_is_direct(insn)) return false;
+    if(!ph_lands_at(mir, ph_next(mir, i), insn->operands[0].symbol)) return false;
+    insn->opcode = MIR_NOP;
+    return true;
+}
+
+// jCC L1, jmp L2, L1:  becomes  j!CC L2, L1:
+static bool ph_branch_over_jump(mir_t* mir, size_t i) {
+    mir_insn_t* branch = &mir->insns[i];
+    if(branch->opcode != MIR_JCC || !ph_is_direct(branch)) return false;
+    size_t j;
+    mir_insn_t* jump = ph_next_insn(mir, i, &j);
+    if(!jump || jump->opcode != MIR_JMP || !ph_is_direct(jump)) return false;
+    if(!ph_lands_at(mir, ph_next(mir, j), branch->operands[0].symbol)) return false;
+
+    branch->cc = MIR_CC_INVERSE(branch->cc);
+    branch->operands[0] = jump->operands[0];
+    jump->opcode = MIR_NOP;
+    return true;
+}
+
+// instructions after a jmp or ret that no label leads to
+static bool ph_unreachable(mir_t* mir, size_t i) {
+    mir_opcode opcode = mir->insns[i].opcode;
+    if(opcode != MIR_JMP && opcode != MIR_RET) return false;
+    bool fired = false;
+    mir_insn_t* next;
+    while((next = ph_next_insn(mir, i, NULL))) {
+        next->opcode = MIR_NOP;
+        fired = true;
+    }
+    return fired;
+}
+
+static bool ph_move_self(mir_t* mir, size_t i) {
+    mir_insn_t* insn = &mir->insns[i];
+    if(!ph_is(insn, MIR_MOV, 2, 4) && !ph_is(insn, MIR_MOV, 2, 8)) return false;
+    if(!ph_is_register(&insn->operands[0]) || !mir_operand_equal(&insn->operands[0], &insn->operands[1])) return false;
+    insn->opcode = MIR_NOP;
+    return true;
+}
+
+// push A, pop B  becomes  mov A, B
+static bool ph_push_pop(mir_t* mir, size_t i) {
+    mir_insn_t* push = &mir->insns[i];
+    if(!ph_is(push, MIR_PUSH, 1, 0)) return false;
+    mir_insn_t* pop = ph_next_insn(mir, i, NULL);
+    if(!ph_is(pop, MIR_POP, 1, 0)) return false;
+    if(ph_is_memory(&push->operands[0]) && ph_is_memory(&pop->operands[0])) return false;
+
+    pop->opcode = MIR_NOP;
+    if(mir_operand_equal(&push->operands[0], &pop->operands[0]))
+        push->opcode = MIR_NOP;
+    else
+        ph_set(push, MIR_MOV, 2, push->operands[0], pop->operands[0]);
+    return true;
+}
+
+// mov A, B, mov B, A  drops the second
+static bool ph_store_reload(mir_t* mir, size_t i) {
+    mir_insn_t* store = &mir->insns[i];
+    if(!ph_is(store, MIR_MOV, 2, 4)) return false;
+    mir_insn_t* load = ph_next_insn(mir, i, NULL);
+    if(!ph_is(load, MIR_MOV, 2, 4)) return false;
+    if(!mir_operand_equal(&store->operands[0], &load->operands[1]) || !mir_operand_equal(&store->operands[1], &load->operands[0])) return false;
+    // the store must not have moved what A is addressed by
+    if(ph_is_register(&store->operands[1]) && mir_uses_reg(&store->operands[0], store->operands[1].reg)) return false;
+    load->opcode = MIR_NOP;
+    return true;
+}
+
+// movl S, %eax, movl %eax, D  becomes  movl S, D  when eax is overwritten next
+static bool ph_forward_accumulator(mir_t* mir, size_t i) {
+    mir_insn_t* load = &mir->insns[i];
+    if(!ph_is(load, MIR_MOV, 2, 4) || !ph_is_exactly_eax(&load->operands[1]) || ph_mentions_eax(&load->operands[0])) return false;
+    size_t j;
+    mir_insn_t* store = ph_next_insn(mir, i, &j);
+    if(!ph_is(store, MIR_MOV, 2, 4) || !ph_is_exactly_eax(&store->operands[0]) || ph_mentions_eax(&store->operands[1])) return false;
+    if(ph_is_memory(&load->operands[0]) && ph_is_memory(&store->operands[1])) return false;
+    if(!ph_eax_dead(mir, j)) return false;
+
+    load->operands[1] = store->operands[1];
+    store->opcode = MIR_NOP;
+    return true;
+}
+
+static const mir_opcode ph_immediate_ops[] = { MIR_CMP, MIR_ADD, MIR_SUB, MIR_AND, MIR_OR, MIR_XOR, MIR_NOP };
+
+// movl $N, %eax, OP %eax, D  becomes  OP $N, D  when eax is overwritten next
+static bool ph_immediate_operand(mir_t* mir, size_t i) {
+    mir_insn_t* load = &mir->insns[i];
+    if(!ph_is(load, MIR_MOV, 2, 4) || load->operands[0].kind != MIR_OPERAND_IMM || !ph_is_exactly_eax(&load->operands[1])) return false;
+    size_t j;
+    mir_insn_t* use = ph_next_insn(mir, i, &j);
+    if(!use || use->operand_count != 2 || use->operands[1].size != 4 || !ph_in_list(use->opcode, ph_immediate_ops)) return false;
+    if(!ph_is_exactly_eax(&use->operands[0]) || ph_mentions_eax(&use->operands[1])) return false;
+    if(!ph_eax_dead(mir, j)) return false;
+
+    use->operands[0] = load->operands[0];
+    load->opcode = MIR_NOP;
+    return true;
+}
+
+// cmpl $0, R  becomes  testl R, R, the flags come out the same
+static bool ph_test_zero(mir_t* mir, size_t i) {
+    mir_insn_t* insn = &mir->insns[i];
+    if(!ph_is(insn, MIR_CMP, 2, 4) || !ph_is_zero(&insn->operands[0]) || !ph_is_register(&insn->operands[1])) return false;
+    ph_set(insn, MIR_TEST, 2, insn->operands[1], insn->operands[1]);
+    return true;
+}
+
+// cmp, movl $0, %eax, setCC %al  zeroes eax with xorl ahead of the compare,
+// or widens the result afterwards when the compare reads eax
+static bool ph_setcc_zero(mir_t* mir, size_t i) {
+    mir_insn_t* compare = &mir->insns[i];
+    if(!ph_is(compare, MIR_CMP, 2, 4) && !ph_is(compare, MIR_TEST, 2, 4)) return false;
+    size_t j;
+    mir_insn_t* zero = ph_next_insn(mir, i, &j);
+    if(!ph_is(zero, MIR_MOV, 2, 4) || !ph_is_zero(&zero->operands[0]) || !ph_is_exactly_eax(&zero->operands[1])) return false;
+    mir_insn_t* set = ph_next_insn(mir, j, NULL);
+    mir_operand_t al = mir_reg(MIR_AX, 1);
+    if(!ph_is(set, MIR_SETCC, 1, 0) || !mir_operand_equal(&set->operands[0], &al)) return false;
+
+    mir_operand_t eax = mir_reg(MIR_AX, 4);
+    if(!ph_mentions_eax(&compare->operands[0]) && !ph_mentions_eax(&compare->operands[1])) {
+        *zero = *compare;
+        ph_set(compare, MIR_XOR, 2, eax, eax);
+    } else {
+        *zero = *set;
+        ph_set(set, MIR_MOVZB, 2, al, eax);
+    }
+    return true;
+}
+
+// movl $0, R  becomes  xorl R, R  when nothing reads the flags it clobbers
+static bool ph_zero_xor(mir_t* mir, size_t i) {
+    mir_insn_t* insn = &mir->insns[i];
+    if(!ph_is(insn, MIR_MOV, 2, 4) || !ph_is_zero(&insn->operands[0]) || !ph_is_register(&insn->operands[1])) return false;
+    if(!ph_flags_dead(mir, i)) return false;
+    ph_set(insn, MIR_XOR, 2, insn->operands[1], insn->operands[1]);
+    return true;
+}
+
+// addl $1, R  becomes  incl R, and the same for decl, when nothing reads the
+// carry they leave alone
+static bool ph_inc_dec(mir_t* mir, size_t i) {
+    mir_insn_t* insn = &mir->insns[i];
+    if(!ph_is(insn, MIR_ADD, 2, 0) && !ph_is(insn, MIR_SUB, 2, 0)) return false;
+    mir_operand_t* amount = &insn->operands[0];
+    if(amount->kind != MIR_OPERAND_IMM || amount->symbol.name || (amount->value != 1 && amount->value != -1)) return false;
+    if(!ph_flags_dead(mir, i)) return false;
+    bool up = (insn->opcode == MIR_ADD) == (amount->value == 1);
+    ph_set(insn, up ? MIR_INC : MIR_DEC, 1, insn->operands[1], insn->operands[1]);
+    return true;
+}
+
+typedef bool (*ph_rule_fn)(mir_t* mir, size_t i);
+
+static const ph_rule_fn ph_rules[PH_RULE_COUNT] = {
+    ph_jump_to_next,
+    ph_branch_over_jump,
+    ph_unreachable,
+    ph_move_self,
+    ph_push_pop,
+    ph_store_reload,
+    ph_forward_accumulator,
+    ph_immediate_operand,
+    ph_test_zero,
+    ph_setcc_zero,
+    ph_zero_xor,
+    ph_inc_dec
+};
+
+void ph_optimize(mir_t* mir, bool optimize_size, ph_stats_t* stats) {
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t i = 0; i < mir->count; ++i) {
+            for(size_t r = 0; r < PH_RULE_COUNT && MIR_IS_INSN(mir->insns[i].opcode); ++r) {
+                if(PH_SIZE_ONLY(r) && !optimize_size) continue;
+                if(!ph_rules[r](mir, i)) continue;
+                if(stats) stats->fired[r]++;
+                changed = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "fwd.h"
+#include "mir.h"
+
+// Rules rewriting a short window of the emitted instructions, tried at every
+// instruction until none of them fires. Windows never reach across a label, except
+// to see where a jump lands.
+#define PH_RULE_LIST(__item, _uargs) \
+    __item(JUMP_TO_NEXT, _uargs) \
+    __item(BRANCH_OVER_JUMP, _uargs) \
+    __item(UNREACHABLE, _uargs) \
+    __item(MOVE_SELF, _uargs) \
+    __item(PUSH_POP, _uargs) \
+    __item(STORE_RELOAD, _uargs) \
+    __item(FORWARD_ACCUMULATOR, _uargs) \
+    __item(IMMEDIATE_OPERAND, _uargs) \
+    __item(TEST_ZERO, _uargs) \
+    __item(SETCC_ZERO, _uargs) \
+    __item(ZERO_XOR, _uargs) \
+    __item(INC_DEC, _uargs)
+
+enum ph_rule_e {
+    PH_RULE_LIST(ENUM_LIST_ITEM, PH_)
+    PH_RULE_COUNT
+};
+typedef enum ph_rule_e ph_rule;
+
+extern const char* ph_rule_names[PH_RULE_COUNT];
+
+typedef struct ph_stats_s {
+    size_t fired[PH_RULE_COUNT];
+} ph_stats_t;
+
+// rules only worth it for size, slower on some cores
+#define PH_SIZE_ONLY(_rule) ((_rule) == PH_INC_DEC)
+
+// whether the flags are written before anything reads them after instruction i,
+// looking no further than the next label
+bool ph_flags_dead(mir_t* mir, size_t i);
+
+// rewrite the instructions in place, deleted ones become MIR_NOP
+void ph_optimize(mir_t* mir, bool optimize_size, ph_stats_t* stats);
+
+#endif
@@ -0,0 +1,462 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "profile.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// share of the hottest function's calls a function needs to count as hot
+#define PROFILE_HOT_DIVISOR 16
+
+// NUMBERING
+
+static void profile_number_exp(profile_t* profile, node_exp_t* exp);
+
+static void profile_number_factor(profile_t* profile, node_factor_t* factor) {
+    if(factor->type == FACTOR_PAREN) {
+        profile_number_exp(profile, factor->exp);
+    } else if(factor->type == FACTOR_UNARY_OP) {
+        profile_number_factor(profile, factor->factor);
+    } else if(factor->type == FACTOR_CALL) {
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next)
+            profile_number_exp(profile, arg);
+    }
+}
+
+static void profile_number_term(profile_t* profile, node_term_t* term) {
+    profile_number_factor(profile, term->factor);
+    for(node_term_subterm_t* sub = term->subterms; sub; sub = sub->next)
+        profile_number_factor(profile, sub->factor);
+}
+
+static void profile_number_sum(profile_t* profile, node_exp_sum_t* sum) {
+    profile_number_term(profile, sum->term);
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub; sub = sub->next)
+        profile_number_term(profile, sub->term);
+}
+
+static void profile_number_relation(profile_t* profile, node_exp_relation_t* relation) {
+    profile_number_sum(profile, relation->sum);
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub; sub = sub->next)
+        profile_number_sum(profile, sub->sum);
+}
+
+static void profile_number_equals(profile_t* profile, node_exp_equals_t* equals) {
+    profile_number_relation(profile, equals->relation);
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub; sub = sub->next)
+        profile_number_relation(profile, sub->relation);
+}
+
+static void profile_number_and(profile_t* profile, node_exp_and_t* and) {
+    if(and->subexps) {
+        and->equals->probe = ++profile->probe_count;
+        for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next)
+            sub->equals->probe = ++profile->probe_count;
+    }
+
+    profile_number_equals(profile, and->equals);
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next)
+        profile_number_equals(profile, sub->equals);
+}
+
+static void profile_number_exp(profile_t* profile, node_exp_t* exp) {
+    if(exp->subexps) {
+        exp->and_exp->probe = ++profile->probe_count;
+        for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next)
+            sub->and_exp->probe = ++profile->probe_count;
+    }
+
+    profile_number_and(profile, exp->and_exp);
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next)
+        profile_number_and(profile, sub->and_exp);
+}
+
+static void profile_number_statement(profile_t* profile, node_stat_t* stat) {
+    if(stat->type == STAT_SWITCH || stat->type == STAT_CASE || stat->type == STAT_DEFAULT)
+        stat->probe = ++profile->probe_count;
+    if(stat->exp) profile_number_exp(profile, stat->exp);
+
+    if(stat->type == STAT_BLOCK) {
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next)
+            profile_number_statement(profile, sub);
+    } else if(stat->type == STAT_SWITCH) {
+        profile_number_statement(profile, stat->stat);
+    }
+}
+
+profile_t* profile_number(program_t* program) {
+    assert(program);
+
+    profile_t* profile;
+    ZMALLOC(profile_t, profile);
+
+    size_t count = 0;
+    for(node_t* curr = program->root->functions; curr; curr = curr->next) count++;
+    profile->funcs = (profile_func_t*)calloc(count + 1, sizeof(profile_func_t));
+
+    for(node_t* curr = program->root->functions; curr; curr = curr->next) {
+        node_func_t* func = (node_func_t*)curr;
+        profile_func_t* entry = &profile->funcs[profile->func_count++];
+        entry->name = strdup(func->function_name);
+        entry->first = profile->probe_count + 1;
+
+        func->probe = ++profile->probe_count;
+        profile_number_statement(profile, func->stat);
+        entry->count = profile->probe_count + 1 - entry->first;
+    }
+
+    return profile;
+}
+
+void free_profile(profile_t* profile) {
+    assert(profile);
+
+    for(size_t i = 0; i < profile->func_count; ++i)
+        free(profile->funcs[i].name);
+    free(profile->funcs);
+    free(profile->counters);
+    free(profile);
+}
+
+// LOADING
+
+static bool profile_read_u32(FILE* fp, uint32_t* out) {
+    unsigned char bytes[4];
+    if(fread(bytes, 1, 4, fp) != 4) return false;
+    *out = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    return true;
+}
+
+bool profile_load(profile_t* profile, const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if(!fp) {
+        printf("Failed to open profile %s\n", path);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    // every function has a probe and every probe two counters in the file,
+    // counts beyond that are not allocated for
+    char magic[sizeof(PROFILE_MAGIC) - 1];
+    uint32_t probe_count, func_count;
+    if(fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, PROFILE_MAGIC, sizeof(magic)) != 0 ||
+        !profile_read_u32(fp, &probe_count) || !profile_read_u32(fp, &func_count) ||
+        16 * (uint64_t)probe_count > (uint64_t)size || func_count > probe_count + (uint64_t)1) {
+        printf("Invalid profile %s\n", path);
+        fclose(fp);
+        return false;
+    }
+
+    // the header names every function and its probes, the counters follow it
+    profile_func_t* file_funcs = (profile_func_t*)calloc(func_count + 1, sizeof(profile_func_t));
+    bool success = true, invalid = false;
+    uint32_t loaded = 0;
+    for(uint32_t i = 0; i < func_count && success; ++i) {
+        uint32_t len, first = 0, count = 0;
+        success = profile_read_u32(fp, &len) && len < 4096;
+        if(!success) break;
+
+        file_funcs[i].name = (char*)calloc(len + 1, 1);
+        loaded++;
+        success = fread(file_funcs[i].name, 1, len, fp) == len &&
+            profile_read_u32(fp, &first) && profile_read_u32(fp, &count);
+        // probes are numbered from 1
+        invalid = success && (first < 1 || first + (uint64_t)count > probe_count + (uint64_t)1);
+        if(invalid) success = false;
+        file_funcs[i].first = first;
+        file_funcs[i].count = count;
+    }
+
+    uint64_t* file_counters = (uint64_t*)calloc(2 * (size_t)probe_count + 1, sizeof(uint64_t));
+    if(success) {
+        unsigned char bytes[8];
+        for(size_t i = 0; i < 2 * (size_t)probe_count && success; ++i) {
+            success = fread(bytes, 1, 8, fp) == 8;
+            for(int b = 7; b >= 0; --b) file_counters[i] = file_counters[i] << 8 | bytes[b];
+        }
+    }
+    fclose(fp);
+
+    if(invalid) printf("Invalid profile %s\n", path);
+    else if(!success) printf("Truncated profile %s\n", path);
+
+    free(profile->counters);
+    profile->counters = (uint64_t*)calloc(2 * profile->probe_count + 2, sizeof(uint64_t));
+    profile->max_calls = 0;
+    for(size_t i = 0; i < profile->func_count && success; ++i) {
+        profile_func_t* func = &profile->funcs[i];
+
+        size_t j = 0;
+        while(j < func_count && strcmp(file_funcs[j].name, func->name) != 0) ++j;
+        if(j == func_count) continue;
+        if(file_funcs[j].count != func->count) {
+            printf("Profile for %s does not match the source, ignoring it\n", func->name);
+            continue;
+        }
+
+        memcpy(&profile->counters[2 * (func->first - 1)], &file_counters[2 * (file_funcs[j].first - 1)],
+            2 * func->count * sizeof(uint64_t));
+        uint64_t calls = profile->counters[2 * (func->first - 1)];
+        if(calls > profile->max_calls) profile->max_calls = calls;
+    }
+
+    for(uint32_t i = 0; i < loaded; ++i) free(file_funcs[i].name);
+    free(file_funcs);
+    free(file_counters);
+    return success;
+}
+
+bool profile_counts(profile_t* profile, size_t probe, uint64_t* first, uint64_t* second) {
+    if(!profile || !profile->counters || !probe || probe > profile->probe_count) return false;
+
+    *first = profile->counters[2 * (probe - 1)];
+    *second = profile->counters[2 * (probe - 1) + 1];
+    return true;
+}
+
+bool profile_true_percent(profile_t* profile, size_t probe, int* percent) {
+    uint64_t evaluated, taken;
+    if(!profile_counts(profile, probe, &evaluated, &taken) || !evaluated) return false;
+
+    *percent = (int)(taken * 100 / evaluated);
+    return true;
+}
+
+bool profile_is_cold(profile_t* profile, node_func_t* func) {
+    uint64_t calls, unused;
+    return profile_counts(profile, func->probe, &calls, &unused) && profile->max_calls && !calls;
+}
+
+bool profile_is_hot(profile_t* profile, node_func_t* func) {
+    uint64_t calls, unused;
+    return profile_counts(profile, func->probe, &calls, &unused) && calls &&
+        calls >= profile->max_calls / PROFILE_HOT_DIVISOR;
+}
+
+// REORDERING
+
+// operands that neither trap nor call out may be evaluated in any order, the
+// cost walk counts their factors and gives 0 for everything else
+
+static size_t profile_cost_exp(node_exp_t* exp);
+
+static size_t profile_cost_factor(node_factor_t* factor) {
+    size_t cost;
+    switch(factor->type) {
+    case FACTOR_CONST:
+    case FACTOR_VARIABLE:
+        return 1;
+    case FACTOR_UNARY_OP:
+        cost = profile_cost_factor(factor->factor);
+        return cost ? cost + 1 : 0;
+    case FACTOR_PAREN:
+        return profile_cost_exp(factor->exp);
+    default:
+        return 0;
+    }
+}
+
+static size_t profile_cost_term(node_term_t* term) {
+    size_t total = profile_cost_factor(term->factor);
+    for(node_term_subterm_t* sub = term->subterms; sub && total; sub = sub->next) {
+        size_t cost = profile_cost_factor(sub->factor);
+        total = cost && sub->operator != OPERATOR_DIVID ? total + cost : 0;
+    }
+    return total;
+}
+
+static size_t profile_cost_sum(node_exp_sum_t* sum) {
+    size_t total = profile_cost_term(sum->term);
+    for(node_exp_sum_subexp_t* sub = sum->subexps; sub && total; sub = sub->next) {
+        size_t cost = profile_cost_term(sub->term);
+        total = cost ? total + cost : 0;
+    }
+    return total;
+}
+
+static size_t profile_cost_relation(node_exp_relation_t* relation) {
+    size_t total = profile_cost_sum(relation->sum);
+    for(node_exp_relation_subexp_t* sub = relation->subexps; sub && total; sub = sub->next) {
+        size_t cost = profile_cost_sum(sub->sum);
+        total = cost ? total + cost : 0;
+    }
+    return total;
+}
+
+size_t profile_cost_equals(node_exp_equals_t* equals) {
+    size_t total = profile_cost_relation(equals->relation);
+    for(node_exp_equals_subexp_t* sub = equals->subexps; sub && total; sub = sub->next) {
+        size_t cost = profile_cost_relation(sub->relation);
+        total = cost ? total + cost : 0;
+    }
+    return total;
+}
+
+size_t profile_cost_and(node_exp_and_t* and) {
+    size_t total = profile_cost_equals(and->equals);
+    for(node_exp_and_subexp_t* sub = and->subexps; sub && total; sub = sub->next) {
+        size_t cost = profile_cost_equals(sub->equals);
+        total = cost ? total + cost : 0;
+    }
+    return total;
+}
+
+static size_t profile_cost_exp(node_exp_t* exp) {
+    size_t total = profile_cost_and(exp->and_exp);
+    for(node_exp_subexp_t* sub = exp->subexps; sub && total; sub = sub->next) {
+        size_t cost = profile_cost_and(sub->and_exp);
+        total = cost ? total + cost : 0;
+    }
+    return total;
+}
+
+typedef struct profile_operand_s {
+    void* node;
+    // 0 pins the operand in place
+    size_t cost;
+    // chance per mille the operand decides the chain, per factor it costs
+    uint64_t rank;
+} profile_operand_t;
+
+typedef struct profile_walk_s {
+    profile_t* profile;
+    size_t reordered;
+} profile_walk_t;
+
+static void profile_rank_operand(profile_t* profile, profile_operand_t* operand, size_t probe, bool decides_when_true) {
+    uint64_t evaluated, taken;
+    if(!operand->cost || !profile_counts(profile, probe, &evaluated, &taken) || !evaluated) {
+        operand->cost = 0;
+        return;
+    }
+
+    uint64_t decided = decides_when_true ? taken : evaluated - taken;
+    operand->rank = decided * 1000 / evaluated * 16 / operand->cost;
+}
+
+// sort each run of movable operands by rank, a pinned operand keeps its place
+// and its side effects stay ordered against everything around it
+static bool profile_sort_runs(profile_operand_t* operands, size_t count) {
+    bool changed = false;
+    for(size_t start = 0; start < count;) {
+        size_t end = start;
+        while(end < count && operands[end].cost) ++end;
+
+        // insertion sort keeps equal ranks in source order
+        for(size_t i = start + 1; i < end; ++i) {
+            profile_operand_t operand = operands[i];
+            size_t j = i;
+            for(; j > start && operands[j - 1].rank < operand.rank; --j) {
+                operands[j] = operands[j - 1];
+                changed = true;
+            }
+            operands[j] = operand;
+        }
+        start = end + 1;
+    }
+    return changed;
+}
+
+// an && chain is decided by its first false operand
+static void profile_reorder_and(profile_walk_t* walk, node_exp_and_t* and) {
+    if(!and->subexps) return;
+
+    size_t count = 1;
+    for(node_exp_and_subexp_t* sub = and->subexps; sub; sub = sub->next) count++;
+
+    profile_operand_t* operands = (profile_operand_t*)calloc(count, sizeof(profile_operand_t));
+    node_exp_and_subexp_t* sub = and->subexps;
+    for(size_t i = 0; i < count; ++i) {
+        node_exp_equals_t* equals = and->equals;
+        if(i) { equals = sub->equals; sub = sub->next; }
+
+        operands[i].node = equals;
+        operands[i].cost = profile_cost_equals(equals);
+        profile_rank_operand(walk->profile, &operands[i], equals->probe, false);
+    }
+
+    if(profile_sort_runs(operands, count)) {
+        walk->reordered++;
+        and->equals = (node_exp_equals_t*)operands[0].node;
+        sub = and->subexps;
+        for(size_t i = 1; i < count; ++i, sub = sub->next) sub->equals = (node_exp_equals_t*)operands[i].node;
+    }
+    free(operands);
+}
+
+// an || chain is decided by its first true operand
+static void profile_reorder_exp(profile_walk_t* walk, node_exp_t* exp) {
+    if(exp->subexps) {
+        size_t count = 1;
+        for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next) count++;
+
+        profile_operand_t* operands = (profile_operand_t*)calloc(count, sizeof(profile_operand_t));
+        node_exp_subexp_t* sub = exp->subexps;
+        for(size_t i = 0; i < count; ++i) {
+            node_exp_and_t* and = exp->and_exp;
+            if(i) { and = sub->and_exp; sub = sub->next; }
+
+            operands[i].node = and;
+            operands[i].cost = profile_cost_and(and);
+            profile_rank_operand(walk->profile, &operands[i], and->probe, true);
+        }
+
+        if(profile_sort_runs(operands, count)) {
+            walk->reordered++;
+            exp->and_exp = (node_exp_and_t*)operands[0].node;
+            sub = exp->subexps;
+            for(size_t i = 1; i < count; ++i, sub = sub->next) sub->and_exp = (node_exp_and_t*)operands[i].node;
+        }
+        free(operands);
+    }
+
+    profile_reorder_and(walk, exp->and_exp);
+    for(node_exp_subexp_t* sub = exp->subexps; sub; sub = sub->next)
+        profile_reorder_and(walk, sub->and_exp);
+}
+
+// nested expressions are reached through the factors holding them
+static void profile_reorder_factor(node_factor_t* factor, void* ctx) {
+    profile_walk_t* walk = (profile_walk_t*)ctx;
+    if(factor->type == FACTOR_PAREN) {
+        profile_reorder_exp(walk, factor->exp);
+    } else if(factor->type == FACTOR_CALL) {
+        for(node_exp_t* arg = factor->args; arg; arg = (node_exp_t*)arg->node.next)
+            profile_reorder_exp(walk, arg);
+    }
+}
+
+static void profile_reorder_statement(profile_walk_t* walk, node_stat_t* stat) {
+    if(stat->exp) profile_reorder_exp(walk, stat->exp);
+
+    if(stat->type == STAT_BLOCK) {
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next)
+            profile_reorder_statement(walk, sub);
+    } else if(stat->type == STAT_SWITCH) {
+        profile_reorder_statement(walk, stat->stat);
+    }
+}
+
+size_t profile_reorder(program_t* program, profile_t* profile) {
+    assert(program && profile);
+
+    profile_walk_t walk = { profile, 0 };
+    if(!profile->counters) return 0;
+
+    for(node_t* curr = program->root->functions; curr; curr = curr->next) {
+        node_func_t* func = (node_func_t*)curr;
+        if(!func->stat) continue;
+
+        profile_reorder_statement(&walk, func->stat);
+        visit_statement_factors(func->stat, profile_reorder_factor, &walk);
+    }
+    return walk.reordered;
+}
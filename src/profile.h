@@ -0,0 +1,57 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "program.h"
+
+// Probes are numbered on the merged program before it is optimized, so an
+// instrumented build and a build using its profile agree on them. Every probe
+// owns two 64 bit counters:
+//   function entry       calls, unused
+//   && or || operand     evaluations, times it was true
+//   case, default, end   dispatches to it, unused
+
+#define PROFILE_MAGIC "HCCPROF1"
+
+typedef struct profile_func_s {
+    char* name;
+    size_t first;
+    size_t count;
+} profile_func_t;
+
+typedef struct profile_s {
+    profile_func_t* funcs;
+    size_t func_count;
+    // probes are numbered from 1, 0 means no probe
+    size_t probe_count;
+
+    // two per probe, NULL until a profile is loaded
+    uint64_t* counters;
+    uint64_t max_calls;
+} profile_t;
+
+profile_t* profile_number(program_t* program);
+void free_profile(profile_t* profile);
+
+// read counters written by an instrumented build, functions whose probes
+// no longer match are left without counts
+bool profile_load(profile_t* profile, const char* path);
+
+bool profile_counts(profile_t* profile, size_t probe, uint64_t* first, uint64_t* second);
+// probability in percent that an && or || operand was true
+bool profile_true_percent(profile_t* profile, size_t probe, int* percent);
+bool profile_is_cold(profile_t* profile, node_func_t* func);
+bool profile_is_hot(profile_t* profile, node_func_t* func);
+
+// put && and || operands that are likely to decide the result first, where
+// no operand can trap or call out
+size_t profile_reorder(program_t* program, profile_t* profile);
+// factors an operand evaluates, 0 when it can trap or call out
+size_t profile_cost_equals(node_exp_equals_t* equals);
+size_t profile_cost_and(node_exp_and_t* and);
+
+#endif
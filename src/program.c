@@ -0,0 +1,286 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "program.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// open addressing table of function names, removed entries keep their name as a tombstone
+
+static size_t program_hash(const char* name) {
+    size_t hash = 14695981039346656037ull;
+    while(*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static program_symbol_t* program_find(program_t* program, const char* name) {
+    size_t mask = program->symbol_capacity - 1;
+    size_t i = program_hash(name) & mask;
+    while(program->symbols[i].name) {
+        if(strcmp(program->symbols[i].name, name) == 0) return &program->symbols[i];
+        i = (i + 1) & mask;
+    }
+    return &program->symbols[i];
+}
+
+static program_symbol_t* program_insert(program_t* program, const char* name) {
+    if((program->symbol_count + 1) * 2 > program->symbol_capacity) {
+        program_symbol_t* old = program->symbols;
+        size_t old_capacity = program->symbol_capacity;
+
+        program->symbol_capacity = old_capacity ? old_capacity * 2 : 64;
+        program->symbols = (program_symbol_t*)calloc(program->symbol_capacity, sizeof(program_symbol_t));
+        for(size_t i = 0; i < old_capacity; ++i) {
+            if(old[i].name) *program_find(program, old[i].name) = old[i];
+        }
+        free(old);
+    }
+
+    program_symbol_t* sym = program_find(program, name);
+    if(!sym->name) {
+        sym->name = strdup(name);
+        program->symbol_count++;
+    }
+    return sym;
+}
+
+typedef struct program_check_s {
+    program_t* program;
+    bool success;
+} program_check_t;
+
+static void program_check_call(node_factor_t* factor, void* ctx) {
+    program_check_t* check = (program_check_t*)ctx;
+    if(factor->type != FACTOR_CALL) return;
+
+    node_func_t* func = program_lookup(check->program, factor->name);
+    if(func && func->param_count != factor->arg_count) {
+        printf("Wrong number of arguments to %s\n", factor->name);
+        check->success = false;
+    }
+}
+
+// the labels of one switch, not of the switches inside it
+typedef struct program_labels_s {
+    int* values;
+    size_t count;
+    size_t capacity;
+    bool has_default;
+} program_labels_t;
+
+static int program_value_compare(const void* a, const void* b) {
+    int lhs = *(const int*)a, rhs = *(const int*)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+// labels and breaks must be inside a switch, each value and the default once per switch
+static bool program_check_labels(node_stat_t* stat, program_labels_t* labels, const char* name) {
+    switch(stat->type) {
+    case STAT_BLOCK: {
+        bool success = true;
+        for(node_stat_t* sub = stat->stats; sub; sub = (node_stat_t*)sub->node.next)
+            success = program_check_labels(sub, labels, name) && success;
+        return success;
+    }
+    case STAT_SWITCH: {
+        program_labels_t inner = { NULL, 0, 0, false };
+        bool success = program_check_labels(stat->stat, &inner, name);
+        qsort(inner.values, inner.count, sizeof(int), program_value_compare);
+        for(size_t i = 1; i < inner.count; ++i) {
+            if(inner.values[i] != inner.values[i - 1] || (i > 1 && inner.values[i] == inner.values[i - 2])) continue;
+            printf("Duplicate case value %d in %s\n", inner.values[i], name);
+            success = false;
+        }
+        free(inner.values);
+        return success;
+    }
+    case STAT_CASE:
+        if(!labels) {
+            printf("Case label outside of a switch in %s\n", name);
+            return false;
+        }
+        if(labels->count == labels->capacity) {
+            labels->capacity = labels->capacity ? labels->capacity * 2 : 16;
+            labels->values = (int*)realloc(labels->values, labels->capacity * sizeof(int));
+        }
+        labels->values[labels->count++] = stat->case_value;
+        return true;
+    case STAT_DEFAULT:
+        if(!labels) {
+            printf("Default label outside of a switch in %s\n", name);
+            return false;
+        }
+        if(labels->has_default) {
+            printf("Multiple default labels in one switch in %s\n", name);
+            return false;
+        }
+        labels->has_default = true;
+        return true;
+    case STAT_BREAK:
+        if(!labels) {
+            printf("Break outside of a switch in %s\n", name);
+            return false;
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+typedef struct program_local_s {
+    char** names;
+    size_t count;
+    size_t index;
+} program_local_t;
+
+static char* program_local_name(program_local_t* local, const char* name) {
+    for(size_t i = 0; i < local->count; ++i) {
+        if(strcmp(local->names[i], name) == 0) {
+            char* renamed = (char*)malloc(strlen(name) + 24);
+            sprintf(renamed, "%s.%lu", name, local->index);
+            return renamed;
+        }
+    }
+    return NULL;
+}
+
+static void program_local_call(node_factor_t* factor, void* ctx) {
+    if(factor->type != FACTOR_CALL) return;
+
+    char* renamed = program_local_name((program_local_t*)ctx, factor->name);
+    if(renamed) {
+        free(factor->name);
+        factor->name = renamed;
+    }
+}
+
+// static functions of different files may share a name, give each file its own
+static void program_localize(node_root_t* root, size_t index) {
+    program_local_t local = { NULL, 0, index };
+    for(node_t* curr = root->functions; curr; curr = curr->next) {
+        node_func_t* func = (node_func_t*)curr;
+        if(!func->is_static) continue;
+        local.names = (char**)realloc(local.names, (local.count + 1) * sizeof(char*));
+        local.names[local.count++] = strdup(func->function_name);
+    }
+    if(!local.count) return;
+
+    for(node_t* curr = root->functions; curr; curr = curr->next) {
+        node_func_t* func = (node_func_t*)curr;
+        if(func->stat) visit_statement_factors(func->stat, program_local_call, &local);
+    }
+
+    for(node_t* curr = root->functions; curr; curr = curr->next) {
+        node_func_t* func = (node_func_t*)curr;
+        char* name = program_local_name(&local, func->function_name);
+        if(!name) continue;
+
+        func->is_static = true;
+        free(func->function_name);
+        func->function_name = name;
+    }
+
+    for(size_t i = 0; i < local.count; ++i) free(local.names[i]);
+    free(local.names);
+}
+
+program_t* program_merge(node_root_t** roots, size_t count) {
+    program_t* program;
+    ZMALLOC(program_t, program);
+    ZMALLOC(node_root_t, program->root);
+    program->root->node.type = NODE_PROGRAM;
+
+    bool success = true;
+    node_t* last = NULL;
+    for(size_t r = 0; r < count; ++r) {
+        if(count > 1) program_localize(roots[r], r);
+
+        node_t* curr = roots[r]->functions;
+        roots[r]->functions = NULL;
+        free_root_node(roots[r]);
+
+        while(curr) {
+            node_t* next = curr->next;
+            node_func_t* func = (node_func_t*)curr;
+            curr->next = curr->prev = NULL;
+
+            program_symbol_t* sym = program_insert(program, func->function_name);
+            if(sym->func && sym->func->param_count != func->param_count) {
+                printf("Conflicting parameters for %s\n", func->function_name);
+                success = false;
+            }
+
+            if(!func->stat) {
+                // keep the first declaration until a definition shows up
+                if(sym->func) free_function(func);
+                else sym->func = func;
+            } else if(sym->func && sym->func->stat) {
+                printf("Multiple definitions of %s\n", func->function_name);
+                success = false;
+                free_function(func);
+            } else {
+                if(sym->func) free_function(sym->func);
+                sym->func = func;
+
+                if(last) {
+                    last->next = curr;
+                    curr->prev = last;
+                } else
+                    program->root->functions = curr;
+                last = curr;
+            }
+
+            curr = next;
+        }
+    }
+
+    // calls must agree with what they call
+    program_check_t check = { program, true };
+    for(node_t* curr = program->root->functions; curr; curr = curr->next)
+        visit_statement_factors(((node_func_t*)curr)->stat, program_check_call, &check);
+    success = success && check.success;
+    for(node_t* curr = program->root->functions; curr; curr = curr->next) {
+        node_func_t* func = (node_func_t*)curr;
+        success = program_check_labels(func->stat, NULL, func->function_name) && success;
+    }
+
+    if(!success) {
+        free_program(program);
+        return NULL;
+    }
+    return program;
+}
+
+void free_program(program_t* program) {
+    assert(program);
+
+    for(size_t i = 0; i < program->symbol_capacity; ++i) {
+        program_symbol_t* sym = &program->symbols[i];
+        // declarations are only owned by the table
+        if(sym->func && !sym->func->stat) free_function(sym->func);
+        free(sym->name);
+    }
+    free(program->symbols);
+
+    free_root_node(program->root);
+    free(program);
+}
+
+node_func_t* program_lookup(program_t* program, const char* name) {
+    if(!program->symbol_capacity) return NULL;
+    return program_find(program, name)->func;
+}
+
+void program_remove(program_t* program, const char* name) {
+    if(!program->symbol_capacity) return;
+    program_symbol_t* sym = program_find(program, name);
+    if(sym->name) sym->func = NULL;
+}
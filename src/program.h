@@ -0,0 +1,35 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "nodes.h"
+
+typedef struct program_symbol_s {
+    char* name;
+    // definition, or the first declaration while none is known
+    node_func_t* func;
+} program_symbol_t;
+
+typedef struct program_s {
+    // every function definition of the program, in input order
+    node_root_t* root;
+
+    program_symbol_t* symbols;
+    size_t symbol_count;
+    size_t symbol_capacity;
+} program_t;
+
+// Merge the parsed translation units into one program, taking ownership of the roots.
+// Declarations are checked against definitions and dropped, duplicate definitions fail.
+program_t* program_merge(node_root_t** roots, size_t count);
+void free_program(program_t* program);
+
+node_func_t* program_lookup(program_t* program, const char* name);
+// forget a function that has been unlinked from the root
+void program_remove(program_t* program, const char* name);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "regalloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// active intervals are kept sorted by end, so the first ones expire first
+static void ra_activate(ra_interval_t* intervals, size_t* active, size_t* active_count, size_t index) {
+    size_t i = *active_count;
+    while(i > 0 && intervals[active[i - 1]].end > intervals[index].end) {
+        active[i] = active[i - 1];
+        --i;
+    }
+    active[i] = index;
+    (*active_count)++;
+}
+
+// spilled values share stack slots once their intervals no longer overlap
+static void ra_assign_slots(ra_interval_t* intervals, size_t count, ra_result_t* result) {
+    size_t* slot_end = (size_t*)malloc(count * sizeof(size_t));
+    for(size_t i = 0; i < count; ++i) {
+        ra_interval_t* curr = &intervals[i];
+        if(curr->reg != RA_SPILLED) {
+            result->used |= RA_BIT(curr->reg);
+            continue;
+        }
+
+        size_t slot = 0;
+        while(slot < result->slots && slot_end[slot] > curr->start) ++slot;
+        if(slot == result->slots) result->slots++;
+        slot_end[slot] = curr->end;
+        curr->slot = slot;
+        result->spilled++;
+    }
+    free(slot_end);
+}
+
+void ra_linear_scan(ra_interval_t* intervals, size_t count, const int* pool, size_t pool_count, ra_result_t* result) {
+    memset(result, 0, sizeof(ra_result_t));
+    if(!count) return;
+
+    size_t* active = (size_t*)malloc(count * sizeof(size_t));
+    size_t active_count = 0;
+    for(size_t i = 0; i < count; ++i) {
+        ra_interval_t* curr = &intervals[i];
+        curr->reg = RA_SPILLED;
+        curr->slot = 0;
+
+        // drop the intervals that ended before this one starts
+        size_t expired = 0;
+        while(expired < active_count && intervals[active[expired]].end < curr->start) ++expired;
+        memmove(active, &active[expired], (active_count - expired) * sizeof(size_t));
+        active_count -= expired;
+
+        uint32_t busy = 0;
+        for(size_t a = 0; a < active_count; ++a) busy |= RA_BIT(intervals[active[a]].reg);
+        for(size_t p = 0; p < pool_count; ++p) {
+            uint32_t bit = RA_BIT(pool[p]);
+            if(!(busy & bit) && !(curr->clobbers & bit)) {
+                curr->reg = pool[p];
+                break;
+            }
+        }
+
+        // out of registers, the value used furthest away gives up its register
+        if(curr->reg == RA_SPILLED) {
+            for(size_t a = active_count; a > 0; --a) {
+                ra_interval_t* victim = &intervals[active[a - 1]];
+                if(victim->end <= curr->end) break;
+                if(curr->clobbers & RA_BIT(victim->reg)) continue;
+
+                curr->reg = victim->reg;
+                victim->reg = RA_SPILLED;
+                memmove(&active[a - 1], &active[a], (active_count - a) * sizeof(size_t));
+                active_count--;
+                break;
+            }
+        }
+
+        if(curr->reg != RA_SPILLED) ra_activate(intervals, active, &active_count, i);
+    }
+    free(active);
+
+    ra_assign_slots(intervals, count, result);
+}
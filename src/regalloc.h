@@ -0,0 +1,43 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Linear scan allocation of the temporaries holding the left operand of a
+// binary operator while the right one is evaluated. Registers are numbered by
+// the caller, who describes each temporary by where it is written and read
+// and which registers are overwritten in between.
+
+#define RA_SPILLED (-1)
+#define RA_BIT(_reg) ((uint32_t)1 << (_reg))
+
+typedef struct ra_interval_s {
+    // positions of the write and the last read
+    size_t start;
+    size_t end;
+    // registers written while the value is live
+    uint32_t clobbers;
+
+    // register given to the value, or RA_SPILLED with it kept in stack slot `slot`
+    int reg;
+    size_t slot;
+} ra_interval_t;
+
+typedef struct ra_result_s {
+    // registers some value was given
+    uint32_t used;
+    size_t slots;
+    size_t spilled;
+} ra_result_t;
+
+// intervals must be sorted by start, pool lists the registers in order of preference
+void ra_linear_scan(ra_interval_t* intervals, size_t count, const int* pool, size_t pool_count, ra_result_t* result);
+
+#endif
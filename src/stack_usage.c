@@ -0,0 +1,211 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "stack_usage.h"
+#include "dwarf.h"
+#include "buffer.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef enum su_mark_e {
+    SU_UNSEEN,
+    // on the chain of calls being summed, meeting it again is recursion
+    SU_CALLING,
+    SU_DONE
+} su_mark;
+
+typedef struct su_data_s {
+    mir_t* mir;
+    int64_t word;
+    su_mark* marks;
+    // deepest each function goes with everything it calls
+    int64_t* totals;
+    // a function that calls itself through the chain, the last called that
+    // is not in the program
+    const char* recursive;
+    const char* outside;
+} su_data_t;
+
+// the prologue pushes, sets the frame pointer and reserves the spill slots
+// before anything else is done
+static bool su_is_prologue(mir_insn_t* insn) {
+    mir_operand_t* src = &insn->operands[0];
+    mir_operand_t* dst = &insn->operands[insn->operand_count ? insn->operand_count - 1 : 0];
+    bool to_sp = dst->kind == MIR_OPERAND_REG && dst->reg == MIR_SP;
+    switch(insn->opcode) {
+    case MIR_GLOBL:
+        return true;
+    case MIR_LABEL:
+        return src->symbol.number == MIR_UNNUMBERED;
+    case MIR_PUSH:
+        return src->kind == MIR_OPERAND_REG;
+    case MIR_MOV:
+        return src->kind == MIR_OPERAND_REG && src->reg == MIR_SP;
+    case MIR_SUB:
+        return to_sp && src->kind == MIR_OPERAND_IMM;
+    default:
+        return false;
+    }
+}
+
+static void su_usage(mir_t* mir, mir_func_t* func, dw_frame_t* frames, su_usage_t* usage) {
+    usage->bytes = usage->frame = 0;
+    bool prologue = true;
+    for(size_t i = func->first; i < func->end; ++i) {
+        dw_frame_t* frame = &frames[i - func->first];
+        if(frame->reg == MIR_NO_REG) continue;
+        if(frame->depth > usage->bytes) usage->bytes = frame->depth;
+        if(prologue && !su_is_prologue(&mir->insns[i])) {
+            prologue = false;
+            usage->frame = frame->depth;
+        }
+    }
+    if(prologue) usage->frame = usage->bytes;
+}
+
+void su_function(mir_t* mir, mir_func_t* func, su_usage_t* usage) {
+    dw_frame_t* frames = (dw_frame_t*)malloc((func->end - func->first + 1) * sizeof(dw_frame_t));
+    dw_frames(mir, func, frames);
+    su_usage(mir, func, frames, usage);
+    free(frames);
+}
+
+// a function of the program, or the compiler's runtime from its label to the
+// end of the program, NULL when the symbol is defined somewhere else
+static mir_func_t* su_find(su_data_t* data, const char* name, mir_func_t* runtime) {
+    mir_t* mir = data->mir;
+    for(size_t i = 0; i < mir->func_count; ++i) {
+        if(strcmp(mir->funcs[i].name, name) == 0) return &mir->funcs[i];
+    }
+    for(size_t i = 0; i < mir->count; ++i) {
+        mir_insn_t* insn = &mir->insns[i];
+        if(insn->opcode != MIR_LABEL || insn->operands[0].symbol.number != MIR_UNNUMBERED) continue;
+        if(strcmp(insn->operands[0].symbol.name, name) != 0) continue;
+        memset(runtime, 0, sizeof(mir_func_t));
+        runtime->name = name;
+        runtime->first = i;
+        runtime->end = mir->count;
+        return runtime;
+    }
+    return NULL;
+}
+
+static int64_t su_total(su_data_t* data, mir_func_t* func);
+
+static bool su_defines(mir_t* mir, mir_func_t* func, mir_label_t label) {
+    for(size_t i = func->first; i < func->end; ++i) {
+        mir_insn_t* insn = &mir->insns[i];
+        if(insn->opcode == MIR_LABEL && mir_label_equal(insn->operands[0].symbol, label)) return true;
+    }
+    return false;
+}
+
+// the deepest a call from depth goes, -1 without a bound
+static int64_t su_call(su_data_t* data, const char* name, int64_t depth) {
+    mir_func_t runtime;
+    mir_func_t* callee = su_find(data, name, &runtime);
+    if(!callee) {
+        data->outside = name;
+        return depth;
+    }
+    if(callee == &runtime) {
+        int64_t total = su_total(data, callee);
+        return total < 0 ? -1 : depth + total;
+    }
+
+    size_t index = callee - data->mir->funcs;
+    if(data->marks[index] == SU_CALLING) {
+        data->recursive = callee->name;
+        return -1;
+    }
+    if(data->marks[index] == SU_UNSEEN) {
+        data->marks[index] = SU_CALLING;
+        data->totals[index] = su_total(data, callee);
+        data->marks[index] = SU_DONE;
+    }
+    return data->totals[index] < 0 ? -1 : depth + data->totals[index];
+}
+
+static int64_t su_total(su_data_t* data, mir_func_t* func) {
+    mir_t* mir = data->mir;
+    dw_frame_t* frames = (dw_frame_t*)malloc((func->end - func->first + 1) * sizeof(dw_frame_t));
+    dw_frames(mir, func, frames);
+    su_usage_t usage;
+    su_usage(mir, func, frames, &usage);
+    int64_t total = usage.bytes;
+
+    for(size_t i = func->first; i < func->end && total >= 0; ++i) {
+        mir_insn_t* insn = &mir->insns[i];
+        dw_frame_t* frame = &frames[i - func->first];
+        mir_operand_t* target = &insn->operands[0];
+        if(frame->reg == MIR_NO_REG || (insn->opcode != MIR_CALL && insn->opcode != MIR_JMP)) continue;
+        // labels numbered within the function are jumps and the call reading its
+        // address, the runtime also jumps to its own symbols
+        if(target->kind != MIR_OPERAND_LABEL || target->symbol.number != MIR_UNNUMBERED) continue;
+        if(insn->opcode == MIR_JMP && su_defines(mir, func, target->symbol)) continue;
+        // a tail call reuses the return address the callee counts
+        int64_t depth = frame->depth - (insn->opcode == MIR_JMP ? data->word : 0);
+        int64_t deepest = su_call(data, target->symbol.name, depth);
+        if(deepest < 0 || deepest > total) total = deepest;
+    }
+
+    free(frames);
+    return total;
+}
+
+bool su_report(mir_t* mir, const char* path) {
+    buf_t buf;
+    buf_init(&buf);
+    for(size_t i = 0; i < mir->func_count; ++i) {
+        mir_func_t* func = &mir->funcs[i];
+        if(!func->file) continue;
+        su_usage_t usage;
+        su_function(mir, func, &usage);
+        buf_puts(&buf, mir->files[func->file - 1]);
+        buf_putc(&buf, ':');
+        buf_put_uint(&buf, func->line, 0);
+        buf_putc(&buf, ':');
+        buf_put_uint(&buf, func->column, 0);
+        buf_putc(&buf, ':');
+        buf_puts(&buf, func->name);
+        buf_putc(&buf, '\t');
+        buf_put_int(&buf, usage.bytes);
+        buf_puts(&buf, usage.bytes > usage.frame ? "\tdynamic,bounded\n" : "\tstatic\n");
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool success = fd >= 0 && buf_flush(&buf, fd);
+    if(fd >= 0) close(fd);
+    free_buf(&buf);
+    if(!success) {
+        printf("Failed to write stack usage to %s\n", path);
+        return false;
+    }
+
+    su_data_t data;
+    memset(&data, 0, sizeof(su_data_t));
+    data.mir = mir;
+    data.word = mir->is_64 ? 8 : 4;
+    data.marks = (su_mark*)calloc(mir->func_count + 1, sizeof(su_mark));
+    data.totals = (int64_t*)calloc(mir->func_count + 1, sizeof(int64_t));
+    mir_func_t runtime;
+    mir_func_t* entry = su_find(&data, "main", &runtime);
+    if(entry && entry != &runtime) {
+        int64_t total = su_call(&data, "main", 0);
+        if(total < 0)
+            printf("Stack usage of main is unbounded, %s can call itself\n", data.recursive);
+        else if(data.outside)
+            printf("Stack usage of main is %ld bytes and whatever %s takes\n", total, data.outside);
+        else
+            printf("Stack usage of main is %ld bytes with everything it calls\n", total);
+    }
+    free(data.totals);
+    free(data.marks);
+    return true;
+}
@@ -0,0 +1,31 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef STACK_USAGE_H
+#define STACK_USAGE_H
+
+#include "fwd.h"
+#include "mir.h"
+
+// The most stack each function takes, from the depths dw_frames finds along
+// every path of its final instructions. Reported one function to a line the
+// way gcc's -fstack-usage writes its .su files, and summed along the calls
+// main makes into a bound for the whole program.
+
+typedef struct su_usage_s {
+    // most bytes the stack pointer gets below the caller's before its call,
+    // the return address included
+    int64_t bytes;
+    // bytes the prologue reserves, less than bytes when calls push arguments
+    int64_t frame;
+} su_usage_t;
+
+void su_function(mir_t* mir, mir_func_t* func, su_usage_t* usage);
+
+// write the usage of every function of the source to path and print how much
+// main takes with everything it calls
+bool su_report(mir_t* mir, const char* path);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "tune.h"
+
+#include <string.h>
+
+#define TUNE_COST(_latency, _uops, _throughput) { _latency, _uops, _throughput }
+
+static const tune_table_t tune_tables[] = {
+    // the mean of skylake, icelake, zen3 and zen4 below, halves rounded up to whole
+    // cycles, so no one of them decides alone
+    { "generic", {
+        [TUNE_ALU] = TUNE_COST(1, 1, 0.25f),
+        [TUNE_SHIFT] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_MOV] = TUNE_COST(0, 1, 0.21f),
+        [TUNE_LEA_SCALED] = TUNE_COST(2, 1, 0.5f),
+        [TUNE_IMUL] = TUNE_COST(3, 1, 1.0f),
+        [TUNE_IMUL_WIDE] = TUNE_COST(4, 3, 1.0f),
+        [TUNE_IDIV] = TUNE_COST(15, 5, 5.25f),
+        [TUNE_CDQ] = TUNE_COST(1, 1, 0.38f)
+    }, 15 },
+    { "skylake", {
+        [TUNE_ALU] = TUNE_COST(1, 1, 0.25f),
+        [TUNE_SHIFT] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_MOV] = TUNE_COST(0, 1, 0.25f),
+        [TUNE_LEA_SCALED] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_IMUL] = TUNE_COST(3, 1, 1.0f),
+        [TUNE_IMUL_WIDE] = TUNE_COST(4, 3, 1.0f),
+        [TUNE_IDIV] = TUNE_COST(26, 10, 6.0f),
+        [TUNE_CDQ] = TUNE_COST(1, 1, 0.5f)
+    }, 16 },
+    // move elimination is turned off by microcode, division got fast
+    { "icelake", {
+        [TUNE_ALU] = TUNE_COST(1, 1, 0.25f),
+        [TUNE_SHIFT] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_MOV] = TUNE_COST(1, 1, 0.25f),
+        [TUNE_LEA_SCALED] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_IMUL] = TUNE_COST(3, 1, 1.0f),
+        [TUNE_IMUL_WIDE] = TUNE_COST(4, 3, 1.0f),
+        [TUNE_IDIV] = TUNE_COST(12, 4, 6.0f),
+        [TUNE_CDQ] = TUNE_COST(1, 1, 0.5f)
+    }, 17 },
+    // a scaled index costs lea a cycle
+    { "zen3", {
+        [TUNE_ALU] = TUNE_COST(1, 1, 0.25f),
+        [TUNE_SHIFT] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_MOV] = TUNE_COST(0, 1, 0.17f),
+        [TUNE_LEA_SCALED] = TUNE_COST(2, 1, 0.5f),
+        [TUNE_IMUL] = TUNE_COST(3, 1, 1.0f),
+        [TUNE_IMUL_WIDE] = TUNE_COST(3, 2, 1.0f),
+        [TUNE_IDIV] = TUNE_COST(10, 2, 6.0f),
+        [TUNE_CDQ] = TUNE_COST(1, 1, 0.25f)
+    }, 13 },
+    { "zen4", {
+        [TUNE_ALU] = TUNE_COST(1, 1, 0.25f),
+        [TUNE_SHIFT] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_MOV] = TUNE_COST(0, 1, 0.17f),
+        [TUNE_LEA_SCALED] = TUNE_COST(2, 1, 0.5f),
+        [TUNE_IMUL] = TUNE_COST(3, 1, 1.0f),
+        [TUNE_IMUL_WIDE] = TUNE_COST(3, 2, 1.0f),
+        [TUNE_IDIV] = TUNE_COST(10, 2, 3.0f),
+        [TUNE_CDQ] = TUNE_COST(1, 1, 0.25f)
+    }, 13 },
+    // the small Atom cores, nothing is renamed away
+    { "goldmont", {
+        [TUNE_ALU] = TUNE_COST(1, 1, 0.33f),
+        [TUNE_SHIFT] = TUNE_COST(1, 1, 0.5f),
+        [TUNE_MOV] = TUNE_COST(1, 1, 0.33f),
+        [TUNE_LEA_SCALED] = TUNE_COST(2, 1, 1.0f),
+        [TUNE_IMUL] = TUNE_COST(3, 1, 1.0f),
+        [TUNE_IMUL_WIDE] = TUNE_COST(5, 3, 2.0f),
+        [TUNE_IDIV] = TUNE_COST(25, 3, 19.0f),
+        [TUNE_CDQ] = TUNE_COST(1, 1, 0.5f)
+    }, 13 }
+};
+
+#define TUNE_TABLE_COUNT (sizeof(tune_tables) / sizeof(tune_table_t))
+
+const tune_table_t* tune_lookup(const char* name) {
+    for(size_t i = 0; i < TUNE_TABLE_COUNT; ++i) {
+        if(strcmp(tune_tables[i].name, name) == 0) return &tune_tables[i];
+    }
+    return NULL;
+}
+
+const char* tune_names(void) {
+    static char names[128];
+    if(!names[0]) {
+        for(size_t i = 0; i < TUNE_TABLE_COUNT; ++i) {
+            if(i) strcat(names, "|");
+            strcat(names, tune_tables[i].name);
+        }
+    }
+    return names;
+}
+
+void tune_add(tune_sequence_t* sequence, const tune_table_t* table, tune_insn insn) {
+    sequence->latency += table->costs[insn].latency;
+    sequence->uops += table->costs[insn].uops;
+    sequence->throughput += table->costs[insn].throughput;
+}
+
+bool tune_no_slower(const tune_sequence_t* a, const tune_sequence_t* b) {
+    if(a->latency != b->latency) return a->latency < b->latency;
+    if(a->uops != b->uops) return a->uops < b->uops;
+    return a->throughput <= b->throughput;
+}
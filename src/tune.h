@@ -0,0 +1,69 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "fwd.h"
+
+// Costs of the instructions code generation picks between, one table per core
+// -mtune names. Latencies and reciprocal throughputs are in cycles, from the
+// published per instruction measurements for each core.
+
+// the instructions whose costs differ enough between cores to change a choice:
+// ALU is add, sub, neg, cmp and the logic ops, SHIFT by an immediate, MOV
+// register to register, LEA_SCALED has an index scaled by 2, 4 or 8, IMUL has
+// two or three operands and IMUL_WIDE one, into edx:eax
+#define TUNE_INSN_LIST(__item, _uargs) \
+    __item(ALU, _uargs) \
+    __item(SHIFT, _uargs) \
+    __item(MOV, _uargs) \
+    __item(LEA_SCALED, _uargs) \
+    __item(IMUL, _uargs) \
+    __item(IMUL_WIDE, _uargs) \
+    __item(IDIV, _uargs) \
+    __item(CDQ, _uargs)
+
+enum tune_insn_e {
+    TUNE_INSN_LIST(ENUM_LIST_ITEM, TUNE_)
+    TUNE_INSN_COUNT
+};
+typedef enum tune_insn_e tune_insn;
+
+typedef struct tune_cost_s {
+    uint8_t latency;
+    uint8_t uops;
+    // cycles per instruction when independent ones issue back to back
+    float throughput;
+} tune_cost_t;
+
+typedef struct tune_table_s {
+    // as -mtune= spells it
+    const char* name;
+    tune_cost_t costs[TUNE_INSN_COUNT];
+    // cycles a mispredicted branch throws away
+    uint8_t branch_miss;
+} tune_table_t;
+
+// the table used without -mtune, the mean of the big cores
+#define TUNE_DEFAULT "generic"
+
+// NULL when no core is called name
+const tune_table_t* tune_lookup(const char* name);
+// the names -mtune takes separated by |, for usage messages
+const char* tune_names(void);
+
+// a chain of instructions each depending on the last
+typedef struct tune_sequence_s {
+    unsigned latency;
+    unsigned uops;
+    float throughput;
+} tune_sequence_t;
+
+void tune_add(tune_sequence_t* sequence, const tune_table_t* table, tune_insn insn);
+// whether a is done no later than b, fewer uops deciding equal latencies
+bool tune_no_slower(const tune_sequence_t* a, const tune_sequence_t* b);
+
+#endif
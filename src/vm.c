@@ -0,0 +1,193 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#include "vm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// the registers and frames double as calls go deeper, up to a few times what
+// fits in the 8MB stack native code gets
+#define VM_MIN_REGS 4096
+#define VM_MAX_REGS (1 << 24)
+#define VM_MIN_FRAMES 256
+#define VM_MAX_FRAMES (1 << 22)
+
+// arithmetic wraps like the generated code does, so do it unsigned
+#define VM_WRAP(_a, _op, _b) (int32_t)((uint32_t)(_a) _op (uint32_t)(_b))
+// where idiv would trap
+#define VM_DIVIDE_TRAPS(_a, _b) ((_b) == 0 || ((_b) == -1 && (_a) == INT32_MIN))
+
+#if defined(__GNUC__)
+// each handler jumps straight to the next one's address
+#define VM_LABEL_ITEM(__value, _) &&vm_##__value,
+#define VM_OP(_op) vm_##_op:
+#define VM_BEGIN() goto *vm_labels[pc->opcode];
+#define VM_END()
+#define VM_NEXT() goto *vm_labels[(++pc)->opcode]
+#define VM_JUMP(_target) do { pc = (_target); goto *vm_labels[pc->opcode]; } while(0)
+#else
+#define VM_OP(_op) case BC_##_op:
+#define VM_BEGIN() for(;;) { switch(pc->opcode) {
+#define VM_END() } }
+#define VM_NEXT() { ++pc; continue; }
+#define VM_JUMP(_target) { pc = (_target); continue; }
+#endif
+
+typedef struct vm_frame_s {
+    // the call to return to and the caller's window
+    const bc_insn_t* pc;
+    size_t base;
+} vm_frame_t;
+
+typedef struct vm_stack_s {
+    int32_t* regs;
+    size_t reg_capacity;
+    vm_frame_t* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+} vm_stack_t;
+
+// room for count registers, false past the limit
+static bool vm_reserve(vm_stack_t* stack, size_t count) {
+    if(count <= stack->reg_capacity) return true;
+    size_t capacity = stack->reg_capacity ? stack->reg_capacity : VM_MIN_REGS;
+    while(capacity < count) capacity *= 2;
+    if(capacity > VM_MAX_REGS) return false;
+    stack->regs = (int32_t*)realloc(stack->regs, capacity * sizeof(int32_t));
+    stack->reg_capacity = capacity;
+    return true;
+}
+
+static bool vm_push(vm_stack_t* stack, const bc_insn_t* pc, size_t base) {
+    if(stack->frame_count == stack->frame_capacity) {
+        if(stack->frame_capacity == VM_MAX_FRAMES) return false;
+        stack->frame_capacity = stack->frame_capacity ? stack->frame_capacity * 2 : VM_MIN_FRAMES;
+        stack->frames = (vm_frame_t*)realloc(stack->frames, stack->frame_capacity * sizeof(vm_frame_t));
+    }
+    stack->frames[stack->frame_count].pc = pc;
+    stack->frames[stack->frame_count].base = base;
+    stack->frame_count++;
+    return true;
+}
+
+vm_result vm_run(bc_program_t* program, bc_func_t* func, const int* args, size_t arg_count, int* status) {
+#if defined(__GNUC__)
+    static void* const vm_labels[BC_OPCODE_COUNT] = {
+        BC_OPCODE_LIST(VM_LABEL_ITEM, )
+    };
+#endif
+    const bc_insn_t* code = program->insns;
+    vm_stack_t stack;
+    memset(&stack, 0, sizeof(vm_stack_t));
+    vm_result result = VM_RETURNED;
+
+    if(!vm_reserve(&stack, func->reg_count > arg_count ? func->reg_count : arg_count)) return VM_STACK_OVERFLOW;
+    for(size_t i = 0; i < func->param_count; ++i)
+        stack.regs[i] = i < arg_count ? args[i] : 0;
+
+    size_t base = 0;
+    int32_t* regs = stack.regs;
+    const bc_insn_t* pc = &code[func->entry];
+    bc_func_t* callee;
+    bc_switch_t* sw;
+    int32_t value;
+
+    VM_BEGIN()
+    VM_OP(CONST) regs[pc->a] = pc->c; VM_NEXT();
+    VM_OP(MOV) regs[pc->a] = regs[pc->b]; VM_NEXT();
+    VM_OP(NEG) regs[pc->a] = VM_WRAP(0, -, regs[pc->b]); VM_NEXT();
+    VM_OP(NOT) regs[pc->a] = ~regs[pc->b]; VM_NEXT();
+    VM_OP(LNOT) regs[pc->a] = !regs[pc->b]; VM_NEXT();
+
+    VM_OP(ADD) regs[pc->a] = VM_WRAP(regs[pc->b], +, regs[pc->c]); VM_NEXT();
+    VM_OP(SUB) regs[pc->a] = VM_WRAP(regs[pc->b], -, regs[pc->c]); VM_NEXT();
+    VM_OP(MUL) regs[pc->a] = VM_WRAP(regs[pc->b], *, regs[pc->c]); VM_NEXT();
+    VM_OP(DIV)
+        if(VM_DIVIDE_TRAPS(regs[pc->b], regs[pc->c])) goto divide_error;
+        regs[pc->a] = regs[pc->b] / regs[pc->c];
+        VM_NEXT();
+    VM_OP(EQ) regs[pc->a] = regs[pc->b] == regs[pc->c]; VM_NEXT();
+    VM_OP(NE) regs[pc->a] = regs[pc->b] != regs[pc->c]; VM_NEXT();
+    VM_OP(LT) regs[pc->a] = regs[pc->b] < regs[pc->c]; VM_NEXT();
+    VM_OP(LE) regs[pc->a] = regs[pc->b] <= regs[pc->c]; VM_NEXT();
+    VM_OP(GT) regs[pc->a] = regs[pc->b] > regs[pc->c]; VM_NEXT();
+    VM_OP(GE) regs[pc->a] = regs[pc->b] >= regs[pc->c]; VM_NEXT();
+
+    VM_OP(ADDI) regs[pc->a] = VM_WRAP(regs[pc->b], +, pc->c); VM_NEXT();
+    VM_OP(SUBI) regs[pc->a] = VM_WRAP(regs[pc->b], -, pc->c); VM_NEXT();
+    VM_OP(MULI) regs[pc->a] = VM_WRAP(regs[pc->b], *, pc->c); VM_NEXT();
+    VM_OP(DIVI)
+        if(VM_DIVIDE_TRAPS(regs[pc->b], pc->c)) goto divide_error;
+        regs[pc->a] = regs[pc->b] / pc->c;
+        VM_NEXT();
+    VM_OP(EQI) regs[pc->a] = regs[pc->b] == pc->c; VM_NEXT();
+    VM_OP(NEI) regs[pc->a] = regs[pc->b] != pc->c; VM_NEXT();
+    VM_OP(LTI) regs[pc->a] = regs[pc->b] < pc->c; VM_NEXT();
+    VM_OP(LEI) regs[pc->a] = regs[pc->b] <= pc->c; VM_NEXT();
+    VM_OP(GTI) regs[pc->a] = regs[pc->b] > pc->c; VM_NEXT();
+    VM_OP(GEI) regs[pc->a] = regs[pc->b] >= pc->c; VM_NEXT();
+
+    VM_OP(JMP) VM_JUMP(&code[pc->c]);
+    VM_OP(JZ)
+        if(!regs[pc->b]) VM_JUMP(&code[pc->c]);
+        VM_NEXT();
+    VM_OP(JNZ)
+        if(regs[pc->b]) VM_JUMP(&code[pc->c]);
+        VM_NEXT();
+
+    // the callee's window starts at the arguments
+    VM_OP(CALL)
+        callee = &program->funcs[pc->c];
+        if(!vm_reserve(&stack, base + pc->b + callee->reg_count) || !vm_push(&stack, pc, base)) goto stack_overflow;
+        base += pc->b;
+        regs = stack.regs + base;
+        VM_JUMP(&code[callee->entry]);
+    VM_OP(TAILCALL)
+        callee = &program->funcs[pc->c];
+        memmove(regs, &regs[pc->b], callee->param_count * sizeof(int32_t));
+        if(!vm_reserve(&stack, base + callee->reg_count)) goto stack_overflow;
+        regs = stack.regs + base;
+        VM_JUMP(&code[callee->entry]);
+    VM_OP(RET)
+        value = regs[pc->b];
+        if(!stack.frame_count) {
+            *status = value;
+            goto done;
+        }
+        stack.frame_count--;
+        pc = stack.frames[stack.frame_count].pc;
+        base = stack.frames[stack.frame_count].base;
+        regs = stack.regs + base;
+        regs[pc->a] = value;
+        VM_NEXT();
+
+    VM_OP(SWITCH) {
+        sw = &program->switches[pc->c];
+        value = regs[pc->b];
+        size_t lo = 0, hi = sw->case_count, target = sw->default_target;
+        while(lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if(sw->cases[mid].value == value) {
+                target = sw->cases[mid].target;
+                break;
+            }
+            if(sw->cases[mid].value < value) lo = mid + 1;
+            else hi = mid;
+        }
+        VM_JUMP(&code[target]);
+    }
+    VM_END()
+
+divide_error:
+    result = VM_DIVIDE_ERROR;
+    goto done;
+stack_overflow:
+    result = VM_STACK_OVERFLOW;
+done:
+    free(stack.regs);
+    free(stack.frames);
+    return result;
+}
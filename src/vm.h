@@ -0,0 +1,26 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Copyright (c) 2026 Adam Warren
+ */
+#ifndef VM_H
+#define VM_H
+
+#include "fwd.h"
+#include "bytecode.h"
+
+// The interpreter for bytecode programs, dispatching through a table of label
+// addresses where the compiler has computed goto and through a switch elsewhere.
+
+typedef enum vm_result_e {
+    VM_RETURNED,
+    // division by zero or of the smallest int by -1, where idiv traps
+    VM_DIVIDE_ERROR,
+    // the calls went deeper than the registers can grow
+    VM_STACK_OVERFLOW
+} vm_result;
+
+// call func with args, missing parameters start as 0, status is what it returned
+vm_result vm_run(bc_program_t* program, bc_func_t* func, const int* args, size_t arg_count, int* status);
+
+#endif
@@ -0,0 +1,5 @@
+int down(int n, int acc) {
+    switch(n) { case 0: return acc; }
+    return down(n - 1, acc + 3);
+}
+int main(int argc) { return down(argc * 10000000, 0) - 29999958; }
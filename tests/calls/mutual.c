@@ -0,0 +1,10 @@
+int odd(int n);
+int even(int n) {
+    switch(n) { case 0: return 1; }
+    return odd(n - 1);
+}
+int odd(int n) {
+    switch(n) { case 0: return 0; }
+    return even(n - 1);
+}
+int main(int argc) { return even(argc * 5000001) + odd(argc * 3000000) * 2 + even(argc * 4000000) * 4; }
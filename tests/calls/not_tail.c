@@ -0,0 +1,6 @@
+int depth(int n) {
+    switch(n) { case 0: return 0; }
+    return 1 + depth(n - 1);
+}
+int twice(int n) { return depth(n) + depth(n); }
+int main(int argc) { return twice(argc * 100) + depth(argc + 4); }
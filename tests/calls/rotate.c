@@ -0,0 +1,9 @@
+int rot(int n, int a, int b, int c) {
+    switch(n) { case 0: return a * 100 + b * 10 + c; }
+    return rot(n - 1, b, c, a);
+}
+int swap(int n, int a, int b) {
+    switch(n) { case 0: return a - b; }
+    return swap(n - 1, b, a);
+}
+int main(int argc) { return rot(argc * 3000001, 1, 2, 3) - swap(argc * 2000001, 7, 2) - 200; }
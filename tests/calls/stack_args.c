@@ -0,0 +1,7 @@
+int sum(int n, int a, int b, int c, int d, int e, int f, int g, int h) {
+    switch(n) { case 0: return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8; }
+    return sum(n - 1, h, a, b, c, d, e, f, g);
+}
+int other(int a, int b, int c, int d, int e, int f, int g, int h) { return a - b + c - d + e - f + g - h * 2; }
+int call(int x) { return other(x, 2, 3, 4, 5, 6, 7, x + 1); }
+int main(int argc) { return sum(argc * 1000003, 1, 2, 3, 4, 5, 6, 7, 8) + call(argc + 10); }
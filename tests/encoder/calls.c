@@ -0,0 +1,15 @@
+int many(int a, int b, int c, int d, int e, int f, int g, int h, int i) {
+    return a - b * 2 + c * 3 - d * 4 + e * 5 - f * 6 + g * 7 - h * 8 + i * 9;
+}
+int fact(int n) {
+    switch(n) { case 0: return 1; }
+    return n * fact(n - 1);
+}
+int gcd(int a, int b) {
+    switch(b) { case 0: return a; }
+    return gcd(b, a - a / b * b);
+}
+int mix(int x) { return x * 8 - x / 2 + x / 7 - ~x + -x / (0 - 3); }
+int main(int argc) {
+    return many(argc, 2, 3, 4, 5, 6, 7, 8, 9) + fact(argc + 4) + gcd(1071, 462) + mix(argc * 1000) / 100;
+}
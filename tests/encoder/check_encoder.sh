@@ -0,0 +1,87 @@
+#!/bin/bash
+# usage: check_encoder.sh <hcc> [hcc flags...]
+#
+# Compiles each sample here to an object with hcc -c and to assembly with
+# hcc -S, then checks GNU as turns that assembly into the same instructions,
+# relocations and data as hcc's own encoder. Each object is also linked,
+# with the sample's _driver.c when it has one, and must print and return
+# what gcc's build of the sample does.
+
+HCC=$1
+shift
+if [ -z "$HCC" ]; then
+    echo "usage: $0 <hcc> [hcc flags...]"
+    exit 1
+fi
+HCC=$(realpath "$HCC")
+cd "$(dirname "$0")"
+
+AS_FLAGS=--64
+CC_FLAGS=
+for flag in "$@"; do
+    if [ "$flag" = "-m32" ]; then
+        AS_FLAGS=--32
+        CC_FLAGS=-m32
+    fi
+done
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# everything after the line naming the file
+dump() {
+    objdump "$@" | tail -n +4
+}
+
+passed=0
+failed=0
+fail() {
+    echo "FAIL $1: $2"
+    failed=$((failed + 1))
+}
+
+for source in *.c; do
+    case $source in *_driver.c) continue;; esac
+    name=${source%.c}
+    driver=
+    [ -f "${name}_driver.c" ] && driver=${name}_driver.c
+
+    if ! "$HCC" "$@" -S "$source" -o "$WORK/$name.s" > "$WORK/$name.log" ||
+       ! "$HCC" "$@" -c "$source" -o "$WORK/$name.o" >> "$WORK/$name.log"; then
+        fail "$name" "hcc failed"
+        cat "$WORK/$name.log"
+        continue
+    fi
+    if ! as $AS_FLAGS "$WORK/$name.s" -o "$WORK/$name.as.o"; then
+        fail "$name" "as rejected hcc's assembly"
+        continue
+    fi
+
+    if ! diff -u <(dump -dr "$WORK/$name.as.o") <(dump -dr "$WORK/$name.o") > "$WORK/$name.diff"; then
+        fail "$name" "instructions differ from as"
+        head -20 "$WORK/$name.diff"
+        continue
+    fi
+    if ! diff -u <(dump -s -j .rodata -j .data "$WORK/$name.as.o" 2>/dev/null) \
+                 <(dump -s -j .rodata -j .data "$WORK/$name.o" 2>/dev/null) > "$WORK/$name.diff"; then
+        fail "$name" "data differs from as"
+        head -20 "$WORK/$name.diff"
+        continue
+    fi
+
+    if ! gcc $CC_FLAGS -w "$source" $driver -o "$WORK/$name.ref" ||
+       ! gcc $CC_FLAGS -w "$WORK/$name.o" $driver -o "$WORK/$name"; then
+        fail "$name" "link failed"
+        continue
+    fi
+    expected=$("$WORK/$name.ref"; echo "exit $?")
+    got=$("$WORK/$name"; echo "exit $?")
+    if [ "$expected" != "$got" ]; then
+        fail "$name" "expected $(echo $expected) got $(echo $got)"
+        continue
+    fi
+    passed=$((passed + 1))
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" = 0 ]
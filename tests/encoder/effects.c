@@ -0,0 +1,4 @@
+int putchar(int c);
+int both(int a, int b) { return a && b; }
+int first(int a, int b) { return a; }
+int main(int argc) { return both(argc - 1, putchar(65)) + first(3, putchar(65)); }
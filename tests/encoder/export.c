@@ -0,0 +1,5 @@
+int f(int a) {
+    switch(a) { case 100: return 1; }
+    return a + a * 2 + a * a;
+}
+int g(int x) { return f(3) + x; }
@@ -0,0 +1,3 @@
+int f(int a);
+int g(int x);
+int main() { return (f(10) == 130) + (g(1) == 19) * 2; }
@@ -0,0 +1,6 @@
+int f0(int a, int b, int c) { return !(c + 1 != 0 || c != 0 || 3 && 0 != c && c || (a - b || b)); }
+int f1(int a, int b, int c) { return (a < b) + (b <= c) * 2 + (a > c) * 4 + (b >= a) * 8 + (a == c) * 16 + (b != c) * 32; }
+int f2(int a, int b, int c) { return a && b || !c && (a - b || b - c); }
+int main(int argc) {
+    return f0(argc, 2, 3) + f1(argc, 5, 1) + f1(7, argc, argc) + f2(argc, 0, 1) * 64 + f2(0, argc, 0) * 128;
+}
@@ -0,0 +1,28 @@
+int dense(int x) {
+    switch(x) {
+    case 0: return 3;
+    case 1: return 14;
+    case 2: return 15;
+    case 3: return 92;
+    case 4: return 65;
+    case 5: return 35;
+    case 6: return 89;
+    case 7: return 79;
+    case 8: return 32;
+    default: return 38;
+    }
+}
+int sparse(int x) {
+    switch(x) {
+    case -5000: return 1;
+    case 100: return 2;
+    case 3000: return 3;
+    case 7000: return 4;
+    case 45000: return 5;
+    case 100000: return 6;
+    }
+    return 7;
+}
+int main(int argc) {
+    return dense(argc) + dense(argc + 3) + dense(argc + 20) + sparse(argc * 3000) + sparse(argc * 7000) + sparse(argc);
+}
@@ -0,0 +1,5 @@
+int many(int a, int b, int c, int d, int e, int f, int g, int h, int i, int j) {
+    return a - b * 2 + c * 3 - d * 4 + e * 5 - f * 6 + g * 7 - h * 8 + i * 9 - j * 10;
+}
+int pass(int a, int b, int c) { return many(c, b, a, a + b, b + c, c + a, a * b, b * c, c * a, a + b + c); }
+int main(int argc) { return pass(argc, argc + 1, argc + 2) + many(1, 2, 3, 4, 5, 6, 7, 8, 9, argc); }
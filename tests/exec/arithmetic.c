@@ -0,0 +1,3 @@
+int f(int a, int b) { return (a + b) * (a - b) - -a + ~b + !a + !!b; }
+int wrap(int a) { return a + 2147483647; }
+int main(int argc) { return f(argc + 10, argc + 3) + (wrap(argc) < 0) * 100 + (wrap(argc - 1) > 0); }
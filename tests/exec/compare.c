@@ -0,0 +1,2 @@
+int c(int a, int b) { return (a < b) + (a <= b) * 2 + (a > b) * 4 + (a >= b) * 8 + (a == b) * 16 + (a != b) * 32; }
+int main(int argc) { return c(argc, 2) + c(argc - 2, argc) + c(-argc, -argc) * 3 + (c(-2147483647 - argc, argc) == 35) * 64; }
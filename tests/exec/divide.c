@@ -0,0 +1,2 @@
+int d(int a, int b) { return a / b; }
+int main(int argc) { return d(-7, 2 * argc) + d(7, -2 * argc) * 3 + d(-2147483647 - 1, 3 * argc) / 1000000 + d(100 * argc, 7) + 50; }
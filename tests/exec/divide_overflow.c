@@ -0,0 +1,2 @@
+int d(int a, int b) { return a / b; }
+int main(int argc) { return d(-2147483647 - argc, -argc); }
@@ -0,0 +1,9 @@
+int fib(int n) {
+    switch(n) { case 0: return 0; case 1: return 1; }
+    return fib(n - 1) + fib(n - 2);
+}
+int depth(int n) {
+    switch(n) { case 0: return 0; }
+    return 1 + depth(n - 1);
+}
+int main(int argc) { return fib(argc + 19) + depth(argc * 10000); }
@@ -0,0 +1,2 @@
+int f(int x);
+int main(int argc) { return f(argc); }
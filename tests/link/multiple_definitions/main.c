@@ -0,0 +1,2 @@
+int f(int x) { return x + 1; }
+int main(int argc) { return f(argc); }
@@ -0,0 +1,2 @@
+static int helper(int x) { return x * 3; }
+int fb(int x) { return helper(x) + helper(1); }
@@ -0,0 +1,3 @@
+int fa(int x);
+int fb(int x);
+int main(int argc) { return fa(argc + 4) * 10 + fb(argc + 1); }
@@ -0,0 +1,3 @@
+static int helper(int x);
+int fa(int x) { return helper(x) + 1; }
+static int helper(int x) { return x * 2; }
@@ -0,0 +1,3 @@
+int fa(int x);
+static int helper(int x) { return x + 50; }
+int main(int argc) { return fa(argc + 2) + helper(argc); }
@@ -0,0 +1,2 @@
+static int helper(int x) { return x * 5; }
+int fb(int x) { return helper(x); }
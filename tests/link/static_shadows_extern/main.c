@@ -0,0 +1,4 @@
+int helper(int x);
+int fa(int x);
+int fb(int x);
+int main(int argc) { return fa(argc + 9) + fb(argc) * 10 + helper(argc + 100); }
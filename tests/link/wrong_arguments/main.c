@@ -0,0 +1,2 @@
+int f(int x, int y) { return x + y; }
+int main(int argc) { return f(argc); }
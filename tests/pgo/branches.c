@@ -0,0 +1,13 @@
+int classify(int x) {
+    switch(x) {
+    case 0: case 1: case 2: return 1;
+    case 7: return 2;
+    case 100: case 200: case 300: return 3;
+    }
+    return (x > 50 && x < 60) || x == 1000;
+}
+int walk(int n, int acc) {
+    switch(n) { case 0: return acc; }
+    return walk(n - 1, acc + classify(n - n / 400 * 400));
+}
+int main(int argc) { return walk(argc * 100000, 0) - 1000 * 0; }
@@ -0,0 +1,11 @@
+int cold(int x) { return x * 7 - 3; }
+int hot(int x) { return x + 1; }
+int pick(int x) {
+    switch(x) { case 999: return cold(x); }
+    return hot(x);
+}
+int loop(int n, int acc) {
+    switch(n) { case 0: return acc; }
+    return loop(n - 1, acc + pick(n));
+}
+int main(int argc) { return loop(argc * 50000, 0); }
@@ -0,0 +1,111 @@
+#!/bin/bash
+# usage: check_pgo.sh <hcc> [hcc flags...]
+#
+# Builds each program in expected with -fprofile-generate, runs it to write its
+# profile and builds it again with -fprofile-use. Both builds must return the
+# expected status, and the second must take the profile as it is. Then the
+# profile is damaged a few ways: each build must say the profile is bad and
+# still return the expected status without it.
+
+HCC=$1
+shift
+if [ -z "$HCC" ]; then
+    echo "usage: $0 <hcc> [hcc flags...]"
+    exit 1
+fi
+HCC=$(realpath "$HCC")
+FLAGS=("$@")
+cd "$(dirname "$0")"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+fail() {
+    echo "FAIL pgo/$1 $2"
+    failed=$((failed + 1))
+}
+
+# build with the profile at $WORK/name.profile, check what hcc says and what the program returns
+use() {
+    local name=$1 expected=$2 case=$3 says=$4
+    if ! "$HCC" "${FLAGS[@]}" -fprofile-use "$name.c" -o "$WORK/$name" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "$case: hcc failed"
+        return
+    fi
+    if [ -n "$says" ] && ! grep -q "$says" "$WORK/$name.log"; then
+        fail "$name" "$case: expected hcc to say $says"
+        return
+    fi
+    if [ -z "$says" ] && grep -q "profile" "$WORK/$name.log"; then
+        fail "$name" "$case: $(head -1 "$WORK/$name.log")"
+        return
+    fi
+    "$WORK/$name" < /dev/null > /dev/null 2>&1
+    local got=$?
+    if [ "$got" != "$expected" ]; then
+        fail "$name" "$case: expected $expected got $got"
+        return
+    fi
+    passed=$((passed + 1))
+}
+
+# write the u32 value little endian at offset of file
+poke() {
+    printf "$(printf '\\x%02x\\x%02x\\x%02x\\x%02x' $(($3 & 255)) $(($3 >> 8 & 255)) $(($3 >> 16 & 255)) $(($3 >> 24 & 255)))" |
+        dd of="$1" bs=1 seek="$2" conv=notrunc status=none
+}
+
+while read -r name expected; do
+    [ -z "$name" ] && continue
+    profile=$WORK/$name.profile
+    rm -f "$profile"
+
+    if ! "$HCC" "${FLAGS[@]}" -fprofile-generate "$name.c" -o "$WORK/$name" > "$WORK/$name.log" 2>&1; then
+        fail "$name" "-fprofile-generate: hcc failed"
+        continue
+    fi
+    "$WORK/$name" < /dev/null > /dev/null 2>&1
+    got=$?
+    if [ "$got" != "$expected" ] || [ ! -s "$profile" ]; then
+        fail "$name" "-fprofile-generate: expected $expected and a profile, got $got"
+        continue
+    fi
+    passed=$((passed + 1))
+    cp "$profile" "$WORK/good"
+
+    use "$name" "$expected" "-fprofile-use" ""
+
+    # the header is the magic, the probe and function counts, then the length
+    # of the first function's name, the name, its first probe and probe count
+    length=$(od -An -tu4 -j 16 -N 4 "$WORK/good" | tr -d ' ')
+
+    head -c 30 "$WORK/good" > "$profile"
+    use "$name" "$expected" "truncated" "Truncated profile\|Invalid profile"
+
+    cp "$WORK/good" "$profile"
+    poke "$profile" 12 4294967295
+    use "$name" "$expected" "too many functions" "Invalid profile"
+
+    cp "$WORK/good" "$profile"
+    poke "$profile" 8 4294967295
+    use "$name" "$expected" "too many probes" "Invalid profile"
+
+    cp "$WORK/good" "$profile"
+    poke "$profile" $((20 + length)) 0
+    use "$name" "$expected" "probes from 0" "Invalid profile"
+
+    cp "$WORK/good" "$profile"
+    poke "$profile" $((24 + length)) 4294967295
+    use "$name" "$expected" "probes past the end" "Invalid profile"
+
+    printf 'NOTAPROFILE' > "$profile"
+    use "$name" "$expected" "wrong magic" "Invalid profile"
+
+    rm -f "$profile"
+    use "$name" "$expected" "missing" "Failed to open profile"
+done < expected
+
+echo "pgo $*: $passed passed, $failed failed"
+[ "$failed" = 0 ]
@@ -0,0 +1,63 @@
+#!/bin/bash
+# usage: run_tests.sh <hcc> <suite> [hcc flags...]
+#
+# Builds each test the suite's expected file names with hcc and checks the
+# status it exits with. A line of expected is a name and a status, or error
+# when hcc must reject the program. The test is name.c, or every .c file in
+# the directory name when it spans several files. With --run or --interp
+# among the flags hcc runs the program itself, once it has built it.
+
+HCC=$1
+SUITE=$2
+shift 2
+if [ -z "$HCC" ] || [ ! -f "$SUITE/expected" ]; then
+    echo "usage: $0 <hcc> <suite> [hcc flags...]"
+    exit 1
+fi
+HCC=$(realpath "$HCC")
+cd "$SUITE"
+
+# the program is built with the other flags first, so both ways reject the same programs
+RUN=
+FLAGS=()
+for flag in "$@"; do
+    case $flag in
+        --run|--interp) RUN=$flag;;
+        *) FLAGS+=("$flag");;
+    esac
+done
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+while read -r name expected; do
+    [ -z "$name" ] && continue
+    if [ -d "$name" ]; then
+        sources=("$name"/*.c)
+    else
+        sources=("$name.c")
+    fi
+
+    if ! "$HCC" "${FLAGS[@]}" "${sources[@]}" -o "$WORK/$name" > "$WORK/$name.log" 2>&1; then
+        got=error
+    elif [ -n "$RUN" ]; then
+        # a trap is a status like any other, not worth the shell's message
+        { "$HCC" "${FLAGS[@]}" $RUN "${sources[@]}" < /dev/null > /dev/null; } 2> /dev/null
+        got=$?
+    else
+        { "$WORK/$name" < /dev/null > /dev/null; } 2> /dev/null
+        got=$?
+    fi
+
+    if [ "$expected" = "$got" ]; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL $(basename "$SUITE")/$name $*: expected $expected got $got"
+        failed=$((failed + 1))
+    fi
+done < expected
+
+echo "$(basename "$SUITE") $*: $passed passed, $failed failed"
+[ "$failed" = 0 ]
@@ -0,0 +1,18 @@
+int f(int x) {
+    switch(x) {
+    case -2147483647 - 1: return 1;
+    case -5000: return 2;
+    case -7: return 3;
+    case 100: return 4;
+    case 3000: return 5;
+    case 7000: return 6;
+    case 45000: return 7;
+    case 100000: return 8;
+    case 2147483647: return 9;
+    }
+    return 10;
+}
+int main(int argc) {
+    return f(argc * (-2147483647) - 1) + f(argc * -5000) * 2 + f(argc - 8) + f(argc * 100) + f(argc * 3000)
+        + f(argc * 7001) * 3 + f(argc * 45000) + f(argc * 100000) * 4 + f(argc * 2147483647) * 5 + f(argc + 99);
+}
@@ -0,0 +1,20 @@
+int f(int x) {
+    switch(x) {
+    case 1: case 3: case 5: case 7: case 11: case 13: case 29:
+        return 1;
+    case 2: case 4: case 8: case 16: case 30:
+        return 2;
+    }
+    return 0;
+}
+int g(int x) {
+    switch(x) {
+    case 33: case 40: case 47: case 60: return 5;
+    case 34: case 61: return 6;
+    default: return 7;
+    }
+}
+int main(int argc) {
+    return f(argc) + f(argc + 1) * 3 + f(argc + 5) * 9 + f(argc + 28) * 27 + f(argc + 29) * 81 + f(argc - 1) + f(argc + 31)
+        + g(argc + 32) + g(argc + 33) * 2 + g(argc + 34) * 3 + g(argc + 60) * 4;
+}
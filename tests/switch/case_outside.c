@@ -0,0 +1,2 @@
+int f(int x) { case 1: return 4; }
+int main(int argc) { return f(argc); }
@@ -0,0 +1,12 @@
+int f(int x) {
+    switch(x) {
+    case 1: return 4;
+    case 2: return 5;
+    case 3: return 6;
+    }
+    return 7;
+}
+int main(int argc) {
+    switch(2) { case 1: return 1; case 2: break; default: return 3; }
+    return f(3) + f(9) * 2 + f(1) * 3;
+}
@@ -0,0 +1,2 @@
+int f(int x) { switch(x) { case 1: return 4; case 1: return 5; } return 0; }
+int main(int argc) { return f(1); }
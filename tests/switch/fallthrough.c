@@ -0,0 +1,14 @@
+int f(int x) {
+    switch(x) {
+    case 1:
+    case 2:
+        switch(x) { case 2: return 20; }
+    default:
+        switch(x) { case 1: return 10; }
+        break;
+    case 3:
+        return 30;
+    }
+    return 40;
+}
+int main(int argc) { return f(argc) + f(argc + 1) + f(argc + 2) + f(argc + 3); }
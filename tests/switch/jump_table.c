@@ -0,0 +1,17 @@
+int f(int x) {
+    switch(x) {
+    case 0: return 3;
+    case 1: return 14;
+    case 2: return 15;
+    case 3: return 92;
+    case 5: return 65;
+    case 6: return 35;
+    case 7: return 89;
+    case 8: return 79;
+    case 9: return 32;
+    default: return 38;
+    }
+}
+int main(int argc) {
+    return f(argc - 2) + f(argc - 1) + f(argc) * 2 + f(argc + 3) + f(argc + 4) * 3 + f(argc + 8) + f(argc + 9) - f(argc + 4000);
+}
@@ -0,0 +1,19 @@
+int f(int x) {
+    switch(x) {
+    case 10: return 1;
+    case 11: return 2;
+    case 12: return 3;
+    case 13: return 4;
+    case 14: return 5;
+    case 15: return 6;
+    case 16: return 7;
+    case 500: return 8;
+    case 900: case 902: case 904: case 906: return 9;
+    case 90000: return 10;
+    default: return 11;
+    }
+}
+int main(int argc) {
+    return f(argc + 9) + f(argc + 12) * 2 + f(argc + 15) * 3 + f(argc + 16) + f(argc + 499) * 4 + f(argc + 903) * 5
+        + f(argc + 901) * 6 + f(argc + 89999) * 7 + f(argc - 1) * 8;
+}
@@ -0,0 +1,16 @@
+int f(int x, int y) {
+    switch(x) {
+    case 1:
+        switch(y) {
+        case 1: return 11;
+        case 2: break;
+        default: return 19;
+        }
+        return 12;
+    case 2:
+        switch(y) { case 1: return 21; }
+        break;
+    }
+    return 99;
+}
+int main(int argc) { return f(argc, argc) + f(argc, argc + 1) + f(argc, argc + 5) + f(argc + 1, argc) + f(argc + 1, argc + 1) - 200; }
@@ -0,0 +1,2 @@
+int f(int x) { switch(x) { case 1: return 4; default: return 5; case 2: default: return 6; } }
+int main(int argc) { return f(argc); }
@@ -0,0 +1,4 @@
+int f(int x) { switch(x) case 1: return 2; return 3; }
+int g(int x) { switch(x) case 1: case 2: default: return 4; return 5; }
+int h(int x) { switch(x) switch(x + 1) case 3: return 6; return 7; }
+int main(int argc) { return f(argc + 4) + f(argc) * 10 + g(argc + 8) * 100 + h(argc + 1) + h(argc); }